@@ -4,7 +4,7 @@
 
 #include "Utility/stb_image.h"
 
-#include "meshoptimizer/meshoptimizer.h"
+#include "Utility/meshoptimizer/meshoptimizer.h"
 
 #include <string>
 
@@ -77,7 +77,7 @@ struct TerraGen : public wi::gui::Window
 void MeshWindow::Create(EditorComponent* editor)
 {
 	wi::gui::Window::Create("Mesh Window");
-	SetSize(XMFLOAT2(580, 580));
+	SetSize(XMFLOAT2(580, 620));
 
 	float x = 150;
 	float y = 0;
@@ -371,12 +371,46 @@ void MeshWindow::Create(EditorComponent* editor)
 
 			mesh->indices = indices;
 
+			if (!mesh->meshlets.empty())
+			{
+				mesh->BuildMeshlets();
+			}
+
 			mesh->CreateRenderData();
 			SetEntity(entity, subset);
 		}
 		});
 	AddWidget(&optimizeButton);
 
+	lodgenButton.Create("LOD Gen");
+	lodgenButton.SetTooltip("Generate LODs (levels of detail) with the meshoptimizer library.\nEvery LOD level will have half the triangles of the previous one.");
+	lodgenButton.SetSize(XMFLOAT2(240, hei));
+	lodgenButton.SetPos(XMFLOAT2(x - 50, y += step));
+	lodgenButton.OnClick([&](wi::gui::EventArgs args) {
+		MeshComponent* mesh = wi::scene::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->GenerateLODs(6);
+			SetEntity(entity, subset);
+		}
+		});
+	AddWidget(&lodgenButton);
+
+	meshletButton.Create("Build Meshlets");
+	meshletButton.SetTooltip("Split the mesh into small clusters that can be culled individually when rendering.\nThis is only used for non-instanced, non-deforming meshes.");
+	meshletButton.SetSize(XMFLOAT2(240, hei));
+	meshletButton.SetPos(XMFLOAT2(x - 50, y += step));
+	meshletButton.OnClick([&](wi::gui::EventArgs args) {
+		MeshComponent* mesh = wi::scene::GetScene().meshes.GetComponent(entity);
+		if (mesh != nullptr)
+		{
+			mesh->BuildMeshlets();
+			mesh->CreateRenderData();
+			SetEntity(entity, subset);
+		}
+		});
+	AddWidget(&meshletButton);
+
 
 	// Right side:
 
@@ -662,15 +696,17 @@ void MeshWindow::SetEntity(Entity entity, int subset)
 		ss += "Vertex count: " + std::to_string(mesh->vertex_positions.size()) + "\n";
 		ss += "Index count: " + std::to_string(mesh->indices.size()) + "\n";
 		ss += "Subset count: " + std::to_string(mesh->subsets.size()) + "\n";
+		ss += "LOD count: " + std::to_string(mesh->GetLODCount()) + "\n";
+		ss += "Meshlet count: " + std::to_string(mesh->meshlets.size()) + "\n";
 		ss += "\nVertex buffers: ";
-		if (mesh->vertexBuffer_POS.IsValid()) ss += "position; ";
-		if (mesh->vertexBuffer_UV0.IsValid()) ss += "uvset_0; ";
-		if (mesh->vertexBuffer_UV1.IsValid()) ss += "uvset_1; ";
-		if (mesh->vertexBuffer_ATL.IsValid()) ss += "atlas; ";
-		if (mesh->vertexBuffer_COL.IsValid()) ss += "color; ";
+		if (mesh->GetVertexView(MeshComponent::VERTEX_STREAM_POS).IsValid()) ss += "position; ";
+		if (mesh->GetVertexView(MeshComponent::VERTEX_STREAM_UV0).IsValid()) ss += "uvset_0; ";
+		if (mesh->GetVertexView(MeshComponent::VERTEX_STREAM_UV1).IsValid()) ss += "uvset_1; ";
+		if (mesh->GetVertexView(MeshComponent::VERTEX_STREAM_ATL).IsValid()) ss += "atlas; ";
+		if (mesh->GetVertexView(MeshComponent::VERTEX_STREAM_COL).IsValid()) ss += "color; ";
 		if (mesh->vertexBuffer_PRE.IsValid()) ss += "previous_position; ";
-		if (mesh->vertexBuffer_BON.IsValid()) ss += "bone; ";
-		if (mesh->vertexBuffer_TAN.IsValid()) ss += "tangent; ";
+		if (mesh->GetVertexView(MeshComponent::VERTEX_STREAM_BON).IsValid()) ss += "bone; ";
+		if (mesh->GetVertexView(MeshComponent::VERTEX_STREAM_TAN).IsValid()) ss += "tangent; ";
 		if (mesh->streamoutBuffer_POS.IsValid()) ss += "streamout_position; ";
 		if (mesh->streamoutBuffer_TAN.IsValid()) ss += "streamout_tangents; ";
 		if (mesh->subsetBuffer.IsValid()) ss += "subset; ";
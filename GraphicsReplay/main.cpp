@@ -0,0 +1,48 @@
+// Command line tool that replays a graphics recording without a GPU and prints call statistics per pass
+//	The recording can be made by starting the application with the "graphicsrecord" argument
+//	Usage: GraphicsReplay <recording file> [repeat count]
+#include "wiGraphicsDevice_Null.h"
+#include "wiGraphicsDevice_Recorder.h"
+#include "wiHelper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::printf("Usage: GraphicsReplay <recording file> [repeat count]\n");
+		return 1;
+	}
+
+	wi::vector<uint8_t> data;
+	if (!wi::helper::FileRead(argv[1], data))
+	{
+		std::printf("Couldn't read file: %s\n", argv[1]);
+		return 1;
+	}
+
+	int repeat = argc > 2 ? std::max(1, std::atoi(argv[2])) : 1;
+
+	// The CPU time of the best run is reported, to reduce noise when comparing results:
+	wi::graphics::GraphicsReplayStats best;
+	for (int i = 0; i < repeat; ++i)
+	{
+		wi::graphics::GraphicsDevice_Null device;
+		wi::graphics::GraphicsReplayStats stats;
+		if (!wi::graphics::ReplayGraphicsRecording(data.data(), data.size(), &device, stats))
+		{
+			std::printf("Replay failed: %s\n", argv[1]);
+			return 1;
+		}
+		if (i == 0 || stats.total.cpu_milliseconds < best.total.cpu_milliseconds)
+		{
+			best = std::move(stats);
+		}
+	}
+
+	std::printf("%s", best.ToString().c_str());
+	return 0;
+}
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "Tests.h"
+#include "wiGraphicsDevice_Null.h"
 
 #include <string>
 #include <fstream>
@@ -25,6 +26,32 @@ void Tests::Initialize()
 
 	ActivatePath(&renderer);
 }
+int Tests::RunHeadless(int test, uint32_t frames)
+{
+	graphicsDevice = std::make_unique<wi::graphics::GraphicsDevice_Null>();
+	SetWindow(nullptr);
+
+	// Only the loading screen is rendered until the engine is initialized, these frames are not counted:
+	do
+	{
+		Run();
+	} while (!wi::initializer::IsInitializeFinished());
+	if (test >= 0)
+	{
+		renderer.SelectTest(test);
+	}
+
+	wi::Timer timer;
+	const uint64_t first_frame = graphicsDevice->GetFrameCount();
+	for (uint32_t frame = 0; frame < frames; ++frame)
+	{
+		Run();
+	}
+
+	const uint64_t rendered = graphicsDevice->GetFrameCount() - first_frame;
+	wi::backlog::post("Headless run finished: " + std::to_string(rendered) + " frames in " + std::to_string(timer.elapsed_seconds()) + " seconds");
+	return rendered >= frames ? 0 : 1;
+}
 
 void TestsRenderer::ResizeLayout()
 {
@@ -122,6 +149,21 @@ void TestsRenderer::Load()
 	testSelector.AddItem("Inverse Kinematics");
 	testSelector.AddItem("65k Instances");
 	testSelector.AddItem("Container perf");
+	testSelector.AddItem("Static Scene Upload");
+	testSelector.AddItem("Meshlet Culling");
+	testSelector.AddItem("Geometry Arena");
+	testSelector.AddItem("Physics Threading");
+	testSelector.AddItem("Physics Queries");
+	testSelector.AddItem("Soft Body Write-back");
+	testSelector.AddItem("Physics Spawning");
+	testSelector.AddItem("Physics LOD");
+	testSelector.AddItem("Network Batching");
+	testSelector.AddItem("Network Service");
+	testSelector.AddItem("Network Reliable Host");
+	testSelector.AddItem("Scene Replication");
+	testSelector.AddItem("Multi-view Culling");
+	testSelector.AddItem("Mesh LODs");
+	testSelector.AddItem("Render Queue Sorting");
 	testSelector.SetMaxVisibleItemCount(10);
 	testSelector.OnSelect([=](wi::gui::EventArgs args) {
 
@@ -271,6 +313,7 @@ void TestsRenderer::Load()
 		break;
 
 		case 18:
+		case 20:
 		{
 			wi::scene::LoadModel("../Content/models/cube.wiscene");
 			wi::profiler::SetEnabled(true);
@@ -292,6 +335,17 @@ void TestsRenderer::Load()
 				}
 			}
 			scene.Entity_Remove(cubeentity);
+
+			if (args.iValue == 20)
+			{
+				// The instances are not animated in this test, so after the first frame only the shader data of the instance that Update() edits should be uploaded:
+				statsFont.params.posX = screenW / 2;
+				statsFont.params.posY = screenH / 2;
+				statsFont.params.h_align = wi::font::WIFALIGN_CENTER;
+				statsFont.params.v_align = wi::font::WIFALIGN_CENTER;
+				statsFont.params.size = 24;
+				AddFont(&statsFont);
+			}
 		}
 		break;
 
@@ -299,6 +353,49 @@ void TestsRenderer::Load()
 			ContainerTest();
 			break;
 
+		case 21:
+			MeshletTest();
+			break;
+		case 22:
+			GeometryArenaTest();
+			break;
+		case 23:
+			PhysicsThreadingTest();
+			break;
+		case 24:
+			PhysicsQueryTest();
+			break;
+		case 25:
+			SoftBodyWritebackTest();
+			break;
+		case 26:
+			PhysicsSpawnTest();
+			break;
+		case 27:
+			PhysicsLODTest();
+			break;
+		case 28:
+			NetworkBatchTest();
+			break;
+		case 29:
+			NetworkServiceTest();
+			break;
+		case 30:
+			NetworkHostTest();
+			break;
+		case 31:
+			SceneReplicationTest();
+			break;
+		case 32:
+			VisibilityBatchTest();
+			break;
+		case 33:
+			MeshLODTest();
+			break;
+		case 34:
+			RenderQueueSortTest();
+			break;
+
 		default:
 			assert(0);
 			break;
@@ -397,7 +494,190 @@ void TestsRenderer::Update(float dt)
 
 	}
 
+	// Static Scene Upload: after the first frames, one instance is edited in every frame, only its data should be uploaded
+	static uint32_t upload_frame = 0;
+	static uint32_t upload_checks = 0;
+	static uint32_t upload_failures = 0;
+	size_t edited_instance = ~0ull;
+	if (testSelector.GetSelected() == 20)
+	{
+		if (upload_frame >= 3 && scene->objects.GetCount() > 0)
+		{
+			edited_instance = size_t(upload_frame * 7919) % scene->objects.GetCount();
+			ObjectComponent& object = scene->objects[edited_instance];
+			object.color.x = object.color.x < 1 ? 1.0f : 0.5f;
+		}
+		upload_frame++;
+	}
+	else
+	{
+		upload_frame = 0;
+		upload_checks = 0;
+		upload_failures = 0;
+	}
+
+	// Geometry Arena: allocations with known data are released to leave gaps, the arena is defragmented and the moved data is read back from the GPU
+	static wi::vector<std::shared_ptr<GeometryArena::Allocation>> arena_allocations;
+	static wi::vector<uint32_t> arena_seeds;
+	static wi::graphics::GPUBuffer arena_readback;
+	static int arena_step = 0;
+	static uint64_t arena_frame = 0;
+	static std::string arena_result;
+	static const uint64_t arena_allocation_size = 64 * 1024;
+	wi::graphics::GraphicsDevice* device = wi::graphics::GetDevice();
+	if (testSelector.GetSelected() == 22)
+	{
+		if (arena_step == 2 && device->GetFrameCount() >= arena_frame)
+		{
+			// The moves were recorded by the last Flush(), so the data is copied from the current offsets before this frame's Update() can move it again:
+			wi::graphics::GPUBufferDesc desc;
+			desc.size = arena_allocations.size() * arena_allocation_size;
+			desc.usage = wi::graphics::Usage::READBACK;
+			device->CreateBuffer(&desc, nullptr, &arena_readback);
+
+			wi::vector<wi::graphics::GPUBarrier> barriers;
+			wi::vector<const void*> blocks;
+			for (auto& allocation : arena_allocations)
+			{
+				if (std::find(blocks.begin(), blocks.end(), allocation->buffer.internal_state.get()) == blocks.end())
+				{
+					blocks.push_back(allocation->buffer.internal_state.get());
+					barriers.push_back(wi::graphics::GPUBarrier::Buffer(&allocation->buffer, GeometryArena::RESTING_STATE, wi::graphics::ResourceState::COPY_SRC));
+				}
+			}
+			wi::graphics::CommandList cmd = device->BeginCommandList();
+			device->Barrier(barriers.data(), (uint32_t)barriers.size(), cmd);
+			for (size_t i = 0; i < arena_allocations.size(); ++i)
+			{
+				device->CopyBuffer(&arena_readback, i * arena_allocation_size, &arena_allocations[i]->buffer, arena_allocations[i]->views[0].offset, arena_allocation_size, cmd);
+			}
+			for (auto& barrier : barriers)
+			{
+				std::swap(barrier.buffer.state_before, barrier.buffer.state_after);
+			}
+			device->Barrier(barriers.data(), (uint32_t)barriers.size(), cmd);
+
+			arena_step = 3;
+			arena_frame = device->GetFrameCount() + wi::graphics::GraphicsDevice::GetBufferCount() + 1;
+		}
+	}
+	else
+	{
+		arena_allocations.clear();
+		arena_seeds.clear();
+		arena_readback = {};
+		arena_step = 0;
+	}
+
     RenderPath3D::Update(dt);
+
+	if (testSelector.GetSelected() == 22)
+	{
+		switch (arena_step)
+		{
+		case 0:
+		{
+			const uint32_t count = 256;
+			wi::vector<uint32_t> data(arena_allocation_size / sizeof(uint32_t));
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				for (uint32_t j = 0; j < (uint32_t)data.size(); ++j)
+				{
+					data[j] = (i << 16) | j;
+				}
+				GeometryArena::Stream stream;
+				stream.data = data.data();
+				stream.size = arena_allocation_size;
+				auto allocation = GetGeometryArena().Allocate(GeometryArena::POOL_VERTEX, &stream, 1);
+				// Every second allocation is released right away, their ranges are freed after the frames in flight:
+				if (i % 2 == 1)
+				{
+					arena_allocations.push_back(allocation);
+					arena_seeds.push_back(i);
+				}
+			}
+			arena_step = 1;
+			arena_frame = device->GetFrameCount() + wi::graphics::GraphicsDevice::GetBufferCount() + 1;
+			arena_result = "Waiting for the released ranges...";
+		}
+		break;
+		case 1:
+			if (device->GetFrameCount() >= arena_frame)
+			{
+				// Moved in the next Update() and copied in the next Flush():
+				GetGeometryArena().Defragment();
+				arena_step = 2;
+				arena_frame = device->GetFrameCount() + 2;
+				arena_result = "Defragmenting...";
+			}
+			break;
+		case 3:
+			if (device->GetFrameCount() >= arena_frame)
+			{
+				uint32_t moved = 0;
+				uint32_t valid = 0;
+				const uint32_t* data = (const uint32_t*)arena_readback.mapped_data;
+				for (size_t i = 0; i < arena_allocations.size(); ++i)
+				{
+					if (arena_allocations[i]->generation > 0)
+					{
+						moved++;
+					}
+					bool match = data != nullptr;
+					const size_t words = arena_allocation_size / sizeof(uint32_t);
+					for (size_t j = 0; j < words && match; ++j)
+					{
+						match = data[i * words + j] == ((arena_seeds[i] << 16) | (uint32_t)j);
+					}
+					if (match)
+					{
+						valid++;
+					}
+				}
+				arena_result = "Defragmented allocations: " + std::to_string(moved) + " / " + std::to_string(arena_allocations.size()) + " moved, ";
+				if (dynamic_cast<wi::graphics::GraphicsDevice_Null*>(device) != nullptr)
+				{
+					arena_result += "data is not verified with the null device";
+				}
+				else
+				{
+					arena_result += std::to_string(valid) + " / " + std::to_string(arena_allocations.size()) + " have the correct data on the GPU";
+				}
+				arena_step = 4;
+			}
+			break;
+		default:
+			break;
+		}
+		statsFont.SetText(arena_result);
+	}
+
+	if (testSelector.GetSelected() == 20)
+	{
+		if (edited_instance != ~0ull)
+		{
+			// Exactly one range with the edited instance, nothing else:
+			const auto& ranges = scene->instanceArray.ranges;
+			const bool success =
+				ranges.size() == 1 &&
+				ranges[0].offset == (uint32_t)edited_instance &&
+				ranges[0].count == 1 &&
+				scene->GetShaderDataUploadSize() == sizeof(ShaderMeshInstance);
+			upload_checks++;
+			if (!success)
+			{
+				upload_failures++;
+			}
+		}
+
+		// Scene was updated by RenderPath3D::Update(), so this is the current frame's upload:
+		std::string ss;
+		ss += "Static scene with " + std::to_string(scene->objects.GetCount()) + " instances\n";
+		ss += "Instance data: " + std::to_string(scene->instanceArraySize * sizeof(ShaderMeshInstance)) + " bytes\n";
+		ss += "Per-frame shader data upload: " + std::to_string(scene->GetShaderDataUploadSize()) + " bytes\n";
+		ss += "Frames where only the one edited instance was uploaded: " + std::to_string(upload_checks - upload_failures) + " / " + std::to_string(upload_checks);
+		statsFont.SetText(ss);
+	}
 }
 
 void TestsRenderer::RunJobSystemTest()
@@ -1027,3 +1307,1544 @@ void TestsRenderer::ContainerTest()
 	font.params.size = 24;
 	this->AddFont(&font);
 }
+void TestsRenderer::MeshletTest()
+{
+	wi::Timer timer;
+
+	// Sphere mesh, only CPU data is needed for meshlet generation and culling:
+	MeshComponent mesh;
+	const uint32_t segments = 256;
+	for (uint32_t y = 0; y <= segments; ++y)
+	{
+		for (uint32_t x = 0; x <= segments; ++x)
+		{
+			const float theta = XM_PI * float(y) / float(segments);
+			const float phi = XM_2PI * float(x) / float(segments);
+			mesh.vertex_positions.push_back(XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+		}
+	}
+	for (uint32_t y = 0; y < segments; ++y)
+	{
+		for (uint32_t x = 0; x < segments; ++x)
+		{
+			const uint32_t i0 = y * (segments + 1) + x;
+			const uint32_t i1 = i0 + 1;
+			const uint32_t i2 = i0 + segments + 1;
+			const uint32_t i3 = i2 + 1;
+			mesh.indices.push_back(i0);
+			mesh.indices.push_back(i1);
+			mesh.indices.push_back(i2);
+			mesh.indices.push_back(i1);
+			mesh.indices.push_back(i3);
+			mesh.indices.push_back(i2);
+		}
+	}
+	mesh.subsets.emplace_back();
+	mesh.subsets.back().indexCount = (uint32_t)mesh.indices.size();
+
+	std::string ss = "Meshlet test for " + std::to_string(mesh.indices.size() / 3) + " triangles:\n";
+
+	timer.record();
+	mesh.BuildMeshlets();
+	ss += "\nBuildMeshlets: " + std::to_string(timer.elapsed_milliseconds()) + " ms, meshlet count: " + std::to_string(mesh.meshlets.size()) + "\n";
+
+	uint32_t meshlet_index_count = 0;
+	for (auto& meshlet : mesh.meshlets)
+	{
+		meshlet_index_count += meshlet.indexCount;
+	}
+	ss += "All indices are covered by meshlets: " + std::string(meshlet_index_count == (uint32_t)mesh.indices.size() ? "yes" : "NO") + "\n";
+
+	CameraComponent camera;
+	camera.Eye = XMFLOAT3(0, 0, -3);
+	camera.At = XMFLOAT3(0, 0, 1);
+	camera.Up = XMFLOAT3(0, 1, 0);
+	camera.CreatePerspective(1, 1, 0.1f, 100);
+	camera.UpdateCamera();
+
+	wi::vector<MeshComponent::MeshletRange> ranges;
+	const XMMATRIX W = XMMatrixIdentity();
+	const int iterations = 1000;
+
+	uint32_t culled = 0;
+	timer.record();
+	for (int i = 0; i < iterations; ++i)
+	{
+		ranges.clear();
+		culled = mesh.CullMeshlets(W, camera.frustum, nullptr, ranges);
+	}
+	ss += "\nFrustum culling: " + std::to_string(timer.elapsed_milliseconds() / iterations) + " ms, culled: " + std::to_string(culled) + ", draw ranges: " + std::to_string(ranges.size()) + "\n";
+
+	timer.record();
+	for (int i = 0; i < iterations; ++i)
+	{
+		ranges.clear();
+		culled = mesh.CullMeshlets(W, camera.frustum, &camera.Eye, ranges);
+	}
+	ss += "Frustum + cone culling: " + std::to_string(timer.elapsed_milliseconds() / iterations) + " ms, culled: " + std::to_string(culled) + ", draw ranges: " + std::to_string(ranges.size()) + "\n";
+
+	// Cone culling must be conservative, none of the front facing triangles can be removed:
+	uint32_t front_total = 0;
+	uint32_t front_visible = 0;
+	auto is_front_facing = [&](uint32_t indexOffset) {
+		const XMVECTOR P0 = XMLoadFloat3(&mesh.vertex_positions[mesh.indices[indexOffset + 0]]);
+		const XMVECTOR P1 = XMLoadFloat3(&mesh.vertex_positions[mesh.indices[indexOffset + 1]]);
+		const XMVECTOR P2 = XMLoadFloat3(&mesh.vertex_positions[mesh.indices[indexOffset + 2]]);
+		const XMVECTOR N = XMVector3Cross(P1 - P0, P2 - P0);
+		return XMVectorGetX(XMVector3LengthSq(N)) > 0 && XMVectorGetX(XMVector3Dot(N, XMLoadFloat3(&camera.Eye) - P0)) > 0;
+	};
+	for (uint32_t i = 0; i < (uint32_t)mesh.indices.size(); i += 3)
+	{
+		front_total += is_front_facing(i) ? 1 : 0;
+	}
+	for (auto& range : ranges)
+	{
+		for (uint32_t i = 0; i < range.indexCount; i += 3)
+		{
+			front_visible += is_front_facing(range.indexOffset + i) ? 1 : 0;
+		}
+	}
+	ss += "Front facing triangles kept: " + std::to_string(front_visible) + " / " + std::to_string(front_total) + "\n";
+
+	ranges.clear();
+	culled = mesh.CullMeshlets(XMMatrixTranslation(0, 0, -10), camera.frustum, &camera.Eye, ranges);
+	ss += "Behind the camera culled: " + std::to_string(culled) + " / " + std::to_string(mesh.meshlets.size()) + "\n";
+
+	// Non-uniform scale changes the normal directions, so only frustum culling should be done:
+	const XMMATRIX squashed = XMMatrixScaling(1, 0.2f, 1);
+	ranges.clear();
+	const uint32_t culled_frustum = mesh.CullMeshlets(squashed, camera.frustum, nullptr, ranges);
+	ranges.clear();
+	culled = mesh.CullMeshlets(squashed, camera.frustum, &camera.Eye, ranges);
+	ss += "Cone culling skipped for non-uniform scale: " + std::string(culled == culled_frustum ? "yes" : "NO") + "\n";
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::GeometryArenaTest()
+{
+	wi::Timer timer;
+
+	// The suballocator of the geometry arena only manages offsets, so it can be tested without GPU buffers:
+	wi::allocator::TLSF allocator;
+	allocator.init(wi::scene::GeometryArena::BLOCK_SIZE * 4);
+
+	const uint64_t alignment = 256;
+	const int count = 50000;
+	wi::vector<wi::allocator::TLSF::Allocation> allocations;
+	allocations.reserve(count);
+
+	std::string ss = "Geometry arena suballocator test with " + std::to_string(count) + " allocations:\n";
+
+	timer.record();
+	for (int i = 0; i < count; ++i)
+	{
+		auto allocation = allocator.allocate(wi::random::GetRandom(64u, 4096u) * 16ull, alignment);
+		if (allocation.IsValid())
+		{
+			allocations.push_back(allocation);
+		}
+	}
+	ss += "\nAllocate: " + std::to_string(timer.elapsed_milliseconds()) + " ms, successful: " + std::to_string(allocations.size()) + "\n";
+
+	// Every second allocation is freed, this leaves the worst case fragmentation:
+	timer.record();
+	wi::vector<wi::allocator::TLSF::Allocation> remaining;
+	for (size_t i = 0; i < allocations.size(); ++i)
+	{
+		if (i % 2 == 0)
+		{
+			allocator.free(allocations[i].handle);
+		}
+		else
+		{
+			remaining.push_back(allocations[i]);
+		}
+	}
+	ss += "Free half: " + std::to_string(timer.elapsed_milliseconds()) + " ms, free ranges: " + std::to_string(allocator.get_free_block_count());
+	ss += ", largest free range: " + std::to_string(allocator.get_largest_free_block() / 1024) + " KB\n";
+
+	wi::vector<wi::allocator::TLSF::Move> moves;
+	timer.record();
+	const uint64_t moved = allocator.defragment(moves);
+	ss += "Defragment: " + std::to_string(timer.elapsed_milliseconds()) + " ms, moves: " + std::to_string(moves.size()) + ", moved: " + std::to_string(moved / (1024 * 1024)) + " MB";
+	ss += ", free ranges: " + std::to_string(allocator.get_free_block_count()) + "\n";
+
+	// The moved allocations must keep their alignment and must not overlap:
+	bool valid = allocator.validate();
+	std::sort(remaining.begin(), remaining.end(), [&](auto& a, auto& b) {
+		return allocator.get_offset(a.handle) < allocator.get_offset(b.handle);
+	});
+	uint64_t end = 0;
+	for (auto& x : remaining)
+	{
+		const uint64_t offset = allocator.get_offset(x.handle);
+		valid &= offset >= end && (offset % alignment) == 0;
+		end = offset + allocator.get_size(x.handle);
+	}
+	ss += "Allocations are aligned and don't overlap after defragment: " + std::string(valid ? "yes" : "NO") + "\n";
+
+	// Random allocations and frees:
+	const int churn = 200000;
+	timer.record();
+	for (int i = 0; i < churn; ++i)
+	{
+		if (!remaining.empty() && wi::random::GetRandom(0, 1) == 0)
+		{
+			const size_t index = wi::random::GetRandom((uint32_t)remaining.size() - 1);
+			allocator.free(remaining[index].handle);
+			remaining[index] = remaining.back();
+			remaining.pop_back();
+		}
+		else
+		{
+			auto allocation = allocator.allocate(wi::random::GetRandom(1u, 256u * 1024u), alignment);
+			if (allocation.IsValid())
+			{
+				remaining.push_back(allocation);
+			}
+		}
+	}
+	const double churn_time = timer.elapsed_milliseconds();
+	ss += "\n" + std::to_string(churn) + " random allocate/free: " + std::to_string(churn_time) + " ms (" + std::to_string(churn_time * 1000000.0 / churn) + " ns per operation)\n";
+	ss += "Allocator state is valid: " + std::string(allocator.validate() ? "yes" : "NO") + "\n";
+
+	for (auto& x : remaining)
+	{
+		allocator.free(x.handle);
+	}
+	ss += "Everything is merged back after freeing: " + std::string(allocator.get_used() == 0 && allocator.get_free_block_count() == 1 ? "yes" : "NO") + "\n";
+
+	// The defragmentation of the real arena is verified over the next frames in Update():
+	statsFont.params.posX = GetLogicalWidth() / 2;
+	statsFont.params.posY = GetLogicalHeight() - 50;
+	statsFont.params.h_align = wi::font::WIFALIGN_CENTER;
+	statsFont.params.v_align = wi::font::WIFALIGN_BOTTOM;
+	statsFont.params.size = 24;
+	this->AddFont(&statsFont);
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::PhysicsThreadingTest()
+{
+	wi::Timer timer;
+
+	// Box stacks standing on a static ground, every stack is a separate simulation island
+	//	The engine doesn't have physics joints, so instead of ragdolls there are piles of capsules, which form large islands
+	const int stacks_x = 16;
+	const int stacks_z = 16;
+	const int stack_height = 8;
+	const int piles = 8;
+	const int pile_count = 64;
+	const int frames = 60;
+	const float dt = 1.0f / 60.0f;
+
+	auto create_scene = [&](Scene& scene) {
+		Entity ground = CreateEntity();
+		scene.transforms.Create(ground).Translate(XMFLOAT3(0, -1, 0));
+		RigidBodyPhysicsComponent& groundbody = scene.rigidbodies.Create(ground);
+		groundbody.shape = RigidBodyPhysicsComponent::CollisionShape::BOX;
+		groundbody.box.halfextents = XMFLOAT3(100, 1, 100);
+		groundbody.mass = 0;
+
+		for (int x = 0; x < stacks_x; ++x)
+		{
+			for (int z = 0; z < stacks_z; ++z)
+			{
+				for (int y = 0; y < stack_height; ++y)
+				{
+					Entity entity = CreateEntity();
+					scene.transforms.Create(entity).Translate(XMFLOAT3(-stacks_x * 1.5f + x * 3.0f, 0.5f + y * 1.01f, -stacks_z * 1.5f + z * 3.0f));
+					RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+					rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::BOX;
+					rigidbody.box.halfextents = XMFLOAT3(0.5f, 0.5f, 0.5f);
+					rigidbody.mass = 1;
+				}
+			}
+		}
+
+		for (int i = 0; i < piles; ++i)
+		{
+			for (int j = 0; j < pile_count; ++j)
+			{
+				Entity entity = CreateEntity();
+				scene.transforms.Create(entity).Translate(XMFLOAT3(-stacks_x * 1.5f - 10.0f + (j % 4) * 0.4f, 1.0f + (j / 4) * 0.85f, -piles * 3.0f + i * 6.0f + (j % 3) * 0.1f));
+				RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+				rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::CAPSULE;
+				rigidbody.capsule.radius = 0.15f;
+				rigidbody.capsule.height = 0.5f;
+				rigidbody.mass = 1;
+			}
+		}
+	};
+
+	const bool multithreading = wi::physics::IsMultithreadingEnabled();
+	const uint32_t threadcount_setting = wi::physics::GetThreadCount();
+
+	// Runs the simulation on a new scene, returns the average update time in milliseconds
+	auto run = [&](bool mt, uint32_t threads) {
+		wi::physics::SetMultithreadingEnabled(mt);
+		wi::physics::SetThreadCount(threads);
+
+		Scene scene;
+		create_scene(scene);
+
+		// The first update only registers the bodies, it is not measured:
+		wi::jobsystem::context ctx;
+		wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+
+		timer.record();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+		}
+		return timer.elapsed_milliseconds() / frames;
+	};
+
+	const int bodies = stacks_x * stacks_z * stack_height + piles * pile_count;
+	std::string ss = "Physics threading test with " + std::to_string(bodies) + " rigid bodies, average of " + std::to_string(frames) + " updates:\n";
+
+	const double serial = run(false, 1);
+	ss += "\nMultithreading disabled: " + std::to_string(serial) + " ms\n";
+
+	const uint32_t maxthreads = wi::jobsystem::GetThreadCount();
+	for (uint32_t threads = 1; ; threads *= 2)
+	{
+		threads = std::min(threads, maxthreads);
+		const double time = run(true, threads);
+		ss += std::to_string(threads) + " threads: " + std::to_string(time) + " ms (" + std::to_string(serial / time) + "x)\n";
+		if (threads == maxthreads)
+			break;
+	}
+
+	// Every scene has its own physics world, so separate scenes can be updated in parallel jobs:
+	{
+		wi::physics::SetMultithreadingEnabled(false);
+
+		wi::vector<Scene> scenes(maxthreads);
+		wi::jobsystem::context ctx;
+		for (auto& scene : scenes)
+		{
+			create_scene(scene);
+			wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+		}
+
+		timer.record();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (auto& scene : scenes)
+			{
+				wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
+					wi::jobsystem::context scene_ctx;
+					wi::physics::RunPhysicsUpdateSystem(scene_ctx, scene, dt);
+				});
+			}
+			wi::jobsystem::Wait(ctx);
+		}
+		const double time = timer.elapsed_milliseconds() / frames;
+		ss += "\n" + std::to_string(scenes.size()) + " scenes updated in parallel: " + std::to_string(time) + " ms (" + std::to_string(serial * scenes.size() / time) + "x)\n";
+	}
+
+	wi::physics::SetMultithreadingEnabled(multithreading);
+	wi::physics::SetThreadCount(threadcount_setting == maxthreads ? 0 : threadcount_setting);
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::PhysicsQueryTest()
+{
+	wi::Timer timer;
+
+	// Static boxes scattered in a volume:
+	Scene scene;
+	const int body_count = 10000;
+	for (int i = 0; i < body_count; ++i)
+	{
+		Entity entity = CreateEntity();
+		scene.transforms.Create(entity).Translate(XMFLOAT3(wi::random::GetRandom(-100, 100), wi::random::GetRandom(-100, 100), wi::random::GetRandom(-100, 100)));
+		RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+		rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::BOX;
+		rigidbody.box.halfextents = XMFLOAT3(1, 1, 1);
+		rigidbody.mass = 0;
+	}
+
+	// A cloth around the origin of the rays, every ray query reaches it, but soft bodies must be skipped by the parallel queries:
+	{
+		Entity entity = CreateEntity();
+		MeshComponent& mesh = scene.meshes.Create(entity);
+		const int resolution = 32;
+		for (int y = 0; y < resolution; ++y)
+		{
+			for (int x = 0; x < resolution; ++x)
+			{
+				const float u = float(x) / float(resolution - 1);
+				const float v = float(y) / float(resolution - 1);
+				mesh.vertex_positions.push_back(XMFLOAT3(u * 4 - 2, 0.5f, v * 4 - 2));
+				mesh.vertex_normals.push_back(XMFLOAT3(0, 1, 0));
+				mesh.vertex_uvset_0.push_back(XMFLOAT2(u, v));
+			}
+		}
+		for (int y = 0; y < resolution - 1; ++y)
+		{
+			for (int x = 0; x < resolution - 1; ++x)
+			{
+				const uint32_t i0 = y * resolution + x;
+				const uint32_t i1 = i0 + 1;
+				const uint32_t i2 = i0 + resolution;
+				const uint32_t i3 = i2 + 1;
+				mesh.indices.insert(mesh.indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+		SoftBodyPhysicsComponent& softbody = scene.softbodies.Create(entity);
+		softbody._flags |= SoftBodyPhysicsComponent::SAFE_TO_REGISTER;
+	}
+
+	wi::jobsystem::context ctx;
+	wi::physics::RunPhysicsUpdateSystem(ctx, scene, 1.0f / 60.0f);
+
+	auto random_direction = []() {
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(wi::random::GetRandom(-100, 100), wi::random::GetRandom(-100, 100), wi::random::GetRandom(-100, 100), 0) + XMVectorSet(0.01f, 0, 0, 0)));
+		return direction;
+	};
+
+	const size_t count = 100000;
+	wi::vector<wi::physics::RayCastQuery> rays(count);
+	wi::vector<wi::physics::SphereSweepQuery> sweeps(count);
+	wi::vector<wi::physics::OverlapQuery> overlaps(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		rays[i].direction = random_direction();
+		rays[i].distance = 200;
+		sweeps[i].direction = random_direction();
+		sweeps[i].distance = 200;
+		sweeps[i].radius = 0.5f;
+		overlaps[i].shape.type = wi::physics::QueryShape::Type::BOX;
+		overlaps[i].shape.halfextents = XMFLOAT3(2, 2, 2);
+		overlaps[i].position = XMFLOAT3(wi::random::GetRandom(-100, 100), wi::random::GetRandom(-100, 100), wi::random::GetRandom(-100, 100));
+	}
+	wi::vector<wi::physics::QueryResult> results(count);
+	wi::vector<wi::physics::OverlapResult> overlap_results(count);
+
+	std::string ss = "Physics query test with " + std::to_string(body_count) + " rigid bodies, one soft body and " + std::to_string(count) + " queries of each type:\n";
+
+	const bool multithreading = wi::physics::IsMultithreadingEnabled();
+	for (int mt = 0; mt < 2; ++mt)
+	{
+		wi::physics::SetMultithreadingEnabled(mt != 0);
+		ss += mt ? "\nMultithreaded (" + std::to_string(wi::physics::GetThreadCount()) + " threads):\n" : "\nSingle threaded:\n";
+
+		timer.record();
+		wi::physics::RayCast(scene, rays.data(), results.data(), count);
+		double time = timer.elapsed_milliseconds();
+		size_t hits = std::count_if(results.begin(), results.end(), [](auto& x) { return x.entity != INVALID_ENTITY; });
+		ss += "RayCast: " + std::to_string(time) + " ms (" + std::to_string(int(count / time)) + " per ms), hits: " + std::to_string(hits) + "\n";
+
+		timer.record();
+		wi::physics::SphereSweep(scene, sweeps.data(), results.data(), count);
+		time = timer.elapsed_milliseconds();
+		hits = std::count_if(results.begin(), results.end(), [](auto& x) { return x.entity != INVALID_ENTITY; });
+		ss += "SphereSweep: " + std::to_string(time) + " ms (" + std::to_string(int(count / time)) + " per ms), hits: " + std::to_string(hits) + "\n";
+
+		timer.record();
+		wi::physics::Overlap(scene, overlaps.data(), overlap_results.data(), count);
+		time = timer.elapsed_milliseconds();
+		hits = std::count_if(overlap_results.begin(), overlap_results.end(), [](auto& x) { return !x.entities.empty(); });
+		ss += "Overlap: " + std::to_string(time) + " ms (" + std::to_string(int(count / time)) + " per ms), hits: " + std::to_string(hits) + "\n";
+	}
+	wi::physics::SetMultithreadingEnabled(multithreading);
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::SoftBodyWritebackTest()
+{
+	wi::Timer timer;
+
+	// Cloth grids falling freely, every grid is a separate soft body:
+	const int cloth_count = 16;
+	const int resolution = 64;
+	const int frames = 60;
+	const float dt = 1.0f / 60.0f;
+
+	auto create_scene = [&](Scene& scene) {
+		for (int i = 0; i < cloth_count; ++i)
+		{
+			Entity entity = CreateEntity();
+			MeshComponent& mesh = scene.meshes.Create(entity);
+			for (int y = 0; y < resolution; ++y)
+			{
+				for (int x = 0; x < resolution; ++x)
+				{
+					const float u = float(x) / float(resolution - 1);
+					const float v = float(y) / float(resolution - 1);
+					mesh.vertex_positions.push_back(XMFLOAT3(i * 12.0f + u * 10.0f, 10, v * 10.0f));
+					mesh.vertex_normals.push_back(XMFLOAT3(0, 1, 0));
+					mesh.vertex_tangents.push_back(XMFLOAT4(1, 0, 0, 1));
+					mesh.vertex_uvset_0.push_back(XMFLOAT2(u, v));
+				}
+			}
+			for (int y = 0; y < resolution - 1; ++y)
+			{
+				for (int x = 0; x < resolution - 1; ++x)
+				{
+					const uint32_t i0 = y * resolution + x;
+					const uint32_t i1 = i0 + 1;
+					const uint32_t i2 = i0 + resolution;
+					const uint32_t i3 = i2 + 1;
+					mesh.indices.insert(mesh.indices.end(), { i0, i2, i1, i1, i2, i3 });
+				}
+			}
+
+			SoftBodyPhysicsComponent& softbody = scene.softbodies.Create(entity);
+			softbody._flags |= SoftBodyPhysicsComponent::SAFE_TO_REGISTER;
+		}
+	};
+
+	const bool multithreading = wi::physics::IsMultithreadingEnabled();
+
+	// Runs the simulation on a new scene, returns the average update time in milliseconds
+	auto run = [&](bool mt) {
+		wi::physics::SetMultithreadingEnabled(mt);
+
+		Scene scene;
+		create_scene(scene);
+
+		// The first update only registers the soft bodies, it is not measured:
+		wi::jobsystem::context ctx;
+		wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+
+		timer.record();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+		}
+		return timer.elapsed_milliseconds() / frames;
+	};
+
+	std::string ss = "Soft body test with " + std::to_string(cloth_count) + " cloth meshes of " + std::to_string(resolution * resolution) + " vertices, average of " + std::to_string(frames) + " updates:\n";
+
+	const double serial = run(false);
+	ss += "\nMultithreading disabled: " + std::to_string(serial) + " ms\n";
+	const double parallel = run(true);
+	ss += "Multithreading enabled (" + std::to_string(wi::physics::GetThreadCount()) + " threads): " + std::to_string(parallel) + " ms (" + std::to_string(serial / parallel) + "x)\n";
+
+	wi::physics::SetMultithreadingEnabled(multithreading);
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::PhysicsSpawnTest()
+{
+	wi::Timer timer;
+
+	// Bursts of debris are spawned above a static ground every frame, the registration of new bodies is measured with the update:
+	const int spawn_count = 2000;
+	const int frames = 20;
+	const float dt = 1.0f / 60.0f;
+
+	// Returns the average update time in milliseconds of frames that spawn bodies
+	auto run = [&]() {
+		Scene scene;
+		Entity ground = CreateEntity();
+		scene.transforms.Create(ground).Translate(XMFLOAT3(0, -1, 0));
+		RigidBodyPhysicsComponent& groundbody = scene.rigidbodies.Create(ground);
+		groundbody.shape = RigidBodyPhysicsComponent::CollisionShape::BOX;
+		groundbody.box.halfextents = XMFLOAT3(100, 1, 100);
+		groundbody.mass = 0;
+
+		wi::jobsystem::context ctx;
+		wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+
+		double time = 0;
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			for (int i = 0; i < spawn_count; ++i)
+			{
+				Entity entity = CreateEntity();
+				TransformComponent& transform = scene.transforms.Create(entity);
+				transform.Translate(XMFLOAT3(wi::random::GetRandom(-90, 90), 5.0f + frame * 2.0f + wi::random::GetRandom(0, 100) * 0.01f, wi::random::GetRandom(-90, 90)));
+				transform.UpdateTransform();
+				RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+				switch (i % 3)
+				{
+				default:
+				case 0:
+					rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::BOX;
+					rigidbody.box.halfextents = XMFLOAT3(0.2f, 0.2f, 0.2f);
+					break;
+				case 1:
+					rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::SPHERE;
+					rigidbody.sphere.radius = 0.2f;
+					break;
+				case 2:
+					rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::CAPSULE;
+					rigidbody.capsule.radius = 0.1f;
+					rigidbody.capsule.height = 0.3f;
+					break;
+				}
+				rigidbody.mass = 1;
+			}
+
+			timer.record();
+			wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+			time += timer.elapsed_milliseconds();
+		}
+		return time / frames;
+	};
+
+	std::string ss = "Physics spawn test, " + std::to_string(spawn_count) + " rigid bodies spawned in each of " + std::to_string(frames) + " updates:\n";
+
+	const double time = run();
+	ss += "\n" + std::to_string(time) + " ms per update (" + std::to_string(int(spawn_count / time)) + " bodies per ms)\n";
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::PhysicsLODTest()
+{
+	wi::Timer timer;
+
+	// Box stacks spread over a large ground, only the area around the interest point needs full simulation:
+	//	The boxes of a stack touch each other and never deactivate, so the stacks far away must be stepped together without waking each other up
+	const int stacks = 48;
+	const int stack_height = 6;
+	const float spacing = 20;
+	const int frames = 60;
+	const float dt = 1.0f / 60.0f;
+
+	// Returns the average update time in milliseconds
+	auto run = [&](bool lod, wi::physics::LODStats& stats) {
+		Scene scene;
+		Entity ground = CreateEntity();
+		scene.transforms.Create(ground).Translate(XMFLOAT3(0, -1, 0));
+		RigidBodyPhysicsComponent& groundbody = scene.rigidbodies.Create(ground);
+		groundbody.shape = RigidBodyPhysicsComponent::CollisionShape::BOX;
+		groundbody.box.halfextents = XMFLOAT3(stacks * spacing, 1, stacks * spacing);
+		groundbody.mass = 0;
+
+		for (int x = 0; x < stacks; ++x)
+		{
+			for (int z = 0; z < stacks; ++z)
+			{
+				for (int y = 0; y < stack_height; ++y)
+				{
+					Entity entity = CreateEntity();
+					scene.transforms.Create(entity).Translate(XMFLOAT3((x - stacks / 2) * spacing, 0.5f + y * 1.01f, (z - stacks / 2) * spacing));
+					RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+					rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::BOX;
+					rigidbody.box.halfextents = XMFLOAT3(0.5f, 0.5f, 0.5f);
+					rigidbody.mass = 1;
+					rigidbody.SetDisableDeactivation(true);
+				}
+			}
+		}
+
+		if (lod)
+		{
+			const XMFLOAT3 point = XMFLOAT3(0, 0, 0);
+			wi::physics::SetInterestPoints(scene, &point, 1);
+		}
+
+		wi::jobsystem::context ctx;
+		wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+
+		timer.record();
+		for (int frame = 0; frame < frames; ++frame)
+		{
+			wi::physics::RunPhysicsUpdateSystem(ctx, scene, dt);
+		}
+		const double time = timer.elapsed_milliseconds() / frames;
+		stats = wi::physics::GetLODStats(scene);
+		return time;
+	};
+	auto print_stats = [](const wi::physics::LODStats& stats) {
+		return "\tbody steps at full rate: " + std::to_string(stats.full_rate_steps) +
+			", reduced rate: " + std::to_string(stats.reduced_rate_steps) +
+			", skipped: " + std::to_string(stats.skipped_steps) +
+			", promoted by contact: " + std::to_string(stats.promotions) + "\n";
+	};
+
+	const int bodies = stacks * stacks * stack_height;
+	std::string ss = "Physics LOD test with " + std::to_string(bodies) + " rigid bodies over " + std::to_string(int(stacks * spacing)) + " meters, average of " + std::to_string(frames) + " updates:\n";
+
+	wi::physics::LODStats stats;
+	const double full = run(false, stats);
+	ss += "\nWithout interest points: " + std::to_string(full) + " ms\n";
+	ss += print_stats(stats);
+	const double lod = run(true, stats);
+	ss += "One interest point (reduced: " + std::to_string(int(wi::physics::GetLODReducedDistance())) + " m, frozen: " + std::to_string(int(wi::physics::GetLODFrozenDistance())) + " m): " + std::to_string(lod) + " ms (" + std::to_string(full / lod) + "x)\n";
+	ss += print_stats(stats);
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::NetworkBatchTest()
+{
+	wi::Timer timer;
+
+	// Bursts of packets are sent to a socket on localhost and received, once per packet and once in batches
+	//	The bursts are small enough to fit in the socket receive buffer, so packets are not dropped
+	const size_t burst = 128;
+	const size_t bursts = 2000;
+	const size_t packet_size = 256;
+
+	wi::network::Connection connection;
+	connection.ipaddress = { 127,0,0,1 }; // localhost
+	connection.port = 12346;
+
+	wi::network::Socket sender;
+	wi::network::CreateSocket(&sender);
+	wi::network::Socket receiver;
+	wi::network::CreateSocket(&receiver);
+	wi::network::ListenPort(&receiver, connection.port);
+
+	wi::vector<uint8_t> send_data(burst * packet_size);
+	wi::vector<uint8_t> receive_data(burst * packet_size);
+	for (size_t i = 0; i < send_data.size(); ++i)
+	{
+		send_data[i] = uint8_t(i);
+	}
+
+	std::string ss = "Network batching test on localhost, " + std::to_string(bursts) + " bursts of " + std::to_string(burst) + " packets, " + std::to_string(packet_size) + " bytes each:\n";
+
+	// Single packet calls:
+	{
+		size_t received = 0;
+		size_t syscalls = 0;
+		timer.record();
+		for (size_t b = 0; b < bursts; ++b)
+		{
+			for (size_t i = 0; i < burst; ++i)
+			{
+				wi::network::Send(&sender, &connection, send_data.data() + i * packet_size, packet_size);
+			}
+			syscalls += burst;
+			wi::network::Connection sender_connection;
+			while (wi::network::CanReceive(&receiver, 0))
+			{
+				wi::network::Receive(&receiver, &sender_connection, receive_data.data() + (received % burst) * packet_size, packet_size);
+				received++;
+				syscalls += 2;
+			}
+			syscalls++;
+		}
+		const double time = timer.elapsed_milliseconds();
+		ss += "\nSend/Receive: " + std::to_string(time) + " ms, " + std::to_string(received) + " packets received (" + std::to_string(int(received / time)) + " per ms), " + std::to_string(syscalls) + " system calls\n";
+	}
+
+	// Batched calls:
+	{
+		wi::vector<wi::network::Packet> send_packets(burst);
+		wi::vector<wi::network::Packet> receive_packets(burst);
+		for (size_t i = 0; i < burst; ++i)
+		{
+			send_packets[i].connection = connection;
+			send_packets[i].data = send_data.data() + i * packet_size;
+			send_packets[i].size = packet_size;
+			receive_packets[i].data = receive_data.data() + i * packet_size;
+			receive_packets[i].capacity = packet_size;
+		}
+
+		size_t received = 0;
+		size_t syscalls = 0;
+		size_t bytes = 0;
+		bool valid = true;
+		timer.record();
+		for (size_t b = 0; b < bursts; ++b)
+		{
+			wi::network::BatchStats stats;
+			wi::network::SendBatch(&sender, send_packets.data(), send_packets.size(), &stats);
+			syscalls += stats.syscalls;
+
+			size_t burst_received = 0;
+			while (burst_received < burst)
+			{
+				const size_t count = wi::network::ReceiveBatch(&receiver, receive_packets.data() + burst_received, burst - burst_received, &stats);
+				syscalls += stats.syscalls;
+				bytes += stats.bytes;
+				burst_received += count;
+				if (count == 0)
+				{
+					syscalls++;
+					if (!wi::network::CanReceive(&receiver, 1000))
+						break;
+				}
+			}
+			received += burst_received;
+			valid &= burst_received == 0 || std::memcmp(receive_data.data(), send_data.data(), packet_size) == 0;
+		}
+		const double time = timer.elapsed_milliseconds();
+		ss += "SendBatch/ReceiveBatch: " + std::to_string(time) + " ms, " + std::to_string(received) + " packets received (" + std::to_string(int(received / time)) + " per ms), " + std::to_string(bytes) + " bytes, " + std::to_string(syscalls) + " system calls\n";
+		ss += valid ? "Received data is valid\n" : "Received data is INVALID!\n";
+	}
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::NetworkServiceTest()
+{
+	wi::Timer timer;
+
+	// Worker jobs send numbered packets from one socket of the service to the other one on localhost
+	//	The main thread drains the received packets and checks that the packets of each job arrive in order
+	const uint32_t job_count = 4;
+	const uint32_t packets_per_job = 20000;
+
+	wi::network::Connection connection;
+	connection.ipaddress = { 127,0,0,1 }; // localhost
+	connection.port = 12347;
+
+	wi::network::Socket sockets[2];
+	wi::network::CreateSocket(&sockets[0]);
+	wi::network::CreateSocket(&sockets[1]);
+	wi::network::ListenPort(&sockets[0], connection.port);
+
+	wi::network::Service service;
+	if (!wi::network::CreateService(&service, sockets, arraysize(sockets)))
+	{
+		static wi::SpriteFont font;
+		font = wi::SpriteFont("Network service is not supported on this platform");
+		font.params.posX = GetLogicalWidth() / 2;
+		font.params.posY = GetLogicalHeight() / 2;
+		font.params.h_align = wi::font::WIFALIGN_CENTER;
+		font.params.v_align = wi::font::WIFALIGN_CENTER;
+		font.params.size = 24;
+		this->AddFont(&font);
+		return;
+	}
+
+	timer.record();
+
+	wi::jobsystem::context ctx;
+	wi::jobsystem::Dispatch(ctx, job_count, 1, [&](wi::jobsystem::JobArgs args) {
+		for (uint32_t i = 0; i < packets_per_job;)
+		{
+			wi::network::Packet* packet = wi::network::ServiceAllocatePacket(&service);
+			if (packet == nullptr)
+			{
+				std::this_thread::yield(); // the pool is empty until the receiver frees some packets
+				continue;
+			}
+			const uint32_t message[] = { args.jobIndex, i };
+			std::memcpy(packet->data, message, sizeof(message));
+			packet->size = sizeof(message);
+			packet->connection = connection;
+			if (!wi::network::ServiceSend(&service, 1, packet))
+			{
+				wi::network::ServiceFreePacket(&service, packet);
+				std::this_thread::yield();
+				continue;
+			}
+			i++;
+		}
+	});
+
+	const uint32_t total = job_count * packets_per_job;
+	uint32_t received = 0;
+	uint32_t out_of_order = 0;
+	uint32_t next[job_count] = {};
+	wi::Timer idle;
+	while (received < total && idle.elapsed_milliseconds() < 1000)
+	{
+		wi::network::Packet* packet = wi::network::ServiceReceive(&service, 0);
+		if (packet == nullptr)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+		idle.record();
+		uint32_t message[2];
+		std::memcpy(message, packet->data, sizeof(message));
+		if (message[0] < job_count)
+		{
+			out_of_order += message[1] < next[message[0]] ? 1 : 0;
+			next[message[0]] = message[1] + 1;
+		}
+		received++;
+		wi::network::ServiceFreePacket(&service, packet);
+	}
+	wi::jobsystem::Wait(ctx);
+	const double time = timer.elapsed_milliseconds() - (received < total ? 1000 : 0);
+
+	const wi::network::ServiceStats stats = wi::network::GetServiceStats(&service);
+	std::string ss = "Network service test on localhost, " + std::to_string(job_count) + " jobs sending " + std::to_string(packets_per_job) + " packets each:\n\n";
+	ss += "Received " + std::to_string(received) + " of " + std::to_string(total) + " packets in " + std::to_string(time) + " ms (" + std::to_string(int(received / time)) + " per ms)\n";
+	ss += "Out of order: " + std::to_string(out_of_order) + ", dropped by the service: " + std::to_string(stats.dropped_packets) + "\n";
+	ss += "I/O thread: " + std::to_string(stats.sent_packets) + " sent, " + std::to_string(stats.received_packets) + " received, " + std::to_string(stats.syscalls) + " system calls\n";
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::NetworkHostTest()
+{
+	wi::Timer timer;
+
+	// A client host sends messages of every delivery type to a server host on localhost, both of them simulating a bad network
+	//	The server checks the content and order of the reliable messages and echoes every ordered message back
+	const uint32_t message_count = 200;
+	auto make_message = [](uint32_t index) {
+		wi::vector<uint8_t> data((index * 997) % 20000 + 1); // up to 20 KB, most of them are fragmented
+		for (size_t i = 0; i < data.size(); ++i)
+		{
+			data[i] = uint8_t(index + i * 7);
+		}
+		return data;
+	};
+
+	wi::network::Host::Simulation simulation;
+	simulation.packet_loss = 0.1f;
+	simulation.latency = 30;
+	simulation.jitter = 20;
+
+	wi::network::Host::Desc desc;
+	desc.port = 12348;
+	wi::network::Host server;
+	wi::network::Host client;
+	if (!server.Create(desc) || !client.Create(wi::network::Host::Desc()))
+	{
+		static wi::SpriteFont font;
+		font = wi::SpriteFont("Network host could not be created");
+		font.params.posX = GetLogicalWidth() / 2;
+		font.params.posY = GetLogicalHeight() / 2;
+		font.params.h_align = wi::font::WIFALIGN_CENTER;
+		font.params.v_align = wi::font::WIFALIGN_CENTER;
+		font.params.size = 24;
+		this->AddFont(&font);
+		return;
+	}
+	server.SetSimulation(simulation);
+	client.SetSimulation(simulation);
+
+	wi::network::Connection connection;
+	connection.ipaddress = { 127,0,0,1 }; // localhost
+	connection.port = desc.port;
+
+	for (uint32_t i = 0; i < message_count; ++i)
+	{
+		wi::vector<uint8_t> data = make_message(i);
+		client.Send(connection, wi::network::Host::Delivery::RELIABLE_ORDERED, data.data(), data.size());
+		data = make_message(message_count + i);
+		client.Send(connection, wi::network::Host::Delivery::RELIABLE_UNORDERED, data.data(), data.size());
+	}
+
+	uint32_t ordered = 0;
+	uint32_t unordered = 0;
+	uint32_t unreliable_sent = 0;
+	uint32_t unreliable = 0;
+	uint32_t echoes = 0;
+	uint32_t errors = 0;
+	wi::vector<bool> unordered_received(message_count);
+	wi::network::Host::Message message;
+	while ((ordered < message_count || unordered < message_count || echoes < message_count) && timer.elapsed_seconds() < 30)
+	{
+		client.Send(connection, wi::network::Host::Delivery::UNRELIABLE, &unreliable_sent, sizeof(unreliable_sent));
+		unreliable_sent++;
+
+		client.Update();
+		server.Update();
+
+		while (server.Receive(message))
+		{
+			switch (message.delivery)
+			{
+			case wi::network::Host::Delivery::RELIABLE_ORDERED:
+				errors += message.data == make_message(ordered) ? 0 : 1;
+				ordered++;
+				server.Send(message.peer, wi::network::Host::Delivery::RELIABLE_ORDERED, message.data.data(), std::min(message.data.size(), size_t(8)));
+				break;
+			case wi::network::Host::Delivery::RELIABLE_UNORDERED:
+			{
+				bool found = false;
+				for (uint32_t i = 0; i < message_count && !found; ++i)
+				{
+					if (!unordered_received[i] && message.data == make_message(message_count + i))
+					{
+						unordered_received[i] = true;
+						found = true;
+					}
+				}
+				errors += found ? 0 : 1;
+				unordered++;
+			}
+			break;
+			default:
+				unreliable++;
+				break;
+			}
+		}
+		while (client.Receive(message))
+		{
+			echoes++;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+	const double time = timer.elapsed_milliseconds();
+
+	// Limits: a message above the maximum message size is rejected, and a host with the maximum number of peers doesn't add more
+	wi::vector<uint8_t> oversized(desc.max_message_size + 1);
+	const bool oversized_rejected = !client.Send(connection, wi::network::Host::Delivery::RELIABLE_ORDERED, oversized.data(), oversized.size());
+	bool peers_limited = false;
+	wi::network::Host::Desc limited_desc;
+	limited_desc.max_peers = 1;
+	wi::network::Host limited;
+	if (limited.Create(limited_desc))
+	{
+		wi::network::Connection other = connection;
+		other.port++;
+		peers_limited =
+			limited.Send(connection, wi::network::Host::Delivery::UNRELIABLE, &echoes, sizeof(echoes)) &&
+			!limited.Send(other, wi::network::Host::Delivery::UNRELIABLE, &echoes, sizeof(echoes)) &&
+			limited.GetPeerCount() == 1
+			;
+	}
+
+	wi::network::Host::PeerStats stats;
+	client.GetPeerStats(connection, stats);
+	std::string ss = "Network host test on localhost with " + std::to_string(int(simulation.packet_loss * 100)) + "% simulated packet loss, " + std::to_string(int(simulation.latency)) + " ms latency and " + std::to_string(int(simulation.jitter)) + " ms jitter:\n\n";
+	ss += "Reliable ordered: " + std::to_string(ordered) + " of " + std::to_string(message_count) + ", reliable unordered: " + std::to_string(unordered) + " of " + std::to_string(message_count) + ", echoes: " + std::to_string(echoes) + "\n";
+	ss += "Unreliable: " + std::to_string(unreliable) + " of " + std::to_string(unreliable_sent) + ", content or order errors: " + std::to_string(errors) + "\n";
+	ss += "Time: " + std::to_string(time) + " ms, round trip: " + std::to_string(stats.rtt) + " ms, send rate: " + std::to_string(int(stats.send_rate / 1024)) + " KB/s\n";
+	ss += "Client sent " + std::to_string(stats.sent_packets) + " datagrams (" + std::to_string(stats.sent_bytes / 1024) + " KB), resent fragments: " + std::to_string(stats.resent_fragments) + "\n";
+	ss += std::string("Oversized message rejected: ") + (oversized_rejected ? "yes" : "NO") + ", peer limit respected: " + (peers_limited ? "yes" : "NO") + "\n";
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::SceneReplicationTest()
+{
+	// A server scene with moving entities is replicated to many clients, half of them only see the entities around the origin
+	//	Client 0 decodes its snapshots into its own scene through a simulated connection with latency and packet loss,
+	//	the other clients acknowledge every snapshot with a fixed delay
+	const uint32_t entity_count = 4000;
+	const uint32_t client_count = 32;
+	const uint32_t tick_count = 120;
+	const uint32_t latency_ticks = 3;
+	const uint32_t packet_loss_percent = 20;
+
+	static wi::scene::Scene server_scene;
+	static wi::scene::Scene client_scene;
+	server_scene.Clear();
+	client_scene.Clear();
+
+	wi::vector<wi::ecs::Entity> entities;
+	entities.reserve(entity_count);
+	wi::scene::replication::Server server;
+	server.Init();
+	for (uint32_t i = 0; i < entity_count; ++i)
+	{
+		wi::ecs::Entity entity;
+		if (i % 40 == 0)
+		{
+			entity = server_scene.Entity_CreateLight("", XMFLOAT3(0, 0, 0), XMFLOAT3(1, 0.5f, 0.25f), float(i));
+		}
+		else
+		{
+			entity = wi::ecs::CreateEntity();
+			server_scene.transforms.Create(entity);
+		}
+		wi::scene::TransformComponent& transform = *server_scene.transforms.GetComponent(entity);
+		transform.Translate(XMFLOAT3(float(wi::random::GetRandom(-500, 500)), 0, float(wi::random::GetRandom(-500, 500))));
+		transform.RotateRollPitchYaw(XMFLOAT3(0, i * 0.1f, 0));
+		transform.UpdateTransform();
+		server.SetReplicated(entity, wi::scene::replication::COMPONENT_ALL);
+		entities.push_back(entity);
+	}
+	for (uint32_t i = 0; i < client_count; ++i)
+	{
+		const uint32_t client = server.AddClient();
+		if (client % 2)
+		{
+			server.SetClientInterest(client, XMFLOAT3(0, 0, 0), 250);
+		}
+	}
+
+	wi::scene::replication::Client client;
+	client.Init();
+	wi::vector<uint8_t> in_flight[latency_ticks + 1];
+	uint32_t decode_failures = 0;
+	uint64_t full_bytes = 0;
+	uint64_t delta_bytes = 0;
+	uint64_t delta_count = 0;
+	double capture_time = 0;
+	double encode_time = 0;
+	double update_time = 0;
+	wi::Timer timer;
+	for (uint32_t tick = 0; tick < tick_count + latency_ticks + 1; ++tick)
+	{
+		const bool final_ticks = tick >= tick_count; // no movement and no loss, so that the client catches up
+		if (!final_ticks)
+		{
+			for (uint32_t i = 0; i < entity_count / 10; ++i)
+			{
+				wi::scene::TransformComponent& transform = *server_scene.transforms.GetComponent(entities[wi::random::GetRandom(entity_count - 1)]);
+				transform.Translate(XMFLOAT3(0.05f, 0, -0.03f));
+				transform.RotateRollPitchYaw(XMFLOAT3(0, 0.02f, 0));
+				transform.UpdateTransform();
+			}
+		}
+
+		timer.record();
+		const uint32_t snapshot = server.Update(server_scene);
+		update_time += timer.elapsed_milliseconds();
+		capture_time += server.GetCaptureTime();
+
+		for (uint32_t i = 0; i < client_count; ++i)
+		{
+			const wi::scene::replication::Server::ClientStats& stats = server.GetClientStats(i);
+			encode_time += stats.encode_time;
+			if (stats.baseline == 0)
+			{
+				full_bytes = std::max(full_bytes, (uint64_t)stats.bytes);
+			}
+			else
+			{
+				delta_bytes += stats.bytes;
+				delta_count++;
+			}
+			if (i > 0 && snapshot > latency_ticks)
+			{
+				server.Acknowledge(i, snapshot - latency_ticks);
+			}
+		}
+
+		const wi::vector<uint8_t>& data = server.GetSnapshot(0);
+		in_flight[tick % arraysize(in_flight)].assign(data.begin(), data.end());
+		const wi::vector<uint8_t>& arrived = in_flight[(tick + 1) % arraysize(in_flight)];
+		if (!arrived.empty() && (final_ticks || wi::random::GetRandom(99u) >= packet_loss_percent))
+		{
+			uint32_t decoded = 0;
+			if (client.Decode(arrived.data(), arrived.size(), client_scene, &decoded))
+			{
+				server.Acknowledge(0, decoded);
+			}
+			else
+			{
+				decode_failures++;
+			}
+		}
+	}
+
+	// The client's scene must match the server's within the quantization precision:
+	float max_position_error = 0;
+	uint32_t mismatches = 0;
+	for (wi::ecs::Entity entity : entities)
+	{
+		const wi::ecs::Entity client_entity = client.GetMappedEntity(entity);
+		const wi::scene::TransformComponent* a = server_scene.transforms.GetComponent(entity);
+		const wi::scene::TransformComponent* b = client_scene.transforms.GetComponent(client_entity);
+		if (b == nullptr)
+		{
+			mismatches++;
+			continue;
+		}
+		max_position_error = std::max(max_position_error, wi::math::Distance(a->translation_local, b->translation_local));
+		const wi::scene::LightComponent* light = server_scene.lights.GetComponent(entity);
+		if (light != nullptr)
+		{
+			const wi::scene::LightComponent* client_light = client_scene.lights.GetComponent(client_entity);
+			mismatches += client_light == nullptr || client_light->energy != light->energy ? 1 : 0;
+		}
+	}
+
+	const uint32_t update_count = tick_count + latency_ticks + 1;
+	std::string ss = "Scene replication of " + std::to_string(entity_count) + " entities to " + std::to_string(client_count) + " clients, 10% of the entities move every tick:\n\n";
+	ss += "Full snapshot: " + std::to_string(full_bytes) + " bytes, average delta snapshot: " + std::to_string(delta_count > 0 ? delta_bytes / delta_count : 0) + " bytes\n";
+	ss += "Server update: " + std::to_string(update_time / update_count) + " ms, capture: " + std::to_string(capture_time / update_count) + " ms, encode per client: " + std::to_string(encode_time / (update_count * client_count)) + " ms\n";
+	ss += "Client 0 with " + std::to_string(packet_loss_percent) + "% loss and " + std::to_string(latency_ticks) + " ticks latency: applied snapshot " + std::to_string(client.GetAppliedSnapshot()) + ", decode failures: " + std::to_string(decode_failures) + "\n";
+	ss += "Mismatching entities: " + std::to_string(mismatches) + ", max position error: " + std::to_string(max_position_error) + "\n";
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+void TestsRenderer::VisibilityBatchTest()
+{
+	// Views around the origin of a large scene are culled one by one, then together with the batched UpdateVisibility()
+	const uint32_t object_count = 250000;
+	const uint32_t light_count = 2000;
+	const uint32_t view_count = 6;
+	const int iterations = 20;
+
+	static wi::scene::Scene scene;
+	scene.Clear();
+	auto random_aabb = [](int range, float size) {
+		XMFLOAT3 center = XMFLOAT3(
+			float(wi::random::GetRandom(-range, range)),
+			float(wi::random::GetRandom(-range, range)),
+			float(wi::random::GetRandom(-range, range))
+		);
+		return wi::primitive::AABB(
+			XMFLOAT3(center.x - size, center.y - size, center.z - size),
+			XMFLOAT3(center.x + size, center.y + size, center.z + size)
+		);
+	};
+	for (uint32_t i = 0; i < object_count; ++i)
+	{
+		Entity entity = CreateEntity();
+		scene.objects.Create(entity);
+		scene.aabb_objects.Create(entity) = random_aabb(500, 1);
+	}
+	for (uint32_t i = 0; i < light_count; ++i)
+	{
+		Entity entity = CreateEntity();
+		LightComponent& light = scene.lights.Create(entity);
+		wi::primitive::AABB& aabb = scene.aabb_lights.Create(entity);
+		aabb = random_aabb(500, 10);
+		light.position = aabb.getCenter();
+	}
+
+	// Cameras look in the six axis directions, like the faces of a cube map:
+	const XMFLOAT3 directions[view_count] = {
+		XMFLOAT3(1, 0, 0), XMFLOAT3(-1, 0, 0),
+		XMFLOAT3(0, 1, 0), XMFLOAT3(0, -1, 0),
+		XMFLOAT3(0, 0, 1), XMFLOAT3(0, 0, -1),
+	};
+	static CameraComponent cameras[view_count];
+	static wi::renderer::Visibility separate[view_count];
+	static wi::renderer::Visibility batched[view_count];
+	wi::renderer::Visibility* views[view_count] = {};
+	for (uint32_t i = 0; i < view_count; ++i)
+	{
+		CameraComponent& camera = cameras[i];
+		camera = CameraComponent();
+		camera.Eye = XMFLOAT3(0, 0, 0);
+		camera.At = directions[i];
+		camera.Up = std::abs(directions[i].y) > 0 ? XMFLOAT3(0, 0, 1) : XMFLOAT3(0, 1, 0);
+		camera.CreatePerspective(1, 1, 0.1f, 1000, XM_PIDIV2);
+		camera.UpdateCamera();
+
+		for (wi::renderer::Visibility* vis : { &separate[i], &batched[i] })
+		{
+			vis->scene = &scene;
+			vis->camera = &camera;
+			vis->flags = wi::renderer::Visibility::ALLOW_OBJECTS | wi::renderer::Visibility::ALLOW_LIGHTS;
+		}
+		views[i] = &batched[i];
+	}
+
+	std::string ss = "Multi-view culling test for " + std::to_string(object_count) + " objects, " + std::to_string(light_count) + " lights and " + std::to_string(view_count) + " views:\n";
+
+	wi::Timer timer;
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		for (uint32_t i = 0; i < view_count; ++i)
+		{
+			wi::renderer::UpdateVisibility(separate[i]);
+		}
+	}
+	const double separate_time = timer.elapsed_milliseconds() / iterations;
+	ss += "\nUpdateVisibility() per view: " + std::to_string(separate_time) + " ms\n";
+
+	timer.record();
+	for (int iteration = 0; iteration < iterations; ++iteration)
+	{
+		wi::renderer::UpdateVisibility(views, view_count);
+	}
+	const double batched_time = timer.elapsed_milliseconds() / iterations;
+	ss += "UpdateVisibility() for all views at once: " + std::to_string(batched_time) + " ms\n";
+	ss += "Speedup: " + std::to_string(separate_time / std::max(batched_time, 0.0001)) + "x\n";
+
+	// Every view must have the same results with both methods:
+	bool match = true;
+	uint32_t visible_objects = 0;
+	for (uint32_t i = 0; i < view_count; ++i)
+	{
+		wi::vector<uint32_t> a = separate[i].visibleObjects;
+		wi::vector<uint32_t> b = batched[i].visibleObjects;
+		std::sort(a.begin(), a.end());
+		std::sort(b.begin(), b.end());
+		match &= a == b;
+		wi::vector<uint32_t> la, lb;
+		for (auto& x : separate[i].visibleLights)
+		{
+			la.push_back(x.index);
+		}
+		for (auto& x : batched[i].visibleLights)
+		{
+			lb.push_back(x.index);
+		}
+		std::sort(la.begin(), la.end());
+		std::sort(lb.begin(), lb.end());
+		match &= la == lb;
+		visible_objects += (uint32_t)a.size();
+	}
+	ss += "\nVisible objects in all views: " + std::to_string(visible_objects) + "\n";
+	ss += "Batched results match: " + std::string(match ? "yes" : "NO");
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::MeshLODTest()
+{
+	// Sphere mesh split into subsets by rows:
+	auto create_sphere = [](MeshComponent& mesh, uint32_t subset_count) {
+		const uint32_t segments = 128;
+		for (uint32_t y = 0; y <= segments; ++y)
+		{
+			for (uint32_t x = 0; x <= segments; ++x)
+			{
+				const float theta = XM_PI * float(y) / float(segments);
+				const float phi = XM_2PI * float(x) / float(segments);
+				mesh.vertex_positions.push_back(XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+				mesh.vertex_normals.push_back(XMFLOAT3(0, 1, 0));
+				mesh.vertex_uvset_0.push_back(XMFLOAT2(float(x) / float(segments), float(y) / float(segments)));
+			}
+		}
+		const uint32_t rows_per_subset = segments / subset_count;
+		for (uint32_t y = 0; y < segments; ++y)
+		{
+			if (y % rows_per_subset == 0)
+			{
+				mesh.subsets.emplace_back().indexOffset = (uint32_t)mesh.indices.size();
+			}
+			for (uint32_t x = 0; x < segments; ++x)
+			{
+				const uint32_t i0 = y * (segments + 1) + x;
+				const uint32_t i1 = i0 + 1;
+				const uint32_t i2 = i0 + segments + 1;
+				const uint32_t i3 = i2 + 1;
+				mesh.indices.push_back(i0);
+				mesh.indices.push_back(i1);
+				mesh.indices.push_back(i2);
+				mesh.indices.push_back(i1);
+				mesh.indices.push_back(i3);
+				mesh.indices.push_back(i2);
+			}
+			mesh.subsets.back().indexCount = (uint32_t)mesh.indices.size() - mesh.subsets.back().indexOffset;
+		}
+	};
+
+	MeshComponent reference;
+	create_sphere(reference, 1);
+	reference.ComputeNormals(MeshComponent::COMPUTE_NORMALS_SMOOTH_FAST);
+	const uint32_t triangle_count = (uint32_t)reference.indices.size() / 3;
+
+	MeshComponent mesh;
+	create_sphere(mesh, 1);
+	mesh.GenerateLODs(8);
+
+	std::string ss = "Mesh LOD test for " + std::to_string(triangle_count) + " triangles:\n\nLOD triangle counts:";
+	bool lods_valid = true;
+	for (uint32_t lod = 0; lod < mesh.GetLODCount(); ++lod)
+	{
+		uint32_t first_subset = 0;
+		uint32_t last_subset = 0;
+		mesh.GetLODSubsetRange(lod, first_subset, last_subset);
+		uint32_t lod_triangle_count = 0;
+		for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+		{
+			lod_triangle_count += mesh.subsets[subsetIndex].indexCount / 3;
+			lods_valid &= mesh.subsets[subsetIndex].indexCount > 0;
+		}
+		ss += " " + std::to_string(lod_triangle_count);
+	}
+	ss += "\nNo LOD is empty: " + std::string(lods_valid ? "yes" : "NO") + "\n";
+
+	// The generated LOD triangles must not change anything that uses the triangles of the mesh:
+	mesh.ComputeNormals(MeshComponent::COMPUTE_NORMALS_SMOOTH_FAST);
+	bool normals_equal = mesh.vertex_normals.size() == reference.vertex_normals.size();
+	for (size_t i = 0; i < mesh.vertex_normals.size() && normals_equal; ++i)
+	{
+		normals_equal =
+			mesh.vertex_normals[i].x == reference.vertex_normals[i].x &&
+			mesh.vertex_normals[i].y == reference.vertex_normals[i].y &&
+			mesh.vertex_normals[i].z == reference.vertex_normals[i].z;
+	}
+	bool tangents_equal = mesh.vertex_tangents.size() == reference.vertex_tangents.size();
+	for (size_t i = 0; i < mesh.vertex_tangents.size() && tangents_equal; ++i)
+	{
+		tangents_equal =
+			mesh.vertex_tangents[i].x == reference.vertex_tangents[i].x &&
+			mesh.vertex_tangents[i].y == reference.vertex_tangents[i].y &&
+			mesh.vertex_tangents[i].z == reference.vertex_tangents[i].z;
+	}
+	ss += "Normals and tangents are unchanged by the LODs: " + std::string(normals_equal && tangents_equal ? "yes" : "NO") + "\n";
+
+	SoftBodyPhysicsComponent softbody;
+	softbody.CreateFromMesh(mesh);
+	ss += "Soft body triangles: " + std::to_string(softbody.triangle_tangents_tmp.size()) + " (expected " + std::to_string(triangle_count) + ")\n";
+
+	// The triangle mesh collision shape is built in the background, the rigid body is created when it is ready:
+	Scene scene;
+	Entity entity = CreateEntity();
+	scene.transforms.Create(entity);
+	scene.meshes.Create(entity) = std::move(mesh);
+	scene.objects.Create(entity).meshID = entity;
+	RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(entity);
+	rigidbody.shape = RigidBodyPhysicsComponent::CollisionShape::TRIANGLE_MESH;
+	rigidbody.mass = 0;
+	wi::jobsystem::context ctx;
+	for (int i = 0; i < 1000 && scene.rigidbodies[0].physicsobject == nullptr; ++i)
+	{
+		wi::physics::RunPhysicsUpdateSystem(ctx, scene, 1.0f / 60.0f);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	ss += "Collision triangles: " + std::to_string(wi::physics::GetCollisionTriangleCount(scene.rigidbodies[0])) + " (expected " + std::to_string(triangle_count) + ")\n";
+
+	// The subset index is 8-bit in the renderer, so the LOD count is limited by the subset count:
+	MeshComponent split;
+	create_sphere(split, 64);
+	split.GenerateLODs(8);
+	ss += "\nMesh with " + std::to_string(split.subsets_per_lod) + " subsets: " + std::to_string(split.GetLODCount()) + " LODs from 8 requested, subset count: " + std::to_string(split.subsets.size()) + " (at most 256)\n";
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
+
+void TestsRenderer::RenderQueueSortTest()
+{
+	// Sorting cost of the render queue keys, with copies of the RenderBatch layouts of the renderer:
+	//	Packed: 16-bit distance | 24-bit mesh index | 24-bit instance index in one 64-bit key (the previous layout)
+	//	Wide: 16-bit distance | 32-bit mesh index in a 64-bit key, then the 32-bit instance index as secondary key (the current layout)
+	struct PackedBatch
+	{
+		uint64_t data;
+		bool operator<(const PackedBatch& other) const { return data < other.data; }
+	};
+	struct WideBatch
+	{
+		uint64_t data;
+		uint32_t instanceIndex;
+		bool operator<(const WideBatch& other) const { return data < other.data || (data == other.data && instanceIndex < other.instanceIndex); }
+	};
+
+	const uint32_t mesh_count = 4096;
+	const int repeats = 5;
+	std::string ss = "Render queue sorting, std::sort of the previous 64-bit and the current 96-bit RenderBatch keys, best of " + std::to_string(repeats) + " runs:\n\n";
+	for (uint32_t batch_count : { 4096u, 65536u, 1048576u })
+	{
+		// The same random scene for both layouts, the distances are quantized to half precision like in the renderer:
+		wi::vector<PackedBatch> packed_source(batch_count);
+		wi::vector<WideBatch> wide_source(batch_count);
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			const uint64_t distance = XMConvertFloatToHalf(float(wi::random::GetRandom(0, 100000)) * 0.01f) & 0xFFFF;
+			const uint64_t mesh = wi::random::GetRandom(0u, mesh_count - 1);
+			const uint64_t instance = i;
+			packed_source[i].data = (distance << 48ull) | (mesh << 24ull) | (instance & 0x00FFFFFF);
+			wide_source[i].data = (distance << 32ull) | mesh;
+			wide_source[i].instanceIndex = uint32_t(instance);
+		}
+
+		double packed_time = std::numeric_limits<double>::max();
+		double wide_time = std::numeric_limits<double>::max();
+		bool same_order = true;
+		for (int r = 0; r < repeats; ++r)
+		{
+			wi::vector<PackedBatch> packed = packed_source;
+			wi::Timer timer;
+			std::sort(packed.begin(), packed.end());
+			packed_time = std::min(packed_time, timer.elapsed_milliseconds());
+
+			wi::vector<WideBatch> wide = wide_source;
+			timer.record();
+			std::sort(wide.begin(), wide.end());
+			wide_time = std::min(wide_time, timer.elapsed_milliseconds());
+
+			for (uint32_t i = 0; i < batch_count && same_order; ++i)
+			{
+				same_order = (packed[i].data & 0x00FFFFFF) == (wide[i].instanceIndex & 0x00FFFFFF);
+			}
+		}
+
+		ss += std::to_string(batch_count) + " batches: packed " + std::to_string(packed_time) + " ms, wide " + std::to_string(wide_time) + " ms (" + std::to_string(int(std::round(wide_time / std::max(packed_time, 0.0001) * 100))) + "%), same order: " + (same_order ? "yes" : "NO") + "\n";
+	}
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
@@ -7,16 +7,33 @@ class TestsRenderer : public wi::RenderPath3D
 	wi::gui::Label label;
 	wi::gui::ComboBox testSelector;
 	wi::ecs::Entity ik_entity = wi::ecs::INVALID_ENTITY;
+	wi::SpriteFont statsFont;
 public:
 	void Load() override;
 	void Update(float dt) override;
 	void ResizeLayout() override;
 
+	void SelectTest(int index) { testSelector.SetSelected(index); }
+
 	void RunJobSystemTest();
 	void RunFontTest();
 	void RunSpriteTest();
 	void RunNetworkTest();
 	void ContainerTest();
+	void MeshletTest();
+	void GeometryArenaTest();
+	void PhysicsThreadingTest();
+	void PhysicsQueryTest();
+	void SoftBodyWritebackTest();
+	void PhysicsSpawnTest();
+	void PhysicsLODTest();
+	void NetworkBatchTest();
+	void NetworkServiceTest();
+	void NetworkHostTest();
+	void SceneReplicationTest();
+	void VisibilityBatchTest();
+	void MeshLODTest();
+	void RenderQueueSortTest();
 };
 
 class Tests : public wi::Application
@@ -24,5 +41,11 @@ class Tests : public wi::Application
 	TestsRenderer renderer;
 public:
 	void Initialize() override;
+
+	// Runs the tests with the null graphics device and without a window
+	//	test	:	index of the test to run, or -1 for the default
+	//	frames	:	number of frames to run
+	//	returns the exit code of the process
+	int RunHeadless(int test, uint32_t frames);
 };
 
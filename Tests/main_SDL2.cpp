@@ -5,6 +5,9 @@
 #include <SDL2/SDL.h>
 #include "sdl2.h"
 
+#include <cstring>
+#include <cstdlib>
+
 int sdl_loop(Tests &tests)
 {
     SDL_Event event;
@@ -55,6 +58,35 @@ int main(int argc, char *argv[])
 
     wi::arguments::Parse(argc, argv);
 
+    if (wi::arguments::HasArgument("headless"))
+    {
+        // Renders frames without a window and GPU, for example on servers and CI machines:
+        //  frames=N selects the number of rendered frames, test=N selects the test that is run
+        uint32_t frames = 100;
+        int test = -1;
+        for (int i = 1; i < argc; ++i)
+        {
+            if (std::strncmp(argv[i], "frames=", 7) == 0)
+            {
+                frames = (uint32_t)std::atoi(argv[i] + 7);
+            }
+            else if (std::strncmp(argv[i], "test=", 5) == 0)
+            {
+                test = std::atoi(argv[i] + 5);
+            }
+        }
+
+        sdl2::sdlsystem_ptr_t system = sdl2::make_sdlsystem(SDL_INIT_EVENTS);
+        if (!system) {
+            throw sdl2::SDLError("Error creating SDL2 system");
+        }
+
+        int ret = tests.RunHeadless(test, frames);
+
+        SDL_Quit();
+        return ret;
+    }
+
     sdl2::sdlsystem_ptr_t system = sdl2::make_sdlsystem(SDL_INIT_EVERYTHING | SDL_INIT_EVENTS);
     if (!system) {
         throw sdl2::SDLError("Error creating SDL2 system");
@@ -969,7 +969,8 @@ inline void		btDbvt::rayTestInternal(	const btDbvtNode* root,
 
 		int								depth=1;
 		int								treshold=DOUBLE_STACKSIZE-2;
-		btAlignedObjectArray<const btDbvtNode*>&	stack = m_rayTestStack;
+		///the stack is per thread instead of m_rayTestStack, so that ray and convex sweep tests can be performed on multiple threads
+		static thread_local btAlignedObjectArray<const btDbvtNode*>	stack;
 		stack.resize(DOUBLE_STACKSIZE);
 		stack[0]=root;
 		btVector3 bounds[2];
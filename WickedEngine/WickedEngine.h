@@ -27,6 +27,7 @@
 #include "wiSprite.h"
 #include "wiSpriteFont.h"
 #include "wiScene.h"
+#include "wiSceneReplication.h"
 #include "wiECS.h"
 #include "wiEmittedParticle.h"
 #include "wiHairParticle.h"
@@ -54,6 +55,8 @@
 #include "wiArchive.h"
 #include "wiSpinLock.h"
 #include "wiRectPacker.h"
+#include "wiAllocator.h"
+#include "wiGeometryArena.h"
 #include "wiProfiler.h"
 #include "wiOcean.h"
 #include "wiFFTGenerator.h"
@@ -62,6 +65,7 @@
 #include "wiGPUSortLib.h"
 #include "wiJobSystem.h"
 #include "wiNetwork.h"
+#include "wiNetworkHost.h"
 #include "wiEventHandler.h"
 #include "wiShaderCompiler.h"
 #include "wiCanvas.h"
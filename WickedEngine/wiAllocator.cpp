@@ -0,0 +1,464 @@
+#include "wiAllocator.h"
+
+#include <cassert>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <intrin.h> // _BitScanReverse64, _BitScanForward64
+#endif // _WIN32
+
+namespace wi::allocator
+{
+	namespace TLSF_Internal
+	{
+		// Index of the most significant set bit, x must not be zero
+		inline uint32_t msb(uint64_t x)
+		{
+#ifdef _WIN32
+			unsigned long index;
+			_BitScanReverse64(&index, x);
+			return (uint32_t)index;
+#else
+			return 63u - (uint32_t)__builtin_clzll(x);
+#endif // _WIN32
+		}
+		// Index of the least significant set bit, x must not be zero
+		inline uint32_t lsb(uint64_t x)
+		{
+#ifdef _WIN32
+			unsigned long index;
+			_BitScanForward64(&index, x);
+			return (uint32_t)index;
+#else
+			return (uint32_t)__builtin_ctzll(x);
+#endif // _WIN32
+		}
+		inline uint64_t align(uint64_t value, uint64_t alignment)
+		{
+			return ((value + alignment - 1) / alignment) * alignment;
+		}
+	}
+	using namespace TLSF_Internal;
+
+	void TLSF::mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+	{
+		// Small sizes are mapped linearly into the first bin:
+		if (size < SL_INDEX_COUNT)
+		{
+			fl = 0;
+			sl = (uint32_t)size;
+		}
+		else
+		{
+			const uint32_t bit = msb(size);
+			fl = bit - SL_INDEX_COUNT_LOG2 + 1;
+			sl = (uint32_t)(size >> (bit - SL_INDEX_COUNT_LOG2)) - SL_INDEX_COUNT;
+		}
+	}
+
+	void TLSF::init(uint64_t capacity)
+	{
+		nodes.clear();
+		free_nodes.clear();
+		fl_bitmap = 0;
+		std::fill(std::begin(sl_bitmap), std::end(sl_bitmap), 0u);
+		for (auto& fl : heads)
+		{
+			std::fill(std::begin(fl), std::end(fl), INVALID);
+		}
+		first_physical = INVALID;
+		this->capacity = capacity;
+		used = 0;
+		allocation_count = 0;
+		free_block_count = 0;
+
+		if (capacity > 0)
+		{
+			first_physical = create_node();
+			nodes[first_physical].offset = 0;
+			nodes[first_physical].size = capacity;
+			insert_free(first_physical);
+		}
+	}
+
+	TLSF::Allocation TLSF::allocate(uint64_t size, uint64_t alignment)
+	{
+		Allocation allocation;
+		if (size == 0 || size > get_free())
+			return allocation;
+		alignment = alignment == 0 ? 1 : alignment;
+
+		// First try to find a block that fits the size, most allocations will be already aligned:
+		uint32_t node = find_free(size);
+		if (node != INVALID && align(nodes[node].offset, alignment) + size > nodes[node].offset + nodes[node].size)
+		{
+			node = alignment > 1 ? find_free(size + alignment - 1) : INVALID;
+		}
+		if (node == INVALID)
+			return allocation;
+
+		remove_free(node);
+
+		// The alignment padding at the beginning is given back as a separate free block:
+		const uint64_t padding = align(nodes[node].offset, alignment) - nodes[node].offset;
+		if (padding > 0)
+		{
+			const uint32_t front = create_node();
+			Node& block = nodes[node];
+			Node& front_block = nodes[front];
+			front_block.offset = block.offset;
+			front_block.size = padding;
+			front_block.prev_physical = block.prev_physical;
+			front_block.next_physical = node;
+			if (block.prev_physical != INVALID)
+			{
+				nodes[block.prev_physical].next_physical = front;
+			}
+			else
+			{
+				first_physical = front;
+			}
+			block.prev_physical = front;
+			block.offset += padding;
+			block.size -= padding;
+			insert_free(front);
+		}
+
+		if (nodes[node].size > size)
+		{
+			split(node, size);
+		}
+
+		Node& block = nodes[node];
+		block.used = true;
+		block.alignment = alignment;
+		used += block.size;
+		allocation_count++;
+
+		allocation.handle = node;
+		allocation.offset = block.offset;
+		allocation.size = block.size;
+		return allocation;
+	}
+
+	void TLSF::free(uint32_t handle)
+	{
+		if (handle == INVALID)
+			return;
+		assert(handle < nodes.size() && nodes[handle].used);
+		Node& block = nodes[handle];
+		block.used = false;
+		used -= block.size;
+		allocation_count--;
+		insert_free(merge(handle));
+	}
+
+	uint64_t TLSF::defragment(wi::vector<Move>& moves, uint64_t max_bytes)
+	{
+		// Slide every allocation down to the end of the previous one:
+		uint64_t moved = 0;
+		uint64_t cursor = 0;
+		wi::vector<uint32_t> allocations;
+		allocations.reserve(allocation_count);
+		for (uint32_t node = first_physical; node != INVALID; node = nodes[node].next_physical)
+		{
+			Node& block = nodes[node];
+			if (!block.used)
+				continue;
+			const uint64_t dst = align(cursor, block.alignment);
+			if (dst < block.offset && moved + block.size <= max_bytes)
+			{
+				Move& move = moves.emplace_back();
+				move.handle = node;
+				move.src_offset = block.offset;
+				move.dst_offset = dst;
+				move.size = block.size;
+				moved += block.size;
+				block.offset = dst;
+			}
+			cursor = block.offset + block.size;
+			allocations.push_back(node);
+		}
+		if (moved == 0)
+			return 0;
+
+		// Rebuild the physical and free lists, the free blocks are recreated in the gaps:
+		for (uint32_t node = first_physical; node != INVALID;)
+		{
+			const uint32_t next = nodes[node].next_physical;
+			if (!nodes[node].used)
+			{
+				release_node(node);
+			}
+			node = next;
+		}
+		fl_bitmap = 0;
+		std::fill(std::begin(sl_bitmap), std::end(sl_bitmap), 0u);
+		for (auto& fl : heads)
+		{
+			std::fill(std::begin(fl), std::end(fl), INVALID);
+		}
+		free_block_count = 0;
+		first_physical = INVALID;
+
+		uint32_t prev = INVALID;
+		uint64_t end = 0;
+		auto append = [&](uint32_t node) {
+			nodes[node].prev_physical = prev;
+			nodes[node].next_physical = INVALID;
+			if (prev == INVALID)
+			{
+				first_physical = node;
+			}
+			else
+			{
+				nodes[prev].next_physical = node;
+			}
+			prev = node;
+			end = nodes[node].offset + nodes[node].size;
+		};
+		auto append_free = [&](uint64_t offset, uint64_t size) {
+			const uint32_t node = create_node();
+			nodes[node].offset = offset;
+			nodes[node].size = size;
+			append(node);
+			insert_free(node);
+		};
+		for (uint32_t node : allocations)
+		{
+			if (nodes[node].offset > end)
+			{
+				append_free(end, nodes[node].offset - end);
+			}
+			append(node);
+		}
+		if (capacity > end)
+		{
+			append_free(end, capacity - end);
+		}
+
+		return moved;
+	}
+
+	uint64_t TLSF::get_largest_free_block() const
+	{
+		if (fl_bitmap == 0)
+			return 0;
+		const uint32_t fl = msb(fl_bitmap);
+		const uint32_t sl = msb(sl_bitmap[fl]);
+		uint64_t largest = 0;
+		for (uint32_t node = heads[fl][sl]; node != INVALID; node = nodes[node].next_free)
+		{
+			largest = std::max(largest, nodes[node].size);
+		}
+		return largest;
+	}
+
+	bool TLSF::validate() const
+	{
+		uint64_t offset = 0;
+		uint64_t used_size = 0;
+		uint32_t used_count = 0;
+		uint32_t free_count = 0;
+		uint32_t prev = INVALID;
+		for (uint32_t node = first_physical; node != INVALID; node = nodes[node].next_physical)
+		{
+			const Node& block = nodes[node];
+			if (block.offset != offset || block.size == 0 || block.prev_physical != prev)
+				return false;
+			if (block.used)
+			{
+				used_size += block.size;
+				used_count++;
+				if (block.offset % block.alignment != 0)
+					return false;
+			}
+			else
+			{
+				free_count++;
+				if (prev != INVALID && !nodes[prev].used)
+					return false; // neighbouring free blocks must be merged
+			}
+			offset += block.size;
+			prev = node;
+		}
+		if (offset != capacity || used_size != used || used_count != allocation_count || free_count != free_block_count)
+			return false;
+
+		uint32_t listed = 0;
+		for (uint32_t fl = 0; fl < FL_INDEX_COUNT; ++fl)
+		{
+			for (uint32_t sl = 0; sl < SL_INDEX_COUNT; ++sl)
+			{
+				const bool bit = (sl_bitmap[fl] & (1u << sl)) != 0;
+				if (bit != (heads[fl][sl] != INVALID))
+					return false;
+				for (uint32_t node = heads[fl][sl]; node != INVALID; node = nodes[node].next_free)
+				{
+					uint32_t f, s;
+					mapping(nodes[node].size, f, s);
+					if (f != fl || s != sl || nodes[node].used)
+						return false;
+					listed++;
+				}
+			}
+			if (((fl_bitmap >> fl) & 1ull) != (sl_bitmap[fl] != 0 ? 1ull : 0ull))
+				return false;
+		}
+		return listed == free_block_count;
+	}
+
+	uint32_t TLSF::create_node()
+	{
+		uint32_t node;
+		if (free_nodes.empty())
+		{
+			node = (uint32_t)nodes.size();
+			nodes.emplace_back();
+		}
+		else
+		{
+			node = free_nodes.back();
+			free_nodes.pop_back();
+			nodes[node] = {};
+		}
+		return node;
+	}
+	void TLSF::release_node(uint32_t node)
+	{
+		free_nodes.push_back(node);
+	}
+
+	void TLSF::insert_free(uint32_t node)
+	{
+		uint32_t fl, sl;
+		mapping(nodes[node].size, fl, sl);
+		Node& block = nodes[node];
+		block.used = false;
+		block.prev_free = INVALID;
+		block.next_free = heads[fl][sl];
+		if (block.next_free != INVALID)
+		{
+			nodes[block.next_free].prev_free = node;
+		}
+		heads[fl][sl] = node;
+		fl_bitmap |= 1ull << fl;
+		sl_bitmap[fl] |= 1u << sl;
+		free_block_count++;
+	}
+	void TLSF::remove_free(uint32_t node)
+	{
+		uint32_t fl, sl;
+		mapping(nodes[node].size, fl, sl);
+		Node& block = nodes[node];
+		if (block.prev_free != INVALID)
+		{
+			nodes[block.prev_free].next_free = block.next_free;
+		}
+		if (block.next_free != INVALID)
+		{
+			nodes[block.next_free].prev_free = block.prev_free;
+		}
+		if (heads[fl][sl] == node)
+		{
+			heads[fl][sl] = block.next_free;
+			if (heads[fl][sl] == INVALID)
+			{
+				sl_bitmap[fl] &= ~(1u << sl);
+				if (sl_bitmap[fl] == 0)
+				{
+					fl_bitmap &= ~(1ull << fl);
+				}
+			}
+		}
+		block.prev_free = INVALID;
+		block.next_free = INVALID;
+		free_block_count--;
+	}
+
+	uint32_t TLSF::find_free(uint64_t size) const
+	{
+		// Round up the size to the next bin, so that any block of that bin will fit:
+		uint64_t rounded = size;
+		if (size >= SL_INDEX_COUNT)
+		{
+			const uint64_t round = (1ull << (msb(size) - SL_INDEX_COUNT_LOG2)) - 1;
+			rounded = size + round < size ? size : size + round;
+		}
+		uint32_t fl, sl;
+		mapping(rounded, fl, sl);
+
+		uint32_t sl_map = fl < FL_INDEX_COUNT ? (sl_bitmap[fl] & (~0u << sl)) : 0;
+		if (sl_map == 0)
+		{
+			const uint64_t fl_map = fl + 1 < 64 ? (fl_bitmap & (~0ull << (fl + 1))) : 0;
+			if (fl_map != 0)
+			{
+				fl = lsb(fl_map);
+				sl_map = sl_bitmap[fl];
+			}
+		}
+		if (sl_map != 0)
+		{
+			return heads[fl][lsb(sl_map)];
+		}
+
+		// The bins above are empty, but the bin of the exact size can still contain a block that fits:
+		mapping(size, fl, sl);
+		for (uint32_t node = heads[fl][sl]; node != INVALID; node = nodes[node].next_free)
+		{
+			if (nodes[node].size >= size)
+				return node;
+		}
+		return INVALID;
+	}
+
+	void TLSF::split(uint32_t node, uint64_t size)
+	{
+		assert(nodes[node].size > size);
+		const uint32_t remainder = create_node();
+		Node& block = nodes[node];
+		Node& remainder_block = nodes[remainder];
+		remainder_block.offset = block.offset + size;
+		remainder_block.size = block.size - size;
+		remainder_block.prev_physical = node;
+		remainder_block.next_physical = block.next_physical;
+		if (block.next_physical != INVALID)
+		{
+			nodes[block.next_physical].prev_physical = remainder;
+		}
+		block.next_physical = remainder;
+		block.size = size;
+		insert_free(remainder);
+	}
+
+	uint32_t TLSF::merge(uint32_t node)
+	{
+		const uint32_t prev = nodes[node].prev_physical;
+		if (prev != INVALID && !nodes[prev].used)
+		{
+			remove_free(prev);
+			nodes[prev].size += nodes[node].size;
+			nodes[prev].next_physical = nodes[node].next_physical;
+			if (nodes[node].next_physical != INVALID)
+			{
+				nodes[nodes[node].next_physical].prev_physical = prev;
+			}
+			release_node(node);
+			node = prev;
+		}
+		const uint32_t next = nodes[node].next_physical;
+		if (next != INVALID && !nodes[next].used)
+		{
+			remove_free(next);
+			nodes[node].size += nodes[next].size;
+			nodes[node].next_physical = nodes[next].next_physical;
+			if (nodes[next].next_physical != INVALID)
+			{
+				nodes[nodes[next].next_physical].prev_physical = node;
+			}
+			release_node(next);
+		}
+		return node;
+	}
+}
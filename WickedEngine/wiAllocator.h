@@ -0,0 +1,103 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiVector.h"
+
+namespace wi::allocator
+{
+	// Two-Level Segregated Fit allocator that manages a range of offsets, it doesn't own any memory
+	//	This can be used to suballocate a large GPU buffer, allocate() and free() are O(1)
+	//	Free blocks are merged with their free neighbours immediately, so fragmentation is kept low
+	//	Allocations are identified by a handle that stays the same when defragment() moves them
+	class TLSF
+	{
+	public:
+		static constexpr uint32_t INVALID = ~0u;
+
+		struct Allocation
+		{
+			uint32_t handle = INVALID;
+			uint64_t offset = 0;
+			uint64_t size = 0;
+
+			constexpr bool IsValid() const { return handle != INVALID; }
+		};
+
+		// Describes a relocated allocation, the data must be copied from src_offset to dst_offset by the user
+		//	The source and destination ranges of a move can overlap
+		struct Move
+		{
+			uint32_t handle = INVALID;
+			uint64_t src_offset = 0;
+			uint64_t dst_offset = 0;
+			uint64_t size = 0;
+		};
+
+		// Resets the allocator, all previous allocations become invalid
+		void init(uint64_t capacity);
+
+		// Returns an invalid allocation if there is not enough contiguous free space
+		Allocation allocate(uint64_t size, uint64_t alignment = 1);
+		void free(uint32_t handle);
+
+		// Moves allocations towards the beginning of the range so that the free space is contiguous at the end
+		//	max_bytes limits the amount of data that is moved in one call, the moves are appended to the moves array
+		//	returns the number of bytes that need to be moved
+		uint64_t defragment(wi::vector<Move>& moves, uint64_t max_bytes = ~0ull);
+
+		// Current offset of an allocation, it can change after defragment()
+		uint64_t get_offset(uint32_t handle) const { return nodes[handle].offset; }
+		uint64_t get_size(uint32_t handle) const { return nodes[handle].size; }
+
+		uint64_t get_capacity() const { return capacity; }
+		uint64_t get_used() const { return used; }
+		uint64_t get_free() const { return capacity - used; }
+		uint32_t get_allocation_count() const { return allocation_count; }
+		uint32_t get_free_block_count() const { return free_block_count; }
+		// Size of the largest contiguous free range
+		uint64_t get_largest_free_block() const;
+
+		// Checks the consistency of the internal data structures, for testing
+		bool validate() const;
+
+	private:
+		static constexpr uint32_t SL_INDEX_COUNT_LOG2 = 4;
+		static constexpr uint32_t SL_INDEX_COUNT = 1u << SL_INDEX_COUNT_LOG2;
+		static constexpr uint32_t FL_INDEX_COUNT = 64 - SL_INDEX_COUNT_LOG2 + 1;
+
+		struct Node
+		{
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			uint64_t alignment = 1;
+			uint32_t prev_physical = INVALID;
+			uint32_t next_physical = INVALID;
+			uint32_t prev_free = INVALID;
+			uint32_t next_free = INVALID;
+			bool used = false;
+		};
+		wi::vector<Node> nodes;
+		wi::vector<uint32_t> free_nodes;
+
+		uint64_t fl_bitmap = 0;
+		uint32_t sl_bitmap[FL_INDEX_COUNT] = {};
+		uint32_t heads[FL_INDEX_COUNT][SL_INDEX_COUNT] = {};
+
+		uint32_t first_physical = INVALID;
+		uint64_t capacity = 0;
+		uint64_t used = 0;
+		uint32_t allocation_count = 0;
+		uint32_t free_block_count = 0;
+
+		// Maps a size to its first and second level bin
+		static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+		uint32_t create_node();
+		void release_node(uint32_t node);
+		void insert_free(uint32_t node);
+		void remove_free(uint32_t node);
+		uint32_t find_free(uint64_t size) const;
+		// Splits the end of a block into a new free block, the remainder must not be zero
+		void split(uint32_t node, uint64_t size);
+		// Merges a free block with its free physical neighbours, returns the merged block
+		uint32_t merge(uint32_t node);
+	};
+}
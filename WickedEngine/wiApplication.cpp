@@ -18,6 +18,8 @@
 
 #include "wiGraphicsDevice_DX12.h"
 #include "wiGraphicsDevice_Vulkan.h"
+#include "wiGraphicsDevice_Null.h"
+#include "wiGraphicsDevice_Recorder.h"
 
 #include <string>
 #include <algorithm>
@@ -301,18 +303,32 @@ namespace wi
 				infodisplay_str += "[UWP]";
 #endif
 
+				GraphicsDevice* displayed_device = graphicsDevice.get();
+				GraphicsDevice_Recorder* recorder = dynamic_cast<GraphicsDevice_Recorder*>(displayed_device);
+				if (recorder != nullptr)
+				{
+					displayed_device = recorder->GetTargetDevice();
+				}
 #ifdef WICKEDENGINE_BUILD_DX12
-				if (dynamic_cast<GraphicsDevice_DX12*>(graphicsDevice.get()))
+				if (dynamic_cast<GraphicsDevice_DX12*>(displayed_device))
 				{
 					infodisplay_str += "[DX12]";
 				}
 #endif
 #ifdef WICKEDENGINE_BUILD_VULKAN
-				if (dynamic_cast<GraphicsDevice_Vulkan*>(graphicsDevice.get()))
+				if (dynamic_cast<GraphicsDevice_Vulkan*>(displayed_device))
 				{
 					infodisplay_str += "[Vulkan]";
 				}
 #endif
+				if (dynamic_cast<GraphicsDevice_Null*>(displayed_device))
+				{
+					infodisplay_str += "[Null]";
+				}
+				if (recorder != nullptr && recorder->IsRecordingEnabled())
+				{
+					infodisplay_str += "[Recording]";
+				}
 
 #ifdef _DEBUG
 				infodisplay_str += "[DEBUG]";
@@ -412,6 +428,7 @@ namespace wi
 
 			bool use_dx12 = wi::arguments::HasArgument("dx12");
 			bool use_vulkan = wi::arguments::HasArgument("vulkan");
+			bool use_null = wi::arguments::HasArgument("nullgraphics");
 
 #ifndef WICKEDENGINE_BUILD_DX12
 			if (use_dx12) {
@@ -426,7 +443,12 @@ namespace wi
 			}
 #endif
 
-			if (!use_dx12 && !use_vulkan)
+			if (use_null)
+			{
+				use_dx12 = false;
+				use_vulkan = false;
+			}
+			else if (!use_dx12 && !use_vulkan)
 			{
 #if defined(WICKEDENGINE_BUILD_DX12)
 				use_dx12 = true;
@@ -437,9 +459,13 @@ namespace wi
 				assert(false);
 #endif
 			}
-			assert(use_dx12 || use_vulkan);
+			assert(use_dx12 || use_vulkan || use_null);
 
-			if (use_vulkan)
+			if (use_null)
+			{
+				graphicsDevice = std::make_unique<GraphicsDevice_Null>();
+			}
+			else if (use_vulkan)
 			{
 #ifdef WICKEDENGINE_BUILD_VULKAN
 				wi::renderer::SetShaderPath(wi::renderer::GetShaderPath() + "spirv/");
@@ -453,10 +479,26 @@ namespace wi
 				graphicsDevice = std::make_unique<GraphicsDevice_DX12>(debugdevice, gpuvalidation);
 #endif
 			}
+
+			if (graphicsDevice != nullptr && wi::arguments::HasArgument("graphicsrecord"))
+			{
+				// All device calls of the first frames will be recorded and saved, the file can be analyzed with the GraphicsReplay tool:
+				auto recorder = std::make_unique<GraphicsDevice_Recorder>(std::move(graphicsDevice));
+				recorder->SetAutoSave(300, "graphics_recording.wigr");
+				graphicsDevice = std::move(recorder);
+			}
 		}
 		wi::graphics::GetDevice() = graphicsDevice.get();
 
-		canvas.init(window);
+		if (window != nullptr)
+		{
+			canvas.init(window);
+		}
+		else if (canvas.GetPhysicalWidth() == 0 || canvas.GetPhysicalHeight() == 0)
+		{
+			// Headless mode, the canvas size can be specified before SetWindow(), otherwise a default resolution is used:
+			canvas.init(1920, 1080);
+		}
 
 		SwapChainDesc desc;
 		if (swapChain.IsValid())
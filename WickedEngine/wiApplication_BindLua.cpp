@@ -336,6 +336,20 @@ namespace wi::lua
 		return 0;
 	}
 
+	int SaveGPUMemoryUsage(lua_State* L)
+	{
+		int argc = wi::lua::SGetArgCount(L);
+		if (argc > 0)
+		{
+			wi::lua::SSetBool(L, wi::profiler::SaveGPUMemoryUsage(wi::lua::SGetString(L, 1)));
+			return 1;
+		}
+		else
+			wi::lua::SError(L, "SaveGPUMemoryUsage(string filename) not enough arguments!");
+
+		return 0;
+	}
+
 	void Application_BindLua::Bind()
 	{
 		static bool initialized = false;
@@ -345,6 +359,7 @@ namespace wi::lua
 			Luna<Application_BindLua>::Register(wi::lua::GetLuaState());
 
 			wi::lua::RegisterFunc("SetProfilerEnabled", SetProfilerEnabled);
+			wi::lua::RegisterFunc("SaveGPUMemoryUsage", SaveGPUMemoryUsage);
 		}
 	}
 
@@ -474,13 +474,18 @@ namespace wi
 			};
 			device->BindUAVs(uavs, 0, arraysize(uavs), cmd);
 
-			if (mesh != nullptr)
+			if (mesh != nullptr && mesh->IsGeometryReady())
 			{
-				const GPUResource* resources[] = {
-					&mesh->indexBuffer,
-					(mesh->streamoutBuffer_POS.IsValid() ? &mesh->streamoutBuffer_POS : &mesh->vertexBuffer_POS),
-				};
-				device->BindResources(resources, 0, arraysize(resources), cmd);
+				// The mesh geometry is a range of the geometry arena buffers, so it's bound with its views:
+				device->BindResource(mesh->GetIndexBuffer(), 0, cmd, mesh->GetIndexView().subresource);
+				if (mesh->streamoutBuffer_POS.IsValid())
+				{
+					device->BindResource(&mesh->streamoutBuffer_POS, 1, cmd);
+				}
+				else
+				{
+					device->BindResource(mesh->GetVertexBuffer(), 1, cmd, mesh->GetVertexView(MeshComponent::VERTEX_STREAM_POS).subresource);
+				}
 			}
 
 			GPUBarrier barrier_indirect_uav = GPUBarrier::Buffer(&indirectBuffers, ResourceState::INDIRECT_ARGUMENT, ResourceState::UNORDERED_ACCESS);
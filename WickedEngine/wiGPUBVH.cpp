@@ -165,7 +165,10 @@ namespace wi
 				{
 					const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
 
-					for (size_t j = 0; j < mesh.subsets.size(); ++j)
+					uint32_t first_subset = 0;
+					uint32_t last_subset = 0;
+					mesh.GetLODSubsetRange(0, first_subset, last_subset);
+					for (uint32_t j = first_subset; j < last_subset; ++j)
 					{
 						auto& subset = mesh.subsets[j];
 
@@ -0,0 +1,527 @@
+#include "wiGeometryArena.h"
+
+#include <cstring>
+
+using namespace wi::graphics;
+using namespace wi::allocator;
+
+namespace wi::scene
+{
+	const ResourceState GeometryArena::RESTING_STATE = ResourceState::SHADER_RESOURCE | ResourceState::VERTEX_BUFFER | ResourceState::INDEX_BUFFER;
+
+	GeometryArena::Allocation::~Allocation()
+	{
+		if (handle != TLSF::INVALID)
+		{
+			GetGeometryArena().release(*this);
+		}
+	}
+
+	uint32_t GeometryArena::create_block(POOL pool, uint64_t size)
+	{
+		GraphicsDevice* device = GetDevice();
+
+		GPUBufferDesc desc;
+		desc.size = std::max(BLOCK_SIZE, size);
+		desc.bind_flags = BindFlag::SHADER_RESOURCE;
+		const char* name = "";
+		switch (pool)
+		{
+		default:
+		case POOL_VERTEX:
+			desc.bind_flags |= BindFlag::VERTEX_BUFFER;
+			desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
+			name = "GeometryArena::POOL_VERTEX";
+			break;
+		case POOL_INDEX16:
+			desc.bind_flags |= BindFlag::INDEX_BUFFER;
+			desc.format = Format::R16_UINT;
+			desc.stride = sizeof(uint16_t);
+			name = "GeometryArena::POOL_INDEX16";
+			break;
+		case POOL_INDEX32:
+			desc.bind_flags |= BindFlag::INDEX_BUFFER;
+			desc.format = Format::R32_UINT;
+			desc.stride = sizeof(uint32_t);
+			name = "GeometryArena::POOL_INDEX32";
+			break;
+		}
+		if (device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
+		{
+			desc.misc_flags |= ResourceMiscFlag::RAY_TRACING;
+		}
+
+		const uint32_t index = (uint32_t)blocks[pool].size();
+		Block& block = blocks[pool].emplace_back();
+		bool success = device->CreateBuffer(&desc, nullptr, &block.buffer);
+		assert(success);
+		device->SetName(&block.buffer, name);
+		block.allocator.init(desc.size);
+		return index;
+	}
+
+	void GeometryArena::release(Allocation& allocation)
+	{
+		GraphicsDevice* device = GetDevice();
+
+		Retired x;
+		x.pool = allocation.pool;
+		x.block = allocation.block;
+		x.handle = allocation.handle;
+		x.buffer = allocation.buffer;
+		for (const View& view : allocation.views)
+		{
+			if (view.subresource >= 0)
+			{
+				x.subresources.push_back(view.subresource);
+			}
+		}
+		x.frame = device == nullptr ? 0 : device->GetFrameCount();
+
+		locker.lock();
+		retired.push_back(std::move(x));
+		locker.unlock();
+	}
+
+	std::shared_ptr<GeometryArena::Allocation> GeometryArena::Allocate(POOL pool, const Stream* streams, size_t stream_count)
+	{
+		GraphicsDevice* device = GetDevice();
+		const uint64_t alignment = device->GetAllocationMinAlignment();
+
+		auto allocation = std::make_shared<Allocation>();
+		allocation->pool = pool;
+		allocation->views.resize(stream_count);
+
+		// The views are placed after each other, the offsets are relative until the allocation is placed:
+		uint64_t size = 0;
+		wi::vector<Upload> stream_uploads;
+		for (size_t i = 0; i < stream_count; ++i)
+		{
+			View& view = allocation->views[i];
+			view.offset = size;
+			view.size = streams[i].size;
+			size += AlignTo(streams[i].size, alignment);
+
+			if (streams[i].data != nullptr && streams[i].size > 0)
+			{
+				Upload& upload = stream_uploads.emplace_back();
+				upload.allocation = allocation;
+				upload.offset = view.offset;
+				upload.data.resize(streams[i].size);
+				std::memcpy(upload.data.data(), streams[i].data, streams[i].size);
+			}
+		}
+		if (size == 0)
+			return nullptr;
+
+		locker.lock();
+
+		TLSF::Allocation range;
+		uint32_t block_index = 0;
+		for (; block_index < (uint32_t)blocks[pool].size(); ++block_index)
+		{
+			range = blocks[pool][block_index].allocator.allocate(size, alignment);
+			if (range.IsValid())
+				break;
+		}
+		if (!range.IsValid())
+		{
+			block_index = create_block(pool, size);
+			range = blocks[pool][block_index].allocator.allocate(size, alignment);
+		}
+		assert(range.IsValid());
+
+		Block& block = blocks[pool][block_index];
+		if (block.owners.size() <= range.handle)
+		{
+			block.owners.resize(range.handle + 1);
+		}
+		block.owners[range.handle] = allocation;
+
+		allocation->block = block_index;
+		allocation->handle = range.handle;
+		allocation->offset = range.offset;
+		allocation->size = range.size;
+		allocation->buffer = block.buffer;
+		for (View& view : allocation->views)
+		{
+			view.offset += range.offset;
+		}
+
+		pending_views.push_back(allocation);
+		defragment_stalled = false;
+		for (Upload& upload : stream_uploads)
+		{
+			pending_uploads.push_back(std::move(upload));
+		}
+
+		locker.unlock();
+
+		return allocation;
+	}
+
+	void GeometryArena::Write(const std::shared_ptr<Allocation>& allocation, uint64_t offset, const void* data, uint64_t size)
+	{
+		if (allocation == nullptr || data == nullptr || size == 0)
+			return;
+		assert(offset + size <= allocation->size);
+
+		Upload upload;
+		upload.allocation = allocation;
+		upload.offset = offset;
+		upload.data.resize(size);
+		std::memcpy(upload.data.data(), data, size);
+
+		locker.lock();
+		uploads.push_back(std::move(upload));
+		locker.unlock();
+	}
+
+	void GeometryArena::Defragment(uint64_t max_bytes)
+	{
+		locker.lock();
+		defragment_request = max_bytes;
+		locker.unlock();
+	}
+
+	void GeometryArena::Update()
+	{
+		GraphicsDevice* device = GetDevice();
+		const uint64_t frame = device->GetFrameCount();
+
+		// Allocations that are locked here must not be destroyed while the lock is held, because their destructor also locks:
+		wi::vector<std::shared_ptr<Allocation>> keepalive;
+
+		locker.lock();
+
+		// Free the ranges and views that are no longer used by any frame in flight:
+		for (size_t i = 0; i < retired.size();)
+		{
+			Retired& x = retired[i];
+			if (x.frame + GraphicsDevice::GetBufferCount() < frame)
+			{
+				for (int subresource : x.subresources)
+				{
+					device->DeleteSubresource(&x.buffer, SubresourceType::SRV, subresource);
+				}
+				if (x.handle != TLSF::INVALID)
+				{
+					Block& block = blocks[x.pool][x.block];
+					block.allocator.free(x.handle);
+					block.owners[x.handle].reset();
+					defragment_stalled = false;
+				}
+				if (i < retired.size() - 1)
+				{
+					retired[i] = std::move(retired.back());
+				}
+				retired.pop_back();
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		// Fragmented blocks are compacted a little in every frame until they have a single free range:
+		bool automatic = false;
+		if (defragment_request == 0 && moves.empty() && !defragment_stalled)
+		{
+			for (int pool = 0; pool < POOL_COUNT && defragment_request == 0; ++pool)
+			{
+				for (const Block& block : blocks[pool])
+				{
+					const TLSF& allocator = block.allocator;
+					if (allocator.get_free_block_count() > 1 && allocator.get_free() - allocator.get_largest_free_block() >= DEFRAGMENT_THRESHOLD)
+					{
+						defragment_request = DEFRAGMENT_BUDGET;
+						automatic = true;
+						break;
+					}
+				}
+			}
+		}
+
+		// Defragmentation is not started until the copies of the previous one are recorded:
+		if (defragment_request > 0 && moves.empty())
+		{
+			uint64_t budget = defragment_request;
+			defragment_request = 0;
+			wi::vector<TLSF::Move> block_moves;
+			for (int pool = 0; pool < POOL_COUNT && budget > 0; ++pool)
+			{
+				for (uint32_t block_index = 0; block_index < (uint32_t)blocks[pool].size() && budget > 0; ++block_index)
+				{
+					Block& block = blocks[pool][block_index];
+					block_moves.clear();
+					budget -= std::min(budget, block.allocator.defragment(block_moves, budget));
+
+					for (const TLSF::Move& move : block_moves)
+					{
+						auto allocation = block.owners[move.handle].lock();
+						if (allocation == nullptr)
+							continue; // released, the data doesn't need to be preserved
+						keepalive.push_back(allocation);
+
+						BlockMove& block_move = moves.emplace_back();
+						block_move.pool = (POOL)pool;
+						block_move.block = block_index;
+						block_move.move = move;
+
+						// The views are recreated at the new location:
+						Retired x;
+						x.pool = (POOL)pool;
+						x.block = block_index;
+						x.buffer = block.buffer;
+						x.frame = frame;
+						for (View& view : allocation->views)
+						{
+							if (view.subresource >= 0)
+							{
+								x.subresources.push_back(view.subresource);
+							}
+							view.offset = view.offset - move.src_offset + move.dst_offset;
+							view.subresource = -1;
+							view.descriptor = -1;
+						}
+						if (!x.subresources.empty())
+						{
+							retired.push_back(std::move(x));
+						}
+						allocation->offset = move.dst_offset;
+						allocation->generation++;
+						pending_views.push_back(allocation);
+					}
+				}
+			}
+
+			// Allocations that are larger than the budget are never moved automatically:
+			defragment_stalled = automatic && moves.empty();
+		}
+
+		for (auto& x : pending_views)
+		{
+			auto allocation = x.lock();
+			if (allocation == nullptr)
+				continue;
+			keepalive.push_back(allocation);
+			for (View& view : allocation->views)
+			{
+				if (!view.IsValid() || view.subresource >= 0)
+					continue;
+				view.subresource = device->CreateSubresource(&allocation->buffer, SubresourceType::SRV, view.offset, view.size);
+				view.descriptor = device->GetDescriptorIndex(&allocation->buffer, SubresourceType::SRV, view.subresource);
+			}
+		}
+		pending_views.clear();
+
+		for (Upload& upload : pending_uploads)
+		{
+			uploads.push_back(std::move(upload));
+		}
+		pending_uploads.clear();
+
+		locker.unlock();
+	}
+
+	void GeometryArena::Flush(CommandList cmd)
+	{
+		GraphicsDevice* device = GetDevice();
+
+		struct Target
+		{
+			POOL pool = POOL_VERTEX;
+			uint32_t block = 0;
+			GPUBuffer buffer;
+			ResourceState state = ResourceState::UNDEFINED;
+		};
+		wi::vector<Target> targets;
+		struct Copy
+		{
+			uint32_t target = 0;
+			uint64_t src_offset = 0;
+			uint64_t dst_offset = 0;
+			uint64_t size = 0;
+			wi::vector<uint8_t> data;
+		};
+		wi::vector<Copy> block_moves;
+		wi::vector<Copy> block_uploads;
+		wi::vector<std::shared_ptr<Allocation>> keepalive;
+
+		auto get_target = [&](POOL pool, uint32_t block) -> uint32_t {
+			for (uint32_t i = 0; i < (uint32_t)targets.size(); ++i)
+			{
+				if (targets[i].pool == pool && targets[i].block == block)
+					return i;
+			}
+			Block& x = blocks[pool][block];
+			Target& target = targets.emplace_back();
+			target.pool = pool;
+			target.block = block;
+			target.buffer = x.buffer;
+			target.state = x.initialized ? RESTING_STATE : ResourceState::UNDEFINED;
+			x.initialized = true;
+			return (uint32_t)targets.size() - 1;
+		};
+
+		locker.lock();
+		// Blocks that were created without uploads still need to leave the undefined state:
+		for (int pool = 0; pool < POOL_COUNT; ++pool)
+		{
+			for (uint32_t block = 0; block < (uint32_t)blocks[pool].size(); ++block)
+			{
+				if (!blocks[pool][block].initialized)
+				{
+					get_target((POOL)pool, block);
+				}
+			}
+		}
+		for (const BlockMove& x : moves)
+		{
+			Copy& copy = block_moves.emplace_back();
+			copy.target = get_target(x.pool, x.block);
+			copy.src_offset = x.move.src_offset;
+			copy.dst_offset = x.move.dst_offset;
+			copy.size = x.move.size;
+		}
+		moves.clear();
+		for (Upload& x : uploads)
+		{
+			// The destination is resolved now, because the allocation could have been moved since the upload was requested:
+			auto allocation = x.allocation.lock();
+			if (allocation == nullptr)
+				continue;
+			keepalive.push_back(allocation);
+			Copy& copy = block_uploads.emplace_back();
+			copy.target = get_target(allocation->pool, allocation->block);
+			copy.dst_offset = allocation->offset + x.offset;
+			copy.size = x.data.size();
+			copy.data = std::move(x.data);
+		}
+		uploads.clear();
+		locker.unlock();
+		keepalive.clear();
+
+		if (targets.empty())
+			return;
+
+		device->EventBegin("GeometryArena::Flush", cmd);
+
+		wi::vector<GPUBarrier> barriers;
+		auto transition = [&](Target& target, ResourceState state) {
+			if (target.state != state)
+			{
+				barriers.push_back(GPUBarrier::Buffer(&target.buffer, target.state, state));
+				target.state = state;
+			}
+		};
+		auto flush_barriers = [&] {
+			if (!barriers.empty())
+			{
+				device->Barrier(barriers.data(), (uint32_t)barriers.size(), cmd);
+				barriers.clear();
+			}
+		};
+
+		if (!block_moves.empty())
+		{
+			// The source and destination of a move can overlap, so the data is copied through a scratch buffer:
+			const uint64_t alignment = device->GetAllocationMinAlignment();
+			uint64_t scratch_size = 0;
+			for (const Copy& x : block_moves)
+			{
+				scratch_size += AlignTo(x.size, alignment);
+			}
+			if (scratch.desc.size < scratch_size)
+			{
+				GPUBufferDesc desc;
+				desc.size = scratch_size;
+				desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
+				bool success = device->CreateBuffer(&desc, nullptr, &scratch);
+				assert(success);
+				device->SetName(&scratch, "GeometryArena::scratch");
+				scratch_initialized = false;
+			}
+
+			for (const Copy& x : block_moves)
+			{
+				transition(targets[x.target], ResourceState::COPY_SRC);
+			}
+			barriers.push_back(GPUBarrier::Buffer(&scratch, scratch_initialized ? ResourceState::COPY_SRC : ResourceState::UNDEFINED, ResourceState::COPY_DST));
+			flush_barriers();
+
+			uint64_t scratch_offset = 0;
+			for (const Copy& x : block_moves)
+			{
+				device->CopyBuffer(&scratch, scratch_offset, &targets[x.target].buffer, x.src_offset, x.size, cmd);
+				scratch_offset += AlignTo(x.size, alignment);
+			}
+
+			for (const Copy& x : block_moves)
+			{
+				transition(targets[x.target], ResourceState::COPY_DST);
+			}
+			barriers.push_back(GPUBarrier::Buffer(&scratch, ResourceState::COPY_DST, ResourceState::COPY_SRC));
+			flush_barriers();
+			scratch_initialized = true;
+
+			scratch_offset = 0;
+			for (const Copy& x : block_moves)
+			{
+				device->CopyBuffer(&targets[x.target].buffer, x.dst_offset, &scratch, scratch_offset, x.size, cmd);
+				scratch_offset += AlignTo(x.size, alignment);
+			}
+		}
+
+		if (!block_uploads.empty())
+		{
+			for (const Copy& x : block_uploads)
+			{
+				transition(targets[x.target], ResourceState::COPY_DST);
+			}
+			flush_barriers();
+
+			for (const Copy& x : block_uploads)
+			{
+				GraphicsDevice::GPUAllocation mem = device->AllocateGPU(x.size, cmd);
+				std::memcpy(mem.data, x.data.data(), x.size);
+				device->CopyBuffer(&targets[x.target].buffer, x.dst_offset, &mem.buffer, mem.offset, x.size, cmd);
+			}
+		}
+
+		for (Target& target : targets)
+		{
+			transition(target, RESTING_STATE);
+		}
+		flush_barriers();
+
+		device->EventEnd(cmd);
+	}
+
+	GeometryArena::Stats GeometryArena::GetStats() const
+	{
+		Stats stats;
+		locker.lock();
+		for (auto& pool : blocks)
+		{
+			for (auto& block : pool)
+			{
+				stats.block_count++;
+				stats.allocation_count += block.allocator.get_allocation_count();
+				stats.free_range_count += block.allocator.get_free_block_count();
+				stats.capacity += block.allocator.get_capacity();
+				stats.used += block.allocator.get_used();
+				stats.largest_free_range = std::max(stats.largest_free_range, block.allocator.get_largest_free_block());
+			}
+		}
+		locker.unlock();
+		return stats;
+	}
+
+	GeometryArena& GetGeometryArena()
+	{
+		// Never destroyed, because meshes of static scenes can be released after it at exit:
+		static GeometryArena* arena = new GeometryArena;
+		return *arena;
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiGraphicsDevice.h"
+#include "wiAllocator.h"
+#include "wiSpinLock.h"
+#include "wiVector.h"
+
+#include <memory>
+
+namespace wi::scene
+{
+	// Shared vertex and index storage for all meshes
+	//	Mesh geometry is suballocated from a few large GPU buffers (blocks) instead of creating buffers for every mesh
+	//	Index buffers of meshes in the same block can be bound once and drawn with an index offset
+	//	Allocations can be moved by defragmentation, the Allocation object is updated in place when that happens
+	//	Fragmented blocks are defragmented automatically by Update(), a limited amount of data is moved in every frame
+	class GeometryArena
+	{
+	public:
+		enum POOL
+		{
+			POOL_VERTEX,	// raw buffers, vertex streams
+			POOL_INDEX16,	// typed R16_UINT buffers
+			POOL_INDEX32,	// typed R32_UINT buffers
+			POOL_COUNT
+		};
+		static constexpr uint64_t BLOCK_SIZE = 64ull * 1024ull * 1024ull; // allocations that are larger will get a dedicated block
+		static constexpr uint64_t DEFRAGMENT_THRESHOLD = BLOCK_SIZE / 8; // free bytes of a block outside of its largest free range that start automatic defragmentation
+		static constexpr uint64_t DEFRAGMENT_BUDGET = 4ull * 1024ull * 1024ull; // bytes moved per frame by automatic defragmentation
+		static const wi::graphics::ResourceState RESTING_STATE; // state of the block buffers outside of Flush()
+
+		// Shader resource view of one stream inside an allocation
+		struct View
+		{
+			uint64_t offset = 0; // byte offset in the block buffer
+			uint64_t size = 0;
+			int subresource = -1;
+			int descriptor = -1; // bindless descriptor, -1 until the arena is updated after the allocation
+
+			constexpr bool IsValid() const { return size > 0; }
+		};
+
+		struct Allocation
+		{
+			POOL pool = POOL_VERTEX;
+			uint32_t block = 0;
+			uint32_t handle = wi::allocator::TLSF::INVALID;
+			uint64_t offset = 0; // byte offset in the block buffer
+			uint64_t size = 0;
+			wi::graphics::GPUBuffer buffer; // the block buffer
+			wi::vector<View> views;
+			uint32_t generation = 0; // incremented every time the allocation is moved
+
+			~Allocation();
+		};
+
+		// Source data for one view of an allocation, data can be nullptr to leave it uninitialized
+		struct Stream
+		{
+			const void* data = nullptr;
+			uint64_t size = 0;
+		};
+
+		// Allocates a range for all the streams, each stream gets a view that is aligned for binding
+		//	The data is copied and uploaded in the next Flush(), the views become usable after the next Update()
+		//	This can be called from any thread
+		std::shared_ptr<Allocation> Allocate(POOL pool, const Stream* streams, size_t stream_count);
+
+		// Overwrites part of an allocation in the next Flush(), offset is relative to the allocation's start
+		void Write(const std::shared_ptr<Allocation>& allocation, uint64_t offset, const void* data, uint64_t size);
+
+		// Requests moving allocations in the next Update(), max_bytes limits the amount of data moved per request
+		//	This is done automatically for fragmented blocks, an explicit request can compact every block at once
+		void Defragment(uint64_t max_bytes = ~0ull);
+
+		// Creates descriptors of new allocations, releases the ones that are no longer used by the GPU and performs requested defragmentation
+		//	Must be called on the main thread before the mesh shader data is written
+		void Update();
+
+		// Records uploads and defragmentation copies into a command list, must be called before rendering with the geometry
+		//	New blocks are transitioned to RESTING_STATE here, even if nothing was uploaded into them
+		void Flush(wi::graphics::CommandList cmd);
+
+		struct Stats
+		{
+			uint32_t block_count = 0;
+			uint32_t allocation_count = 0;
+			uint32_t free_range_count = 0;
+			uint64_t capacity = 0;
+			uint64_t used = 0;
+			uint64_t largest_free_range = 0;
+		};
+		Stats GetStats() const;
+
+	private:
+		struct Block
+		{
+			wi::graphics::GPUBuffer buffer;
+			wi::allocator::TLSF allocator;
+			wi::vector<std::weak_ptr<Allocation>> owners; // indexed by allocator handle
+			bool initialized = false; // the first barrier is from undefined state
+		};
+		wi::vector<Block> blocks[POOL_COUNT];
+
+		struct Upload
+		{
+			std::weak_ptr<Allocation> allocation;
+			uint64_t offset = 0;
+			wi::vector<uint8_t> data;
+		};
+		wi::vector<Upload> pending_uploads; // activated in the next Update()
+		wi::vector<Upload> uploads; // recorded in the next Flush()
+		wi::vector<std::weak_ptr<Allocation>> pending_views;
+
+		struct Retired
+		{
+			POOL pool = POOL_VERTEX;
+			uint32_t block = 0;
+			uint32_t handle = wi::allocator::TLSF::INVALID; // INVALID when only the views are retired
+			wi::graphics::GPUBuffer buffer;
+			wi::vector<int> subresources;
+			uint64_t frame = 0;
+		};
+		wi::vector<Retired> retired;
+
+		struct BlockMove
+		{
+			POOL pool = POOL_VERTEX;
+			uint32_t block = 0;
+			wi::allocator::TLSF::Move move;
+		};
+		wi::vector<BlockMove> moves;
+		wi::graphics::GPUBuffer scratch;
+		bool scratch_initialized = false;
+		uint64_t defragment_request = 0;
+		bool defragment_stalled = false; // automatic defragmentation couldn't move anything, it is retried after the next allocation or release
+
+		mutable wi::SpinLock locker;
+
+		uint32_t create_block(POOL pool, uint64_t size);
+		void release(Allocation& allocation);
+	};
+
+	// The arena is shared by all scenes, because meshes can be moved between scenes
+	GeometryArena& GetGeometryArena();
+}
@@ -775,6 +775,34 @@ namespace wi::graphics
 		int32_t bottom = 0;
 	};
 
+	struct GPUMemoryUsage
+	{
+		enum class Category
+		{
+			BUFFER,
+			TEXTURE,
+			RENDERTARGET,	// textures with RENDER_TARGET or DEPTH_STENCIL bind flag
+			ACCELERATION_STRUCTURE,
+			COUNT
+		};
+		struct Allocations
+		{
+			uint32_t count = 0;
+			uint64_t size = 0;	// in bytes
+		};
+		struct NamedResource
+		{
+			std::string name;	// set with GraphicsDevice::SetName(), resources without name are listed as "unnamed"
+			Category category = Category::BUFFER;
+			Allocations allocations;
+		};
+
+		uint64_t budget = 0;	// device local memory in bytes that the process can use without problems, reported by the operating system
+		uint64_t usage = 0;		// device local memory in bytes that the process is using currently
+		Allocations categories[size_t(Category::COUNT)];
+		wi::vector<NamedResource> named_resources;	// grouped by name and category, sorted by size in descending order
+	};
+
 
 	// Resources:
 
@@ -2,10 +2,15 @@
 #include "CommonInclude.h"
 #include "wiGraphics.h"
 #include "wiPlatform.h"
+#include "wiSpinLock.h"
+#include "wiVector.h"
+#include "wiUnorderedMap.h"
 
 #include <cassert>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <string>
 
 namespace wi::graphics
 {
@@ -57,6 +62,102 @@ namespace wi::graphics
 		QUEUE_COUNT,
 	};
 
+	// Tracks the memory of live resources by category and name, the graphics device implementations can use it to implement GetMemoryUsage()
+	//	The resources are identified by a key that is unique while they are alive, for example the allocation handle
+	//	Resources are distributed to multiple locks by their key, so threads creating and destroying resources don't contend much
+	class GPUMemoryTracker
+	{
+		struct Entry
+		{
+			GPUMemoryUsage::Category category = GPUMemoryUsage::Category::BUFFER;
+			uint64_t size = 0;
+			std::string name;
+		};
+		struct Shard
+		{
+			wi::SpinLock locker;
+			wi::unordered_map<const void*, Entry> entries;
+		};
+		static constexpr uint32_t SHARD_COUNT = 16;
+		mutable Shard shards[SHARD_COUNT];
+
+		Shard& GetShard(const void* key) const
+		{
+			return shards[(std::hash<const void*>{}(key) >> 4) % SHARD_COUNT];
+		}
+
+	public:
+		void Add(const void* key, GPUMemoryUsage::Category category, uint64_t size)
+		{
+			if (key == nullptr)
+				return;
+			Shard& shard = GetShard(key);
+			shard.locker.lock();
+			Entry& entry = shard.entries[key];
+			entry.category = category;
+			entry.size = size;
+			entry.name.clear();
+			shard.locker.unlock();
+		}
+		void Remove(const void* key)
+		{
+			if (key == nullptr)
+				return;
+			Shard& shard = GetShard(key);
+			shard.locker.lock();
+			shard.entries.erase(key);
+			shard.locker.unlock();
+		}
+		void SetName(const void* key, const char* name)
+		{
+			if (key == nullptr)
+				return;
+			Shard& shard = GetShard(key);
+			shard.locker.lock();
+			auto it = shard.entries.find(key);
+			if (it != shard.entries.end())
+			{
+				it->second.name = name == nullptr ? "" : name;
+			}
+			shard.locker.unlock();
+		}
+
+		// Fills the categories and named_resources of the memory usage
+		void Fill(GPUMemoryUsage& usage) const
+		{
+			wi::unordered_map<std::string, size_t> named_lookup;
+			for (auto& shard : shards)
+			{
+				shard.locker.lock();
+				for (auto& x : shard.entries)
+				{
+					const Entry& entry = x.second;
+					GPUMemoryUsage::Allocations& category = usage.categories[size_t(entry.category)];
+					category.count++;
+					category.size += entry.size;
+
+					std::string name = entry.name.empty() ? "unnamed" : entry.name;
+					name += (char)entry.category; // resources with the same name but different category are listed separately
+					auto it = named_lookup.find(name);
+					if (it == named_lookup.end())
+					{
+						it = named_lookup.insert({ name, usage.named_resources.size() }).first;
+						GPUMemoryUsage::NamedResource& named = usage.named_resources.emplace_back();
+						named.name = entry.name.empty() ? "unnamed" : entry.name;
+						named.category = entry.category;
+					}
+					GPUMemoryUsage::NamedResource& named = usage.named_resources[it->second];
+					named.allocations.count++;
+					named.allocations.size += entry.size;
+				}
+				shard.locker.unlock();
+			}
+			std::sort(usage.named_resources.begin(), usage.named_resources.end(), [](const GPUMemoryUsage::NamedResource& a, const GPUMemoryUsage::NamedResource& b) {
+				return a.allocations.size > b.allocations.size;
+			});
+		}
+	};
+
 	class GraphicsDevice
 	{
 	protected:
@@ -87,6 +188,9 @@ namespace wi::graphics
 		
 		virtual int CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const = 0;
 		virtual int CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size = ~0) const = 0;
+		// Frees the descriptor of a buffer subresource that was created with CreateSubresource(), it must not be used after this
+		//	The index of the deleted subresource is not reused by the buffer
+		virtual void DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const = 0;
 
 		virtual int GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource = -1) const = 0;
 		virtual int GetDescriptorIndex(const Sampler* sampler) const = 0;
@@ -134,6 +238,11 @@ namespace wi::graphics
 		constexpr size_t GetTopLevelAccelerationStructureInstanceSize() const { return TOPLEVEL_ACCELERATION_STRUCTURE_INSTANCE_SIZE; }
 		constexpr uint32_t GetVariableRateShadingTileSize() const { return VARIABLE_RATE_SHADING_TILE_SIZE; }
 		constexpr uint64_t GetTimestampFrequency() const { return TIMESTAMP_FREQUENCY; }
+		constexpr uint64_t GetAllocationMinAlignment() const { return ALLOCATION_MIN_ALIGNMENT; }
+
+		// Returns the memory budget, usage and the memory of live resources by category and name
+		//	Resource names are assigned by SetName()
+		virtual GPUMemoryUsage GetMemoryUsage() const { return {}; }
 
 		// Get the shader binary format that the underlying graphics API consumes
 		virtual ShaderFormat GetShaderFormat() const = 0;
@@ -206,13 +315,72 @@ namespace wi::graphics
 
 		// Some useful helpers:
 
+	protected:
+		// The upload ring is one large persistently mapped UPLOAD buffer per frame in flight, divided into fixed size pages
+		//	Command lists take pages with an atomic increment and suballocate from them linearly
+		//	A ring is reused when its buffer index comes around again, at that point the frame fence was already waited on by SubmitCommandLists()
+		//	If a frame needs more pages than the ring has, the extra pages are created as separate buffers and the ring is enlarged when it's reused
+		static constexpr uint64_t UPLOAD_RING_PAGE_SIZE = 64ull * 1024ull;
+		static constexpr uint64_t UPLOAD_RING_INITIAL_PAGE_COUNT = 64;
+		struct GPUUploadRing
+		{
+			GPUBuffer buffer;
+			uint64_t page_count = 0;
+			std::atomic<uint64_t> next_page{ 0 };
+			std::atomic<uint64_t> frame_index{ ~0ull };
+			wi::SpinLock locker;
+			wi::vector<GPUBuffer> overflow_buffers;
+		} upload_rings[BUFFERCOUNT];
+		std::atomic<uint64_t> upload_ring_high_water_pages{ 0 };
+		std::atomic<uint64_t> upload_ring_overflow_count{ 0 };
+
 		struct GPULinearAllocator
 		{
 			GPUBuffer buffer;
-			uint64_t offset = 0;
+			uint64_t offset = 0;	// next free byte in buffer
+			uint64_t end = 0;		// end of the pages that this command list owns in buffer
+			uint64_t allocated = 0;	// total allocated bytes in the current frame
 			uint64_t frame_index = 0;
-		} frame_allocators[BUFFERCOUNT][COMMANDLIST_COUNT];
+		} frame_allocators[COMMANDLIST_COUNT];
+
+		GPUBuffer CreateUploadRingBuffer(uint64_t page_count, const char* name)
+		{
+			GPUBufferDesc desc;
+			desc.usage = Usage::UPLOAD;
+			desc.size = page_count * UPLOAD_RING_PAGE_SIZE;
+			desc.bind_flags = BindFlag::CONSTANT_BUFFER | BindFlag::VERTEX_BUFFER | BindFlag::INDEX_BUFFER | BindFlag::SHADER_RESOURCE;
+			desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
+			GPUBuffer buffer;
+			CreateBuffer(&desc, nullptr, &buffer);
+			SetName(&buffer, name);
+			return buffer;
+		}
 
+		GPUUploadRing& GetUploadRing()
+		{
+			GPUUploadRing& ring = upload_rings[GetBufferIndex()];
+			if (ring.frame_index.load(std::memory_order_acquire) != FRAMECOUNT)
+			{
+				// The first allocation of the frame restarts the ring, other threads wait for it here:
+				ring.locker.lock();
+				if (ring.frame_index.load(std::memory_order_relaxed) != FRAMECOUNT)
+				{
+					const uint64_t required_pages = std::max(ring.next_page.load(std::memory_order_relaxed), UPLOAD_RING_INITIAL_PAGE_COUNT);
+					if (required_pages > ring.page_count)
+					{
+						ring.page_count = AlignTo(required_pages, UPLOAD_RING_INITIAL_PAGE_COUNT);
+						ring.buffer = CreateUploadRingBuffer(ring.page_count, "upload_ring");
+					}
+					ring.overflow_buffers.clear();
+					ring.next_page.store(0, std::memory_order_relaxed);
+					ring.frame_index.store(FRAMECOUNT, std::memory_order_release);
+				}
+				ring.locker.unlock();
+			}
+			return ring;
+		}
+
+	public:
 		struct GPUAllocation
 		{
 			void* data = nullptr;	// application can write to this. Reads might be not supported or slow. The offset is already applied
@@ -231,36 +399,62 @@ namespace wi::graphics
 			if (dataSize == 0)
 				return allocation;
 
-			GPULinearAllocator& allocator = frame_allocators[GetBufferIndex()][cmd];
+			GPULinearAllocator& allocator = frame_allocators[cmd];
 			if (FRAMECOUNT != allocator.frame_index)
 			{
 				allocator.frame_index = FRAMECOUNT;
+				allocator.buffer = {};
 				allocator.offset = 0;
+				allocator.end = 0;
+				allocator.allocated = 0;
 			}
 
-			const uint64_t free_space = allocator.buffer.desc.size - allocator.offset;
-			if (dataSize > free_space)
+			const uint64_t aligned_size = AlignTo(dataSize, ALLOCATION_MIN_ALIGNMENT);
+			if (aligned_size > allocator.end - allocator.offset)
 			{
-				GPUBufferDesc desc;
-				desc.usage = Usage::UPLOAD;
-				desc.size = AlignTo((allocator.buffer.desc.size + dataSize) * 2, ALLOCATION_MIN_ALIGNMENT);
-				desc.bind_flags = BindFlag::CONSTANT_BUFFER | BindFlag::VERTEX_BUFFER | BindFlag::INDEX_BUFFER | BindFlag::SHADER_RESOURCE;
-				desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-				CreateBuffer(&desc, nullptr, &allocator.buffer);
-				SetName(&allocator.buffer, "frame_allocator");
-				allocator.offset = 0;
+				// Take new pages from the ring, large allocations take multiple consecutive pages:
+				GPUUploadRing& ring = GetUploadRing();
+				const uint64_t page_count = (aligned_size + UPLOAD_RING_PAGE_SIZE - 1) / UPLOAD_RING_PAGE_SIZE;
+				const uint64_t first_page = ring.next_page.fetch_add(page_count, std::memory_order_relaxed);
+				const uint64_t used_pages = first_page + page_count;
+
+				uint64_t high_water = upload_ring_high_water_pages.load(std::memory_order_relaxed);
+				while (used_pages > high_water && !upload_ring_high_water_pages.compare_exchange_weak(high_water, used_pages, std::memory_order_relaxed)) {}
+
+				if (used_pages <= ring.page_count)
+				{
+					allocator.buffer = ring.buffer;
+					allocator.offset = first_page * UPLOAD_RING_PAGE_SIZE;
+				}
+				else
+				{
+					// The ring is full, this is only expected until the rings have grown to the high water mark:
+					allocator.buffer = CreateUploadRingBuffer(page_count, "upload_ring_overflow");
+					allocator.offset = 0;
+					ring.locker.lock();
+					ring.overflow_buffers.push_back(allocator.buffer);
+					ring.locker.unlock();
+					upload_ring_overflow_count.fetch_add(1, std::memory_order_relaxed);
+				}
+				allocator.end = allocator.offset + page_count * UPLOAD_RING_PAGE_SIZE;
 			}
 
 			allocation.buffer = allocator.buffer;
 			allocation.offset = allocator.offset;
 			allocation.data = (void*)((size_t)allocator.buffer.mapped_data + allocator.offset);
 
-			allocator.offset += AlignTo(dataSize, ALLOCATION_MIN_ALIGNMENT);
+			allocator.offset += aligned_size;
+			allocator.allocated += aligned_size;
 
 			assert(allocation.IsValid());
 			return allocation;
 		}
 
+		// Returns the most upload ring memory that was used by a single frame in bytes
+		uint64_t GetUploadRingHighWaterMark() const { return upload_ring_high_water_pages.load(std::memory_order_relaxed) * UPLOAD_RING_PAGE_SIZE; }
+		// Returns how many times the upload ring was full and a separate buffer had to be created
+		uint64_t GetUploadRingOverflowCount() const { return upload_ring_overflow_count.load(std::memory_order_relaxed); }
+
 		// Updates a Usage::DEFAULT buffer data
 		//	Since it uses a GPU Copy operation, appropriate synchronization is expected
 		//	And it cannot be used inside a RenderPass
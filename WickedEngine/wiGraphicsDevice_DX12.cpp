@@ -1312,6 +1312,7 @@ namespace dx12_internal
 
 		virtual ~Resource_DX12()
 		{
+			allocationhandler->memorytracker.Remove(allocation);
 			allocationhandler->destroylocker.lock();
 			uint64_t framecount = allocationhandler->framecount;
 			if (allocation) allocationhandler->destroyer_allocations.push_back(std::make_pair(allocation, framecount));
@@ -2967,6 +2968,10 @@ using namespace dx12_internal;
 			IID_PPV_ARGS(&internal_state->resource)
 		);
 		assert(SUCCEEDED(hr));
+		if (SUCCEEDED(hr))
+		{
+			allocationhandler->memorytracker.Add(internal_state->allocation, GPUMemoryUsage::Category::BUFFER, internal_state->allocation->GetSize());
+		}
 
 		internal_state->gpu_address = internal_state->resource->GetGPUVirtualAddress();
 
@@ -3141,6 +3146,12 @@ using namespace dx12_internal;
 			IID_PPV_ARGS(&internal_state->resource)
 		);
 		assert(SUCCEEDED(hr));
+		if (SUCCEEDED(hr))
+		{
+			const GPUMemoryUsage::Category category = has_flag(pDesc->bind_flags, BindFlag::RENDER_TARGET) || has_flag(pDesc->bind_flags, BindFlag::DEPTH_STENCIL) ?
+				GPUMemoryUsage::Category::RENDERTARGET : GPUMemoryUsage::Category::TEXTURE;
+			allocationhandler->memorytracker.Add(internal_state->allocation, category, internal_state->allocation->GetSize());
+		}
 
 		if (pTexture->desc.usage == Usage::READBACK)
 		{
@@ -3921,6 +3932,10 @@ using namespace dx12_internal;
 			IID_PPV_ARGS(&internal_state->resource)
 		);
 		assert(SUCCEEDED(hr));
+		if (SUCCEEDED(hr))
+		{
+			allocationhandler->memorytracker.Add(internal_state->allocation, GPUMemoryUsage::Category::ACCELERATION_STRUCTURE, internal_state->allocation->GetSize());
+		}
 
 		internal_state->gpu_address = internal_state->resource->GetGPUVirtualAddress();
 
@@ -4530,6 +4545,17 @@ using namespace dx12_internal;
 		return -1;
 	}
 
+	void GraphicsDevice_DX12::DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const
+	{
+		if (buffer == nullptr || !buffer->IsValid() || subresource < 0)
+			return;
+		auto internal_state = to_internal(buffer);
+		auto& subresources = type == SubresourceType::SRV ? internal_state->subresources_srv : internal_state->subresources_uav;
+		assert(size_t(subresource) < subresources.size());
+		subresources[subresource].destroy();
+		subresources[subresource] = {};
+	}
+
 	int GraphicsDevice_DX12::GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource) const
 	{
 		if (resource == nullptr || !resource->IsValid())
@@ -4610,9 +4636,21 @@ using namespace dx12_internal;
 			{
 				internal_state->resource->SetName(text);
 			}
+			allocationhandler->memorytracker.SetName(internal_state->allocation, name);
 		}
 	}
 
+	GPUMemoryUsage GraphicsDevice_DX12::GetMemoryUsage() const
+	{
+		GPUMemoryUsage result;
+		D3D12MA::Budget budget;
+		allocationhandler->allocator->GetBudget(&budget, nullptr);
+		result.budget = budget.BudgetBytes;
+		result.usage = budget.UsageBytes;
+		allocationhandler->memorytracker.Fill(result);
+		return result;
+	}
+
 	CommandList GraphicsDevice_DX12::BeginCommandList(QUEUE_TYPE queue)
 	{
 		HRESULT hr;
@@ -163,6 +163,7 @@ namespace wi::graphics
 		
 		int CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const override;
 		int CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size = ~0) const override;
+		void DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const override;
 
 		int GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource = -1) const override;
 		int GetDescriptorIndex(const Sampler* sampler) const override;
@@ -180,6 +181,8 @@ namespace wi::graphics
 		void ClearPipelineStateCache() override;
 		size_t GetActivePipelineCount() const override { return pipelines_global.size(); }
 
+		GPUMemoryUsage GetMemoryUsage() const override;
+
 		ShaderFormat GetShaderFormat() const override { return ShaderFormat::HLSL6; }
 
 		Texture GetBackBuffer(const SwapChain* swapchain) const override;
@@ -273,6 +276,7 @@ namespace wi::graphics
 			Microsoft::WRL::ComPtr<ID3D12Device> device;
 			uint64_t framecount = 0;
 			std::mutex destroylocker;
+			GPUMemoryTracker memorytracker;
 
 			struct DescriptorAllocator
 			{
@@ -0,0 +1,428 @@
+#include "wiGraphicsDevice_Null.h"
+#include "wiHelper.h"
+#include "wiBacklog.h"
+
+#include <chrono>
+
+namespace wi::graphics
+{
+	namespace Null_Internal
+	{
+		struct Resource_Null
+		{
+			std::shared_ptr<GraphicsDevice_Null::AllocationHandler> allocationhandler;
+			wi::vector<uint8_t> memory; // only for UPLOAD and READBACK resources
+			int srv_index = -1;
+			int uav_index = -1;
+			wi::vector<int> subresources_srv_index;
+			wi::vector<int> subresources_uav_index;
+			uint32_t subresources_rtv_count = 0;
+			uint32_t subresources_dsv_count = 0;
+
+			~Resource_Null()
+			{
+				if (allocationhandler == nullptr)
+					return;
+				allocationhandler->Free(srv_index);
+				allocationhandler->Free(uav_index);
+				for (int index : subresources_srv_index)
+				{
+					allocationhandler->Free(index);
+				}
+				for (int index : subresources_uav_index)
+				{
+					allocationhandler->Free(index);
+				}
+			}
+		};
+		struct Sampler_Null
+		{
+			std::shared_ptr<GraphicsDevice_Null::AllocationHandler> allocationhandler;
+			int index = -1;
+
+			~Sampler_Null()
+			{
+				if (allocationhandler == nullptr)
+					return;
+				allocationhandler->Free(index);
+			}
+		};
+		struct SwapChain_Null
+		{
+			Texture backbuffer;
+		};
+		struct Object_Null
+		{
+		};
+
+		Resource_Null* to_internal(const GPUResource* param)
+		{
+			return static_cast<Resource_Null*>(param->internal_state.get());
+		}
+		Sampler_Null* to_internal(const Sampler* param)
+		{
+			return static_cast<Sampler_Null*>(param->internal_state.get());
+		}
+		SwapChain_Null* to_internal(const SwapChain* param)
+		{
+			return static_cast<SwapChain_Null*>(param->internal_state.get());
+		}
+
+		// Returns the memory size of a texture mip chain, used for CPU-visible textures:
+		uint64_t ComputeTextureMemorySize(const TextureDesc& desc, uint32_t& rowpitch)
+		{
+			const uint32_t block_size = GetFormatBlockSize(desc.format);
+			const uint32_t stride = GetFormatStride(desc.format);
+			rowpitch = std::max(1u, (desc.width + block_size - 1) / block_size) * stride;
+
+			uint64_t size = 0;
+			for (uint32_t mip = 0; mip < desc.mip_levels; ++mip)
+			{
+				const uint32_t width = std::max(1u, desc.width >> mip);
+				const uint32_t height = std::max(1u, desc.height >> mip);
+				const uint32_t depth = std::max(1u, desc.depth >> mip);
+				const uint64_t rows = std::max(1u, (height + block_size - 1) / block_size);
+				const uint64_t row_size = std::max(1u, (width + block_size - 1) / block_size) * stride;
+				size += row_size * rows * depth;
+			}
+			return size * desc.array_size;
+		}
+	}
+	using namespace Null_Internal;
+
+	GraphicsDevice_Null::GraphicsDevice_Null()
+	{
+		allocationhandler = std::make_shared<AllocationHandler>();
+
+		ALLOCATION_MIN_ALIGNMENT = 256;
+		TIMESTAMP_FREQUENCY = 1000000000ull; // QueryResolve writes timestamps in nanoseconds
+		capabilities = GraphicsDeviceCapability::NONE;
+
+		wi::backlog::post("Created GraphicsDevice_Null (no GPU rendering)");
+	}
+	GraphicsDevice_Null::~GraphicsDevice_Null()
+	{
+	}
+
+	bool GraphicsDevice_Null::CreateSwapChain(const SwapChainDesc* pDesc, wi::platform::window_type window, SwapChain* swapChain) const
+	{
+		auto internal_state = std::static_pointer_cast<SwapChain_Null>(swapChain->internal_state);
+		if (swapChain->internal_state == nullptr)
+		{
+			internal_state = std::make_shared<SwapChain_Null>();
+		}
+		swapChain->internal_state = internal_state;
+		swapChain->desc = *pDesc;
+
+		TextureDesc desc;
+		desc.width = pDesc->width;
+		desc.height = pDesc->height;
+		desc.format = pDesc->format;
+		desc.bind_flags = BindFlag::RENDER_TARGET;
+		desc.layout = ResourceState::RENDERTARGET;
+		return CreateTexture(&desc, nullptr, &internal_state->backbuffer);
+	}
+	bool GraphicsDevice_Null::CreateBuffer(const GPUBufferDesc *pDesc, const void* pInitialData, GPUBuffer *pBuffer) const
+	{
+		auto internal_state = std::make_shared<Resource_Null>();
+		internal_state->allocationhandler = allocationhandler;
+		pBuffer->internal_state = internal_state;
+		pBuffer->type = GPUResource::Type::BUFFER;
+		pBuffer->mapped_data = nullptr;
+		pBuffer->mapped_rowpitch = 0;
+
+		pBuffer->desc = *pDesc;
+
+		if (pDesc->usage == Usage::UPLOAD || pDesc->usage == Usage::READBACK)
+		{
+			internal_state->memory.resize(pDesc->size);
+			pBuffer->mapped_data = internal_state->memory.data();
+			pBuffer->mapped_rowpitch = static_cast<uint32_t>(pDesc->size);
+			if (pInitialData != nullptr)
+			{
+				std::memcpy(pBuffer->mapped_data, pInitialData, pDesc->size);
+			}
+		}
+
+		// Create resource views if needed
+		if (has_flag(pDesc->bind_flags, BindFlag::SHADER_RESOURCE))
+		{
+			CreateSubresource(pBuffer, SubresourceType::SRV, 0);
+		}
+		if (has_flag(pDesc->bind_flags, BindFlag::UNORDERED_ACCESS))
+		{
+			CreateSubresource(pBuffer, SubresourceType::UAV, 0);
+		}
+
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateTexture(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture *pTexture) const
+	{
+		auto internal_state = std::make_shared<Resource_Null>();
+		internal_state->allocationhandler = allocationhandler;
+		pTexture->internal_state = internal_state;
+		pTexture->type = GPUResource::Type::TEXTURE;
+		pTexture->mapped_data = nullptr;
+		pTexture->mapped_rowpitch = 0;
+
+		pTexture->desc = *pDesc;
+
+		if (pTexture->desc.mip_levels == 0)
+		{
+			pTexture->desc.mip_levels = (uint32_t)log2(std::max(pTexture->desc.width, pTexture->desc.height)) + 1;
+		}
+
+		if (pDesc->usage == Usage::UPLOAD || pDesc->usage == Usage::READBACK)
+		{
+			uint32_t rowpitch = 0;
+			internal_state->memory.resize(ComputeTextureMemorySize(pTexture->desc, rowpitch));
+			pTexture->mapped_data = internal_state->memory.data();
+			pTexture->mapped_rowpitch = rowpitch;
+
+			if (pInitialData != nullptr)
+			{
+				// Subresources are tightly packed in the same order as pInitialData: mips of the first slice, then the next slice
+				const uint32_t block_size = GetFormatBlockSize(pTexture->desc.format);
+				const uint32_t stride = GetFormatStride(pTexture->desc.format);
+				uint8_t* dst = internal_state->memory.data();
+				uint32_t subresource = 0;
+				for (uint32_t slice = 0; slice < pTexture->desc.array_size; ++slice)
+				{
+					for (uint32_t mip = 0; mip < pTexture->desc.mip_levels; ++mip)
+					{
+						const SubresourceData& data = pInitialData[subresource++];
+						const uint32_t width = std::max(1u, pTexture->desc.width >> mip);
+						const uint32_t height = std::max(1u, pTexture->desc.height >> mip);
+						const uint32_t depth = std::max(1u, pTexture->desc.depth >> mip);
+						const uint32_t rows = std::max(1u, (height + block_size - 1) / block_size);
+						const uint32_t row_size = std::max(1u, (width + block_size - 1) / block_size) * stride;
+						for (uint32_t z = 0; z < depth; ++z)
+						{
+							for (uint32_t y = 0; y < rows; ++y)
+							{
+								const uint8_t* src = (const uint8_t*)data.data_ptr + z * data.slice_pitch + y * data.row_pitch;
+								std::memcpy(dst, src, row_size);
+								dst += row_size;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		if (has_flag(pTexture->desc.bind_flags, BindFlag::RENDER_TARGET))
+		{
+			CreateSubresource(pTexture, SubresourceType::RTV, 0, -1, 0, -1);
+		}
+		if (has_flag(pTexture->desc.bind_flags, BindFlag::DEPTH_STENCIL))
+		{
+			CreateSubresource(pTexture, SubresourceType::DSV, 0, -1, 0, -1);
+		}
+		if (has_flag(pTexture->desc.bind_flags, BindFlag::SHADER_RESOURCE))
+		{
+			CreateSubresource(pTexture, SubresourceType::SRV, 0, -1, 0, -1);
+		}
+		if (has_flag(pTexture->desc.bind_flags, BindFlag::UNORDERED_ACCESS))
+		{
+			CreateSubresource(pTexture, SubresourceType::UAV, 0, -1, 0, -1);
+		}
+
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateShader(ShaderStage stage, const void *pShaderBytecode, size_t BytecodeLength, Shader *pShader) const
+	{
+		pShader->internal_state = std::make_shared<Object_Null>();
+		pShader->stage = stage;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateSampler(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState) const
+	{
+		auto internal_state = std::make_shared<Sampler_Null>();
+		internal_state->allocationhandler = allocationhandler;
+		internal_state->index = allocationhandler->Allocate();
+		pSamplerState->internal_state = internal_state;
+		pSamplerState->desc = *pSamplerDesc;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateQueryHeap(const GPUQueryHeapDesc *pDesc, GPUQueryHeap *pQueryHeap) const
+	{
+		pQueryHeap->internal_state = std::make_shared<Object_Null>();
+		pQueryHeap->desc = *pDesc;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreatePipelineState(const PipelineStateDesc* pDesc, PipelineState* pso) const
+	{
+		pso->internal_state = std::make_shared<Object_Null>();
+		pso->desc = *pDesc;
+		pipeline_count.fetch_add(1);
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateRenderPass(const RenderPassDesc* pDesc, RenderPass* renderpass) const
+	{
+		renderpass->internal_state = std::make_shared<Object_Null>();
+		renderpass->desc = *pDesc;
+		renderpass->hash = 0;
+		wi::helper::hash_combine(renderpass->hash, pDesc->attachments.size());
+		for (auto& attachment : pDesc->attachments)
+		{
+			if (attachment.type == RenderPassAttachment::Type::RENDERTARGET || attachment.type == RenderPassAttachment::Type::DEPTH_STENCIL)
+			{
+				wi::helper::hash_combine(renderpass->hash, attachment.texture->desc.format);
+				wi::helper::hash_combine(renderpass->hash, attachment.texture->desc.sample_count);
+			}
+		}
+		return true;
+	}
+
+	int GraphicsDevice_Null::CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const
+	{
+		auto internal_state = to_internal(texture);
+
+		switch (type)
+		{
+		case SubresourceType::SRV:
+		case SubresourceType::UAV:
+		{
+			int& default_index = type == SubresourceType::SRV ? internal_state->srv_index : internal_state->uav_index;
+			auto& subresources = type == SubresourceType::SRV ? internal_state->subresources_srv_index : internal_state->subresources_uav_index;
+			const int index = allocationhandler->Allocate();
+			if (default_index == -1)
+			{
+				default_index = index;
+				return -1;
+			}
+			subresources.push_back(index);
+			return int(subresources.size() - 1);
+		}
+		case SubresourceType::RTV:
+			return int(internal_state->subresources_rtv_count++) - 1;
+		case SubresourceType::DSV:
+			return int(internal_state->subresources_dsv_count++) - 1;
+		default:
+			break;
+		}
+		return -1;
+	}
+	int GraphicsDevice_Null::CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size) const
+	{
+		auto internal_state = to_internal(buffer);
+
+		switch (type)
+		{
+		case SubresourceType::SRV:
+		case SubresourceType::UAV:
+		{
+			int& default_index = type == SubresourceType::SRV ? internal_state->srv_index : internal_state->uav_index;
+			auto& subresources = type == SubresourceType::SRV ? internal_state->subresources_srv_index : internal_state->subresources_uav_index;
+			const int index = allocationhandler->Allocate();
+			if (default_index == -1)
+			{
+				default_index = index;
+				return -1;
+			}
+			subresources.push_back(index);
+			return int(subresources.size() - 1);
+		}
+		default:
+			assert(0);
+			break;
+		}
+		return -1;
+	}
+
+	void GraphicsDevice_Null::DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const
+	{
+		if (buffer == nullptr || !buffer->IsValid() || subresource < 0)
+			return;
+		auto internal_state = to_internal(buffer);
+		auto& subresources = type == SubresourceType::SRV ? internal_state->subresources_srv_index : internal_state->subresources_uav_index;
+		assert(size_t(subresource) < subresources.size());
+		allocationhandler->Free(subresources[subresource]);
+		subresources[subresource] = -1;
+	}
+
+	int GraphicsDevice_Null::GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource) const
+	{
+		if (resource == nullptr || !resource->IsValid() || resource->IsAccelerationStructure())
+			return -1;
+
+		auto internal_state = to_internal(resource);
+		switch (type)
+		{
+		default:
+		case SubresourceType::SRV:
+			return subresource < 0 ? internal_state->srv_index : internal_state->subresources_srv_index[subresource];
+		case SubresourceType::UAV:
+			return subresource < 0 ? internal_state->uav_index : internal_state->subresources_uav_index[subresource];
+		}
+		return -1;
+	}
+	int GraphicsDevice_Null::GetDescriptorIndex(const Sampler* sampler) const
+	{
+		if (sampler == nullptr || !sampler->IsValid())
+			return -1;
+
+		return to_internal(sampler)->index;
+	}
+
+	CommandList GraphicsDevice_Null::BeginCommandList(QUEUE_TYPE queue)
+	{
+		CommandList cmd;
+		cmd.index = (CommandList::index_type)cmd_count.fetch_add(1);
+		assert(cmd.index < COMMANDLIST_COUNT);
+		active_renderpass[cmd] = nullptr;
+		return cmd;
+	}
+	void GraphicsDevice_Null::SubmitCommandLists()
+	{
+		cmd_count.store(0);
+		FRAMECOUNT++;
+	}
+
+	Texture GraphicsDevice_Null::GetBackBuffer(const SwapChain* swapchain) const
+	{
+		return to_internal(swapchain)->backbuffer;
+	}
+
+	void GraphicsDevice_Null::CopyResource(const GPUResource* pDst, const GPUResource* pSrc, CommandList cmd)
+	{
+		// Copies are only executed between CPU-visible resources, everything else is GPU memory that doesn't exist here:
+		auto internal_state_dst = to_internal(pDst);
+		auto internal_state_src = to_internal(pSrc);
+		const size_t size = std::min(internal_state_dst->memory.size(), internal_state_src->memory.size());
+		if (size > 0)
+		{
+			std::memcpy(internal_state_dst->memory.data(), internal_state_src->memory.data(), size);
+		}
+	}
+	void GraphicsDevice_Null::CopyBuffer(const GPUBuffer* pDst, uint64_t dst_offset, const GPUBuffer* pSrc, uint64_t src_offset, uint64_t size, CommandList cmd)
+	{
+		auto internal_state_dst = to_internal(pDst);
+		auto internal_state_src = to_internal(pSrc);
+		if (internal_state_dst->memory.empty() || internal_state_src->memory.empty())
+			return;
+		assert(dst_offset + size <= internal_state_dst->memory.size());
+		assert(src_offset + size <= internal_state_src->memory.size());
+		std::memcpy(internal_state_dst->memory.data() + dst_offset, internal_state_src->memory.data() + src_offset, size);
+	}
+	void GraphicsDevice_Null::QueryResolve(const GPUQueryHeap* heap, uint32_t index, uint32_t count, const GPUBuffer* dest, uint64_t dest_offset, CommandList cmd)
+	{
+		auto internal_state_dst = to_internal(dest);
+		if (internal_state_dst->memory.empty())
+			return;
+		assert(dest_offset + count * sizeof(uint64_t) <= internal_state_dst->memory.size());
+		uint64_t* results = (uint64_t*)(internal_state_dst->memory.data() + dest_offset);
+
+		// Occlusion queries report everything as visible, so that CPU work is not skipped for objects as if they were occluded
+		//	Timestamps are taken from the CPU clock
+		uint64_t value = 1;
+		if (heap->desc.type == GpuQueryType::TIMESTAMP)
+		{
+			value = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+		}
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			results[i] = value;
+		}
+	}
+}
@@ -0,0 +1,138 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiPlatform.h"
+#include "wiGraphicsDevice.h"
+#include "wiSpinLock.h"
+#include "wiVector.h"
+
+#include <memory>
+#include <atomic>
+
+namespace wi::graphics
+{
+	// Graphics device that doesn't use a GPU:
+	//	- UPLOAD and READBACK resources are backed by CPU memory, so they can be mapped, written and read
+	//	- Descriptor indices are allocated like on a real device, so bindless code paths work the same way
+	//	- Draws, dispatches and barriers are not executed
+	//	This can be used to run the engine without a GPU (servers, automated testing) and to measure CPU-side rendering cost
+	class GraphicsDevice_Null final : public GraphicsDevice
+	{
+	public:
+		struct AllocationHandler
+		{
+			wi::SpinLock locker;
+			int next_descriptor = 0;
+			wi::vector<int> free_descriptors;
+
+			int Allocate()
+			{
+				locker.lock();
+				int index = next_descriptor;
+				if (free_descriptors.empty())
+				{
+					next_descriptor++;
+				}
+				else
+				{
+					index = free_descriptors.back();
+					free_descriptors.pop_back();
+				}
+				locker.unlock();
+				return index;
+			}
+			void Free(int index)
+			{
+				if (index < 0)
+					return;
+				locker.lock();
+				free_descriptors.push_back(index);
+				locker.unlock();
+			}
+		};
+
+	protected:
+		std::shared_ptr<AllocationHandler> allocationhandler;
+
+		std::atomic<uint32_t> cmd_count{ 0 };
+		const RenderPass* active_renderpass[COMMANDLIST_COUNT] = {};
+		mutable std::atomic<size_t> pipeline_count{ 0 };
+
+	public:
+		GraphicsDevice_Null();
+		~GraphicsDevice_Null() override;
+
+		bool CreateSwapChain(const SwapChainDesc* pDesc, wi::platform::window_type window, SwapChain* swapChain) const override;
+		bool CreateBuffer(const GPUBufferDesc *pDesc, const void* pInitialData, GPUBuffer *pBuffer) const override;
+		bool CreateTexture(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture *pTexture) const override;
+		bool CreateShader(ShaderStage stage, const void *pShaderBytecode, size_t BytecodeLength, Shader *pShader) const override;
+		bool CreateSampler(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState) const override;
+		bool CreateQueryHeap(const GPUQueryHeapDesc *pDesc, GPUQueryHeap *pQueryHeap) const override;
+		bool CreatePipelineState(const PipelineStateDesc* pDesc, PipelineState* pso) const override;
+		bool CreateRenderPass(const RenderPassDesc* pDesc, RenderPass* renderpass) const override;
+
+		int CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const override;
+		int CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size = ~0) const override;
+		void DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const override;
+
+		int GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource = -1) const override;
+		int GetDescriptorIndex(const Sampler* sampler) const override;
+
+		void SetName(GPUResource* pResource, const char* name) override {}
+
+		CommandList BeginCommandList(QUEUE_TYPE queue = QUEUE_GRAPHICS) override;
+		void SubmitCommandLists() override;
+
+		void WaitForGPU() const override {}
+		void ClearPipelineStateCache() override { pipeline_count.store(0); }
+		size_t GetActivePipelineCount() const override { return pipeline_count.load(); }
+
+		ShaderFormat GetShaderFormat() const override { return ShaderFormat::NONE; }
+
+		Texture GetBackBuffer(const SwapChain* swapchain) const override;
+		ColorSpace GetSwapChainColorSpace(const SwapChain* swapchain) const override { return ColorSpace::SRGB; }
+		bool IsSwapChainSupportsHDR(const SwapChain* swapchain) const override { return false; }
+
+		///////////////Thread-sensitive////////////////////////
+
+		void WaitCommandList(CommandList cmd, CommandList wait_for) override {}
+		void RenderPassBegin(const SwapChain* swapchain, CommandList cmd) override { active_renderpass[cmd] = nullptr; }
+		void RenderPassBegin(const RenderPass* renderpass, CommandList cmd) override { active_renderpass[cmd] = renderpass; }
+		void RenderPassEnd(CommandList cmd) override { active_renderpass[cmd] = nullptr; }
+		void BindScissorRects(uint32_t numRects, const Rect* rects, CommandList cmd) override {}
+		void BindViewports(uint32_t NumViewports, const Viewport* pViewports, CommandList cmd) override {}
+		void BindResource(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override {}
+		void BindResources(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override {}
+		void BindUAV(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override {}
+		void BindUAVs(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override {}
+		void BindSampler(const Sampler* sampler, uint32_t slot, CommandList cmd) override {}
+		void BindConstantBuffer(const GPUBuffer* buffer, uint32_t slot, CommandList cmd, uint64_t offset = 0ull) override {}
+		void BindVertexBuffers(const GPUBuffer *const* vertexBuffers, uint32_t slot, uint32_t count, const uint32_t* strides, const uint64_t* offsets, CommandList cmd) override {}
+		void BindIndexBuffer(const GPUBuffer* indexBuffer, const IndexBufferFormat format, uint64_t offset, CommandList cmd) override {}
+		void BindStencilRef(uint32_t value, CommandList cmd) override {}
+		void BindBlendFactor(float r, float g, float b, float a, CommandList cmd) override {}
+		void BindPipelineState(const PipelineState* pso, CommandList cmd) override {}
+		void BindComputeShader(const Shader* cs, CommandList cmd) override {}
+		void BindDepthBounds(float min_bounds, float max_bounds, CommandList cmd) override {}
+		void Draw(uint32_t vertexCount, uint32_t startVertexLocation, CommandList cmd) override {}
+		void DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation, CommandList cmd) override {}
+		void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override {}
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override {}
+		void DrawInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override {}
+		void DrawIndexedInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override {}
+		void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd) override {}
+		void DispatchIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override {}
+		void CopyResource(const GPUResource* pDst, const GPUResource* pSrc, CommandList cmd) override;
+		void CopyBuffer(const GPUBuffer* pDst, uint64_t dst_offset, const GPUBuffer* pSrc, uint64_t src_offset, uint64_t size, CommandList cmd) override;
+		void QueryBegin(const GPUQueryHeap *heap, uint32_t index, CommandList cmd) override {}
+		void QueryEnd(const GPUQueryHeap *heap, uint32_t index, CommandList cmd) override {}
+		void QueryResolve(const GPUQueryHeap* heap, uint32_t index, uint32_t count, const GPUBuffer* dest, uint64_t dest_offset, CommandList cmd) override;
+		void Barrier(const GPUBarrier* barriers, uint32_t numBarriers, CommandList cmd) override {}
+		void PushConstants(const void* data, uint32_t size, CommandList cmd, uint32_t offset = 0) override {}
+
+		void EventBegin(const char* name, CommandList cmd) override {}
+		void EventEnd(CommandList cmd) override {}
+		void SetMarker(const char* name, CommandList cmd) override {}
+
+		const RenderPass* GetCurrentRenderPass(CommandList cmd) const override { return active_renderpass[cmd]; }
+	};
+}
@@ -0,0 +1,1991 @@
+#include "wiGraphicsDevice_Recorder.h"
+#include "wiHelper.h"
+#include "wiBacklog.h"
+#include "wiTimer.h"
+
+#include <sstream>
+#include <iomanip>
+
+namespace wi::graphics
+{
+	namespace Recorder_Internal
+	{
+		static constexpr uint32_t RECORDING_MAGIC = 0x52474957; // "WIGR"
+		static constexpr uint32_t RECORDING_VERSION = 2;
+
+		enum class Op : uint8_t
+		{
+			// Device:
+			CREATE_SWAPCHAIN,
+			CREATE_BUFFER,
+			CREATE_TEXTURE,
+			CREATE_SHADER,
+			CREATE_SAMPLER,
+			CREATE_QUERYHEAP,
+			CREATE_PIPELINESTATE,
+			CREATE_RENDERPASS,
+			CREATE_RAYTRACING_ACCELERATION_STRUCTURE,
+			CREATE_RAYTRACING_PIPELINESTATE,
+			CREATE_SUBRESOURCE_TEXTURE,
+			CREATE_SUBRESOURCE_BUFFER,
+			DELETE_SUBRESOURCE_BUFFER,
+			BACKBUFFER,
+			SUBMIT,
+
+			// Command list:
+			ALLOCATE,
+			WAIT_COMMANDLIST,
+			RENDERPASS_BEGIN_SWAPCHAIN,
+			RENDERPASS_BEGIN,
+			RENDERPASS_END,
+			BIND_SCISSOR_RECTS,
+			BIND_VIEWPORTS,
+			BIND_RESOURCE,
+			BIND_RESOURCES,
+			BIND_UAV,
+			BIND_UAVS,
+			BIND_SAMPLER,
+			BIND_CONSTANT_BUFFER,
+			BIND_VERTEX_BUFFERS,
+			BIND_INDEX_BUFFER,
+			BIND_STENCIL_REF,
+			BIND_BLEND_FACTOR,
+			BIND_SHADING_RATE,
+			BIND_PIPELINESTATE,
+			BIND_COMPUTE_SHADER,
+			BIND_DEPTH_BOUNDS,
+			DRAW,
+			DRAW_INDEXED,
+			DRAW_INSTANCED,
+			DRAW_INDEXED_INSTANCED,
+			DRAW_INSTANCED_INDIRECT,
+			DRAW_INDEXED_INSTANCED_INDIRECT,
+			DISPATCH,
+			DISPATCH_INDIRECT,
+			DISPATCH_MESH,
+			DISPATCH_MESH_INDIRECT,
+			COPY_RESOURCE,
+			COPY_BUFFER,
+			QUERY_BEGIN,
+			QUERY_END,
+			QUERY_RESOLVE,
+			QUERY_RESET,
+			BARRIER,
+			BUILD_RAYTRACING_ACCELERATION_STRUCTURE,
+			BIND_RAYTRACING_PIPELINESTATE,
+			DISPATCH_RAYS,
+			PUSH_CONSTANTS,
+			PREDICATION_BEGIN,
+			PREDICATION_END,
+			EVENT_BEGIN,
+			EVENT_END,
+			SET_MARKER,
+		};
+
+		inline void write_data(wi::vector<uint8_t>& stream, const void* data, size_t size)
+		{
+			if (size == 0)
+				return;
+			const size_t pos = stream.size();
+			stream.resize(pos + size);
+			std::memcpy(stream.data() + pos, data, size);
+		}
+		template<typename T>
+		inline void write(wi::vector<uint8_t>& stream, const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be recorded!");
+			write_data(stream, &value, sizeof(T));
+		}
+		inline void write_string(wi::vector<uint8_t>& stream, const char* str)
+		{
+			const uint32_t length = str == nullptr ? 0 : (uint32_t)strlen(str);
+			write(stream, length);
+			write_data(stream, str, length);
+		}
+
+		struct Reader
+		{
+			const uint8_t* data = nullptr;
+			size_t size = 0;
+			size_t pos = 0;
+			bool failed = false;
+
+			const uint8_t* read_data(size_t count)
+			{
+				if (failed || count > size - pos)
+				{
+					failed = true;
+					return nullptr;
+				}
+				const uint8_t* ret = data + pos;
+				pos += count;
+				return ret;
+			}
+			template<typename T>
+			T read()
+			{
+				T value = {};
+				const uint8_t* src = read_data(sizeof(T));
+				if (src != nullptr)
+				{
+					std::memcpy(&value, src, sizeof(T));
+				}
+				return value;
+			}
+			std::string read_string()
+			{
+				const uint32_t length = read<uint32_t>();
+				const uint8_t* src = read_data(length);
+				if (src == nullptr)
+					return {};
+				return std::string((const char*)src, length);
+			}
+			bool end() const { return failed || pos >= size; }
+		};
+	}
+	using namespace Recorder_Internal;
+
+	GraphicsDevice_Recorder::GraphicsDevice_Recorder(std::unique_ptr<GraphicsDevice>&& device) : device(std::move(device))
+	{
+		GraphicsDevice* target = this->device.get();
+		assert(target != nullptr);
+
+		FRAMECOUNT = target->GetFrameCount();
+		DEBUGDEVICE = target->IsDebugDevice();
+		SHADER_IDENTIFIER_SIZE = target->GetShaderIdentifierSize();
+		TOPLEVEL_ACCELERATION_STRUCTURE_INSTANCE_SIZE = target->GetTopLevelAccelerationStructureInstanceSize();
+		VARIABLE_RATE_SHADING_TILE_SIZE = target->GetVariableRateShadingTileSize();
+		TIMESTAMP_FREQUENCY = target->GetTimestampFrequency();
+		ALLOCATION_MIN_ALIGNMENT = target->GetAllocationMinAlignment();
+		capabilities = GraphicsDeviceCapability::NONE;
+		for (uint32_t i = 0; i < 32; ++i)
+		{
+			const GraphicsDeviceCapability capability = (GraphicsDeviceCapability)(1u << i);
+			if (target->CheckCapability(capability))
+			{
+				capabilities |= capability;
+			}
+		}
+
+		write(recording, RECORDING_MAGIC);
+		write(recording, RECORDING_VERSION);
+		write(recording, ALLOCATION_MIN_ALIGNMENT);
+
+		wi::backlog::post("Created GraphicsDevice_Recorder");
+	}
+	GraphicsDevice_Recorder::~GraphicsDevice_Recorder()
+	{
+	}
+
+	// Owns the internal state of a registered object, and removes the object from the registry when the last copy of the object is destroyed
+	struct GraphicsDevice_Recorder::RegisteredState
+	{
+		std::shared_ptr<void> state;
+		std::shared_ptr<ObjectRegistry> registry;
+		const void* key = nullptr;
+		uint32_t id = 0;
+
+		~RegisteredState()
+		{
+			registry->locker.lock();
+			auto it = registry->ids.find(key);
+			if (it != registry->ids.end() && it->second == id) // the object could have been registered again with a newer id
+			{
+				registry->ids.erase(it);
+			}
+			registry->locker.unlock();
+		}
+	};
+
+	uint32_t GraphicsDevice_Recorder::RegisterObject(GraphicsDeviceChild* object) const
+	{
+		// The internal state identifies an object, because copies of the same object share it
+		//	The locker must be held by the caller
+		const uint32_t id = next_id++;
+		const void* key = object->internal_state.get();
+
+		// The internal state is replaced by an aliasing pointer to the same state, so the wrapped device sees no difference,
+		//	but the registry entry is removed before the state is destroyed and its address can be reused by a new object:
+		auto registered = std::make_shared<RegisteredState>();
+		registered->state = std::move(object->internal_state);
+		registered->registry = registry;
+		registered->key = key;
+		registered->id = id;
+		object->internal_state = std::shared_ptr<void>(registered, const_cast<void*>(key));
+
+		registry->locker.lock();
+		registry->ids[key] = id;
+		registry->locker.unlock();
+		return id;
+	}
+	uint32_t GraphicsDevice_Recorder::GetObjectID(const GraphicsDeviceChild* object) const
+	{
+		if (object == nullptr || !object->IsValid())
+			return 0;
+		registry->locker.lock();
+		auto it = registry->ids.find(object->internal_state.get());
+		const uint32_t id = it == registry->ids.end() ? 0 : it->second;
+		registry->locker.unlock();
+		return id;
+	}
+	void GraphicsDevice_Recorder::TrackAllocations(CommandList cmd)
+	{
+		// AllocateGPU() is not virtual, so the allocations are detected by the frame allocator movement before each command:
+		const GPULinearAllocator& allocator = frame_allocators[cmd];
+		const uint64_t allocated = allocator.frame_index == FRAMECOUNT ? allocator.allocated : 0;
+		CommandStream& stream = streams[cmd];
+		if (allocated != stream.allocated)
+		{
+			write(stream.data, Op::ALLOCATE);
+			write(stream.data, allocated - stream.allocated);
+			stream.allocated = allocated;
+		}
+	}
+
+	bool GraphicsDevice_Recorder::SaveRecording(const std::string& filename) const
+	{
+		locker.lock();
+		bool success = wi::helper::FileWrite(filename, recording.data(), recording.size());
+		locker.unlock();
+		if (success)
+		{
+			wi::backlog::post("Graphics recording saved: " + filename + " (" + std::to_string(recorded_frames) + " frames, " + std::to_string(recording.size()) + " bytes)");
+		}
+		else
+		{
+			wi::backlog::post("Graphics recording could not be saved: " + filename, wi::backlog::LogLevel::Error);
+		}
+		return success;
+	}
+
+	bool GraphicsDevice_Recorder::CreateSwapChain(const SwapChainDesc* pDesc, wi::platform::window_type window, SwapChain* swapChain) const
+	{
+		bool success = device->CreateSwapChain(pDesc, window, swapChain);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_SWAPCHAIN);
+			write(recording, RegisterObject(swapChain));
+			write(recording, *pDesc);
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateBuffer(const GPUBufferDesc *pDesc, const void* pInitialData, GPUBuffer *pBuffer) const
+	{
+		bool success = device->CreateBuffer(pDesc, pInitialData, pBuffer);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_BUFFER);
+			write(recording, RegisterObject(pBuffer));
+			write(recording, *pDesc);
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateTexture(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture *pTexture) const
+	{
+		bool success = device->CreateTexture(pDesc, pInitialData, pTexture);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_TEXTURE);
+			write(recording, RegisterObject(pTexture));
+			write(recording, *pDesc);
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateShader(ShaderStage stage, const void *pShaderBytecode, size_t BytecodeLength, Shader *pShader) const
+	{
+		bool success = device->CreateShader(stage, pShaderBytecode, BytecodeLength, pShader);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_SHADER);
+			write(recording, RegisterObject(pShader));
+			write(recording, stage);
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateSampler(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState) const
+	{
+		bool success = device->CreateSampler(pSamplerDesc, pSamplerState);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_SAMPLER);
+			write(recording, RegisterObject(pSamplerState));
+			write(recording, *pSamplerDesc);
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateQueryHeap(const GPUQueryHeapDesc *pDesc, GPUQueryHeap *pQueryHeap) const
+	{
+		bool success = device->CreateQueryHeap(pDesc, pQueryHeap);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_QUERYHEAP);
+			write(recording, RegisterObject(pQueryHeap));
+			write(recording, *pDesc);
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreatePipelineState(const PipelineStateDesc* pDesc, PipelineState* pso) const
+	{
+		bool success = device->CreatePipelineState(pDesc, pso);
+		if (success && recording_enabled)
+		{
+			// Only the identity of the pipeline is recorded, it is enough to detect pipeline changes:
+			locker.lock();
+			write(recording, Op::CREATE_PIPELINESTATE);
+			write(recording, RegisterObject(pso));
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateRenderPass(const RenderPassDesc* pDesc, RenderPass* renderpass) const
+	{
+		bool success = device->CreateRenderPass(pDesc, renderpass);
+		if (success && recording_enabled)
+		{
+			wi::vector<uint32_t> texture_ids(pDesc->attachments.size());
+			for (size_t i = 0; i < pDesc->attachments.size(); ++i)
+			{
+				texture_ids[i] = GetObjectID(pDesc->attachments[i].texture);
+			}
+
+			locker.lock();
+			write(recording, Op::CREATE_RENDERPASS);
+			write(recording, RegisterObject(renderpass));
+			write(recording, pDesc->flags);
+			write(recording, (uint32_t)pDesc->attachments.size());
+			for (size_t i = 0; i < pDesc->attachments.size(); ++i)
+			{
+				const RenderPassAttachment& attachment = pDesc->attachments[i];
+				write(recording, attachment.type);
+				write(recording, attachment.loadop);
+				write(recording, texture_ids[i]);
+				write(recording, attachment.subresource);
+				write(recording, attachment.storeop);
+				write(recording, attachment.initial_layout);
+				write(recording, attachment.subpass_layout);
+				write(recording, attachment.final_layout);
+			}
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateRaytracingAccelerationStructure(const RaytracingAccelerationStructureDesc* pDesc, RaytracingAccelerationStructure* bvh) const
+	{
+		bool success = device->CreateRaytracingAccelerationStructure(pDesc, bvh);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_RAYTRACING_ACCELERATION_STRUCTURE);
+			write(recording, RegisterObject(bvh));
+			locker.unlock();
+		}
+		return success;
+	}
+	bool GraphicsDevice_Recorder::CreateRaytracingPipelineState(const RaytracingPipelineStateDesc* pDesc, RaytracingPipelineState* rtpso) const
+	{
+		bool success = device->CreateRaytracingPipelineState(pDesc, rtpso);
+		if (success && recording_enabled)
+		{
+			locker.lock();
+			write(recording, Op::CREATE_RAYTRACING_PIPELINESTATE);
+			write(recording, RegisterObject(rtpso));
+			locker.unlock();
+		}
+		return success;
+	}
+
+	int GraphicsDevice_Recorder::CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const
+	{
+		int subresource = device->CreateSubresource(texture, type, firstSlice, sliceCount, firstMip, mipCount);
+		if (recording_enabled)
+		{
+			const uint32_t id = GetObjectID(texture);
+			locker.lock();
+			write(recording, Op::CREATE_SUBRESOURCE_TEXTURE);
+			write(recording, id);
+			write(recording, type);
+			write(recording, firstSlice);
+			write(recording, sliceCount);
+			write(recording, firstMip);
+			write(recording, mipCount);
+			locker.unlock();
+		}
+		return subresource;
+	}
+	int GraphicsDevice_Recorder::CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size) const
+	{
+		int subresource = device->CreateSubresource(buffer, type, offset, size);
+		if (recording_enabled)
+		{
+			const uint32_t id = GetObjectID(buffer);
+			locker.lock();
+			write(recording, Op::CREATE_SUBRESOURCE_BUFFER);
+			write(recording, id);
+			write(recording, type);
+			write(recording, offset);
+			write(recording, size);
+			locker.unlock();
+		}
+		return subresource;
+	}
+	void GraphicsDevice_Recorder::DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const
+	{
+		device->DeleteSubresource(buffer, type, subresource);
+		if (recording_enabled)
+		{
+			const uint32_t id = GetObjectID(buffer);
+			locker.lock();
+			write(recording, Op::DELETE_SUBRESOURCE_BUFFER);
+			write(recording, id);
+			write(recording, type);
+			write(recording, subresource);
+			locker.unlock();
+		}
+	}
+
+	CommandList GraphicsDevice_Recorder::BeginCommandList(QUEUE_TYPE queue)
+	{
+		CommandList cmd = device->BeginCommandList(queue);
+		CommandStream& stream = streams[cmd];
+		stream.data.clear();
+		stream.queue = queue;
+		stream.active = true;
+		const GPULinearAllocator& allocator = frame_allocators[cmd];
+		stream.allocated = allocator.frame_index == FRAMECOUNT ? allocator.allocated : 0;
+		return cmd;
+	}
+	void GraphicsDevice_Recorder::SubmitCommandLists()
+	{
+		if (recording_enabled)
+		{
+			for (CommandList::index_type cmd = 0; cmd < COMMANDLIST_COUNT; ++cmd)
+			{
+				if (streams[cmd].active)
+				{
+					TrackAllocations(CommandList{ cmd });
+				}
+			}
+
+			uint32_t count = 0;
+			for (auto& stream : streams)
+			{
+				count += stream.active ? 1 : 0;
+			}
+
+			locker.lock();
+			write(recording, Op::SUBMIT);
+			write(recording, count);
+			for (auto& stream : streams)
+			{
+				if (!stream.active)
+					continue;
+				write(recording, stream.queue);
+				write(recording, (uint64_t)stream.data.size());
+				write_data(recording, stream.data.data(), stream.data.size());
+			}
+			locker.unlock();
+			recorded_frames++;
+		}
+		for (auto& stream : streams)
+		{
+			stream.active = false;
+			stream.data.clear();
+		}
+
+		device->SubmitCommandLists();
+		FRAMECOUNT = device->GetFrameCount();
+
+		if (recording_enabled && autosave_frames > 0 && recorded_frames >= autosave_frames)
+		{
+			recording_enabled = false;
+			SaveRecording(autosave_filename);
+		}
+	}
+
+	Texture GraphicsDevice_Recorder::GetBackBuffer(const SwapChain* swapchain) const
+	{
+		Texture backbuffer = device->GetBackBuffer(swapchain);
+		if (recording_enabled && backbuffer.IsValid())
+		{
+			// The back buffer can be a new object every time, so it is always registered again:
+			locker.lock();
+			write(recording, Op::BACKBUFFER);
+			write(recording, RegisterObject(&backbuffer));
+			write(recording, backbuffer.desc);
+			locker.unlock();
+		}
+		return backbuffer;
+	}
+
+	void GraphicsDevice_Recorder::WaitCommandList(CommandList cmd, CommandList wait_for)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::WAIT_COMMANDLIST);
+			write(stream, wait_for.index);
+		}
+		device->WaitCommandList(cmd, wait_for);
+	}
+	void GraphicsDevice_Recorder::RenderPassBegin(const SwapChain* swapchain, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::RENDERPASS_BEGIN_SWAPCHAIN);
+			write(stream, GetObjectID(swapchain));
+		}
+		device->RenderPassBegin(swapchain, cmd);
+	}
+	void GraphicsDevice_Recorder::RenderPassBegin(const RenderPass* renderpass, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::RENDERPASS_BEGIN);
+			write(stream, GetObjectID(renderpass));
+		}
+		device->RenderPassBegin(renderpass, cmd);
+	}
+	void GraphicsDevice_Recorder::RenderPassEnd(CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			write(streams[cmd].data, Op::RENDERPASS_END);
+		}
+		device->RenderPassEnd(cmd);
+	}
+	void GraphicsDevice_Recorder::BindScissorRects(uint32_t numRects, const Rect* rects, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_SCISSOR_RECTS);
+			write(stream, numRects);
+			write_data(stream, rects, sizeof(Rect) * numRects);
+		}
+		device->BindScissorRects(numRects, rects, cmd);
+	}
+	void GraphicsDevice_Recorder::BindViewports(uint32_t NumViewports, const Viewport* pViewports, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_VIEWPORTS);
+			write(stream, NumViewports);
+			write_data(stream, pViewports, sizeof(Viewport) * NumViewports);
+		}
+		device->BindViewports(NumViewports, pViewports, cmd);
+	}
+	void GraphicsDevice_Recorder::BindResource(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_RESOURCE);
+			write(stream, GetObjectID(resource));
+			write(stream, slot);
+			write(stream, subresource);
+		}
+		device->BindResource(resource, slot, cmd, subresource);
+	}
+	void GraphicsDevice_Recorder::BindResources(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_RESOURCES);
+			write(stream, slot);
+			write(stream, count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				write(stream, GetObjectID(resources[i]));
+			}
+		}
+		device->BindResources(resources, slot, count, cmd);
+	}
+	void GraphicsDevice_Recorder::BindUAV(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_UAV);
+			write(stream, GetObjectID(resource));
+			write(stream, slot);
+			write(stream, subresource);
+		}
+		device->BindUAV(resource, slot, cmd, subresource);
+	}
+	void GraphicsDevice_Recorder::BindUAVs(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_UAVS);
+			write(stream, slot);
+			write(stream, count);
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				write(stream, GetObjectID(resources[i]));
+			}
+		}
+		device->BindUAVs(resources, slot, count, cmd);
+	}
+	void GraphicsDevice_Recorder::BindSampler(const Sampler* sampler, uint32_t slot, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_SAMPLER);
+			write(stream, GetObjectID(sampler));
+			write(stream, slot);
+		}
+		device->BindSampler(sampler, slot, cmd);
+	}
+	void GraphicsDevice_Recorder::BindConstantBuffer(const GPUBuffer* buffer, uint32_t slot, CommandList cmd, uint64_t offset)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_CONSTANT_BUFFER);
+			write(stream, GetObjectID(buffer));
+			write(stream, slot);
+			write(stream, offset);
+		}
+		device->BindConstantBuffer(buffer, slot, cmd, offset);
+	}
+	void GraphicsDevice_Recorder::BindVertexBuffers(const GPUBuffer *const* vertexBuffers, uint32_t slot, uint32_t count, const uint32_t* strides, const uint64_t* offsets, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_VERTEX_BUFFERS);
+			write(stream, slot);
+			write(stream, count);
+			write(stream, (uint8_t)(strides != nullptr ? 1 : 0));
+			write(stream, (uint8_t)(offsets != nullptr ? 1 : 0));
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				write(stream, GetObjectID(vertexBuffers[i]));
+			}
+			if (strides != nullptr)
+			{
+				write_data(stream, strides, sizeof(uint32_t) * count);
+			}
+			if (offsets != nullptr)
+			{
+				write_data(stream, offsets, sizeof(uint64_t) * count);
+			}
+		}
+		device->BindVertexBuffers(vertexBuffers, slot, count, strides, offsets, cmd);
+	}
+	void GraphicsDevice_Recorder::BindIndexBuffer(const GPUBuffer* indexBuffer, const IndexBufferFormat format, uint64_t offset, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_INDEX_BUFFER);
+			write(stream, GetObjectID(indexBuffer));
+			write(stream, format);
+			write(stream, offset);
+		}
+		device->BindIndexBuffer(indexBuffer, format, offset, cmd);
+	}
+	void GraphicsDevice_Recorder::BindStencilRef(uint32_t value, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_STENCIL_REF);
+			write(stream, value);
+		}
+		device->BindStencilRef(value, cmd);
+	}
+	void GraphicsDevice_Recorder::BindBlendFactor(float r, float g, float b, float a, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_BLEND_FACTOR);
+			write(stream, r);
+			write(stream, g);
+			write(stream, b);
+			write(stream, a);
+		}
+		device->BindBlendFactor(r, g, b, a, cmd);
+	}
+	void GraphicsDevice_Recorder::BindShadingRate(ShadingRate rate, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_SHADING_RATE);
+			write(stream, rate);
+		}
+		device->BindShadingRate(rate, cmd);
+	}
+	void GraphicsDevice_Recorder::BindPipelineState(const PipelineState* pso, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_PIPELINESTATE);
+			write(stream, GetObjectID(pso));
+		}
+		device->BindPipelineState(pso, cmd);
+	}
+	void GraphicsDevice_Recorder::BindComputeShader(const Shader* cs, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_COMPUTE_SHADER);
+			write(stream, GetObjectID(cs));
+		}
+		device->BindComputeShader(cs, cmd);
+	}
+	void GraphicsDevice_Recorder::BindDepthBounds(float min_bounds, float max_bounds, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_DEPTH_BOUNDS);
+			write(stream, min_bounds);
+			write(stream, max_bounds);
+		}
+		device->BindDepthBounds(min_bounds, max_bounds, cmd);
+	}
+	void GraphicsDevice_Recorder::Draw(uint32_t vertexCount, uint32_t startVertexLocation, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DRAW);
+			write(stream, vertexCount);
+			write(stream, startVertexLocation);
+		}
+		device->Draw(vertexCount, startVertexLocation, cmd);
+	}
+	void GraphicsDevice_Recorder::DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DRAW_INDEXED);
+			write(stream, indexCount);
+			write(stream, startIndexLocation);
+			write(stream, baseVertexLocation);
+		}
+		device->DrawIndexed(indexCount, startIndexLocation, baseVertexLocation, cmd);
+	}
+	void GraphicsDevice_Recorder::DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertexLocation, uint32_t startInstanceLocation, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DRAW_INSTANCED);
+			write(stream, vertexCount);
+			write(stream, instanceCount);
+			write(stream, startVertexLocation);
+			write(stream, startInstanceLocation);
+		}
+		device->DrawInstanced(vertexCount, instanceCount, startVertexLocation, startInstanceLocation, cmd);
+	}
+	void GraphicsDevice_Recorder::DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DRAW_INDEXED_INSTANCED);
+			write(stream, indexCount);
+			write(stream, instanceCount);
+			write(stream, startIndexLocation);
+			write(stream, baseVertexLocation);
+			write(stream, startInstanceLocation);
+		}
+		device->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation, cmd);
+	}
+	void GraphicsDevice_Recorder::DrawInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DRAW_INSTANCED_INDIRECT);
+			write(stream, GetObjectID(args));
+			write(stream, args_offset);
+		}
+		device->DrawInstancedIndirect(args, args_offset, cmd);
+	}
+	void GraphicsDevice_Recorder::DrawIndexedInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DRAW_INDEXED_INSTANCED_INDIRECT);
+			write(stream, GetObjectID(args));
+			write(stream, args_offset);
+		}
+		device->DrawIndexedInstancedIndirect(args, args_offset, cmd);
+	}
+	void GraphicsDevice_Recorder::Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DISPATCH);
+			write(stream, threadGroupCountX);
+			write(stream, threadGroupCountY);
+			write(stream, threadGroupCountZ);
+		}
+		device->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ, cmd);
+	}
+	void GraphicsDevice_Recorder::DispatchIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DISPATCH_INDIRECT);
+			write(stream, GetObjectID(args));
+			write(stream, args_offset);
+		}
+		device->DispatchIndirect(args, args_offset, cmd);
+	}
+	void GraphicsDevice_Recorder::DispatchMesh(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DISPATCH_MESH);
+			write(stream, threadGroupCountX);
+			write(stream, threadGroupCountY);
+			write(stream, threadGroupCountZ);
+		}
+		device->DispatchMesh(threadGroupCountX, threadGroupCountY, threadGroupCountZ, cmd);
+	}
+	void GraphicsDevice_Recorder::DispatchMeshIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DISPATCH_MESH_INDIRECT);
+			write(stream, GetObjectID(args));
+			write(stream, args_offset);
+		}
+		device->DispatchMeshIndirect(args, args_offset, cmd);
+	}
+	void GraphicsDevice_Recorder::CopyResource(const GPUResource* pDst, const GPUResource* pSrc, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::COPY_RESOURCE);
+			write(stream, GetObjectID(pDst));
+			write(stream, GetObjectID(pSrc));
+		}
+		device->CopyResource(pDst, pSrc, cmd);
+	}
+	void GraphicsDevice_Recorder::CopyBuffer(const GPUBuffer* pDst, uint64_t dst_offset, const GPUBuffer* pSrc, uint64_t src_offset, uint64_t size, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::COPY_BUFFER);
+			write(stream, GetObjectID(pDst));
+			write(stream, dst_offset);
+			write(stream, GetObjectID(pSrc));
+			write(stream, src_offset);
+			write(stream, size);
+		}
+		device->CopyBuffer(pDst, dst_offset, pSrc, src_offset, size, cmd);
+	}
+	void GraphicsDevice_Recorder::QueryBegin(const GPUQueryHeap* heap, uint32_t index, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::QUERY_BEGIN);
+			write(stream, GetObjectID(heap));
+			write(stream, index);
+		}
+		device->QueryBegin(heap, index, cmd);
+	}
+	void GraphicsDevice_Recorder::QueryEnd(const GPUQueryHeap* heap, uint32_t index, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::QUERY_END);
+			write(stream, GetObjectID(heap));
+			write(stream, index);
+		}
+		device->QueryEnd(heap, index, cmd);
+	}
+	void GraphicsDevice_Recorder::QueryResolve(const GPUQueryHeap* heap, uint32_t index, uint32_t count, const GPUBuffer* dest, uint64_t dest_offset, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::QUERY_RESOLVE);
+			write(stream, GetObjectID(heap));
+			write(stream, index);
+			write(stream, count);
+			write(stream, GetObjectID(dest));
+			write(stream, dest_offset);
+		}
+		device->QueryResolve(heap, index, count, dest, dest_offset, cmd);
+	}
+	void GraphicsDevice_Recorder::QueryReset(const GPUQueryHeap* heap, uint32_t index, uint32_t count, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::QUERY_RESET);
+			write(stream, GetObjectID(heap));
+			write(stream, index);
+			write(stream, count);
+		}
+		device->QueryReset(heap, index, count, cmd);
+	}
+	void GraphicsDevice_Recorder::Barrier(const GPUBarrier* barriers, uint32_t numBarriers, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BARRIER);
+			write(stream, numBarriers);
+			for (uint32_t i = 0; i < numBarriers; ++i)
+			{
+				const GPUBarrier& barrier = barriers[i];
+				write(stream, barrier.type);
+				switch (barrier.type)
+				{
+				case GPUBarrier::Type::MEMORY:
+					write(stream, GetObjectID(barrier.memory.resource));
+					break;
+				case GPUBarrier::Type::IMAGE:
+					write(stream, GetObjectID(barrier.image.texture));
+					write(stream, barrier.image.layout_before);
+					write(stream, barrier.image.layout_after);
+					write(stream, barrier.image.mip);
+					write(stream, barrier.image.slice);
+					break;
+				case GPUBarrier::Type::BUFFER:
+					write(stream, GetObjectID(barrier.buffer.buffer));
+					write(stream, barrier.buffer.state_before);
+					write(stream, barrier.buffer.state_after);
+					break;
+				default:
+					break;
+				}
+			}
+		}
+		device->Barrier(barriers, numBarriers, cmd);
+	}
+	void GraphicsDevice_Recorder::BuildRaytracingAccelerationStructure(const RaytracingAccelerationStructure* dst, CommandList cmd, const RaytracingAccelerationStructure* src)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BUILD_RAYTRACING_ACCELERATION_STRUCTURE);
+			write(stream, GetObjectID(dst));
+			write(stream, GetObjectID(src));
+		}
+		device->BuildRaytracingAccelerationStructure(dst, cmd, src);
+	}
+	void GraphicsDevice_Recorder::BindRaytracingPipelineState(const RaytracingPipelineState* rtpso, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::BIND_RAYTRACING_PIPELINESTATE);
+			write(stream, GetObjectID(rtpso));
+		}
+		device->BindRaytracingPipelineState(rtpso, cmd);
+	}
+	void GraphicsDevice_Recorder::DispatchRays(const DispatchRaysDesc* desc, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::DISPATCH_RAYS);
+			write(stream, desc->width);
+			write(stream, desc->height);
+			write(stream, desc->depth);
+		}
+		device->DispatchRays(desc, cmd);
+	}
+	void GraphicsDevice_Recorder::PushConstants(const void* data, uint32_t size, CommandList cmd, uint32_t offset)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::PUSH_CONSTANTS);
+			write(stream, size);
+			write(stream, offset);
+			write_data(stream, data, size);
+		}
+		device->PushConstants(data, size, cmd, offset);
+	}
+	void GraphicsDevice_Recorder::PredicationBegin(const GPUBuffer* buffer, uint64_t offset, PredicationOp op, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::PREDICATION_BEGIN);
+			write(stream, GetObjectID(buffer));
+			write(stream, offset);
+			write(stream, op);
+		}
+		device->PredicationBegin(buffer, offset, op, cmd);
+	}
+	void GraphicsDevice_Recorder::PredicationEnd(CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			write(streams[cmd].data, Op::PREDICATION_END);
+		}
+		device->PredicationEnd(cmd);
+	}
+
+	void GraphicsDevice_Recorder::EventBegin(const char* name, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::EVENT_BEGIN);
+			write_string(stream, name);
+		}
+		device->EventBegin(name, cmd);
+	}
+	void GraphicsDevice_Recorder::EventEnd(CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			write(streams[cmd].data, Op::EVENT_END);
+		}
+		device->EventEnd(cmd);
+	}
+	void GraphicsDevice_Recorder::SetMarker(const char* name, CommandList cmd)
+	{
+		if (recording_enabled)
+		{
+			TrackAllocations(cmd);
+			auto& stream = streams[cmd].data;
+			write(stream, Op::SET_MARKER);
+			write_string(stream, name);
+		}
+		device->SetMarker(name, cmd);
+	}
+
+
+
+	std::string GraphicsReplayStats::ToString() const
+	{
+		std::stringstream ss;
+		ss << "Frames: " << frames << ", command lists: " << command_lists << "\n";
+		ss << std::left << std::setw(40) << "Pass"
+			<< std::right
+			<< std::setw(8) << "Events"
+			<< std::setw(10) << "Draws"
+			<< std::setw(10) << "Dispatch"
+			<< std::setw(8) << "Copies"
+			<< std::setw(10) << "Barriers"
+			<< std::setw(10) << "PSO bind"
+			<< std::setw(10) << "PSO chg"
+			<< std::setw(8) << "VB chg"
+			<< std::setw(8) << "IB chg"
+			<< std::setw(10) << "Res bind"
+			<< std::setw(10) << "CB bind"
+			<< std::setw(8) << "Push"
+			<< std::setw(12) << "Alloc KB"
+			<< std::setw(12) << "CPU ms"
+			<< "\n";
+		auto print = [&](const Pass& pass) {
+			ss << std::left << std::setw(40) << pass.name.substr(0, 39)
+				<< std::right
+				<< std::setw(8) << pass.events
+				<< std::setw(10) << pass.draws
+				<< std::setw(10) << pass.dispatches
+				<< std::setw(8) << pass.copies
+				<< std::setw(10) << pass.barriers
+				<< std::setw(10) << pass.pipeline_binds
+				<< std::setw(10) << pass.pipeline_changes
+				<< std::setw(8) << pass.vertex_buffer_changes
+				<< std::setw(8) << pass.index_buffer_changes
+				<< std::setw(10) << pass.resource_binds
+				<< std::setw(10) << pass.constant_buffer_binds
+				<< std::setw(8) << pass.push_constants
+				<< std::setw(12) << (pass.allocated_bytes / 1024)
+				<< std::setw(12) << std::fixed << std::setprecision(3) << pass.cpu_milliseconds
+				<< "\n";
+		};
+		for (auto& pass : passes)
+		{
+			print(pass);
+		}
+		print(total);
+		return ss.str();
+	}
+
+	bool ReplayGraphicsRecording(const uint8_t* data, size_t size, GraphicsDevice* device, GraphicsReplayStats& stats)
+	{
+		stats = {};
+		stats.total.name = "TOTAL";
+		if (data == nullptr || device == nullptr)
+			return false;
+
+		Reader reader;
+		reader.data = data;
+		reader.size = size;
+		if (reader.read<uint32_t>() != RECORDING_MAGIC || reader.read<uint32_t>() != RECORDING_VERSION)
+		{
+			wi::backlog::post("ReplayGraphicsRecording: not a valid graphics recording!", wi::backlog::LogLevel::Error);
+			return false;
+		}
+		reader.read<uint64_t>(); // allocation alignment of the recording device, informative only
+
+		// Without shader bytecode, pipelines can only be replayed on a device that doesn't consume shaders:
+		const bool execute_shaders = device->GetShaderFormat() == ShaderFormat::NONE;
+
+		// Objects are referenced by pointers (for example from render passes), so they must not move in memory:
+		struct ReplayObject
+		{
+			GPUBuffer buffer;
+			Texture texture;
+			Sampler sampler;
+			Shader shader;
+			PipelineState pso;
+			RenderPass renderpass;
+			GPUQueryHeap queryheap;
+			SwapChain swapchain;
+
+			const GPUResource* resource() const
+			{
+				if (texture.IsValid())
+					return &texture;
+				if (buffer.IsValid())
+					return &buffer;
+				return nullptr;
+			}
+		};
+		wi::vector<std::unique_ptr<ReplayObject>> objects;
+		auto create = [&](uint32_t id) -> ReplayObject& {
+			if (id >= objects.size())
+			{
+				objects.resize(id + 1);
+			}
+			objects[id] = std::make_unique<ReplayObject>(); // an id is reused when an object is registered again
+			return *objects[id];
+		};
+		auto get = [&](uint32_t id) -> ReplayObject* {
+			if (id == 0 || id >= objects.size())
+				return nullptr;
+			return objects[id].get();
+		};
+		auto get_resource = [&](uint32_t id) -> const GPUResource* {
+			ReplayObject* object = get(id);
+			return object == nullptr ? nullptr : object->resource();
+		};
+		auto get_buffer = [&](uint32_t id) -> const GPUBuffer* {
+			ReplayObject* object = get(id);
+			return object == nullptr || !object->buffer.IsValid() ? nullptr : &object->buffer;
+		};
+		auto get_texture = [&](uint32_t id) -> const Texture* {
+			ReplayObject* object = get(id);
+			return object == nullptr || !object->texture.IsValid() ? nullptr : &object->texture;
+		};
+
+		wi::unordered_map<std::string, size_t> pass_lookup;
+		auto get_pass = [&](const std::string& name) -> size_t {
+			auto it = pass_lookup.find(name);
+			if (it != pass_lookup.end())
+				return it->second;
+			size_t index = stats.passes.size();
+			stats.passes.emplace_back();
+			stats.passes.back().name = name;
+			pass_lookup[name] = index;
+			return index;
+		};
+
+		Texture backbuffer;
+		wi::vector<CommandList> replay_cmds;
+		wi::vector<GPUBarrier> barriers;
+		wi::vector<const GPUResource*> resources;
+		wi::vector<const GPUBuffer*> vertex_buffers;
+		wi::vector<uint32_t> vertex_buffer_ids;
+		wi::vector<uint8_t> push_constants;
+		wi::Timer timer;
+
+		while (!reader.end())
+		{
+			const Op op = reader.read<Op>();
+			switch (op)
+			{
+			case Op::CREATE_SWAPCHAIN:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				SwapChainDesc desc = reader.read<SwapChainDesc>();
+				device->CreateSwapChain(&desc, nullptr, &object.swapchain);
+			}
+			break;
+			case Op::CREATE_BUFFER:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				GPUBufferDesc desc = reader.read<GPUBufferDesc>();
+				device->CreateBuffer(&desc, nullptr, &object.buffer);
+			}
+			break;
+			case Op::CREATE_TEXTURE:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				TextureDesc desc = reader.read<TextureDesc>();
+				device->CreateTexture(&desc, nullptr, &object.texture);
+			}
+			break;
+			case Op::BACKBUFFER:
+			{
+				// The back buffer is registered again every time it is requested, but it is only created when it was resized:
+				ReplayObject& object = create(reader.read<uint32_t>());
+				TextureDesc desc = reader.read<TextureDesc>();
+				const TextureDesc& last_desc = backbuffer.GetDesc();
+				if (!backbuffer.IsValid() || last_desc.width != desc.width || last_desc.height != desc.height || last_desc.format != desc.format)
+				{
+					device->CreateTexture(&desc, nullptr, &backbuffer);
+				}
+				object.texture = backbuffer;
+			}
+			break;
+			case Op::CREATE_SHADER:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				ShaderStage stage = reader.read<ShaderStage>();
+				if (execute_shaders)
+				{
+					device->CreateShader(stage, nullptr, 0, &object.shader);
+				}
+			}
+			break;
+			case Op::CREATE_SAMPLER:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				SamplerDesc desc = reader.read<SamplerDesc>();
+				device->CreateSampler(&desc, &object.sampler);
+			}
+			break;
+			case Op::CREATE_QUERYHEAP:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				GPUQueryHeapDesc desc = reader.read<GPUQueryHeapDesc>();
+				device->CreateQueryHeap(&desc, &object.queryheap);
+			}
+			break;
+			case Op::CREATE_PIPELINESTATE:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				if (execute_shaders)
+				{
+					PipelineStateDesc desc;
+					device->CreatePipelineState(&desc, &object.pso);
+				}
+			}
+			break;
+			case Op::CREATE_RENDERPASS:
+			{
+				ReplayObject& object = create(reader.read<uint32_t>());
+				RenderPassDesc desc;
+				desc.flags = reader.read<RenderPassDesc::Flags>();
+				const uint32_t count = reader.read<uint32_t>();
+				for (uint32_t i = 0; i < count && !reader.failed; ++i)
+				{
+					RenderPassAttachment attachment;
+					attachment.type = reader.read<RenderPassAttachment::Type>();
+					attachment.loadop = reader.read<RenderPassAttachment::LoadOp>();
+					attachment.texture = get_texture(reader.read<uint32_t>());
+					attachment.subresource = reader.read<int>();
+					attachment.storeop = reader.read<RenderPassAttachment::StoreOp>();
+					attachment.initial_layout = reader.read<ResourceState>();
+					attachment.subpass_layout = reader.read<ResourceState>();
+					attachment.final_layout = reader.read<ResourceState>();
+					desc.attachments.push_back(attachment);
+				}
+				device->CreateRenderPass(&desc, &object.renderpass);
+			}
+			break;
+			case Op::CREATE_RAYTRACING_ACCELERATION_STRUCTURE:
+			case Op::CREATE_RAYTRACING_PIPELINESTATE:
+				// Raytracing objects are not replayed, only their usage is counted
+				create(reader.read<uint32_t>());
+				break;
+			case Op::CREATE_SUBRESOURCE_TEXTURE:
+			{
+				ReplayObject* object = get(reader.read<uint32_t>());
+				SubresourceType type = reader.read<SubresourceType>();
+				uint32_t firstSlice = reader.read<uint32_t>();
+				uint32_t sliceCount = reader.read<uint32_t>();
+				uint32_t firstMip = reader.read<uint32_t>();
+				uint32_t mipCount = reader.read<uint32_t>();
+				if (object != nullptr && object->texture.IsValid())
+				{
+					device->CreateSubresource(&object->texture, type, firstSlice, sliceCount, firstMip, mipCount);
+				}
+			}
+			break;
+			case Op::CREATE_SUBRESOURCE_BUFFER:
+			{
+				ReplayObject* object = get(reader.read<uint32_t>());
+				SubresourceType type = reader.read<SubresourceType>();
+				uint64_t offset = reader.read<uint64_t>();
+				uint64_t buffer_size = reader.read<uint64_t>();
+				if (object != nullptr && object->buffer.IsValid())
+				{
+					device->CreateSubresource(&object->buffer, type, offset, buffer_size);
+				}
+			}
+			break;
+			case Op::DELETE_SUBRESOURCE_BUFFER:
+			{
+				ReplayObject* object = get(reader.read<uint32_t>());
+				SubresourceType type = reader.read<SubresourceType>();
+				int subresource = reader.read<int>();
+				if (object != nullptr && object->buffer.IsValid())
+				{
+					device->DeleteSubresource(&object->buffer, type, subresource);
+				}
+			}
+			break;
+			case Op::SUBMIT:
+			{
+				const uint32_t cmd_count = reader.read<uint32_t>();
+				replay_cmds.clear();
+				for (uint32_t c = 0; c < cmd_count && !reader.failed; ++c)
+				{
+					const QUEUE_TYPE queue = reader.read<QUEUE_TYPE>();
+					const uint64_t stream_size = reader.read<uint64_t>();
+					Reader cmd_reader;
+					cmd_reader.data = reader.read_data((size_t)stream_size);
+					cmd_reader.size = (size_t)stream_size;
+					if (cmd_reader.data == nullptr)
+						break;
+
+					CommandList cmd = device->BeginCommandList(queue);
+					replay_cmds.push_back(cmd);
+					stats.command_lists++;
+
+					wi::vector<size_t> event_stack;
+					uint32_t pso_id = 0;
+					uint32_t ib_id = 0;
+					uint64_t ib_offset = 0;
+					bool renderpass_skipped = false;
+					vertex_buffer_ids.clear();
+
+					while (!cmd_reader.end())
+					{
+						const Op cmd_op = cmd_reader.read<Op>();
+						if (cmd_op == Op::EVENT_BEGIN)
+						{
+							std::string name = cmd_reader.read_string();
+							event_stack.push_back(get_pass(name));
+							stats.passes[event_stack.back()].events++;
+							stats.total.events++;
+							timer.record();
+							device->EventBegin(name.c_str(), cmd);
+							stats.passes[event_stack.back()].cpu_milliseconds += timer.elapsed_milliseconds();
+							continue;
+						}
+
+						if (event_stack.empty())
+						{
+							event_stack.push_back(get_pass("(no event)"));
+						}
+						GraphicsReplayStats::Pass& pass = stats.passes[event_stack.back()];
+
+						// The counters are incremented for both the current pass and the total:
+						auto count = [&](uint64_t GraphicsReplayStats::Pass::* counter, uint64_t value = 1) {
+							pass.*counter += value;
+							stats.total.*counter += value;
+						};
+
+						timer.record();
+						switch (cmd_op)
+						{
+						case Op::ALLOCATE:
+						{
+							const uint64_t alloc_size = cmd_reader.read<uint64_t>();
+							device->AllocateGPU(alloc_size, cmd);
+							count(&GraphicsReplayStats::Pass::allocations);
+							count(&GraphicsReplayStats::Pass::allocated_bytes, alloc_size);
+						}
+						break;
+						case Op::WAIT_COMMANDLIST:
+						{
+							const CommandList::index_type wait_for = cmd_reader.read<CommandList::index_type>();
+							if (wait_for < replay_cmds.size())
+							{
+								device->WaitCommandList(cmd, replay_cmds[wait_for]);
+							}
+						}
+						break;
+						case Op::RENDERPASS_BEGIN_SWAPCHAIN:
+						{
+							ReplayObject* object = get(cmd_reader.read<uint32_t>());
+							renderpass_skipped = object == nullptr || !object->swapchain.IsValid();
+							if (!renderpass_skipped)
+							{
+								device->RenderPassBegin(&object->swapchain, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::renderpasses);
+						}
+						break;
+						case Op::RENDERPASS_BEGIN:
+						{
+							ReplayObject* object = get(cmd_reader.read<uint32_t>());
+							renderpass_skipped = object == nullptr || !object->renderpass.IsValid();
+							if (!renderpass_skipped)
+							{
+								device->RenderPassBegin(&object->renderpass, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::renderpasses);
+						}
+						break;
+						case Op::RENDERPASS_END:
+							if (!renderpass_skipped)
+							{
+								device->RenderPassEnd(cmd);
+							}
+							renderpass_skipped = false;
+							break;
+						case Op::BIND_SCISSOR_RECTS:
+						{
+							const uint32_t num = cmd_reader.read<uint32_t>();
+							const Rect* rects = (const Rect*)cmd_reader.read_data(sizeof(Rect) * num);
+							if (rects != nullptr)
+							{
+								device->BindScissorRects(num, rects, cmd);
+							}
+						}
+						break;
+						case Op::BIND_VIEWPORTS:
+						{
+							const uint32_t num = cmd_reader.read<uint32_t>();
+							const Viewport* viewports = (const Viewport*)cmd_reader.read_data(sizeof(Viewport) * num);
+							if (viewports != nullptr)
+							{
+								device->BindViewports(num, viewports, cmd);
+							}
+						}
+						break;
+						case Op::BIND_RESOURCE:
+						case Op::BIND_UAV:
+						{
+							const GPUResource* resource = get_resource(cmd_reader.read<uint32_t>());
+							const uint32_t slot = cmd_reader.read<uint32_t>();
+							const int subresource = cmd_reader.read<int>();
+							if (cmd_op == Op::BIND_RESOURCE)
+							{
+								device->BindResource(resource, slot, cmd, subresource);
+							}
+							else
+							{
+								device->BindUAV(resource, slot, cmd, subresource);
+							}
+							count(&GraphicsReplayStats::Pass::resource_binds);
+						}
+						break;
+						case Op::BIND_RESOURCES:
+						case Op::BIND_UAVS:
+						{
+							const uint32_t slot = cmd_reader.read<uint32_t>();
+							const uint32_t num = cmd_reader.read<uint32_t>();
+							resources.clear();
+							for (uint32_t i = 0; i < num && !cmd_reader.failed; ++i)
+							{
+								resources.push_back(get_resource(cmd_reader.read<uint32_t>()));
+							}
+							if (cmd_op == Op::BIND_RESOURCES)
+							{
+								device->BindResources(resources.data(), slot, (uint32_t)resources.size(), cmd);
+							}
+							else
+							{
+								device->BindUAVs(resources.data(), slot, (uint32_t)resources.size(), cmd);
+							}
+							count(&GraphicsReplayStats::Pass::resource_binds, resources.size());
+						}
+						break;
+						case Op::BIND_SAMPLER:
+						{
+							ReplayObject* object = get(cmd_reader.read<uint32_t>());
+							const uint32_t slot = cmd_reader.read<uint32_t>();
+							device->BindSampler(object == nullptr || !object->sampler.IsValid() ? nullptr : &object->sampler, slot, cmd);
+							count(&GraphicsReplayStats::Pass::sampler_binds);
+						}
+						break;
+						case Op::BIND_CONSTANT_BUFFER:
+						{
+							const GPUBuffer* buffer = get_buffer(cmd_reader.read<uint32_t>());
+							const uint32_t slot = cmd_reader.read<uint32_t>();
+							const uint64_t offset = cmd_reader.read<uint64_t>();
+							device->BindConstantBuffer(buffer, slot, cmd, offset);
+							count(&GraphicsReplayStats::Pass::constant_buffer_binds);
+						}
+						break;
+						case Op::BIND_VERTEX_BUFFERS:
+						{
+							const uint32_t slot = cmd_reader.read<uint32_t>();
+							const uint32_t num = cmd_reader.read<uint32_t>();
+							const bool has_strides = cmd_reader.read<uint8_t>() != 0;
+							const bool has_offsets = cmd_reader.read<uint8_t>() != 0;
+							vertex_buffers.clear();
+							bool changed = num != vertex_buffer_ids.size();
+							vertex_buffer_ids.resize(num);
+							for (uint32_t i = 0; i < num && !cmd_reader.failed; ++i)
+							{
+								const uint32_t id = cmd_reader.read<uint32_t>();
+								changed |= vertex_buffer_ids[i] != id;
+								vertex_buffer_ids[i] = id;
+								vertex_buffers.push_back(get_buffer(id));
+							}
+							const uint32_t* strides = has_strides ? (const uint32_t*)cmd_reader.read_data(sizeof(uint32_t) * num) : nullptr;
+							const uint64_t* offsets = has_offsets ? (const uint64_t*)cmd_reader.read_data(sizeof(uint64_t) * num) : nullptr;
+							if (!cmd_reader.failed)
+							{
+								device->BindVertexBuffers(vertex_buffers.data(), slot, (uint32_t)vertex_buffers.size(), strides, offsets, cmd);
+							}
+							if (changed)
+							{
+								count(&GraphicsReplayStats::Pass::vertex_buffer_changes);
+							}
+						}
+						break;
+						case Op::BIND_INDEX_BUFFER:
+						{
+							const uint32_t id = cmd_reader.read<uint32_t>();
+							const IndexBufferFormat format = cmd_reader.read<IndexBufferFormat>();
+							const uint64_t offset = cmd_reader.read<uint64_t>();
+							device->BindIndexBuffer(get_buffer(id), format, offset, cmd);
+							if (id != ib_id || offset != ib_offset)
+							{
+								ib_id = id;
+								ib_offset = offset;
+								count(&GraphicsReplayStats::Pass::index_buffer_changes);
+							}
+						}
+						break;
+						case Op::BIND_STENCIL_REF:
+							device->BindStencilRef(cmd_reader.read<uint32_t>(), cmd);
+							break;
+						case Op::BIND_BLEND_FACTOR:
+						{
+							const float r = cmd_reader.read<float>();
+							const float g = cmd_reader.read<float>();
+							const float b = cmd_reader.read<float>();
+							const float a = cmd_reader.read<float>();
+							device->BindBlendFactor(r, g, b, a, cmd);
+						}
+						break;
+						case Op::BIND_SHADING_RATE:
+							device->BindShadingRate(cmd_reader.read<ShadingRate>(), cmd);
+							break;
+						case Op::BIND_PIPELINESTATE:
+						case Op::BIND_COMPUTE_SHADER:
+						{
+							const uint32_t id = cmd_reader.read<uint32_t>();
+							ReplayObject* object = get(id);
+							if (execute_shaders && object != nullptr)
+							{
+								if (cmd_op == Op::BIND_PIPELINESTATE)
+								{
+									device->BindPipelineState(&object->pso, cmd);
+								}
+								else
+								{
+									device->BindComputeShader(&object->shader, cmd);
+								}
+							}
+							count(&GraphicsReplayStats::Pass::pipeline_binds);
+							if (id != pso_id)
+							{
+								pso_id = id;
+								count(&GraphicsReplayStats::Pass::pipeline_changes);
+							}
+						}
+						break;
+						case Op::BIND_DEPTH_BOUNDS:
+						{
+							const float min_bounds = cmd_reader.read<float>();
+							const float max_bounds = cmd_reader.read<float>();
+							device->BindDepthBounds(min_bounds, max_bounds, cmd);
+						}
+						break;
+						case Op::DRAW:
+						{
+							const uint32_t vertexCount = cmd_reader.read<uint32_t>();
+							const uint32_t startVertexLocation = cmd_reader.read<uint32_t>();
+							if (execute_shaders)
+							{
+								device->Draw(vertexCount, startVertexLocation, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::draws);
+						}
+						break;
+						case Op::DRAW_INDEXED:
+						{
+							const uint32_t indexCount = cmd_reader.read<uint32_t>();
+							const uint32_t startIndexLocation = cmd_reader.read<uint32_t>();
+							const int32_t baseVertexLocation = cmd_reader.read<int32_t>();
+							if (execute_shaders)
+							{
+								device->DrawIndexed(indexCount, startIndexLocation, baseVertexLocation, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::draws);
+						}
+						break;
+						case Op::DRAW_INSTANCED:
+						{
+							const uint32_t vertexCount = cmd_reader.read<uint32_t>();
+							const uint32_t instanceCount = cmd_reader.read<uint32_t>();
+							const uint32_t startVertexLocation = cmd_reader.read<uint32_t>();
+							const uint32_t startInstanceLocation = cmd_reader.read<uint32_t>();
+							if (execute_shaders)
+							{
+								device->DrawInstanced(vertexCount, instanceCount, startVertexLocation, startInstanceLocation, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::draws);
+						}
+						break;
+						case Op::DRAW_INDEXED_INSTANCED:
+						{
+							const uint32_t indexCount = cmd_reader.read<uint32_t>();
+							const uint32_t instanceCount = cmd_reader.read<uint32_t>();
+							const uint32_t startIndexLocation = cmd_reader.read<uint32_t>();
+							const int32_t baseVertexLocation = cmd_reader.read<int32_t>();
+							const uint32_t startInstanceLocation = cmd_reader.read<uint32_t>();
+							if (execute_shaders)
+							{
+								device->DrawIndexedInstanced(indexCount, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::draws);
+						}
+						break;
+						case Op::DRAW_INSTANCED_INDIRECT:
+						case Op::DRAW_INDEXED_INSTANCED_INDIRECT:
+						case Op::DISPATCH_INDIRECT:
+						case Op::DISPATCH_MESH_INDIRECT:
+						{
+							const GPUBuffer* args = get_buffer(cmd_reader.read<uint32_t>());
+							const uint64_t args_offset = cmd_reader.read<uint64_t>();
+							if (execute_shaders && args != nullptr)
+							{
+								switch (cmd_op)
+								{
+								case Op::DRAW_INSTANCED_INDIRECT:
+									device->DrawInstancedIndirect(args, args_offset, cmd);
+									break;
+								case Op::DRAW_INDEXED_INSTANCED_INDIRECT:
+									device->DrawIndexedInstancedIndirect(args, args_offset, cmd);
+									break;
+								case Op::DISPATCH_INDIRECT:
+									device->DispatchIndirect(args, args_offset, cmd);
+									break;
+								default:
+									device->DispatchMeshIndirect(args, args_offset, cmd);
+									break;
+								}
+							}
+							if (cmd_op == Op::DISPATCH_INDIRECT)
+							{
+								count(&GraphicsReplayStats::Pass::dispatches);
+							}
+							else
+							{
+								count(&GraphicsReplayStats::Pass::draws);
+							}
+						}
+						break;
+						case Op::DISPATCH:
+						case Op::DISPATCH_MESH:
+						{
+							const uint32_t x = cmd_reader.read<uint32_t>();
+							const uint32_t y = cmd_reader.read<uint32_t>();
+							const uint32_t z = cmd_reader.read<uint32_t>();
+							if (execute_shaders)
+							{
+								if (cmd_op == Op::DISPATCH)
+								{
+									device->Dispatch(x, y, z, cmd);
+								}
+								else
+								{
+									device->DispatchMesh(x, y, z, cmd);
+								}
+							}
+							if (cmd_op == Op::DISPATCH)
+							{
+								count(&GraphicsReplayStats::Pass::dispatches);
+							}
+							else
+							{
+								count(&GraphicsReplayStats::Pass::draws);
+							}
+						}
+						break;
+						case Op::COPY_RESOURCE:
+						{
+							const GPUResource* dst = get_resource(cmd_reader.read<uint32_t>());
+							const GPUResource* src = get_resource(cmd_reader.read<uint32_t>());
+							if (dst != nullptr && src != nullptr)
+							{
+								device->CopyResource(dst, src, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::copies);
+						}
+						break;
+						case Op::COPY_BUFFER:
+						{
+							const GPUBuffer* dst = get_buffer(cmd_reader.read<uint32_t>());
+							const uint64_t dst_offset = cmd_reader.read<uint64_t>();
+							const GPUBuffer* src = get_buffer(cmd_reader.read<uint32_t>());
+							const uint64_t src_offset = cmd_reader.read<uint64_t>();
+							const uint64_t copy_size = cmd_reader.read<uint64_t>();
+							if (dst != nullptr && src != nullptr)
+							{
+								device->CopyBuffer(dst, dst_offset, src, src_offset, copy_size, cmd);
+							}
+							count(&GraphicsReplayStats::Pass::copies);
+						}
+						break;
+						case Op::QUERY_BEGIN:
+						case Op::QUERY_END:
+						{
+							ReplayObject* object = get(cmd_reader.read<uint32_t>());
+							const uint32_t index = cmd_reader.read<uint32_t>();
+							if (object != nullptr && object->queryheap.IsValid())
+							{
+								if (cmd_op == Op::QUERY_BEGIN)
+								{
+									device->QueryBegin(&object->queryheap, index, cmd);
+								}
+								else
+								{
+									device->QueryEnd(&object->queryheap, index, cmd);
+								}
+							}
+						}
+						break;
+						case Op::QUERY_RESOLVE:
+						{
+							ReplayObject* object = get(cmd_reader.read<uint32_t>());
+							const uint32_t index = cmd_reader.read<uint32_t>();
+							const uint32_t num = cmd_reader.read<uint32_t>();
+							const GPUBuffer* dest = get_buffer(cmd_reader.read<uint32_t>());
+							const uint64_t dest_offset = cmd_reader.read<uint64_t>();
+							if (object != nullptr && object->queryheap.IsValid() && dest != nullptr)
+							{
+								device->QueryResolve(&object->queryheap, index, num, dest, dest_offset, cmd);
+							}
+						}
+						break;
+						case Op::QUERY_RESET:
+						{
+							ReplayObject* object = get(cmd_reader.read<uint32_t>());
+							const uint32_t index = cmd_reader.read<uint32_t>();
+							const uint32_t num = cmd_reader.read<uint32_t>();
+							if (object != nullptr && object->queryheap.IsValid())
+							{
+								device->QueryReset(&object->queryheap, index, num, cmd);
+							}
+						}
+						break;
+						case Op::BARRIER:
+						{
+							const uint32_t num = cmd_reader.read<uint32_t>();
+							barriers.clear();
+							for (uint32_t i = 0; i < num && !cmd_reader.failed; ++i)
+							{
+								GPUBarrier barrier;
+								barrier.type = cmd_reader.read<GPUBarrier::Type>();
+								switch (barrier.type)
+								{
+								case GPUBarrier::Type::MEMORY:
+									barrier.memory.resource = get_resource(cmd_reader.read<uint32_t>());
+									break;
+								case GPUBarrier::Type::IMAGE:
+									barrier.image.texture = get_texture(cmd_reader.read<uint32_t>());
+									barrier.image.layout_before = cmd_reader.read<ResourceState>();
+									barrier.image.layout_after = cmd_reader.read<ResourceState>();
+									barrier.image.mip = cmd_reader.read<int>();
+									barrier.image.slice = cmd_reader.read<int>();
+									if (barrier.image.texture == nullptr)
+										continue;
+									break;
+								case GPUBarrier::Type::BUFFER:
+									barrier.buffer.buffer = get_buffer(cmd_reader.read<uint32_t>());
+									barrier.buffer.state_before = cmd_reader.read<ResourceState>();
+									barrier.buffer.state_after = cmd_reader.read<ResourceState>();
+									if (barrier.buffer.buffer == nullptr)
+										continue;
+									break;
+								default:
+									break;
+								}
+								barriers.push_back(barrier);
+							}
+							if (!barriers.empty())
+							{
+								device->Barrier(barriers.data(), (uint32_t)barriers.size(), cmd);
+							}
+							count(&GraphicsReplayStats::Pass::barriers, num);
+						}
+						break;
+						case Op::BUILD_RAYTRACING_ACCELERATION_STRUCTURE:
+							cmd_reader.read<uint32_t>();
+							cmd_reader.read<uint32_t>();
+							break;
+						case Op::BIND_RAYTRACING_PIPELINESTATE:
+							cmd_reader.read<uint32_t>();
+							count(&GraphicsReplayStats::Pass::pipeline_binds);
+							break;
+						case Op::DISPATCH_RAYS:
+							cmd_reader.read<uint32_t>();
+							cmd_reader.read<uint32_t>();
+							cmd_reader.read<uint32_t>();
+							count(&GraphicsReplayStats::Pass::dispatches);
+							break;
+						case Op::PUSH_CONSTANTS:
+						{
+							const uint32_t push_size = cmd_reader.read<uint32_t>();
+							const uint32_t offset = cmd_reader.read<uint32_t>();
+							const uint8_t* push_data = cmd_reader.read_data(push_size);
+							if (push_data != nullptr)
+							{
+								// copied, because the recording is not aligned:
+								push_constants.resize(push_size);
+								std::memcpy(push_constants.data(), push_data, push_size);
+								device->PushConstants(push_constants.data(), push_size, cmd, offset);
+							}
+							count(&GraphicsReplayStats::Pass::push_constants);
+						}
+						break;
+						case Op::PREDICATION_BEGIN:
+						{
+							const GPUBuffer* buffer = get_buffer(cmd_reader.read<uint32_t>());
+							const uint64_t offset = cmd_reader.read<uint64_t>();
+							const PredicationOp predication_op = cmd_reader.read<PredicationOp>();
+							if (buffer != nullptr)
+							{
+								device->PredicationBegin(buffer, offset, predication_op, cmd);
+							}
+						}
+						break;
+						case Op::PREDICATION_END:
+							device->PredicationEnd(cmd);
+							break;
+						case Op::EVENT_END:
+							device->EventEnd(cmd);
+							break;
+						case Op::SET_MARKER:
+						{
+							std::string name = cmd_reader.read_string();
+							device->SetMarker(name.c_str(), cmd);
+						}
+						break;
+						default:
+							wi::backlog::post("ReplayGraphicsRecording: unknown command in recording!", wi::backlog::LogLevel::Error);
+							cmd_reader.failed = true;
+							break;
+						}
+						const double elapsed = timer.elapsed_milliseconds();
+						pass.cpu_milliseconds += elapsed;
+						stats.total.cpu_milliseconds += elapsed;
+
+						if (cmd_op == Op::EVENT_END && !event_stack.empty())
+						{
+							event_stack.pop_back();
+						}
+					}
+					if (cmd_reader.failed)
+					{
+						reader.failed = true;
+					}
+				}
+
+				timer.record();
+				device->SubmitCommandLists();
+				stats.total.cpu_milliseconds += timer.elapsed_milliseconds();
+				stats.frames++;
+			}
+			break;
+			default:
+				wi::backlog::post("ReplayGraphicsRecording: unknown object in recording!", wi::backlog::LogLevel::Error);
+				reader.failed = true;
+				break;
+			}
+		}
+
+		device->WaitForGPU();
+
+		if (reader.failed)
+		{
+			wi::backlog::post("ReplayGraphicsRecording: the recording is corrupted or truncated!", wi::backlog::LogLevel::Error);
+			return false;
+		}
+		return true;
+	}
+}
@@ -0,0 +1,207 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiPlatform.h"
+#include "wiGraphicsDevice.h"
+#include "wiSpinLock.h"
+#include "wiVector.h"
+#include "wiUnorderedMap.h"
+
+#include <memory>
+#include <string>
+
+namespace wi::graphics
+{
+	// Graphics device that wraps an other graphics device and records every device call into a compact binary stream:
+	//	- Resource creation is recorded with the resource descriptions (but not the contents)
+	//	- Command list calls are recorded with resource references, so binds, draws, dispatches, barriers, etc. can be replayed
+	//	- AllocateGPU() sizes are recorded as well, so the replay also exercises the frame allocators
+	//	The recording can be replayed with ReplayGraphicsRecording() against any device (for example GraphicsDevice_Null)
+	//	to measure call counts, state changes and CPU cost of a frame without running the whole engine
+	class GraphicsDevice_Recorder final : public GraphicsDevice
+	{
+	protected:
+		std::unique_ptr<GraphicsDevice> device;
+
+		struct CommandStream
+		{
+			wi::vector<uint8_t> data;
+			QUEUE_TYPE queue = QUEUE_GRAPHICS;
+			uint64_t allocated = 0;
+			bool active = false;
+		};
+		CommandStream streams[COMMANDLIST_COUNT];
+
+		mutable wi::SpinLock locker;
+		mutable wi::vector<uint8_t> recording;
+		mutable uint32_t next_id = 1;
+
+		// Objects are identified by their internal state, entries are removed when the object is destroyed
+		//	It is shared with the registered objects, because they can be destroyed after the recorder
+		struct ObjectRegistry
+		{
+			wi::SpinLock locker;
+			wi::unordered_map<const void*, uint32_t> ids;
+		};
+		std::shared_ptr<ObjectRegistry> registry = std::make_shared<ObjectRegistry>();
+		struct RegisteredState;
+		bool recording_enabled = true;
+		uint32_t recorded_frames = 0;
+		uint32_t autosave_frames = 0;
+		std::string autosave_filename;
+
+		uint32_t RegisterObject(GraphicsDeviceChild* object) const;
+		uint32_t GetObjectID(const GraphicsDeviceChild* object) const;
+		void TrackAllocations(CommandList cmd);
+
+	public:
+		GraphicsDevice_Recorder(std::unique_ptr<GraphicsDevice>&& device);
+		~GraphicsDevice_Recorder() override;
+
+		// Returns the device that is receiving the forwarded calls
+		GraphicsDevice* GetTargetDevice() const { return device.get(); }
+
+		// Recording can be paused and resumed. Objects created while paused will not be known by the replay
+		void SetRecordingEnabled(bool value) { recording_enabled = value; }
+		bool IsRecordingEnabled() const { return recording_enabled; }
+		// Returns the number of submits that were recorded
+		uint32_t GetRecordedFrameCount() const { return recorded_frames; }
+		// Returns the recorded stream
+		const wi::vector<uint8_t>& GetRecording() const { return recording; }
+		// Write the recorded stream to a file, returns true if successful
+		bool SaveRecording(const std::string& filename) const;
+		// When the specified number of frames are recorded, the recording will be saved to the file and recording will stop
+		void SetAutoSave(uint32_t frame_count, const std::string& filename) { autosave_frames = frame_count; autosave_filename = filename; }
+
+		bool CreateSwapChain(const SwapChainDesc* pDesc, wi::platform::window_type window, SwapChain* swapChain) const override;
+		bool CreateBuffer(const GPUBufferDesc *pDesc, const void* pInitialData, GPUBuffer *pBuffer) const override;
+		bool CreateTexture(const TextureDesc* pDesc, const SubresourceData *pInitialData, Texture *pTexture) const override;
+		bool CreateShader(ShaderStage stage, const void *pShaderBytecode, size_t BytecodeLength, Shader *pShader) const override;
+		bool CreateSampler(const SamplerDesc *pSamplerDesc, Sampler *pSamplerState) const override;
+		bool CreateQueryHeap(const GPUQueryHeapDesc *pDesc, GPUQueryHeap *pQueryHeap) const override;
+		bool CreatePipelineState(const PipelineStateDesc* pDesc, PipelineState* pso) const override;
+		bool CreateRenderPass(const RenderPassDesc* pDesc, RenderPass* renderpass) const override;
+		bool CreateRaytracingAccelerationStructure(const RaytracingAccelerationStructureDesc* pDesc, RaytracingAccelerationStructure* bvh) const override;
+		bool CreateRaytracingPipelineState(const RaytracingPipelineStateDesc* pDesc, RaytracingPipelineState* rtpso) const override;
+
+		int CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const override;
+		int CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size = ~0) const override;
+		void DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const override;
+
+		int GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource = -1) const override { return device->GetDescriptorIndex(resource, type, subresource); }
+		int GetDescriptorIndex(const Sampler* sampler) const override { return device->GetDescriptorIndex(sampler); }
+
+		void WriteShadingRateValue(ShadingRate rate, void* dest) const override { device->WriteShadingRateValue(rate, dest); }
+		void WriteTopLevelAccelerationStructureInstance(const RaytracingAccelerationStructureDesc::TopLevel::Instance* instance, void* dest) const override { device->WriteTopLevelAccelerationStructureInstance(instance, dest); }
+		void WriteShaderIdentifier(const RaytracingPipelineState* rtpso, uint32_t group_index, void* dest) const override { device->WriteShaderIdentifier(rtpso, group_index, dest); }
+
+		void SetName(GPUResource* pResource, const char* name) override { device->SetName(pResource, name); }
+
+		CommandList BeginCommandList(QUEUE_TYPE queue = QUEUE_GRAPHICS) override;
+		void SubmitCommandLists() override;
+
+		void WaitForGPU() const override { device->WaitForGPU(); }
+		void ClearPipelineStateCache() override { device->ClearPipelineStateCache(); }
+		size_t GetActivePipelineCount() const override { return device->GetActivePipelineCount(); }
+
+		GPUMemoryUsage GetMemoryUsage() const override { return device->GetMemoryUsage(); }
+		ShaderFormat GetShaderFormat() const override { return device->GetShaderFormat(); }
+
+		Texture GetBackBuffer(const SwapChain* swapchain) const override;
+		ColorSpace GetSwapChainColorSpace(const SwapChain* swapchain) const override { return device->GetSwapChainColorSpace(swapchain); }
+		bool IsSwapChainSupportsHDR(const SwapChain* swapchain) const override { return device->IsSwapChainSupportsHDR(swapchain); }
+
+		///////////////Thread-sensitive////////////////////////
+
+		void WaitCommandList(CommandList cmd, CommandList wait_for) override;
+		void RenderPassBegin(const SwapChain* swapchain, CommandList cmd) override;
+		void RenderPassBegin(const RenderPass* renderpass, CommandList cmd) override;
+		void RenderPassEnd(CommandList cmd) override;
+		void BindScissorRects(uint32_t numRects, const Rect* rects, CommandList cmd) override;
+		void BindViewports(uint32_t NumViewports, const Viewport* pViewports, CommandList cmd) override;
+		void BindResource(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override;
+		void BindResources(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override;
+		void BindUAV(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override;
+		void BindUAVs(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override;
+		void BindSampler(const Sampler* sampler, uint32_t slot, CommandList cmd) override;
+		void BindConstantBuffer(const GPUBuffer* buffer, uint32_t slot, CommandList cmd, uint64_t offset = 0ull) override;
+		void BindVertexBuffers(const GPUBuffer *const* vertexBuffers, uint32_t slot, uint32_t count, const uint32_t* strides, const uint64_t* offsets, CommandList cmd) override;
+		void BindIndexBuffer(const GPUBuffer* indexBuffer, const IndexBufferFormat format, uint64_t offset, CommandList cmd) override;
+		void BindStencilRef(uint32_t value, CommandList cmd) override;
+		void BindBlendFactor(float r, float g, float b, float a, CommandList cmd) override;
+		void BindShadingRate(ShadingRate rate, CommandList cmd) override;
+		void BindPipelineState(const PipelineState* pso, CommandList cmd) override;
+		void BindComputeShader(const Shader* cs, CommandList cmd) override;
+		void BindDepthBounds(float min_bounds, float max_bounds, CommandList cmd) override;
+		void Draw(uint32_t vertexCount, uint32_t startVertexLocation, CommandList cmd) override;
+		void DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation, CommandList cmd) override;
+		void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override;
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override;
+		void DrawInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override;
+		void DrawIndexedInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override;
+		void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd) override;
+		void DispatchIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override;
+		void DispatchMesh(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd) override;
+		void DispatchMeshIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override;
+		void CopyResource(const GPUResource* pDst, const GPUResource* pSrc, CommandList cmd) override;
+		void CopyBuffer(const GPUBuffer* pDst, uint64_t dst_offset, const GPUBuffer* pSrc, uint64_t src_offset, uint64_t size, CommandList cmd) override;
+		void QueryBegin(const GPUQueryHeap *heap, uint32_t index, CommandList cmd) override;
+		void QueryEnd(const GPUQueryHeap *heap, uint32_t index, CommandList cmd) override;
+		void QueryResolve(const GPUQueryHeap* heap, uint32_t index, uint32_t count, const GPUBuffer* dest, uint64_t dest_offset, CommandList cmd) override;
+		void QueryReset(const GPUQueryHeap* heap, uint32_t index, uint32_t count, CommandList cmd) override;
+		void Barrier(const GPUBarrier* barriers, uint32_t numBarriers, CommandList cmd) override;
+		void BuildRaytracingAccelerationStructure(const RaytracingAccelerationStructure* dst, CommandList cmd, const RaytracingAccelerationStructure* src = nullptr) override;
+		void BindRaytracingPipelineState(const RaytracingPipelineState* rtpso, CommandList cmd) override;
+		void DispatchRays(const DispatchRaysDesc* desc, CommandList cmd) override;
+		void PushConstants(const void* data, uint32_t size, CommandList cmd, uint32_t offset = 0) override;
+		void PredicationBegin(const GPUBuffer* buffer, uint64_t offset, PredicationOp op, CommandList cmd) override;
+		void PredicationEnd(CommandList cmd) override;
+
+		void EventBegin(const char* name, CommandList cmd) override;
+		void EventEnd(CommandList cmd) override;
+		void SetMarker(const char* name, CommandList cmd) override;
+
+		const RenderPass* GetCurrentRenderPass(CommandList cmd) const override { return device->GetCurrentRenderPass(cmd); }
+	};
+
+	// Statistics that are gathered while replaying a recording
+	//	Commands are grouped into passes by the innermost EventBegin() that was active when they were recorded
+	struct GraphicsReplayStats
+	{
+		struct Pass
+		{
+			std::string name;
+			uint64_t events = 0;				// how many times the pass was started
+			uint64_t draws = 0;					// all Draw* calls, including indirect and mesh shader draws
+			uint64_t dispatches = 0;			// all Dispatch* calls, including DispatchRays
+			uint64_t copies = 0;
+			uint64_t barriers = 0;				// individual barriers, not Barrier() calls
+			uint64_t renderpasses = 0;
+			uint64_t pipeline_binds = 0;		// BindPipelineState and BindComputeShader calls
+			uint64_t pipeline_changes = 0;		// pipeline binds that changed the previously bound pipeline
+			uint64_t vertex_buffer_changes = 0;
+			uint64_t index_buffer_changes = 0;
+			uint64_t resource_binds = 0;		// SRV and UAV binds
+			uint64_t constant_buffer_binds = 0;
+			uint64_t sampler_binds = 0;
+			uint64_t push_constants = 0;
+			uint64_t allocations = 0;			// AllocateGPU() calls (consecutive allocations can be merged together)
+			uint64_t allocated_bytes = 0;		// AllocateGPU() size, aligned to the allocation alignment of the recording device
+			double cpu_milliseconds = 0;		// CPU time spent in the replay device
+		};
+		wi::vector<Pass> passes;
+		Pass total;
+		uint32_t frames = 0;
+		uint32_t command_lists = 0;
+
+		// Returns a human readable table of the statistics
+		std::string ToString() const;
+	};
+
+	// Replays a recording that was made with GraphicsDevice_Recorder
+	//	device : the replay target, it can be a different device from the one that was used when recording
+	//	If the device doesn't consume shaders (ShaderFormat::NONE), then everything is replayed
+	//	Otherwise, shaders and pipeline states can't be created because the recording doesn't contain bytecode,
+	//	so only the resource, copy, barrier and query commands will be executed, but all commands will be counted
+	//	Returns false if the recording is not valid
+	bool ReplayGraphicsRecording(const uint8_t* data, size_t size, GraphicsDevice* device, GraphicsReplayStats& stats);
+}
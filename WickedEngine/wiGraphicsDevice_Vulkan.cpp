@@ -21,9 +21,11 @@
 #endif
 
 #include <string>
+#include <string_view>
 #include <cstring>
 #include <iostream>
 #include <algorithm>
+#include <numeric>
 
 // These shifts are made so that Vulkan resource bindings slots don't interfere with each other across shader stages:
 //	These are also defined in wi::shadercompiler.cpp as hard coded compiler arguments for SPIRV, so they need to be the same
@@ -596,6 +598,8 @@ namespace vulkan_internal
 		wi::vector<int> subresources_srv_index;
 		wi::vector<VkBufferView> subresources_uav;
 		wi::vector<int> subresources_uav_index;
+		wi::vector<VkDescriptorBufferInfo> subresources_srv_range; // raw buffer subresources
+		wi::vector<VkDescriptorBufferInfo> subresources_uav_range; // raw buffer subresources
 		VkDeviceAddress address = 0;
 		bool is_typedbuffer = false;
 
@@ -603,46 +607,47 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (resource) allocationhandler->destroyer_buffers.push_back(std::make_pair(std::make_pair(resource, allocation), framecount));
-			if (srv) allocationhandler->destroyer_bufferviews.push_back(std::make_pair(srv, framecount));
-			if (uav) allocationhandler->destroyer_bufferviews.push_back(std::make_pair(uav, framecount));
+			allocationhandler->memorytracker.Remove(allocation);
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (resource) shard.batch.buffers.push_back(std::make_pair(resource, allocation));
+			if (srv) shard.batch.bufferviews.push_back(srv);
+			if (uav) shard.batch.bufferviews.push_back(uav);
 			for (auto x : subresources_srv)
 			{
-				allocationhandler->destroyer_bufferviews.push_back(std::make_pair(x, framecount));
+				shard.batch.bufferviews.push_back(x);
 			}
 			for (auto x : subresources_uav)
 			{
-				allocationhandler->destroyer_bufferviews.push_back(std::make_pair(x, framecount));
+				shard.batch.bufferviews.push_back(x);
 			}
 			if (is_typedbuffer)
 			{
-				if (srv_index >= 0) allocationhandler->destroyer_bindlessUniformTexelBuffers.push_back(std::make_pair(srv_index, framecount));
-				if (uav_index >= 0) allocationhandler->destroyer_bindlessStorageTexelBuffers.push_back(std::make_pair(uav_index, framecount));
+				if (srv_index >= 0) shard.batch.bindlessUniformTexelBuffers.push_back(srv_index);
+				if (uav_index >= 0) shard.batch.bindlessStorageTexelBuffers.push_back(uav_index);
 				for (auto x : subresources_srv_index)
 				{
-					if (x >= 0) allocationhandler->destroyer_bindlessUniformTexelBuffers.push_back(std::make_pair(x, framecount));
+					if (x >= 0) shard.batch.bindlessUniformTexelBuffers.push_back(x);
 				}
 				for (auto x : subresources_uav_index)
 				{
-					if (x >= 0) allocationhandler->destroyer_bindlessStorageTexelBuffers.push_back(std::make_pair(x, framecount));
+					if (x >= 0) shard.batch.bindlessStorageTexelBuffers.push_back(x);
 				}
 			}
 			else
 			{
-				if (srv_index >= 0) allocationhandler->destroyer_bindlessStorageBuffers.push_back(std::make_pair(srv_index, framecount));
-				if (uav_index >= 0) allocationhandler->destroyer_bindlessStorageBuffers.push_back(std::make_pair(uav_index, framecount));
+				if (srv_index >= 0) shard.batch.bindlessStorageBuffers.push_back(srv_index);
+				if (uav_index >= 0) shard.batch.bindlessStorageBuffers.push_back(uav_index);
 				for (auto x : subresources_srv_index)
 				{
-					if (x >= 0) allocationhandler->destroyer_bindlessStorageBuffers.push_back(std::make_pair(x, framecount));
+					if (x >= 0) shard.batch.bindlessStorageBuffers.push_back(x);
 				}
 				for (auto x : subresources_uav_index)
 				{
-					if (x >= 0) allocationhandler->destroyer_bindlessStorageBuffers.push_back(std::make_pair(x, framecount));
+					if (x >= 0) shard.batch.bindlessStorageBuffers.push_back(x);
 				}
 			}
-			allocationhandler->destroylocker.unlock();
+			shard.locker.unlock();
 		}
 	};
 	struct Texture_Vulkan
@@ -672,41 +677,42 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (resource) allocationhandler->destroyer_images.push_back(std::make_pair(std::make_pair(resource, allocation), framecount));
-			if (staging_resource) allocationhandler->destroyer_buffers.push_back(std::make_pair(std::make_pair(staging_resource, allocation), framecount));
-			if (srv) allocationhandler->destroyer_imageviews.push_back(std::make_pair(srv, framecount));
-			if (uav) allocationhandler->destroyer_imageviews.push_back(std::make_pair(uav, framecount));
-			if (srv) allocationhandler->destroyer_imageviews.push_back(std::make_pair(rtv, framecount));
-			if (uav) allocationhandler->destroyer_imageviews.push_back(std::make_pair(dsv, framecount));
+			allocationhandler->memorytracker.Remove(allocation);
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (resource) shard.batch.images.push_back(std::make_pair(resource, allocation));
+			if (staging_resource) shard.batch.buffers.push_back(std::make_pair(staging_resource, allocation));
+			if (srv) shard.batch.imageviews.push_back(srv);
+			if (uav) shard.batch.imageviews.push_back(uav);
+			if (srv) shard.batch.imageviews.push_back(rtv);
+			if (uav) shard.batch.imageviews.push_back(dsv);
 			for (auto x : subresources_srv)
 			{
-				allocationhandler->destroyer_imageviews.push_back(std::make_pair(x, framecount));
+				shard.batch.imageviews.push_back(x);
 			}
 			for (auto x : subresources_uav)
 			{
-				allocationhandler->destroyer_imageviews.push_back(std::make_pair(x, framecount));
+				shard.batch.imageviews.push_back(x);
 			}
 			for (auto x : subresources_rtv)
 			{
-				allocationhandler->destroyer_imageviews.push_back(std::make_pair(x, framecount));
+				shard.batch.imageviews.push_back(x);
 			}
 			for (auto x : subresources_dsv)
 			{
-				allocationhandler->destroyer_imageviews.push_back(std::make_pair(x, framecount));
+				shard.batch.imageviews.push_back(x);
 			}
-			if (srv_index >= 0) allocationhandler->destroyer_bindlessSampledImages.push_back(std::make_pair(srv_index, framecount));
-			if (uav_index >= 0) allocationhandler->destroyer_bindlessStorageImages.push_back(std::make_pair(uav_index, framecount));
+			if (srv_index >= 0) shard.batch.bindlessSampledImages.push_back(srv_index);
+			if (uav_index >= 0) shard.batch.bindlessStorageImages.push_back(uav_index);
 			for (auto x : subresources_srv_index)
 			{
-				if (x >= 0) allocationhandler->destroyer_bindlessSampledImages.push_back(std::make_pair(x, framecount));
+				if (x >= 0) shard.batch.bindlessSampledImages.push_back(x);
 			}
 			for (auto x : subresources_uav_index)
 			{
-				if (x >= 0) allocationhandler->destroyer_bindlessStorageImages.push_back(std::make_pair(x, framecount));
+				if (x >= 0) shard.batch.bindlessStorageImages.push_back(x);
 			}
-			allocationhandler->destroylocker.unlock();
+			shard.locker.unlock();
 		}
 	};
 	struct Sampler_Vulkan
@@ -719,11 +725,11 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (resource) allocationhandler->destroyer_samplers.push_back(std::make_pair(resource, framecount));
-			if (index >= 0) allocationhandler->destroyer_bindlessSamplers.push_back(std::make_pair(index, framecount));
-			allocationhandler->destroylocker.unlock();
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (resource) shard.batch.samplers.push_back(resource);
+			if (index >= 0) shard.batch.bindlessSamplers.push_back(index);
+			shard.locker.unlock();
 		}
 	};
 	struct QueryHeap_Vulkan
@@ -735,16 +741,17 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (pool) allocationhandler->destroyer_querypools.push_back(std::make_pair(pool, framecount));
-			allocationhandler->destroylocker.unlock();
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (pool) shard.batch.querypools.push_back(pool);
+			shard.locker.unlock();
 		}
 	};
 	struct Shader_Vulkan
 	{
 		std::shared_ptr<GraphicsDevice_Vulkan::AllocationHandler> allocationhandler;
 		VkShaderModule shaderModule = VK_NULL_HANDLE;
+		size_t bytecode_hash = 0;
 		VkPipeline pipeline_cs = VK_NULL_HANDLE;
 		VkPipelineShaderStageCreateInfo stageInfo = {};
 		VkPipelineLayout pipelineLayout_cs = VK_NULL_HANDLE; // no lifetime management here
@@ -767,11 +774,11 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (shaderModule) allocationhandler->destroyer_shadermodules.push_back(std::make_pair(shaderModule, framecount));
-			if (pipeline_cs) allocationhandler->destroyer_pipelines.push_back(std::make_pair(pipeline_cs, framecount));
-			allocationhandler->destroylocker.unlock();
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (shaderModule) shard.batch.shadermodules.push_back(shaderModule);
+			if (pipeline_cs) shard.batch.pipelines.push_back(pipeline_cs);
+			shard.locker.unlock();
 		}
 	};
 	struct PipelineState_Vulkan
@@ -786,6 +793,8 @@ namespace vulkan_internal
 		wi::vector<VkDescriptorSet> bindlessSets;
 		uint32_t bindlessFirstSet = 0;
 
+		size_t prewarm_key = 0; // stable hash for the pipeline manifest
+
 		VkPushConstantRange pushconstants = {};
 
 		VkDeviceSize uniform_buffer_sizes[DESCRIPTORBINDER_CBV_COUNT] = {};
@@ -817,11 +826,11 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (renderpass) allocationhandler->destroyer_renderpasses.push_back(std::make_pair(renderpass, framecount));
-			if (framebuffer) allocationhandler->destroyer_framebuffers.push_back(std::make_pair(framebuffer, framecount));
-			allocationhandler->destroylocker.unlock();
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (renderpass) shard.batch.renderpasses.push_back(renderpass);
+			if (framebuffer) shard.batch.framebuffers.push_back(framebuffer);
+			shard.locker.unlock();
 		}
 	};
 	struct BVH_Vulkan
@@ -844,12 +853,13 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (buffer) allocationhandler->destroyer_buffers.push_back(std::make_pair(std::make_pair(buffer, allocation), framecount));
-			if (resource) allocationhandler->destroyer_bvhs.push_back(std::make_pair(resource, framecount));
-			if (index >= 0) allocationhandler->destroyer_bindlessAccelerationStructures.push_back(std::make_pair(index, framecount));
-			allocationhandler->destroylocker.unlock();
+			allocationhandler->memorytracker.Remove(allocation);
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (buffer) shard.batch.buffers.push_back(std::make_pair(buffer, allocation));
+			if (resource) shard.batch.bvhs.push_back(resource);
+			if (index >= 0) shard.batch.bindlessAccelerationStructures.push_back(index);
+			shard.locker.unlock();
 		}
 	};
 	struct RTPipelineState_Vulkan
@@ -861,10 +871,10 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
-			if (pipeline) allocationhandler->destroyer_pipelines.push_back(std::make_pair(pipeline, framecount));
-			allocationhandler->destroylocker.unlock();
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			if (pipeline) shard.batch.pipelines.push_back(pipeline);
+			shard.locker.unlock();
 		}
 	};
 	struct SwapChain_Vulkan
@@ -894,13 +904,13 @@ namespace vulkan_internal
 		{
 			if (allocationhandler == nullptr)
 				return;
-			allocationhandler->destroylocker.lock();
-			uint64_t framecount = allocationhandler->framecount;
+			auto& shard = allocationhandler->GetDestroyShard();
+			shard.locker.lock();
 
 			for (size_t i = 0; i < swapChainImages.size(); ++i)
 			{
-				allocationhandler->destroyer_framebuffers.push_back(std::make_pair(swapChainFramebuffers[i], framecount));
-				allocationhandler->destroyer_imageviews.push_back(std::make_pair(swapChainImageViews[i], framecount));
+				shard.batch.framebuffers.push_back(swapChainFramebuffers[i]);
+				shard.batch.imageviews.push_back(swapChainImageViews[i]);
 			}
 
 #ifdef SDL2
@@ -909,13 +919,13 @@ namespace vulkan_internal
 			if (SDL_WasInit(SDL_INIT_VIDEO))
 #endif
 			{
-				allocationhandler->destroyer_swapchains.push_back(std::make_pair(swapChain, framecount));
-				allocationhandler->destroyer_surfaces.push_back(std::make_pair(surface, framecount));
+				shard.batch.swapchains.push_back(swapChain);
+				shard.batch.surfaces.push_back(surface);
 			}
-			allocationhandler->destroyer_semaphores.push_back(std::make_pair(swapchainAcquireSemaphore, framecount));
-			allocationhandler->destroyer_semaphores.push_back(std::make_pair(swapchainReleaseSemaphore, framecount));
+			shard.batch.semaphores.push_back(swapchainAcquireSemaphore);
+			shard.batch.semaphores.push_back(swapchainReleaseSemaphore);
 
-			allocationhandler->destroylocker.unlock();
+			shard.locker.unlock();
 
 		}
 	};
@@ -965,6 +975,88 @@ namespace vulkan_internal
 	{
 		return wi::helper::GetTempDirectoryPath() + "WickedVkPipelineCache.data";
 	}
+	inline const std::string GetPipelineManifestPath()
+	{
+		return wi::helper::GetTempDirectoryPath() + "WickedVkPipelineManifest.data";
+	}
+	static constexpr uint32_t PIPELINE_MANIFEST_MAGIC = 0x4D505657; // "WVPM"
+	static constexpr uint32_t PIPELINE_MANIFEST_VERSION = 1;
+
+	// Computes a PipelineState hash from the shader bytecodes and state contents instead of pointers, so it will be the same between runs
+	size_t ComputePipelineStateKey(const PipelineStateDesc& desc)
+	{
+		size_t key = 0;
+		for (const Shader* shader : { desc.ms, desc.as, desc.vs, desc.ps, desc.hs, desc.ds, desc.gs })
+		{
+			wi::helper::hash_combine(key, shader == nullptr ? 0 : to_internal(shader)->bytecode_hash);
+		}
+		if (desc.il != nullptr)
+		{
+			for (auto& x : desc.il->elements)
+			{
+				wi::helper::hash_combine(key, x.semantic_name);
+				wi::helper::hash_combine(key, x.semantic_index);
+				wi::helper::hash_combine(key, x.format);
+				wi::helper::hash_combine(key, x.input_slot);
+				wi::helper::hash_combine(key, x.aligned_byte_offset);
+				wi::helper::hash_combine(key, x.input_slot_class);
+			}
+		}
+		if (desc.rs != nullptr)
+		{
+			const RasterizerState& rs = *desc.rs;
+			wi::helper::hash_combine(key, rs.fill_mode);
+			wi::helper::hash_combine(key, rs.cull_mode);
+			wi::helper::hash_combine(key, rs.front_counter_clockwise);
+			wi::helper::hash_combine(key, rs.depth_bias);
+			wi::helper::hash_combine(key, rs.depth_bias_clamp);
+			wi::helper::hash_combine(key, rs.slope_scaled_depth_bias);
+			wi::helper::hash_combine(key, rs.depth_clip_enable);
+			wi::helper::hash_combine(key, rs.multisample_enable);
+			wi::helper::hash_combine(key, rs.antialiased_line_enable);
+			wi::helper::hash_combine(key, rs.conservative_rasterization_enable);
+			wi::helper::hash_combine(key, rs.forced_sample_count);
+		}
+		if (desc.bs != nullptr)
+		{
+			const BlendState& bs = *desc.bs;
+			wi::helper::hash_combine(key, bs.alpha_to_coverage_enable);
+			wi::helper::hash_combine(key, bs.independent_blend_enable);
+			for (auto& x : bs.render_target)
+			{
+				wi::helper::hash_combine(key, x.blend_enable);
+				wi::helper::hash_combine(key, x.src_blend);
+				wi::helper::hash_combine(key, x.dest_blend);
+				wi::helper::hash_combine(key, x.blend_op);
+				wi::helper::hash_combine(key, x.src_blend_alpha);
+				wi::helper::hash_combine(key, x.dest_blend_alpha);
+				wi::helper::hash_combine(key, x.blend_op_alpha);
+				wi::helper::hash_combine(key, x.render_target_write_mask);
+			}
+		}
+		if (desc.dss != nullptr)
+		{
+			const DepthStencilState& dss = *desc.dss;
+			wi::helper::hash_combine(key, dss.depth_enable);
+			wi::helper::hash_combine(key, dss.depth_write_mask);
+			wi::helper::hash_combine(key, dss.depth_func);
+			wi::helper::hash_combine(key, dss.stencil_enable);
+			wi::helper::hash_combine(key, dss.stencil_read_mask);
+			wi::helper::hash_combine(key, dss.stencil_write_mask);
+			for (auto& x : { dss.front_face, dss.back_face })
+			{
+				wi::helper::hash_combine(key, x.stencil_fail_op);
+				wi::helper::hash_combine(key, x.stencil_depth_fail_op);
+				wi::helper::hash_combine(key, x.stencil_pass_op);
+				wi::helper::hash_combine(key, x.stencil_func);
+			}
+			wi::helper::hash_combine(key, dss.depth_bounds_test_enable);
+		}
+		wi::helper::hash_combine(key, desc.pt);
+		wi::helper::hash_combine(key, desc.patch_control_points);
+		wi::helper::hash_combine(key, desc.sample_mask);
+		return key;
+	}
 
 	bool CreateSwapChainInternal(
 		SwapChain_Vulkan* internal_state,
@@ -1191,9 +1283,10 @@ namespace vulkan_internal
 
 			if (internal_state->swapChainImageViews[i] != VK_NULL_HANDLE)
 			{
-				allocationhandler->destroylocker.lock();
-				allocationhandler->destroyer_imageviews.push_back(std::make_pair(internal_state->swapChainImageViews[i], allocationhandler->framecount));
-				allocationhandler->destroylocker.unlock();
+				auto& shard = allocationhandler->GetDestroyShard();
+				shard.locker.lock();
+				shard.batch.imageviews.push_back(internal_state->swapChainImageViews[i]);
+				shard.locker.unlock();
 			}
 			res = vkCreateImageView(device, &createInfo, nullptr, &internal_state->swapChainImageViews[i]);
 			assert(res == VK_SUCCESS);
@@ -1213,9 +1306,10 @@ namespace vulkan_internal
 
 			if (internal_state->swapChainFramebuffers[i] != VK_NULL_HANDLE)
 			{
-				allocationhandler->destroylocker.lock();
-				allocationhandler->destroyer_framebuffers.push_back(std::make_pair(internal_state->swapChainFramebuffers[i], allocationhandler->framecount));
-				allocationhandler->destroylocker.unlock();
+				auto& shard = allocationhandler->GetDestroyShard();
+				shard.locker.lock();
+				shard.batch.framebuffers.push_back(internal_state->swapChainFramebuffers[i]);
+				shard.locker.unlock();
 			}
 			res = vkCreateFramebuffer(device, &framebufferInfo, nullptr, &internal_state->swapChainFramebuffers[i]);
 			assert(res == VK_SUCCESS);
@@ -1328,6 +1422,9 @@ using namespace vulkan_internal;
 
 		VkResult res = vkCreateSemaphore(device->device, &createInfo, nullptr, &semaphore);
 		assert(res == VK_SUCCESS);
+
+		// If the copy queue is the same as an other queue, it can only be submitted to from the thread that calls SubmitCommandLists():
+		immediate_submit = device->copyQueue != device->graphicsQueue && device->copyQueue != device->computeQueue;
 	}
 	void GraphicsDevice_Vulkan::CopyAllocator::destroy()
 	{
@@ -1336,66 +1433,163 @@ using namespace vulkan_internal;
 		{
 			vkDestroyCommandPool(device->device, x.commandPool, nullptr);
 		}
+		for (auto& x : worklist)
+		{
+			vkDestroyCommandPool(device->device, x.commandPool, nullptr);
+		}
+		pages.clear();
 		vkDestroySemaphore(device->device, semaphore, nullptr);
 	}
-	GraphicsDevice_Vulkan::CopyAllocator::CopyCMD GraphicsDevice_Vulkan::CopyAllocator::allocate(uint64_t staging_size)
+	GraphicsDevice_Vulkan::CopyAllocator::CopyCMD GraphicsDevice_Vulkan::CopyAllocator::allocate(uint64_t staging_size, uint64_t alignment)
 	{
 		locker.lock();
 
-		// create a new command list if there are no free ones:
+		uint64_t offset = 0;
+		if (current_page < pages.size())
+		{
+			offset = AlignTo(pages[current_page].offset, alignment);
+		}
+		if (current_page >= pages.size() || offset + staging_size > pages[current_page].buffer.desc.size)
+		{
+			// The current page is full, search for a page that the GPU is finished with:
+			uint64_t completed_fence_value = 0;
+			VkResult res = vkGetSemaphoreCounterValue(device->device, semaphore, &completed_fence_value);
+			assert(res == VK_SUCCESS);
+
+			current_page = ~0u;
+			for (uint32_t i = 0; i < (uint32_t)pages.size(); ++i)
+			{
+				const StagingPage& page = pages[i];
+				if (page.pending == 0 && page.target <= completed_fence_value && page.buffer.desc.size >= staging_size)
+				{
+					current_page = i;
+					break;
+				}
+			}
+
+			// If no page was found that fits the data, create one:
+			if (current_page == ~0u)
+			{
+				GPUBufferDesc uploaddesc;
+				uploaddesc.size = std::max(STAGING_PAGE_SIZE, wi::math::GetNextPowerOfTwo(staging_size));
+				uploaddesc.usage = Usage::UPLOAD;
+				StagingPage& page = pages.emplace_back();
+				bool upload_success = device->CreateBuffer(&uploaddesc, nullptr, &page.buffer);
+				assert(upload_success);
+				device->SetName(&page.buffer, "CopyAllocator::staging");
+				current_page = uint32_t(pages.size() - 1);
+			}
+			pages[current_page].offset = 0;
+			offset = 0;
+		}
+
+		StagingPage& page = pages[current_page];
+		CopyCMD cmd;
+		cmd.page = current_page;
+		cmd.uploadbuffer = to_internal(&page.buffer)->resource;
+		cmd.offset = offset;
+		cmd.data = (uint8_t*)page.buffer.mapped_data + offset;
+		page.offset = offset + staging_size;
+		page.pending++;
+
+		locker.unlock();
+		return cmd;
+	}
+	void GraphicsDevice_Vulkan::CopyAllocator::submitted(const CopyCMD& cmd)
+	{
+		StagingPage& page = pages[cmd.page];
+		assert(page.pending > 0);
+		page.pending--;
+		page.target = fenceValue + 1; // the next batch submit will signal this
+	}
+	void GraphicsDevice_Vulkan::CopyAllocator::submit_buffer(const CopyCMD& cmd, VkBuffer dst, uint64_t size, VkAccessFlags dstAccessMask)
+	{
+		locker.lock();
+		BufferCopy& copy = buffer_copies.emplace_back();
+		copy.src = cmd.uploadbuffer;
+		copy.dst = dst;
+		copy.region.srcOffset = cmd.offset;
+		copy.region.dstOffset = 0;
+		copy.region.size = size;
+		copy.dstAccessMask = dstAccessMask;
+		batch_size += size;
+		submitted(cmd);
+		if (immediate_submit && batch_size >= BATCH_FLUSH_SIZE)
+		{
+			submit_batch();
+		}
+		locker.unlock();
+	}
+	void GraphicsDevice_Vulkan::CopyAllocator::submit_texture(const CopyCMD& cmd, VkImage dst, uint64_t size, VkImageLayout oldLayout, const VkImageSubresourceRange& range, const VkBufferImageCopy* regions, uint32_t region_count)
+	{
+		locker.lock();
+		TextureCopy& copy = texture_copies.emplace_back();
+		copy.src = cmd.uploadbuffer;
+		copy.dst = dst;
+		copy.oldLayout = oldLayout;
+		copy.range = range;
+		copy.region_offset = (uint32_t)texture_regions.size();
+		copy.region_count = region_count;
+		texture_regions.insert(texture_regions.end(), regions, regions + region_count);
+		batch_size += size;
+		submitted(cmd);
+		if (immediate_submit && batch_size >= BATCH_FLUSH_SIZE)
+		{
+			submit_batch();
+		}
+		locker.unlock();
+	}
+	void GraphicsDevice_Vulkan::CopyAllocator::submit_batch()
+	{
+		if (buffer_copies.empty() && texture_copies.empty())
+			return;
+
+		VkResult res;
+
+		// free up the finished command buffers:
+		uint64_t completed_fence_value;
+		res = vkGetSemaphoreCounterValue(device->device, semaphore, &completed_fence_value);
+		assert(res == VK_SUCCESS);
+		for (size_t i = 0; i < worklist.size(); ++i)
+		{
+			if (worklist[i].target <= completed_fence_value)
+			{
+				freelist.push_back(worklist[i]);
+				worklist[i] = worklist.back();
+				worklist.pop_back();
+				i--;
+			}
+		}
+
+		// create a new command buffer if there are no free ones:
 		if (freelist.empty())
 		{
-			CopyCMD cmd;
+			Batch batch;
 
 			VkCommandPoolCreateInfo poolInfo = {};
 			poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 			poolInfo.queueFamilyIndex = device->copyFamily;
 			poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
 
-			VkResult res = vkCreateCommandPool(device->device, &poolInfo, nullptr, &cmd.commandPool);
+			res = vkCreateCommandPool(device->device, &poolInfo, nullptr, &batch.commandPool);
 			assert(res == VK_SUCCESS);
 
 			VkCommandBufferAllocateInfo commandBufferInfo = {};
 			commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 			commandBufferInfo.commandBufferCount = 1;
-			commandBufferInfo.commandPool = cmd.commandPool;
+			commandBufferInfo.commandPool = batch.commandPool;
 			commandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
-			res = vkAllocateCommandBuffers(device->device, &commandBufferInfo, &cmd.commandBuffer);
+			res = vkAllocateCommandBuffers(device->device, &commandBufferInfo, &batch.commandBuffer);
 			assert(res == VK_SUCCESS);
 
-			freelist.push_back(cmd);
+			freelist.push_back(batch);
 		}
 
-		CopyCMD cmd = freelist.back();
-		if (cmd.uploadbuffer.desc.size < staging_size)
-		{
-			// Try to search for a staging buffer that can fit the request:
-			for (size_t i = 0; i < freelist.size(); ++i)
-			{
-				if (freelist[i].uploadbuffer.desc.size >= staging_size)
-				{
-					cmd = freelist[i];
-					std::swap(freelist[i], freelist.back());
-					break;
-				}
-			}
-		}
+		Batch batch = freelist.back();
 		freelist.pop_back();
-		locker.unlock();
 
-		// If no buffer was found that fits the data, create one:
-		if (cmd.uploadbuffer.desc.size < staging_size)
-		{
-			GPUBufferDesc uploaddesc;
-			uploaddesc.size = wi::math::GetNextPowerOfTwo(staging_size);
-			uploaddesc.usage = Usage::UPLOAD;
-			bool upload_success = device->CreateBuffer(&uploaddesc, nullptr, &cmd.uploadbuffer);
-			assert(upload_success);
-		}
-
-		// begin command list in valid state:
-		VkResult res = vkResetCommandPool(device->device, cmd.commandPool, 0);
+		res = vkResetCommandPool(device->device, batch.commandPool, 0);
 		assert(res == VK_SUCCESS);
 
 		VkCommandBufferBeginInfo beginInfo = {};
@@ -1403,69 +1597,114 @@ using namespace vulkan_internal;
 		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 		beginInfo.pInheritanceInfo = nullptr;
 
-		res = vkBeginCommandBuffer(cmd.commandBuffer, &beginInfo);
+		res = vkBeginCommandBuffer(batch.commandBuffer, &beginInfo);
 		assert(res == VK_SUCCESS);
 
-		return cmd;
-	}
-	void GraphicsDevice_Vulkan::CopyAllocator::submit(CopyCMD cmd)
-	{
-		VkResult res = vkEndCommandBuffer(cmd.commandBuffer);
-		assert(res == VK_SUCCESS);
-
-		// It was very slow in Vulkan to submit the copies immediately
-		//	In Vulkan, the submit is not thread safe, so it had to be locked
-		//	Instead, the submits are batched and performed in flush() function
-		locker.lock();
-		cmd.target = ++fenceValue;
-		worklist.push_back(cmd);
-		submit_cmds.push_back(cmd.commandBuffer);
-		submit_wait = std::max(submit_wait, cmd.target);
-		locker.unlock();
-	}
-	uint64_t GraphicsDevice_Vulkan::CopyAllocator::flush()
-	{
-		locker.lock();
-		if (!submit_cmds.empty())
-		{
-			VkSubmitInfo submitInfo = {};
-			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-			submitInfo.commandBufferCount = (uint32_t)submit_cmds.size();
-			submitInfo.pCommandBuffers = submit_cmds.data();
-			submitInfo.pSignalSemaphores = &semaphore;
-			submitInfo.signalSemaphoreCount = 1;
-
-			VkTimelineSemaphoreSubmitInfo timelineInfo = {};
-			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
-			timelineInfo.pNext = nullptr;
-			timelineInfo.waitSemaphoreValueCount = 0;
-			timelineInfo.pWaitSemaphoreValues = nullptr;
-			timelineInfo.signalSemaphoreValueCount = 1;
-			timelineInfo.pSignalSemaphoreValues = &submit_wait;
-
-			submitInfo.pNext = &timelineInfo;
-
-			VkResult res = vkQueueSubmit(device->copyQueue, 1, &submitInfo, VK_NULL_HANDLE);
-			assert(res == VK_SUCCESS);
+		// All destinations are transitioned to copy destination together:
+		buffer_barriers.clear();
+		image_barriers.clear();
+		for (auto& x : buffer_copies)
+		{
+			VkBufferMemoryBarrier& barrier = buffer_barriers.emplace_back();
+			barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.buffer = x.dst;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.size = VK_WHOLE_SIZE;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		}
+		for (auto& x : texture_copies)
+		{
+			VkImageMemoryBarrier& barrier = image_barriers.emplace_back();
+			barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.image = x.dst;
+			barrier.oldLayout = x.oldLayout;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.subresourceRange = x.range;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		}
+		vkCmdPipelineBarrier(
+			batch.commandBuffer,
+			VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0, nullptr,
+			(uint32_t)buffer_barriers.size(), buffer_barriers.data(),
+			(uint32_t)image_barriers.size(), image_barriers.data()
+		);
 
-			submit_cmds.clear();
+		for (auto& x : buffer_copies)
+		{
+			vkCmdCopyBuffer(batch.commandBuffer, x.src, x.dst, 1, &x.region);
+		}
+		for (auto& x : texture_copies)
+		{
+			vkCmdCopyBufferToImage(batch.commandBuffer, x.src, x.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, x.region_count, texture_regions.data() + x.region_offset);
 		}
 
-		// free up the finished command lists:
-		uint64_t completed_fence_value;
-		VkResult res = vkGetSemaphoreCounterValue(device->device, semaphore, &completed_fence_value);
-		assert(res == VK_SUCCESS);
-		for (size_t i = 0; i < worklist.size(); ++i)
+		// Buffers are transitioned to their usage here, textures will be transitioned by the graphics queue:
+		for (size_t i = 0; i < buffer_copies.size(); ++i)
 		{
-			if (worklist[i].target <= completed_fence_value)
-			{
-				freelist.push_back(worklist[i]);
-				worklist[i] = worklist.back();
-				worklist.pop_back();
-				i--;
-			}
+			VkBufferMemoryBarrier& barrier = buffer_barriers[i];
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = buffer_copies[i].dstAccessMask;
 		}
+		if (!buffer_barriers.empty())
+		{
+			vkCmdPipelineBarrier(
+				batch.commandBuffer,
+				VK_PIPELINE_STAGE_TRANSFER_BIT,
+				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				0,
+				0, nullptr,
+				(uint32_t)buffer_barriers.size(), buffer_barriers.data(),
+				0, nullptr
+			);
+		}
+
+		res = vkEndCommandBuffer(batch.commandBuffer);
+		assert(res == VK_SUCCESS);
+
+		batch.target = ++fenceValue;
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.commandBuffer;
+		submitInfo.pSignalSemaphores = &semaphore;
+		submitInfo.signalSemaphoreCount = 1;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.pNext = nullptr;
+		timelineInfo.waitSemaphoreValueCount = 0;
+		timelineInfo.pWaitSemaphoreValues = nullptr;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &batch.target;
+
+		submitInfo.pNext = &timelineInfo;
 
+		res = vkQueueSubmit(device->copyQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		assert(res == VK_SUCCESS);
+
+		worklist.push_back(batch);
+		submit_wait = batch.target;
+
+		buffer_copies.clear();
+		texture_copies.clear();
+		texture_regions.clear();
+		batch_size = 0;
+	}
+	uint64_t GraphicsDevice_Vulkan::CopyAllocator::flush()
+	{
+		locker.lock();
+		submit_batch();
 		uint64_t value = submit_wait;
 		submit_wait = 0;
 		locker.unlock();
@@ -1543,10 +1782,11 @@ using namespace vulkan_internal;
 	{
 		if (descriptorPool != VK_NULL_HANDLE)
 		{
-			device->allocationhandler->destroylocker.lock();
-			device->allocationhandler->destroyer_descriptorPools.push_back(std::make_pair(descriptorPool, device->FRAMECOUNT));
+			auto& shard = device->allocationhandler->GetDestroyShard();
+			shard.locker.lock();
+			shard.batch.descriptorPools.push_back(descriptorPool);
 			descriptorPool = VK_NULL_HANDLE;
-			device->allocationhandler->destroylocker.unlock();
+			shard.locker.unlock();
 		}
 	}
 	void GraphicsDevice_Vulkan::FrameResources::DescriptorBinderPool::reset()
@@ -1947,8 +2187,15 @@ using namespace vulkan_internal;
 							{
 								int subresource = table.SRV_index[original_binding];
 								auto buffer_internal = to_internal((const GPUBuffer*)&resource);
-								bufferInfos.back().buffer = buffer_internal->resource;
-								bufferInfos.back().range = VK_WHOLE_SIZE;
+								if (subresource >= 0)
+								{
+									bufferInfos.back() = buffer_internal->subresources_srv_range[subresource];
+								}
+								else
+								{
+									bufferInfos.back().buffer = buffer_internal->resource;
+									bufferInfos.back().range = VK_WHOLE_SIZE;
+								}
 							}
 						}
 						else
@@ -1965,8 +2212,15 @@ using namespace vulkan_internal;
 							{
 								int subresource = table.UAV_index[original_binding];
 								auto buffer_internal = to_internal((const GPUBuffer*)&resource);
-								bufferInfos.back().buffer = buffer_internal->resource;
-								bufferInfos.back().range = VK_WHOLE_SIZE;
+								if (subresource >= 0)
+								{
+									bufferInfos.back() = buffer_internal->subresources_uav_range[subresource];
+								}
+								else
+								{
+									bufferInfos.back().buffer = buffer_internal->resource;
+									bufferInfos.back().range = VK_WHOLE_SIZE;
+								}
 							}
 						}
 					}
@@ -2042,6 +2296,168 @@ using namespace vulkan_internal;
 		dirty = DIRTY_NONE;
 	}
 
+	VkPipeline GraphicsDevice_Vulkan::create_pipeline(const PipelineState* pso, VkRenderPass renderpass, const PipelineAttachmentLayout* attachments, uint32_t attachment_count, const uint32_t* strides) const
+	{
+		auto internal_state = to_internal(pso);
+
+		VkGraphicsPipelineCreateInfo pipelineInfo = internal_state->pipelineInfo; // make a copy here
+		pipelineInfo.renderPass = renderpass;
+		pipelineInfo.subpass = 0;
+
+		// MSAA:
+		VkPipelineMultisampleStateCreateInfo multisampling = {};
+		multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		multisampling.sampleShadingEnable = VK_FALSE;
+		multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		if (attachment_count > 0)
+		{
+			multisampling.rasterizationSamples = (VkSampleCountFlagBits)attachments[0].sample_count;
+		}
+		if (pso->desc.rs != nullptr)
+		{
+			const RasterizerState& desc = *pso->desc.rs;
+			if (desc.forced_sample_count > 1)
+			{
+				multisampling.rasterizationSamples = (VkSampleCountFlagBits)desc.forced_sample_count;
+			}
+		}
+		multisampling.minSampleShading = 1.0f;
+		VkSampleMask samplemask = internal_state->samplemask;
+		samplemask = pso->desc.sample_mask;
+		multisampling.pSampleMask = &samplemask;
+		if (pso->desc.bs != nullptr)
+		{
+			multisampling.alphaToCoverageEnable = pso->desc.bs->alpha_to_coverage_enable ? VK_TRUE : VK_FALSE;
+		}
+		else
+		{
+			multisampling.alphaToCoverageEnable = VK_FALSE;
+		}
+		multisampling.alphaToOneEnable = VK_FALSE;
+
+		pipelineInfo.pMultisampleState = &multisampling;
+
+
+		// Blending:
+		uint32_t numBlendAttachments = 0;
+		VkPipelineColorBlendAttachmentState colorBlendAttachments[8] = {};
+		for (uint32_t i = 0; i < attachment_count; ++i)
+		{
+			if (attachments[i].type != RenderPassAttachment::Type::RENDERTARGET)
+			{
+				continue;
+			}
+
+			size_t attachmentIndex = 0;
+			if (pso->desc.bs->independent_blend_enable)
+				attachmentIndex = i;
+
+			const auto& desc = pso->desc.bs->render_target[attachmentIndex];
+			VkPipelineColorBlendAttachmentState& attachment = colorBlendAttachments[numBlendAttachments];
+			numBlendAttachments++;
+
+			attachment.blendEnable = desc.blend_enable ? VK_TRUE : VK_FALSE;
+
+			attachment.colorWriteMask = 0;
+			if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_RED))
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_R_BIT;
+			}
+			if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_GREEN))
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_G_BIT;
+			}
+			if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_BLUE))
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_B_BIT;
+			}
+			if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_ALPHA))
+			{
+				attachment.colorWriteMask |= VK_COLOR_COMPONENT_A_BIT;
+			}
+
+			attachment.srcColorBlendFactor = _ConvertBlend(desc.src_blend);
+			attachment.dstColorBlendFactor = _ConvertBlend(desc.dest_blend);
+			attachment.colorBlendOp = _ConvertBlendOp(desc.blend_op);
+			attachment.srcAlphaBlendFactor = _ConvertBlend(desc.src_blend_alpha);
+			attachment.dstAlphaBlendFactor = _ConvertBlend(desc.dest_blend_alpha);
+			attachment.alphaBlendOp = _ConvertBlendOp(desc.blend_op_alpha);
+		}
+
+		VkPipelineColorBlendStateCreateInfo colorBlending = {};
+		colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		colorBlending.logicOpEnable = VK_FALSE;
+		colorBlending.logicOp = VK_LOGIC_OP_COPY;
+		colorBlending.attachmentCount = numBlendAttachments;
+		colorBlending.pAttachments = colorBlendAttachments;
+		colorBlending.blendConstants[0] = 1.0f;
+		colorBlending.blendConstants[1] = 1.0f;
+		colorBlending.blendConstants[2] = 1.0f;
+		colorBlending.blendConstants[3] = 1.0f;
+
+		pipelineInfo.pColorBlendState = &colorBlending;
+
+		// Input layout:
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		wi::vector<VkVertexInputBindingDescription> bindings;
+		wi::vector<VkVertexInputAttributeDescription> attributes;
+		if (pso->desc.il != nullptr)
+		{
+			uint32_t lastBinding = 0xFFFFFFFF;
+			for (auto& x : pso->desc.il->elements)
+			{
+				if (x.input_slot == lastBinding)
+					continue;
+				lastBinding = x.input_slot;
+				VkVertexInputBindingDescription& bind = bindings.emplace_back();
+				bind.binding = x.input_slot;
+				bind.inputRate = x.input_slot_class == InputClassification::PER_VERTEX_DATA ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE;
+				bind.stride = strides[x.input_slot];
+			}
+
+			uint32_t offset = 0;
+			uint32_t i = 0;
+			lastBinding = 0xFFFFFFFF;
+			for (auto& x : pso->desc.il->elements)
+			{
+				VkVertexInputAttributeDescription attr = {};
+				attr.binding = x.input_slot;
+				if (attr.binding != lastBinding)
+				{
+					lastBinding = attr.binding;
+					offset = 0;
+				}
+				attr.format = _ConvertFormat(x.format);
+				attr.location = i;
+				attr.offset = x.aligned_byte_offset;
+				if (attr.offset == InputLayout::APPEND_ALIGNED_ELEMENT)
+				{
+					// need to manually resolve this from the format spec.
+					attr.offset = offset;
+					offset += GetFormatStride(x.format);
+				}
+
+				attributes.push_back(attr);
+
+				i++;
+			}
+
+			vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+			vertexInputInfo.pVertexBindingDescriptions = bindings.data();
+			vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+			vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+		}
+		pipelineInfo.pVertexInputState = &vertexInputInfo;
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		VkResult res = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+		assert(res == VK_SUCCESS);
+
+		return pipeline;
+
+	}
+
 	void GraphicsDevice_Vulkan::pso_validate(CommandList cmd)
 	{
 		if (!dirty_pso[cmd])
@@ -2050,188 +2466,211 @@ using namespace vulkan_internal;
 		const PipelineState* pso = active_pso[cmd];
 		size_t pipeline_hash = prev_pipeline_hash[cmd];
 		wi::helper::hash_combine(pipeline_hash, vb_hash[cmd]);
-		auto internal_state = to_internal(pso);
 
 		VkPipeline pipeline = VK_NULL_HANDLE;
 		auto it = pipelines_global.find(pipeline_hash);
 		if (it == pipelines_global.end())
 		{
-			for (auto& x : pipelines_worker[cmd])
+			auto it_worker = pipelines_worker[cmd].find(pipeline_hash);
+			if (it_worker != pipelines_worker[cmd].end())
 			{
-				if (pipeline_hash == x.first)
-				{
-					pipeline = x.second;
-					break;
-				}
+				pipeline = it_worker->second;
 			}
-
-			if (pipeline == VK_NULL_HANDLE)
+			else
 			{
-				VkGraphicsPipelineCreateInfo pipelineInfo = internal_state->pipelineInfo; // make a copy here
-				pipelineInfo.renderPass = to_internal(active_renderpass[cmd])->renderpass;
-				pipelineInfo.subpass = 0;
-
-				// MSAA:
-				VkPipelineMultisampleStateCreateInfo multisampling = {};
-				multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-				multisampling.sampleShadingEnable = VK_FALSE;
-				multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-				if (active_renderpass[cmd]->desc.attachments.size() > 0 && active_renderpass[cmd]->desc.attachments[0].texture != nullptr)
-				{
-					multisampling.rasterizationSamples = (VkSampleCountFlagBits)active_renderpass[cmd]->desc.attachments[0].texture->desc.sample_count;
-				}
-				if (pso->desc.rs != nullptr)
+				const RenderPass* renderpass = active_renderpass[cmd];
+				PipelineAttachmentLayout attachments[arraysize(PipelinePrewarmEntry::attachments)];
+				const uint32_t attachment_count = (uint32_t)std::min(renderpass->desc.attachments.size(), arraysize(attachments));
+				for (uint32_t i = 0; i < attachment_count; ++i)
 				{
-					const RasterizerState& desc = *pso->desc.rs;
-					if (desc.forced_sample_count > 1)
+					const RenderPassAttachment& attachment = renderpass->desc.attachments[i];
+					attachments[i].type = attachment.type;
+					if (attachment.texture != nullptr)
 					{
-						multisampling.rasterizationSamples = (VkSampleCountFlagBits)desc.forced_sample_count;
+						attachments[i].format = attachment.texture->desc.format;
+						attachments[i].sample_count = attachment.texture->desc.sample_count;
 					}
 				}
-				multisampling.minSampleShading = 1.0f;
-				VkSampleMask samplemask = internal_state->samplemask;
-				samplemask = pso->desc.sample_mask;
-				multisampling.pSampleMask = &samplemask;
-				if (pso->desc.bs != nullptr)
-				{
-					multisampling.alphaToCoverageEnable = pso->desc.bs->alpha_to_coverage_enable ? VK_TRUE : VK_FALSE;
-				}
-				else
-				{
-					multisampling.alphaToCoverageEnable = VK_FALSE;
-				}
-				multisampling.alphaToOneEnable = VK_FALSE;
 
-				pipelineInfo.pMultisampleState = &multisampling;
+				pipeline = create_pipeline(pso, to_internal(renderpass)->renderpass, attachments, attachment_count, vb_strides[cmd]);
+				pipelines_worker[cmd][pipeline_hash] = pipeline;
 
+				prewarm_record(pso, renderpass, vb_strides[cmd], vb_hash[cmd]);
+			}
+		}
+		else
+		{
+			pipeline = it->second;
+		}
+		assert(pipeline != VK_NULL_HANDLE);
 
-				// Blending:
-				uint32_t numBlendAttachments = 0;
-				VkPipelineColorBlendAttachmentState colorBlendAttachments[8] = {};
-				const size_t blend_loopCount = active_renderpass[cmd]->desc.attachments.size();
-				for (size_t i = 0; i < blend_loopCount; ++i)
-				{
-					if (active_renderpass[cmd]->desc.attachments[i].type != RenderPassAttachment::Type::RENDERTARGET)
-					{
-						continue;
-					}
-
-					size_t attachmentIndex = 0;
-					if (pso->desc.bs->independent_blend_enable)
-						attachmentIndex = i;
+		vkCmdBindPipeline(GetCommandList(cmd), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+		dirty_pso[cmd] = false;
+	}
 
-					const auto& desc = pso->desc.bs->render_target[attachmentIndex];
-					VkPipelineColorBlendAttachmentState& attachment = colorBlendAttachments[numBlendAttachments];
-					numBlendAttachments++;
+	void GraphicsDevice_Vulkan::prewarm_record(const PipelineState* pso, const RenderPass* renderpass, const uint32_t* strides, size_t vb_hash)
+	{
+		PipelinePrewarmEntry entry;
+		entry.pso_key = to_internal(pso)->prewarm_key;
+		entry.renderpass_hash = renderpass->hash;
+		entry.vb_hash = vb_hash;
+		if (renderpass->desc.attachments.size() > arraysize(entry.attachments))
+			return;
+		for (auto& attachment : renderpass->desc.attachments)
+		{
+			if (attachment.type == RenderPassAttachment::Type::SHADING_RATE_SOURCE)
+				return; // not supported by pre-warming
+			if (attachment.type != RenderPassAttachment::Type::RESOLVE && (attachment.texture == nullptr || !attachment.texture->IsValid()))
+				return; // swapchain render pass, it is not recreated by pre-warming
+			PipelineAttachmentLayout& layout = entry.attachments[entry.attachment_count++];
+			layout.type = attachment.type;
+			if (attachment.texture != nullptr)
+			{
+				layout.format = attachment.texture->desc.format;
+				layout.sample_count = attachment.texture->desc.sample_count;
+			}
+		}
+		std::memcpy(entry.vb_strides, strides, sizeof(entry.vb_strides));
 
-					attachment.blendEnable = desc.blend_enable ? VK_TRUE : VK_FALSE;
+		std::scoped_lock lock(prewarm_mutex);
+		auto& entries = prewarm_manifest[entry.pso_key];
+		for (auto& x : entries)
+		{
+			if (x.renderpass_hash == entry.renderpass_hash && x.vb_hash == entry.vb_hash)
+				return;
+		}
+		entries.push_back(entry);
+	}
+	void GraphicsDevice_Vulkan::prewarm_schedule(const PipelineState* pso) const
+	{
+		bool start = false;
+		{
+			std::scoped_lock lock(prewarm_mutex);
+			const size_t key = to_internal(pso)->prewarm_key;
+			prewarm_used_keys.insert(key);
+			auto it = prewarm_manifest.find(key);
+			if (it == prewarm_manifest.end())
+				return;
+			for (auto& entry : it->second)
+			{
+				prewarm_queue.emplace_back();
+				prewarm_queue.back().pso = *pso;
+				prewarm_queue.back().entry = entry;
+			}
+			start = !prewarm_running && !prewarm_queue.empty();
+			prewarm_running |= start;
+		}
+		if (!start)
+			return;
 
-					attachment.colorWriteMask = 0;
-					if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_RED))
+		// One low priority job compiles the whole queue, so it doesn't compete with the frame's jobs:
+		prewarm_ctx.priority = wi::jobsystem::Priority::Low;
+		wi::jobsystem::Execute(prewarm_ctx, [this](wi::jobsystem::JobArgs args) {
+			while (true)
+			{
+				PipelinePrewarmJob job;
+				{
+					// The job stops in the same critical section that finds the queue empty,
+					//	so that a schedule call that adds entries after this will start a new job:
+					std::scoped_lock lock(prewarm_mutex);
+					if (prewarm_queue.empty() || prewarm_cancel.load())
 					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_R_BIT;
+						prewarm_running = false;
+						break;
 					}
-					if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_GREEN))
+					job = std::move(prewarm_queue.back());
+					prewarm_queue.pop_back();
+				}
+				const PipelinePrewarmEntry& entry = job.entry;
+
+				// The pipeline only needs a compatible render pass, which only depends on attachment formats and sample counts:
+				VkAttachmentDescription2 attachmentDescriptions[arraysize(entry.attachments)] = {};
+				VkAttachmentReference2 colorAttachmentRefs[8] = {};
+				VkAttachmentReference2 resolveAttachmentRefs[8] = {};
+				VkAttachmentReference2 depthAttachmentRef = {};
+				VkSubpassDescription2 subpass = {};
+				subpass.sType = VK_STRUCTURE_TYPE_SUBPASS_DESCRIPTION_2;
+				subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+				uint32_t attachmentCount = 0;
+				uint32_t resolveCount = 0;
+				for (uint32_t i = 0; i < entry.attachment_count; ++i)
+				{
+					const PipelineAttachmentLayout& layout = entry.attachments[i];
+					if (layout.type == RenderPassAttachment::Type::RESOLVE)
 					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_G_BIT;
+						VkAttachmentReference2& ref = resolveAttachmentRefs[resolveCount++];
+						ref.sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2;
+						ref.attachment = VK_ATTACHMENT_UNUSED;
+						subpass.pResolveAttachments = resolveAttachmentRefs;
+						if (layout.format == Format::UNKNOWN)
+							continue;
+						ref.attachment = attachmentCount;
+						ref.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+						ref.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 					}
-					if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_BLUE))
+					VkAttachmentDescription2& attachment = attachmentDescriptions[attachmentCount];
+					attachment.sType = VK_STRUCTURE_TYPE_ATTACHMENT_DESCRIPTION_2;
+					attachment.format = _ConvertFormat(layout.format);
+					attachment.samples = (VkSampleCountFlagBits)layout.sample_count;
+					attachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+					attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+					attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+					if (layout.type == RenderPassAttachment::Type::RENDERTARGET)
 					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_B_BIT;
+						attachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+						VkAttachmentReference2& ref = colorAttachmentRefs[subpass.colorAttachmentCount++];
+						ref.sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2;
+						ref.attachment = attachmentCount;
+						ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+						ref.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+						subpass.pColorAttachments = colorAttachmentRefs;
 					}
-					if (has_flag(desc.render_target_write_mask, ColorWrite::ENABLE_ALPHA))
+					else if (layout.type == RenderPassAttachment::Type::DEPTH_STENCIL)
 					{
-						attachment.colorWriteMask |= VK_COLOR_COMPONENT_A_BIT;
+						attachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+						depthAttachmentRef.sType = VK_STRUCTURE_TYPE_ATTACHMENT_REFERENCE_2;
+						depthAttachmentRef.attachment = attachmentCount;
+						depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+						depthAttachmentRef.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+						if (IsFormatStencilSupport(layout.format))
+						{
+							depthAttachmentRef.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+						}
+						subpass.pDepthStencilAttachment = &depthAttachmentRef;
 					}
-
-					attachment.srcColorBlendFactor = _ConvertBlend(desc.src_blend);
-					attachment.dstColorBlendFactor = _ConvertBlend(desc.dest_blend);
-					attachment.colorBlendOp = _ConvertBlendOp(desc.blend_op);
-					attachment.srcAlphaBlendFactor = _ConvertBlend(desc.src_blend_alpha);
-					attachment.dstAlphaBlendFactor = _ConvertBlend(desc.dest_blend_alpha);
-					attachment.alphaBlendOp = _ConvertBlendOp(desc.blend_op_alpha);
-				}
-
-				VkPipelineColorBlendStateCreateInfo colorBlending = {};
-				colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-				colorBlending.logicOpEnable = VK_FALSE;
-				colorBlending.logicOp = VK_LOGIC_OP_COPY;
-				colorBlending.attachmentCount = numBlendAttachments;
-				colorBlending.pAttachments = colorBlendAttachments;
-				colorBlending.blendConstants[0] = 1.0f;
-				colorBlending.blendConstants[1] = 1.0f;
-				colorBlending.blendConstants[2] = 1.0f;
-				colorBlending.blendConstants[3] = 1.0f;
-
-				pipelineInfo.pColorBlendState = &colorBlending;
-
-				// Input layout:
-				VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-				vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-				wi::vector<VkVertexInputBindingDescription> bindings;
-				wi::vector<VkVertexInputAttributeDescription> attributes;
-				if (pso->desc.il != nullptr)
-				{
-					uint32_t lastBinding = 0xFFFFFFFF;
-					for (auto& x : pso->desc.il->elements)
+					else
 					{
-						if (x.input_slot == lastBinding)
-							continue;
-						lastBinding = x.input_slot;
-						VkVertexInputBindingDescription& bind = bindings.emplace_back();
-						bind.binding = x.input_slot;
-						bind.inputRate = x.input_slot_class == InputClassification::PER_VERTEX_DATA ? VK_VERTEX_INPUT_RATE_VERTEX : VK_VERTEX_INPUT_RATE_INSTANCE;
-						bind.stride = vb_strides[cmd][x.input_slot];
+						attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 					}
+					attachmentCount++;
+				}
 
-					uint32_t offset = 0;
-					uint32_t i = 0;
-					lastBinding = 0xFFFFFFFF;
-					for (auto& x : pso->desc.il->elements)
-					{
-						VkVertexInputAttributeDescription attr = {};
-						attr.binding = x.input_slot;
-						if (attr.binding != lastBinding)
-						{
-							lastBinding = attr.binding;
-							offset = 0;
-						}
-						attr.format = _ConvertFormat(x.format);
-						attr.location = i;
-						attr.offset = x.aligned_byte_offset;
-						if (attr.offset == InputLayout::APPEND_ALIGNED_ELEMENT)
-						{
-							// need to manually resolve this from the format spec.
-							attr.offset = offset;
-							offset += GetFormatStride(x.format);
-						}
-
-						attributes.push_back(attr);
+				VkRenderPassCreateInfo2 renderPassInfo = {};
+				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO_2;
+				renderPassInfo.attachmentCount = attachmentCount;
+				renderPassInfo.pAttachments = attachmentDescriptions;
+				renderPassInfo.subpassCount = 1;
+				renderPassInfo.pSubpasses = &subpass;
 
-						i++;
-					}
+				VkRenderPass renderpass = VK_NULL_HANDLE;
+				VkResult res = vkCreateRenderPass2(device, &renderPassInfo, nullptr, &renderpass);
+				assert(res == VK_SUCCESS);
 
-					vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
-					vertexInputInfo.pVertexBindingDescriptions = bindings.data();
-					vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
-					vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
-				}
-				pipelineInfo.pVertexInputState = &vertexInputInfo;
+				VkPipeline pipeline = create_pipeline(&job.pso, renderpass, entry.attachments, entry.attachment_count, entry.vb_strides);
+				vkDestroyRenderPass(device, renderpass, nullptr);
 
-				VkResult res = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
-				assert(res == VK_SUCCESS);
+				// Same hash that will be looked up by pso_validate():
+				size_t pipeline_hash = 0;
+				wi::helper::hash_combine(pipeline_hash, job.pso.hash);
+				wi::helper::hash_combine(pipeline_hash, entry.renderpass_hash);
+				wi::helper::hash_combine(pipeline_hash, entry.vb_hash);
 
-				pipelines_worker[cmd].push_back(std::make_pair(pipeline_hash, pipeline));
+				std::scoped_lock lock(prewarm_mutex);
+				prewarm_results.push_back(std::make_pair(pipeline_hash, pipeline));
 			}
-		}
-		else
-		{
-			pipeline = it->second;
-		}
-		assert(pipeline != VK_NULL_HANDLE);
-
-		vkCmdBindPipeline(GetCommandList(cmd), VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-		dirty_pso[cmd] = false;
+		});
 	}
 
 	void GraphicsDevice_Vulkan::predraw(CommandList cmd)
@@ -2536,6 +2975,11 @@ using namespace vulkan_internal;
 					properties_chain = &mesh_shader_properties.pNext;
 				}
 
+				if (checkExtensionSupport(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, available_deviceExtensions))
+				{
+					enabled_deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+				}
+
 				if (checkExtensionSupport(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME, available_deviceExtensions))
 				{
 					enabled_deviceExtensions.push_back(VK_EXT_CONDITIONAL_RENDERING_EXTENSION_NAME);
@@ -2711,6 +3155,7 @@ using namespace vulkan_internal;
 			createInfo.ppEnabledExtensionNames = enabled_deviceExtensions.data();
 
 			res = vkCreateDevice(physicalDevice, &createInfo, nullptr, &device);
+			memoryBudgetEXT = std::find_if(enabled_deviceExtensions.begin(), enabled_deviceExtensions.end(), [](const char* x) { return strcmp(x, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0; }) != enabled_deviceExtensions.end();
 			assert(res == VK_SUCCESS);
 			if (res != VK_SUCCESS)
 			{
@@ -2767,9 +3212,14 @@ using namespace vulkan_internal;
 		allocatorInfo.physicalDevice = physicalDevice;
 		allocatorInfo.device = device;
 		allocatorInfo.instance = instance;
+		allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_2; // same as the instance, VMA will use the core memory properties query for the budget
 		if (features_1_2.bufferDeviceAddress)
 		{
-			allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+		}
+		if (memoryBudgetEXT)
+		{
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
 		}
 		res = vmaCreateAllocator(&allocatorInfo, &allocationhandler->allocator);
 		assert(res == VK_SUCCESS);
@@ -3131,6 +3581,27 @@ using namespace vulkan_internal;
 			// Create Vulkan pipeline cache
 			res = vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache);
 			assert(res == VK_SUCCESS);
+
+			// Load the pipeline pre-warm manifest, the pipelines will be compiled when their PipelineStates are created:
+			wi::vector<uint8_t> manifestData;
+			uint32_t header[4] = {};
+			if (wi::helper::FileRead(GetPipelineManifestPath(), manifestData) && manifestData.size() >= sizeof(header))
+			{
+				std::memcpy(header, manifestData.data(), sizeof(header));
+				if (header[0] == PIPELINE_MANIFEST_MAGIC &&
+					header[1] == PIPELINE_MANIFEST_VERSION &&
+					header[2] == sizeof(PipelinePrewarmEntry) &&
+					manifestData.size() >= sizeof(header) + header[3] * sizeof(PipelinePrewarmEntry))
+				{
+					for (uint32_t i = 0; i < header[3]; ++i)
+					{
+						PipelinePrewarmEntry entry;
+						std::memcpy(&entry, manifestData.data() + sizeof(header) + i * sizeof(PipelinePrewarmEntry), sizeof(entry));
+						prewarm_manifest[entry.pso_key].push_back(entry);
+					}
+					wi::backlog::post("Vulkan pipeline manifest loaded: " + std::to_string(header[3]) + " pipelines will be compiled in the background");
+				}
+			}
 		}
 
 		// Static samplers:
@@ -3264,6 +3735,9 @@ using namespace vulkan_internal;
 	}
 	GraphicsDevice_Vulkan::~GraphicsDevice_Vulkan()
 	{
+		prewarm_cancel.store(true);
+		wi::jobsystem::Wait(prewarm_ctx);
+
 		VkResult res = vkDeviceWaitIdle(device);
 		assert(res == VK_SUCCESS);
 
@@ -3309,6 +3783,38 @@ using namespace vulkan_internal;
 		{
 			vkDestroyPipeline(device, x.second, nullptr);
 		}
+		for (auto& x : prewarm_results)
+		{
+			vkDestroyPipeline(device, x.second, nullptr);
+		}
+
+		// Write the pipeline pre-warm manifest:
+		{
+			wi::vector<uint8_t> data;
+			auto write = [&](const void* src, size_t size) {
+				const size_t offset = data.size();
+				data.resize(offset + size);
+				std::memcpy(data.data() + offset, src, size);
+			};
+			uint32_t count = 0;
+			for (auto& x : prewarm_manifest)
+			{
+				if (prewarm_used_keys.count(x.first) > 0)
+				{
+					count += (uint32_t)x.second.size();
+				}
+			}
+			const uint32_t header[] = { PIPELINE_MANIFEST_MAGIC, PIPELINE_MANIFEST_VERSION, (uint32_t)sizeof(PipelinePrewarmEntry), count };
+			write(header, sizeof(header));
+			for (auto& x : prewarm_manifest)
+			{
+				if (prewarm_used_keys.count(x.first) > 0)
+				{
+					write(x.second.data(), sizeof(PipelinePrewarmEntry) * x.second.size());
+				}
+			}
+			wi::helper::FileWrite(GetPipelineManifestPath(), data.data(), data.size());
+		}
 
 		vmaDestroyBuffer(allocationhandler->allocator, nullBuffer, nullBufferAllocation);
 		vkDestroyBufferView(device, nullBufferView, nullptr);
@@ -3520,6 +4026,10 @@ using namespace vulkan_internal;
 
 		VkResult res = vmaCreateBuffer(allocationhandler->allocator, &bufferInfo, &allocInfo, &internal_state->resource, &internal_state->allocation, nullptr);
 		assert(res == VK_SUCCESS);
+		if (res == VK_SUCCESS)
+		{
+			allocationhandler->memorytracker.Add(internal_state->allocation, GPUMemoryUsage::Category::BUFFER, internal_state->allocation->GetSize());
+		}
 
 		if (pDesc->usage == Usage::READBACK || pDesc->usage == Usage::UPLOAD)
 		{
@@ -3540,83 +4050,39 @@ using namespace vulkan_internal;
 		{
 			auto cmd = copyAllocator.allocate(pDesc->size);
 
-			std::memcpy(cmd.uploadbuffer.mapped_data, pInitialData, pBuffer->desc.size);
-
-			VkBufferMemoryBarrier barrier = {};
-			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
-			barrier.buffer = internal_state->resource;
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.size = VK_WHOLE_SIZE;
-
-			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-			vkCmdPipelineBarrier(
-				cmd.commandBuffer,
-				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				0,
-				0, nullptr,
-				1, &barrier,
-				0, nullptr
-			);
-
-			VkBufferCopy copyRegion = {};
-			copyRegion.size = pBuffer->desc.size;
-			copyRegion.srcOffset = 0;
-			copyRegion.dstOffset = 0;
-
-			vkCmdCopyBuffer(
-				cmd.commandBuffer,
-				to_internal(&cmd.uploadbuffer)->resource,
-				internal_state->resource,
-				1,
-				&copyRegion
-			);
-
-			std::swap(barrier.srcAccessMask, barrier.dstAccessMask);
+			std::memcpy(cmd.data, pInitialData, pBuffer->desc.size);
 
+			VkAccessFlags dstAccessMask = 0;
 			if (has_flag(pBuffer->desc.bind_flags, BindFlag::CONSTANT_BUFFER))
 			{
-				barrier.dstAccessMask |= VK_ACCESS_UNIFORM_READ_BIT;
+				dstAccessMask |= VK_ACCESS_UNIFORM_READ_BIT;
 			}
 			if (has_flag(pBuffer->desc.bind_flags, BindFlag::VERTEX_BUFFER))
 			{
-				barrier.dstAccessMask |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+				dstAccessMask |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
 			}
 			if (has_flag(pBuffer->desc.bind_flags, BindFlag::INDEX_BUFFER))
 			{
-				barrier.dstAccessMask |= VK_ACCESS_INDEX_READ_BIT;
+				dstAccessMask |= VK_ACCESS_INDEX_READ_BIT;
 			}
 			if (has_flag(pBuffer->desc.bind_flags, BindFlag::SHADER_RESOURCE))
 			{
-				barrier.dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
+				dstAccessMask |= VK_ACCESS_SHADER_READ_BIT;
 			}
 			if (has_flag(pBuffer->desc.bind_flags, BindFlag::UNORDERED_ACCESS))
 			{
-				barrier.dstAccessMask |= VK_ACCESS_SHADER_WRITE_BIT;
+				dstAccessMask |= VK_ACCESS_SHADER_WRITE_BIT;
 			}
 			if (has_flag(pBuffer->desc.misc_flags, ResourceMiscFlag::INDIRECT_ARGS))
 			{
-				barrier.dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+				dstAccessMask |= VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
 			}
 			if (has_flag(pBuffer->desc.misc_flags, ResourceMiscFlag::RAY_TRACING))
 			{
-				barrier.dstAccessMask |= VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+				dstAccessMask |= VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR;
 			}
 
-			vkCmdPipelineBarrier(
-				cmd.commandBuffer,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-				0,
-				0, nullptr,
-				1, &barrier,
-				0, nullptr
-			);
-
-			copyAllocator.submit(cmd);
+			copyAllocator.submit_buffer(cmd, internal_state->resource, pBuffer->desc.size, dstAccessMask);
 		}
 
 		if (pDesc->format == Format::UNKNOWN)
@@ -3756,6 +4222,10 @@ using namespace vulkan_internal;
 
 			res = vmaCreateBuffer(allocationhandler->allocator, &bufferInfo, &allocInfo, &internal_state->staging_resource, &internal_state->allocation, nullptr);
 			assert(res == VK_SUCCESS);
+			if (res == VK_SUCCESS)
+			{
+				allocationhandler->memorytracker.Add(internal_state->allocation, GPUMemoryUsage::Category::TEXTURE, internal_state->allocation->GetSize());
+			}
 
 			imageInfo.tiling = VK_IMAGE_TILING_LINEAR;
 			VkImage image;
@@ -3779,12 +4249,19 @@ using namespace vulkan_internal;
 		{
 			res = vmaCreateImage(allocationhandler->allocator, &imageInfo, &allocInfo, &internal_state->resource, &internal_state->allocation, nullptr);
 			assert(res == VK_SUCCESS);
+			if (res == VK_SUCCESS)
+			{
+				const GPUMemoryUsage::Category category = has_flag(pDesc->bind_flags, BindFlag::RENDER_TARGET) || has_flag(pDesc->bind_flags, BindFlag::DEPTH_STENCIL) ?
+					GPUMemoryUsage::Category::RENDERTARGET : GPUMemoryUsage::Category::TEXTURE;
+				allocationhandler->memorytracker.Add(internal_state->allocation, category, internal_state->allocation->GetSize());
+			}
 		}
 
 		// Issue data copy on request:
 		if (pInitialData != nullptr)
 		{
-			auto cmd = copyAllocator.allocate(internal_state->allocation->GetSize());
+			// The buffer offset of the copy must be a multiple of both the texel size and 4:
+			auto cmd = copyAllocator.allocate(internal_state->allocation->GetSize(), std::lcm((uint64_t)GetFormatStride(pDesc->format), (uint64_t)4));
 
 			wi::vector<VkBufferImageCopy> copyRegions;
 
@@ -3799,11 +4276,11 @@ using namespace vulkan_internal;
 				{
 					const SubresourceData& subresourceData = pInitialData[initDataIdx++];
 					VkDeviceSize copySize = subresourceData.row_pitch * height * depth / GetFormatBlockSize(pDesc->format);
-					uint8_t* cpyaddr = (uint8_t*)cmd.uploadbuffer.mapped_data + copyOffset;
+					uint8_t* cpyaddr = (uint8_t*)cmd.data + copyOffset;
 					std::memcpy(cpyaddr, subresourceData.data_ptr, copySize);
 
 					VkBufferImageCopy copyRegion = {};
-					copyRegion.bufferOffset = copyOffset;
+					copyRegion.bufferOffset = cmd.offset + copyOffset;
 					copyRegion.bufferRowLength = 0;
 					copyRegion.bufferImageHeight = 0;
 
@@ -3845,19 +4322,7 @@ using namespace vulkan_internal;
 				barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 				barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
 
-				vkCmdPipelineBarrier(
-					cmd.commandBuffer,
-					VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
-					VK_PIPELINE_STAGE_TRANSFER_BIT,
-					0,
-					0, nullptr,
-					0, nullptr,
-					1, &barrier
-				);
-
-				vkCmdCopyBufferToImage(cmd.commandBuffer, to_internal(&cmd.uploadbuffer)->resource, internal_state->resource, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copyRegions.size(), copyRegions.data());
-
-				copyAllocator.submit(cmd);
+				copyAllocator.submit_texture(cmd, internal_state->resource, copyOffset, imageInfo.initialLayout, barrier.subresourceRange, copyRegions.data(), (uint32_t)copyRegions.size());
 
 				barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 				barrier.newLayout = _ConvertImageLayout(pTexture->desc.layout);
@@ -3949,6 +4414,8 @@ using namespace vulkan_internal;
 
 		VkResult res = VK_SUCCESS;
 
+		internal_state->bytecode_hash = std::hash<std::string_view>()(std::string_view((const char*)pShaderBytecode, BytecodeLength));
+
 		VkShaderModuleCreateInfo moduleInfo = {};
 		moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
 		moduleInfo.codeSize = BytecodeLength;
@@ -4971,6 +5438,9 @@ using namespace vulkan_internal;
 
 		pipelineInfo.pDynamicState = &dynamicStateInfo;
 
+		internal_state->prewarm_key = ComputePipelineStateKey(*pDesc);
+		prewarm_schedule(pso);
+
 		return res == VK_SUCCESS;
 	}
 	bool GraphicsDevice_Vulkan::CreateRenderPass(const RenderPassDesc* pDesc, RenderPass* renderpass) const
@@ -5415,6 +5885,10 @@ using namespace vulkan_internal;
 			nullptr
 		);
 		assert(res == VK_SUCCESS);
+		if (res == VK_SUCCESS)
+		{
+			allocationhandler->memorytracker.Add(internal_state->allocation, GPUMemoryUsage::Category::ACCELERATION_STRUCTURE, internal_state->allocation->GetSize());
+		}
 
 		// Create the acceleration structure:
 		internal_state->createInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
@@ -5847,6 +6321,11 @@ using namespace vulkan_internal;
 					vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
 				}
 
+				VkDescriptorBufferInfo range = {};
+				range.buffer = internal_state->resource;
+				range.offset = offset;
+				range.range = size;
+
 				if (type == SubresourceType::SRV)
 				{
 					if (internal_state->srv_index == -1)
@@ -5855,6 +6334,7 @@ using namespace vulkan_internal;
 						return -1;
 					}
 					internal_state->subresources_srv_index.push_back(index);
+					internal_state->subresources_srv_range.push_back(range);
 					return int(internal_state->subresources_srv_index.size() - 1);
 				}
 				else
@@ -5865,6 +6345,7 @@ using namespace vulkan_internal;
 						return -1;
 					}
 					internal_state->subresources_uav_index.push_back(index);
+					internal_state->subresources_uav_range.push_back(range);
 					return int(internal_state->subresources_uav_index.size() - 1);
 				}
 			}
@@ -5952,6 +6433,45 @@ using namespace vulkan_internal;
 		return -1;
 	}
 
+	void GraphicsDevice_Vulkan::DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const
+	{
+		if (buffer == nullptr || !buffer->IsValid() || subresource < 0)
+			return;
+		auto internal_state = to_internal(buffer);
+		const bool srv = type == SubresourceType::SRV;
+		auto& indices = srv ? internal_state->subresources_srv_index : internal_state->subresources_uav_index;
+		assert(size_t(subresource) < indices.size());
+
+		auto& shard = allocationhandler->GetDestroyShard();
+		shard.locker.lock();
+		if (internal_state->is_typedbuffer)
+		{
+			auto& views = srv ? internal_state->subresources_srv : internal_state->subresources_uav;
+			if (views[subresource] != VK_NULL_HANDLE)
+			{
+				shard.batch.bufferviews.push_back(views[subresource]);
+				views[subresource] = VK_NULL_HANDLE;
+			}
+			if (indices[subresource] >= 0)
+			{
+				if (srv)
+				{
+					shard.batch.bindlessUniformTexelBuffers.push_back(indices[subresource]);
+				}
+				else
+				{
+					shard.batch.bindlessStorageTexelBuffers.push_back(indices[subresource]);
+				}
+			}
+		}
+		else if (indices[subresource] >= 0)
+		{
+			shard.batch.bindlessStorageBuffers.push_back(indices[subresource]);
+		}
+		shard.locker.unlock();
+		indices[subresource] = -1;
+	}
+
 	int GraphicsDevice_Vulkan::GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource) const
 	{
 		if (resource == nullptr || !resource->IsValid())
@@ -6083,36 +6603,58 @@ using namespace vulkan_internal;
 	
 	void GraphicsDevice_Vulkan::SetName(GPUResource* pResource, const char* name)
 	{
-		if (debugUtils)
-		{
-			VkDebugUtilsObjectNameInfoEXT info { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
-			info.pObjectName = name;
-			if (pResource->IsTexture())
-			{
-				info.objectType = VK_OBJECT_TYPE_IMAGE;
-				info.objectHandle = (uint64_t)to_internal((const Texture*)pResource)->resource;
-			}
-			else if (pResource->IsBuffer())
-			{
-				info.objectType = VK_OBJECT_TYPE_BUFFER;
-				info.objectHandle = (uint64_t)to_internal((const GPUBuffer*)pResource)->resource;
-			}
-			else if (pResource->IsAccelerationStructure())
-			{
-				info.objectType = VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR;
-				info.objectHandle = (uint64_t)to_internal((const RaytracingAccelerationStructure*)pResource)->resource;
-			}
+		if (pResource == nullptr || !pResource->IsValid())
+			return;
 
-			if (info.objectHandle == (uint64_t)VK_NULL_HANDLE)
-			{
-				return;
-			}
+		VkDebugUtilsObjectNameInfoEXT info { VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT };
+		info.pObjectName = name;
+		if (pResource->IsTexture())
+		{
+			info.objectType = VK_OBJECT_TYPE_IMAGE;
+			info.objectHandle = (uint64_t)to_internal((const Texture*)pResource)->resource;
+			allocationhandler->memorytracker.SetName(to_internal((const Texture*)pResource)->allocation, name);
+		}
+		else if (pResource->IsBuffer())
+		{
+			info.objectType = VK_OBJECT_TYPE_BUFFER;
+			info.objectHandle = (uint64_t)to_internal((const GPUBuffer*)pResource)->resource;
+			allocationhandler->memorytracker.SetName(to_internal((const GPUBuffer*)pResource)->allocation, name);
+		}
+		else if (pResource->IsAccelerationStructure())
+		{
+			info.objectType = VK_OBJECT_TYPE_ACCELERATION_STRUCTURE_KHR;
+			info.objectHandle = (uint64_t)to_internal((const RaytracingAccelerationStructure*)pResource)->resource;
+			allocationhandler->memorytracker.SetName(to_internal((const RaytracingAccelerationStructure*)pResource)->allocation, name);
+		}
 
+		if (debugUtils && info.objectHandle != (uint64_t)VK_NULL_HANDLE)
+		{
 			VkResult res = vkSetDebugUtilsObjectNameEXT(device, &info);
 			assert(res == VK_SUCCESS);
 		}
 	}
 
+	GPUMemoryUsage GraphicsDevice_Vulkan::GetMemoryUsage() const
+	{
+		GPUMemoryUsage result;
+
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS] = {};
+		vmaGetBudget(allocationhandler->allocator, budgets);
+		const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+		vmaGetMemoryProperties(allocationhandler->allocator, &memoryProperties);
+		for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i)
+		{
+			if (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			{
+				result.budget += budgets[i].budget;
+				result.usage += budgets[i].usage;
+			}
+		}
+
+		allocationhandler->memorytracker.Fill(result);
+		return result;
+	}
+
 	CommandList GraphicsDevice_Vulkan::BeginCommandList(QUEUE_TYPE queue)
 	{
 		VkResult res;
@@ -6299,14 +6841,34 @@ using namespace vulkan_internal;
 					}
 					else
 					{
-						allocationhandler->destroylocker.lock();
-						allocationhandler->destroyer_pipelines.push_back(std::make_pair(x.second, FRAMECOUNT));
-						allocationhandler->destroylocker.unlock();
+						auto& shard = allocationhandler->GetDestroyShard();
+						shard.locker.lock();
+						shard.batch.pipelines.push_back(x.second);
+						shard.locker.unlock();
 					}
 				}
 				pipelines_worker[cmd].clear();
 			}
 
+			// Pipelines that were compiled by pre-warming become visible to all command lists from now:
+			prewarm_mutex.lock();
+			for (auto& x : prewarm_results)
+			{
+				if (pipelines_global.count(x.first) == 0)
+				{
+					pipelines_global[x.first] = x.second;
+				}
+				else
+				{
+					auto& shard = allocationhandler->GetDestroyShard();
+					shard.locker.lock();
+					shard.batch.pipelines.push_back(x.second);
+					shard.locker.unlock();
+				}
+			}
+			prewarm_results.clear();
+			prewarm_mutex.unlock();
+
 			// final submits with fences:
 			for (int queue = 0; queue < QUEUE_COUNT; ++queue)
 			{
@@ -6362,32 +6924,47 @@ using namespace vulkan_internal;
 	}
 	void GraphicsDevice_Vulkan::ClearPipelineStateCache()
 	{
-		allocationhandler->destroylocker.lock();
+		// Background compilation must be stopped, because the pipeline cache will be recreated:
+		prewarm_cancel.store(true);
+		wi::jobsystem::Wait(prewarm_ctx);
+		prewarm_cancel.store(false);
+		prewarm_mutex.lock();
+		prewarm_queue.clear();
+		prewarm_mutex.unlock();
+
+		auto& shard = allocationhandler->GetDestroyShard();
+		shard.locker.lock();
 
 		pso_layout_cache_mutex.lock();
 		for (auto& x : pso_layout_cache)
 		{
-			if (x.second.pipelineLayout) allocationhandler->destroyer_pipelineLayouts.push_back(std::make_pair(x.second.pipelineLayout, FRAMECOUNT));
-			if (x.second.descriptorSetLayout) allocationhandler->destroyer_descriptorSetLayouts.push_back(std::make_pair(x.second.descriptorSetLayout, FRAMECOUNT));
+			if (x.second.pipelineLayout) shard.batch.pipelineLayouts.push_back(x.second.pipelineLayout);
+			if (x.second.descriptorSetLayout) shard.batch.descriptorSetLayouts.push_back(x.second.descriptorSetLayout);
 		}
 		pso_layout_cache.clear();
 		pso_layout_cache_mutex.unlock();
 
 		for (auto& x : pipelines_global)
 		{
-			allocationhandler->destroyer_pipelines.push_back(std::make_pair(x.second, FRAMECOUNT));
+			shard.batch.pipelines.push_back(x.second);
 		}
 		pipelines_global.clear();
 
+		for (auto& x : prewarm_results)
+		{
+			shard.batch.pipelines.push_back(x.second);
+		}
+		prewarm_results.clear();
+
 		for (int i = 0; i < arraysize(pipelines_worker); ++i)
 		{
 			for (auto& x : pipelines_worker[i])
 			{
-				allocationhandler->destroyer_pipelines.push_back(std::make_pair(x.second, FRAMECOUNT));
+				shard.batch.pipelines.push_back(x.second);
 			}
 			pipelines_worker[i].clear();
 		}
-		allocationhandler->destroylocker.unlock();
+		shard.locker.unlock();
 
 		// Destroy Vulkan pipeline cache 
 		vkDestroyPipelineCache(device, pipelineCache, nullptr);
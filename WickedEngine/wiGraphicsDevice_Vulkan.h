@@ -9,7 +9,11 @@
 #ifdef WICKEDENGINE_BUILD_VULKAN
 #include "wiGraphicsDevice.h"
 #include "wiUnorderedMap.h"
+#include "wiUnorderedSet.h"
 #include "wiVector.h"
+#include "wiJobSystem.h"
+#include "wiSpinLock.h"
+#include "wiTimer.h"
 
 #ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
@@ -32,6 +36,7 @@ namespace wi::graphics
 		friend struct CommandQueue;
 	protected:
 		bool debugUtils = false;
+		bool memoryBudgetEXT = false;
 		VkInstance instance = VK_NULL_HANDLE;
 	    VkDebugUtilsMessengerEXT debugUtilsMessenger = VK_NULL_HANDLE;
 		VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
@@ -104,6 +109,10 @@ namespace wi::graphics
 
 		} queues[QUEUE_COUNT];
 
+		// Uploads initial data of resources to the GPU with the copy queue:
+		//	Resource creation only copies the data into shared staging pages and records the copy, it doesn't block
+		//	The recorded copies of all threads are submitted in one command buffer when flushed, which happens at the latest in SubmitCommandLists()
+		//	Completion is tracked with a timeline semaphore, staging pages and command buffers are reused when the GPU finished with them
 		struct CopyAllocator
 		{
 			GraphicsDevice_Vulkan* device = nullptr;
@@ -111,23 +120,74 @@ namespace wi::graphics
 			uint64_t fenceValue = 0;
 			std::mutex locker;
 
+			static constexpr uint64_t STAGING_PAGE_SIZE = 16ull * 1024ull * 1024ull;
+			static constexpr uint64_t BATCH_FLUSH_SIZE = 64ull * 1024ull * 1024ull; // if this much data is pending, the batch is submitted immediately
+			struct StagingPage
+			{
+				GPUBuffer buffer;
+				uint64_t offset = 0;
+				uint64_t target = 0;	// semaphore value after which the GPU is finished with the page
+				uint32_t pending = 0;	// allocations that weren't submitted yet
+			};
+			wi::vector<StagingPage> pages;
+			uint32_t current_page = ~0u;
+
 			struct CopyCMD
+			{
+				uint32_t page = ~0u;
+				VkBuffer uploadbuffer = VK_NULL_HANDLE;
+				uint64_t offset = 0;	// offset of data in uploadbuffer
+				void* data = nullptr;	// write the upload data here
+			};
+
+			struct BufferCopy
+			{
+				VkBuffer src = VK_NULL_HANDLE;
+				VkBuffer dst = VK_NULL_HANDLE;
+				VkBufferCopy region = {};
+				VkAccessFlags dstAccessMask = 0;
+			};
+			struct TextureCopy
+			{
+				VkBuffer src = VK_NULL_HANDLE;
+				VkImage dst = VK_NULL_HANDLE;
+				VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+				VkImageSubresourceRange range = {};
+				uint32_t region_offset = 0;
+				uint32_t region_count = 0;
+			};
+			wi::vector<BufferCopy> buffer_copies;
+			wi::vector<TextureCopy> texture_copies;
+			wi::vector<VkBufferImageCopy> texture_regions;
+			uint64_t batch_size = 0;
+
+			struct Batch
 			{
 				VkCommandPool commandPool = VK_NULL_HANDLE;
 				VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
 				uint64_t target = 0;
-				GPUBuffer uploadbuffer;
 			};
-			wi::vector<CopyCMD> freelist; // available
-			wi::vector<CopyCMD> worklist; // in progress
-			wi::vector<VkCommandBuffer> submit_cmds; // for next submit
+			wi::vector<Batch> freelist; // available
+			wi::vector<Batch> worklist; // in progress
 			uint64_t submit_wait = 0; // last submit wait value
+			bool immediate_submit = false; // whether batches can be submitted from any thread (if the copy queue is not shared with other queues)
+
+			wi::vector<VkBufferMemoryBarrier> buffer_barriers;
+			wi::vector<VkImageMemoryBarrier> image_barriers;
 
 			void init(GraphicsDevice_Vulkan* device);
 			void destroy();
-			CopyCMD allocate(uint64_t staging_size);
-			void submit(CopyCMD cmd);
+			// Allocates staging memory, alignment can be any value
+			CopyCMD allocate(uint64_t staging_size, uint64_t alignment = 16);
+			void submit_buffer(const CopyCMD& cmd, VkBuffer dst, uint64_t size, VkAccessFlags dstAccessMask);
+			// The texture will be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL after the copy, the region buffer offsets must include the allocation offset
+			//	size is the number of staging bytes that the regions read
+			void submit_texture(const CopyCMD& cmd, VkImage dst, uint64_t size, VkImageLayout oldLayout, const VkImageSubresourceRange& range, const VkBufferImageCopy* regions, uint32_t region_count);
 			uint64_t flush();
+
+		private:
+			void submit_batch(); // locker must be held
+			void submitted(const CopyCMD& cmd); // locker must be held
 		};
 		mutable CopyAllocator copyAllocator;
 
@@ -217,7 +277,43 @@ namespace wi::graphics
 
 		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 		wi::unordered_map<size_t, VkPipeline> pipelines_global;
-		wi::vector<std::pair<size_t, VkPipeline>> pipelines_worker[COMMANDLIST_COUNT];
+		wi::unordered_map<size_t, VkPipeline> pipelines_worker[COMMANDLIST_COUNT];
+
+		// Pipeline pre-warming:
+		//	Pipelines that are compiled at draw time are saved to a manifest next to the pipeline cache
+		//	In the next run, when a PipelineState is created, its pipelines from the manifest are compiled by a low priority background job
+		struct PipelineAttachmentLayout
+		{
+			RenderPassAttachment::Type type = RenderPassAttachment::Type::RENDERTARGET;
+			Format format = Format::UNKNOWN;
+			uint32_t sample_count = 1;
+		};
+		struct PipelinePrewarmEntry
+		{
+			size_t pso_key = 0; // content hash of the PipelineState, which is the same between runs
+			size_t renderpass_hash = 0;
+			size_t vb_hash = 0;
+			uint32_t attachment_count = 0;
+			PipelineAttachmentLayout attachments[18];
+			uint32_t vb_strides[8] = {};
+		};
+		struct PipelinePrewarmJob
+		{
+			PipelineState pso;
+			PipelinePrewarmEntry entry;
+		};
+		mutable std::mutex prewarm_mutex;
+		mutable wi::unordered_map<size_t, wi::vector<PipelinePrewarmEntry>> prewarm_manifest; // pso_key -> entries
+		mutable wi::unordered_set<size_t> prewarm_used_keys; // only the entries of PipelineStates that were created in this run will be saved
+		mutable wi::vector<PipelinePrewarmJob> prewarm_queue;
+		mutable wi::vector<std::pair<size_t, VkPipeline>> prewarm_results;
+		mutable bool prewarm_running = false;
+		mutable wi::jobsystem::context prewarm_ctx;
+		std::atomic_bool prewarm_cancel{ false };
+		void prewarm_schedule(const PipelineState* pso) const;
+		void prewarm_record(const PipelineState* pso, const RenderPass* renderpass, const uint32_t* strides, size_t vb_hash);
+		VkPipeline create_pipeline(const PipelineState* pso, VkRenderPass renderpass, const PipelineAttachmentLayout* attachments, uint32_t attachment_count, const uint32_t* strides) const;
+
 		size_t prev_pipeline_hash[COMMANDLIST_COUNT] = {};
 		const PipelineState* active_pso[COMMANDLIST_COUNT] = {};
 		const Shader* active_cs[COMMANDLIST_COUNT] = {};
@@ -258,6 +354,7 @@ namespace wi::graphics
 		
 		int CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount) const override;
 		int CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size = ~0) const override;
+		void DeleteSubresource(GPUBuffer* buffer, SubresourceType type, int subresource) const override;
 
 		int GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource = -1) const override;
 		int GetDescriptorIndex(const Sampler* sampler) const override;
@@ -275,6 +372,8 @@ namespace wi::graphics
 		void ClearPipelineStateCache() override;
 		size_t GetActivePipelineCount() const override { return pipelines_global.size(); }
 
+		GPUMemoryUsage GetMemoryUsage() const override;
+
 		ShaderFormat GetShaderFormat() const override { return ShaderFormat::SPIRV; }
 
 		Texture GetBackBuffer(const SwapChain* swapchain) const override;
@@ -340,7 +439,7 @@ namespace wi::graphics
 			VkDevice device = VK_NULL_HANDLE;
 			VkInstance instance;
 			uint64_t framecount = 0;
-			std::mutex destroylocker;
+			GPUMemoryTracker memorytracker;
 
 			struct BindlessDescriptorHeap
 			{
@@ -442,6 +541,14 @@ namespace wi::graphics
 					freelist.push_back(index);
 					locker.unlock();
 				}
+				void free(const wi::vector<int>& indices)
+				{
+					if (indices.empty())
+						return;
+					locker.lock();
+					freelist.insert(freelist.end(), indices.begin(), indices.end());
+					locker.unlock();
+				}
 			};
 			BindlessDescriptorHeap bindlessSampledImages;
 			BindlessDescriptorHeap bindlessUniformTexelBuffers;
@@ -451,31 +558,92 @@ namespace wi::graphics
 			BindlessDescriptorHeap bindlessSamplers;
 			BindlessDescriptorHeap bindlessAccelerationStructures;
 
-			std::deque<std::pair<std::pair<VkImage, VmaAllocation>, uint64_t>> destroyer_images;
-			std::deque<std::pair<VkImageView, uint64_t>> destroyer_imageviews;
-			std::deque<std::pair<std::pair<VkBuffer, VmaAllocation>, uint64_t>> destroyer_buffers;
-			std::deque<std::pair<VkBufferView, uint64_t>> destroyer_bufferviews;
-			std::deque<std::pair<VkAccelerationStructureKHR, uint64_t>> destroyer_bvhs;
-			std::deque<std::pair<VkSampler, uint64_t>> destroyer_samplers;
-			std::deque<std::pair<VkDescriptorPool, uint64_t>> destroyer_descriptorPools;
-			std::deque<std::pair<VkDescriptorSetLayout, uint64_t>> destroyer_descriptorSetLayouts;
-			std::deque<std::pair<VkDescriptorUpdateTemplate, uint64_t>> destroyer_descriptorUpdateTemplates;
-			std::deque<std::pair<VkShaderModule, uint64_t>> destroyer_shadermodules;
-			std::deque<std::pair<VkPipelineLayout, uint64_t>> destroyer_pipelineLayouts;
-			std::deque<std::pair<VkPipeline, uint64_t>> destroyer_pipelines;
-			std::deque<std::pair<VkRenderPass, uint64_t>> destroyer_renderpasses;
-			std::deque<std::pair<VkFramebuffer, uint64_t>> destroyer_framebuffers;
-			std::deque<std::pair<VkQueryPool, uint64_t>> destroyer_querypools;
-			std::deque<std::pair<VkSwapchainKHR, uint64_t>> destroyer_swapchains;
-			std::deque<std::pair<VkSurfaceKHR, uint64_t>> destroyer_surfaces;
-			std::deque<std::pair<VkSemaphore, uint64_t>> destroyer_semaphores;
-			std::deque<std::pair<int, uint64_t>> destroyer_bindlessSampledImages;
-			std::deque<std::pair<int, uint64_t>> destroyer_bindlessUniformTexelBuffers;
-			std::deque<std::pair<int, uint64_t>> destroyer_bindlessStorageBuffers;
-			std::deque<std::pair<int, uint64_t>> destroyer_bindlessStorageImages;
-			std::deque<std::pair<int, uint64_t>> destroyer_bindlessStorageTexelBuffers;
-			std::deque<std::pair<int, uint64_t>> destroyer_bindlessSamplers;
-			std::deque<std::pair<int, uint64_t>> destroyer_bindlessAccelerationStructures;
+			// Objects that are released within one frame, they will be destroyed when the GPU is finished with that frame:
+			struct DestroyBatch
+			{
+				uint64_t framecount = 0;
+				wi::vector<std::pair<VkImage, VmaAllocation>> images;
+				wi::vector<VkImageView> imageviews;
+				wi::vector<std::pair<VkBuffer, VmaAllocation>> buffers;
+				wi::vector<VkBufferView> bufferviews;
+				wi::vector<VkAccelerationStructureKHR> bvhs;
+				wi::vector<VkSampler> samplers;
+				wi::vector<VkDescriptorPool> descriptorPools;
+				wi::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+				wi::vector<VkDescriptorUpdateTemplate> descriptorUpdateTemplates;
+				wi::vector<VkShaderModule> shadermodules;
+				wi::vector<VkPipelineLayout> pipelineLayouts;
+				wi::vector<VkPipeline> pipelines;
+				wi::vector<VkRenderPass> renderpasses;
+				wi::vector<VkFramebuffer> framebuffers;
+				wi::vector<VkQueryPool> querypools;
+				wi::vector<VkSwapchainKHR> swapchains;
+				wi::vector<VkSurfaceKHR> surfaces;
+				wi::vector<VkSemaphore> semaphores;
+				wi::vector<int> bindlessSampledImages;
+				wi::vector<int> bindlessUniformTexelBuffers;
+				wi::vector<int> bindlessStorageBuffers;
+				wi::vector<int> bindlessStorageImages;
+				wi::vector<int> bindlessStorageTexelBuffers;
+				wi::vector<int> bindlessSamplers;
+				wi::vector<int> bindlessAccelerationStructures;
+
+				// Moves all objects from other batch to this, returns true if anything was moved
+				bool merge(DestroyBatch& other)
+				{
+					bool moved = false;
+					auto move = [&](auto& dst, auto& src) {
+						moved |= !src.empty();
+						dst.insert(dst.end(), src.begin(), src.end());
+						src.clear();
+					};
+					move(images, other.images);
+					move(imageviews, other.imageviews);
+					move(buffers, other.buffers);
+					move(bufferviews, other.bufferviews);
+					move(bvhs, other.bvhs);
+					move(samplers, other.samplers);
+					move(descriptorPools, other.descriptorPools);
+					move(descriptorSetLayouts, other.descriptorSetLayouts);
+					move(descriptorUpdateTemplates, other.descriptorUpdateTemplates);
+					move(shadermodules, other.shadermodules);
+					move(pipelineLayouts, other.pipelineLayouts);
+					move(pipelines, other.pipelines);
+					move(renderpasses, other.renderpasses);
+					move(framebuffers, other.framebuffers);
+					move(querypools, other.querypools);
+					move(swapchains, other.swapchains);
+					move(surfaces, other.surfaces);
+					move(semaphores, other.semaphores);
+					move(bindlessSampledImages, other.bindlessSampledImages);
+					move(bindlessUniformTexelBuffers, other.bindlessUniformTexelBuffers);
+					move(bindlessStorageBuffers, other.bindlessStorageBuffers);
+					move(bindlessStorageImages, other.bindlessStorageImages);
+					move(bindlessStorageTexelBuffers, other.bindlessStorageTexelBuffers);
+					move(bindlessSamplers, other.bindlessSamplers);
+					move(bindlessAccelerationStructures, other.bindlessAccelerationStructures);
+					return moved;
+				}
+			};
+
+			// Releases are recorded into one of multiple batches, each thread uses its own, so the threads don't contend on a single lock
+			//	The batches are merged into the destroy queue in Update()
+			static constexpr uint32_t DESTROY_SHARD_COUNT = 16;
+			struct DestroyShard
+			{
+				wi::SpinLock locker;
+				DestroyBatch batch;
+			};
+			DestroyShard destroy_shards[DESTROY_SHARD_COUNT];
+			std::deque<DestroyBatch> destroy_queue;
+			double destroy_budget_milliseconds = 2.0; // 0 means there is no limit
+
+			DestroyShard& GetDestroyShard()
+			{
+				static std::atomic<uint32_t> next_shard{ 0 };
+				thread_local const uint32_t shard = next_shard.fetch_add(1) % DESTROY_SHARD_COUNT;
+				return destroy_shards[shard];
+			}
 
 			~AllocationHandler()
 			{
@@ -486,6 +654,7 @@ namespace wi::graphics
 				bindlessStorageTexelBuffers.destroy(device);
 				bindlessSamplers.destroy(device);
 				bindlessAccelerationStructures.destroy(device);
+				destroy_budget_milliseconds = 0;
 				Update(~0, 0); // destroy all remaining
 				vmaDestroyAllocator(allocator);
 				vkDestroyDevice(device, nullptr);
@@ -493,336 +662,84 @@ namespace wi::graphics
 			}
 
 			// Deferred destroy of resources that the GPU is already finished with:
+			//	The destruction is spread over multiple frames if it doesn't fit into destroy_budget_milliseconds
 			void Update(uint64_t FRAMECOUNT, uint32_t BUFFERCOUNT)
 			{
-				destroylocker.lock();
-				framecount = FRAMECOUNT;
-				while (!destroyer_images.empty())
-				{
-					if (destroyer_images.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_images.front();
-						destroyer_images.pop_front();
-						vmaDestroyImage(allocator, item.first.first, item.first.second);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_imageviews.empty())
-				{
-					if (destroyer_imageviews.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_imageviews.front();
-						destroyer_imageviews.pop_front();
-						vkDestroyImageView(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_buffers.empty())
-				{
-					if (destroyer_buffers.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_buffers.front();
-						destroyer_buffers.pop_front();
-						vmaDestroyBuffer(allocator, item.first.first, item.first.second);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bufferviews.empty())
-				{
-					if (destroyer_bufferviews.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_bufferviews.front();
-						destroyer_bufferviews.pop_front();
-						vkDestroyBufferView(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bvhs.empty())
-				{
-					if (destroyer_bvhs.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_bvhs.front();
-						destroyer_bvhs.pop_front();
-						vkDestroyAccelerationStructureKHR(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_samplers.empty())
-				{
-					if (destroyer_samplers.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_samplers.front();
-						destroyer_samplers.pop_front();
-						vkDestroySampler(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_descriptorPools.empty())
-				{
-					if (destroyer_descriptorPools.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_descriptorPools.front();
-						destroyer_descriptorPools.pop_front();
-						vkDestroyDescriptorPool(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_descriptorSetLayouts.empty())
-				{
-					if (destroyer_descriptorSetLayouts.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_descriptorSetLayouts.front();
-						destroyer_descriptorSetLayouts.pop_front();
-						vkDestroyDescriptorSetLayout(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_descriptorUpdateTemplates.empty())
-				{
-					if (destroyer_descriptorUpdateTemplates.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_descriptorUpdateTemplates.front();
-						destroyer_descriptorUpdateTemplates.pop_front();
-						vkDestroyDescriptorUpdateTemplate(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_shadermodules.empty())
+				DestroyBatch& merged = destroy_queue.emplace_back();
+				merged.framecount = framecount;
+				bool any = false;
+				for (auto& shard : destroy_shards)
 				{
-					if (destroyer_shadermodules.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_shadermodules.front();
-						destroyer_shadermodules.pop_front();
-						vkDestroyShaderModule(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_pipelineLayouts.empty())
-				{
-					if (destroyer_pipelineLayouts.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_pipelineLayouts.front();
-						destroyer_pipelineLayouts.pop_front();
-						vkDestroyPipelineLayout(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_pipelines.empty())
-				{
-					if (destroyer_pipelines.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_pipelines.front();
-						destroyer_pipelines.pop_front();
-						vkDestroyPipeline(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_renderpasses.empty())
-				{
-					if (destroyer_renderpasses.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_renderpasses.front();
-						destroyer_renderpasses.pop_front();
-						vkDestroyRenderPass(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_framebuffers.empty())
-				{
-					if (destroyer_framebuffers.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_framebuffers.front();
-						destroyer_framebuffers.pop_front();
-						vkDestroyFramebuffer(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
+					shard.locker.lock();
+					any |= merged.merge(shard.batch);
+					shard.locker.unlock();
 				}
-				while (!destroyer_querypools.empty())
+				if (!any)
 				{
-					if (destroyer_querypools.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_querypools.front();
-						destroyer_querypools.pop_front();
-						vkDestroyQueryPool(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
+					destroy_queue.pop_back();
 				}
-				while (!destroyer_swapchains.empty())
-				{
-					if (destroyer_swapchains.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_swapchains.front();
-						destroyer_swapchains.pop_front();
-						vkDestroySwapchainKHR(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_surfaces.empty())
-				{
-					if (destroyer_surfaces.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_surfaces.front();
-						destroyer_surfaces.pop_front();
-						vkDestroySurfaceKHR(instance, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_semaphores.empty())
-				{
-					if (destroyer_semaphores.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						auto item = destroyer_semaphores.front();
-						destroyer_semaphores.pop_front();
-						vkDestroySemaphore(device, item.first, nullptr);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bindlessSampledImages.empty())
-				{
-					if (destroyer_bindlessSampledImages.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						int index = destroyer_bindlessSampledImages.front().first;
-						destroyer_bindlessSampledImages.pop_front();
-						bindlessSampledImages.free(index);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bindlessUniformTexelBuffers.empty())
-				{
-					if (destroyer_bindlessUniformTexelBuffers.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						int index = destroyer_bindlessUniformTexelBuffers.front().first;
-						destroyer_bindlessUniformTexelBuffers.pop_front();
-						bindlessUniformTexelBuffers.free(index);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bindlessStorageBuffers.empty())
-				{
-					if (destroyer_bindlessStorageBuffers.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						int index = destroyer_bindlessStorageBuffers.front().first;
-						destroyer_bindlessStorageBuffers.pop_front();
-						bindlessStorageBuffers.free(index);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bindlessStorageImages.empty())
-				{
-					if (destroyer_bindlessStorageImages.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						int index = destroyer_bindlessStorageImages.front().first;
-						destroyer_bindlessStorageImages.pop_front();
-						bindlessStorageImages.free(index);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bindlessStorageTexelBuffers.empty())
-				{
-					if (destroyer_bindlessStorageTexelBuffers.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						int index = destroyer_bindlessStorageTexelBuffers.front().first;
-						destroyer_bindlessStorageTexelBuffers.pop_front();
-						bindlessStorageTexelBuffers.free(index);
-					}
-					else
-					{
-						break;
-					}
-				}
-				while (!destroyer_bindlessSamplers.empty())
-				{
-					if (destroyer_bindlessSamplers.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						int index = destroyer_bindlessSamplers.front().first;
-						destroyer_bindlessSamplers.pop_front();
-						bindlessSamplers.free(index);
-					}
-					else
+				framecount = FRAMECOUNT;
+
+				wi::Timer timer;
+				uint32_t counter = 0;
+				auto out_of_time = [&]() {
+					return destroy_budget_milliseconds > 0 && (++counter % 32) == 0 && timer.elapsed_milliseconds() > destroy_budget_milliseconds;
+				};
+				auto drain = [&](auto& list, auto&& destroy) {
+					while (!list.empty())
 					{
-						break;
+						if (out_of_time())
+							return false;
+						destroy(list.back());
+						list.pop_back();
 					}
-				}
-				while (!destroyer_bindlessAccelerationStructures.empty())
+					return true;
+				};
+
+				while (!destroy_queue.empty() && destroy_queue.front().framecount + BUFFERCOUNT < FRAMECOUNT)
 				{
-					if (destroyer_bindlessAccelerationStructures.front().second + BUFFERCOUNT < FRAMECOUNT)
-					{
-						int index = destroyer_bindlessAccelerationStructures.front().first;
-						destroyer_bindlessAccelerationStructures.pop_front();
-						bindlessAccelerationStructures.free(index);
-					}
-					else
-					{
-						break;
-					}
+					DestroyBatch& batch = destroy_queue.front();
+
+					// Freeing descriptor indices is cheap, it is not limited by the budget:
+					bindlessSampledImages.free(batch.bindlessSampledImages);
+					bindlessUniformTexelBuffers.free(batch.bindlessUniformTexelBuffers);
+					bindlessStorageBuffers.free(batch.bindlessStorageBuffers);
+					bindlessStorageImages.free(batch.bindlessStorageImages);
+					bindlessStorageTexelBuffers.free(batch.bindlessStorageTexelBuffers);
+					bindlessSamplers.free(batch.bindlessSamplers);
+					bindlessAccelerationStructures.free(batch.bindlessAccelerationStructures);
+					batch.bindlessSampledImages.clear();
+					batch.bindlessUniformTexelBuffers.clear();
+					batch.bindlessStorageBuffers.clear();
+					batch.bindlessStorageImages.clear();
+					batch.bindlessStorageTexelBuffers.clear();
+					batch.bindlessSamplers.clear();
+					batch.bindlessAccelerationStructures.clear();
+
+					const bool finished =
+						drain(batch.framebuffers, [&](VkFramebuffer x) { vkDestroyFramebuffer(device, x, nullptr); }) &&
+						drain(batch.imageviews, [&](VkImageView x) { vkDestroyImageView(device, x, nullptr); }) &&
+						drain(batch.bufferviews, [&](VkBufferView x) { vkDestroyBufferView(device, x, nullptr); }) &&
+						drain(batch.bvhs, [&](VkAccelerationStructureKHR x) { vkDestroyAccelerationStructureKHR(device, x, nullptr); }) &&
+						drain(batch.images, [&](const std::pair<VkImage, VmaAllocation>& x) { vmaDestroyImage(allocator, x.first, x.second); }) &&
+						drain(batch.buffers, [&](const std::pair<VkBuffer, VmaAllocation>& x) { vmaDestroyBuffer(allocator, x.first, x.second); }) &&
+						drain(batch.samplers, [&](VkSampler x) { vkDestroySampler(device, x, nullptr); }) &&
+						drain(batch.descriptorPools, [&](VkDescriptorPool x) { vkDestroyDescriptorPool(device, x, nullptr); }) &&
+						drain(batch.descriptorSetLayouts, [&](VkDescriptorSetLayout x) { vkDestroyDescriptorSetLayout(device, x, nullptr); }) &&
+						drain(batch.descriptorUpdateTemplates, [&](VkDescriptorUpdateTemplate x) { vkDestroyDescriptorUpdateTemplate(device, x, nullptr); }) &&
+						drain(batch.shadermodules, [&](VkShaderModule x) { vkDestroyShaderModule(device, x, nullptr); }) &&
+						drain(batch.pipelineLayouts, [&](VkPipelineLayout x) { vkDestroyPipelineLayout(device, x, nullptr); }) &&
+						drain(batch.pipelines, [&](VkPipeline x) { vkDestroyPipeline(device, x, nullptr); }) &&
+						drain(batch.renderpasses, [&](VkRenderPass x) { vkDestroyRenderPass(device, x, nullptr); }) &&
+						drain(batch.querypools, [&](VkQueryPool x) { vkDestroyQueryPool(device, x, nullptr); }) &&
+						drain(batch.swapchains, [&](VkSwapchainKHR x) { vkDestroySwapchainKHR(device, x, nullptr); }) &&
+						drain(batch.surfaces, [&](VkSurfaceKHR x) { vkDestroySurfaceKHR(instance, x, nullptr); }) &&
+						drain(batch.semaphores, [&](VkSemaphore x) { vkDestroySemaphore(device, x, nullptr); });
+
+					if (!finished)
+						break; // continue next frame
+					destroy_queue.pop_front();
 				}
-				destroylocker.unlock();
 			}
 		};
 		std::shared_ptr<AllocationHandler> allocationhandler;
@@ -229,7 +229,7 @@ namespace wi
 	}
 	void HairParticleSystem::UpdateGPU(uint32_t instanceIndex, uint32_t materialIndex, const MeshComponent& mesh, const MaterialComponent& material, CommandList cmd) const
 	{
-		if (strandCount == 0 || !simulationBuffer.IsValid())
+		if (strandCount == 0 || !simulationBuffer.IsValid() || !mesh.IsGeometryReady())
 		{
 			return;
 		}
@@ -294,12 +294,24 @@ namespace wi
 			};
 			device->BindUAVs(uavs, 0, arraysize(uavs), cmd);
 
-			const GPUResource* res[] = {
-				indexBuffer.IsValid() ? &indexBuffer : &mesh.indexBuffer,
-				mesh.streamoutBuffer_POS.IsValid() ? &mesh.streamoutBuffer_POS : &mesh.vertexBuffer_POS,
-				&vertexBuffer_length
-			};
-			device->BindResources(res, 0, arraysize(res), cmd);
+			// The mesh geometry is a range of the geometry arena buffers, so it's bound with its views:
+			if (indexBuffer.IsValid())
+			{
+				device->BindResource(&indexBuffer, 0, cmd);
+			}
+			else
+			{
+				device->BindResource(mesh.GetIndexBuffer(), 0, cmd, mesh.GetIndexView().subresource);
+			}
+			if (mesh.streamoutBuffer_POS.IsValid())
+			{
+				device->BindResource(&mesh.streamoutBuffer_POS, 1, cmd);
+			}
+			else
+			{
+				device->BindResource(mesh.GetVertexBuffer(), 1, cmd, mesh.GetVertexView(MeshComponent::VERTEX_STREAM_POS).subresource);
+			}
+			device->BindResource(&vertexBuffer_length, 2, cmd);
 
 			device->Dispatch(hcb.xHairNumDispatchGroups, 1, 1, cmd);
 
@@ -87,6 +87,7 @@ namespace wi::jobsystem
 		uint32_t numThreads = 0;
 		std::shared_ptr<WorkerState> worker_state = std::make_shared<WorkerState>(); // kept alive by both threads and internal_state
 		ThreadSafeRingBuffer<Job, 256> jobQueue;
+		ThreadSafeRingBuffer<Job, 256> lowPriorityJobQueue;
 		~InternalState()
 		{
 			worker_state->alive.store(false);
@@ -95,10 +96,11 @@ namespace wi::jobsystem
 	} static internal_state;
 
 	// This function executes the next item from the job queue. Returns true if successful, false if there was no job available
-	inline bool work()
+	//	allow_low_priority : if there are no high priority jobs, a low priority job can be executed
+	inline bool work(bool allow_low_priority)
 	{
 		Job job;
-		if (internal_state.jobQueue.pop_front(job))
+		if (internal_state.jobQueue.pop_front(job) || (allow_low_priority && internal_state.lowPriorityJobQueue.pop_front(job)))
 		{
 			JobArgs args;
 			args.groupID = job.groupID;
@@ -147,7 +149,7 @@ namespace wi::jobsystem
 				std::shared_ptr<WorkerState> worker_state = internal_state.worker_state; // this is a copy of shared_ptr<WorkerState>, so it will remain alive for the thread's lifetime
 				while (worker_state->alive.load())
 				{
-					if (!work())
+					if (!work(true))
 					{
 						// no job, put thread to sleep
 						std::unique_lock<std::mutex> lock(worker_state->wakeMutex);
@@ -221,7 +223,9 @@ namespace wi::jobsystem
 		job.sharedmemory_size = 0;
 
 		// Try to push a new job until it is pushed successfully:
-		while (!internal_state.jobQueue.push_back(job)) { internal_state.worker_state->wakeCondition.notify_all(); work(); }
+		const bool low_priority = ctx.priority == Priority::Low;
+		auto& queue = low_priority ? internal_state.lowPriorityJobQueue : internal_state.jobQueue;
+		while (!queue.push_back(job)) { internal_state.worker_state->wakeCondition.notify_all(); work(low_priority); }
 
 		// Wake any one thread that might be sleeping:
 		internal_state.worker_state->wakeCondition.notify_one();
@@ -244,6 +248,9 @@ namespace wi::jobsystem
 		job.task = task;
 		job.sharedmemory_size = (uint32_t)sharedmemory_size;
 
+		const bool low_priority = ctx.priority == Priority::Low;
+		auto& queue = low_priority ? internal_state.lowPriorityJobQueue : internal_state.jobQueue;
+
 		for (uint32_t groupID = 0; groupID < groupCount; ++groupID)
 		{
 			// For each group, generate one real job:
@@ -252,7 +259,7 @@ namespace wi::jobsystem
 			job.groupJobEnd = std::min(job.groupJobOffset + groupSize, jobCount);
 
 			// Try to push a new job until it is pushed successfully:
-			while (!internal_state.jobQueue.push_back(job)) { internal_state.worker_state->wakeCondition.notify_all(); work(); }
+			while (!queue.push_back(job)) { internal_state.worker_state->wakeCondition.notify_all(); work(low_priority); }
 		}
 
 		// Wake any threads that might be sleeping:
@@ -277,6 +284,8 @@ namespace wi::jobsystem
 		internal_state.worker_state->wakeCondition.notify_all();
 
 		// Waiting will also put the current thread to good use by working on an other job if it can:
-		while (IsBusy(ctx)) { work(); }
+		//	Low priority jobs are only picked up when waiting for a low priority context, to not stall high priority work
+		const bool low_priority = ctx.priority == Priority::Low;
+		while (IsBusy(ctx)) { work(low_priority); }
 	}
 }
@@ -19,10 +19,17 @@ namespace wi::jobsystem
 
 	uint32_t GetThreadCount();
 
+	enum class Priority
+	{
+		High,	// Default, for jobs that are waited on within the frame
+		Low,	// For background work, it is only picked up when there are no high priority jobs, and never by waiting on a high priority context
+	};
+
 	// Defines a state of execution, can be waited on
 	struct context
 	{
 		std::atomic<uint32_t> counter{ 0 };
+		Priority priority = Priority::High;
 	};
 
 	// Add a task to execute asynchronously. Any idle thread will execute this.
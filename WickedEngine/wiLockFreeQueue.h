@@ -0,0 +1,163 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+namespace wi
+{
+	// Fixed size queue for exactly one producer thread and one consumer thread, without locks
+	//	The capacity is rounded up to a power of two
+	template<typename T>
+	class SPSCQueue
+	{
+	public:
+		void init(size_t capacity)
+		{
+			size_t size = 1;
+			while (size < capacity)
+			{
+				size <<= 1;
+			}
+			data.reset(new T[size]);
+			mask = size - 1;
+			head.store(0, std::memory_order_relaxed);
+			tail.store(0, std::memory_order_relaxed);
+			tail_cache = 0;
+			head_cache = 0;
+		}
+
+		// Called only by the producer thread, returns false if the queue is full
+		bool push(const T& item)
+		{
+			const size_t pos = head.load(std::memory_order_relaxed);
+			if (pos - tail_cache > mask)
+			{
+				tail_cache = tail.load(std::memory_order_acquire);
+				if (pos - tail_cache > mask)
+					return false;
+			}
+			data[pos & mask] = item;
+			head.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Called only by the consumer thread, returns false if the queue is empty
+		bool pop(T& item)
+		{
+			const size_t pos = tail.load(std::memory_order_relaxed);
+			if (pos == head_cache)
+			{
+				head_cache = head.load(std::memory_order_acquire);
+				if (pos == head_cache)
+					return false;
+			}
+			item = data[pos & mask];
+			tail.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		std::unique_ptr<T[]> data;
+		size_t mask = 0;
+		// The producer and consumer positions are on separate cache lines, with a cached copy of the other side's position:
+		alignas(64) std::atomic<size_t> head{ 0 };
+		size_t tail_cache = 0;
+		alignas(64) std::atomic<size_t> tail{ 0 };
+		size_t head_cache = 0;
+	};
+
+	// Fixed size queue for any number of producer and consumer threads, without locks
+	//	Every cell has a sequence number that tells whether it is ready to be written or read in the current round
+	//	The capacity is rounded up to a power of two
+	template<typename T>
+	class MPMCQueue
+	{
+	public:
+		void init(size_t capacity)
+		{
+			size_t size = 1;
+			while (size < capacity)
+			{
+				size <<= 1;
+			}
+			cells.reset(new Cell[size]);
+			for (size_t i = 0; i < size; ++i)
+			{
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			mask = size - 1;
+			enqueue_pos.store(0, std::memory_order_relaxed);
+			dequeue_pos.store(0, std::memory_order_relaxed);
+		}
+
+		// Returns false if the queue is full
+		bool push(const T& item)
+		{
+			Cell* cell;
+			size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				cell = &cells[pos & mask];
+				const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				const intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+				if (diff == 0)
+				{
+					if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = enqueue_pos.load(std::memory_order_relaxed);
+				}
+			}
+			cell->data = item;
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Returns false if the queue is empty
+		bool pop(T& item)
+		{
+			Cell* cell;
+			size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				cell = &cells[pos & mask];
+				const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				const intptr_t diff = (intptr_t)sequence - (intptr_t)(pos + 1);
+				if (diff == 0)
+				{
+					if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+						break;
+				}
+				else if (diff < 0)
+				{
+					return false;
+				}
+				else
+				{
+					pos = dequeue_pos.load(std::memory_order_relaxed);
+				}
+			}
+			item = cell->data;
+			cell->sequence.store(pos + mask + 1, std::memory_order_release);
+			return true;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			T data;
+		};
+		std::unique_ptr<Cell[]> cells;
+		size_t mask = 0;
+		alignas(64) std::atomic<size_t> enqueue_pos{ 0 };
+		alignas(64) std::atomic<size_t> dequeue_pos{ 0 };
+	};
+}
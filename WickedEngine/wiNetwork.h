@@ -19,6 +19,23 @@ namespace wi::network
 		uint16_t port = DEFAULT_PORT;
 	};
 
+	// Describes one packet of SendBatch() or ReceiveBatch(), the data buffer is owned by the caller
+	struct Packet
+	{
+		Connection connection;	// receiver when sending, sender when receiving
+		void* data = nullptr;	// packet data
+		size_t capacity = 0;	// size of the data buffer in bytes, used when receiving
+		size_t size = 0;		// size of the packet in bytes: it is provided when sending, and filled out when receiving
+	};
+
+	// Counters of a SendBatch() or ReceiveBatch() call
+	struct BatchStats
+	{
+		size_t packets = 0;		// number of packets that were sent or received
+		size_t bytes = 0;		// number of bytes that were sent or received
+		size_t syscalls = 0;	// number of system calls made
+	};
+
 	// Creates a socket that can be used to send or receive data
 	bool CreateSocket(Socket* sock);
 
@@ -46,4 +63,73 @@ namespace wi::network
 	//	data		:	buffer to hold received data, must be already allocated to a sufficient size
 	//	dataSize	:	expected data size in bytes
 	bool Receive(const Socket* sock, Connection* connection, void* data, size_t dataSize);
+
+	// Sends multiple packets, on Linux with a single system call for up to 64 packets
+	//	sock		:	socket that sends the packets
+	//	packets		:	array of packets to send, the data and size of each must be filled out
+	//	count		:	number of packets in the array
+	//	stats		:	optional, counters of the call will be written to it
+	//	returns the number of packets sent, sending stops at the first error
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count, BatchStats* stats = nullptr);
+
+	// Receives the packets that are queued on the socket, it never blocks
+	//	sock		:	socket that receives packets
+	//	packets		:	array of packets to receive into, the data and capacity of each must be filled out. Packets larger than the capacity are truncated
+	//	count		:	number of packets in the array, at most this many packets are received
+	//	stats		:	optional, counters of the call will be written to it
+	//	returns the number of packets received, 0 if there were no packets queued
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count, BatchStats* stats = nullptr);
+
+	// Network I/O service that sends and receives packets of a set of sockets on a dedicated thread
+	//	Received packets are put into a queue per socket, which is drained by one consumer thread with ServiceReceive()
+	//	Packets can be sent from any thread with ServiceSend(), the I/O thread sends them in batches
+	//	Packet buffers come from a pool that is allocated when the service is created
+	//	It is implemented with epoll on Linux, CreateService() fails on other platforms
+	struct Service
+	{
+		std::shared_ptr<void> internal_state;
+		inline bool IsValid() const { return internal_state.get() != nullptr; }
+	};
+	struct ServiceDesc
+	{
+		uint32_t packet_count = 4096;			// number of packet buffers in the pool
+		uint32_t packet_size = 1500;			// capacity of a packet buffer in bytes, larger received packets are truncated
+		uint32_t receive_queue_size = 1024;		// number of received packets that can wait in the queue of a socket, more are dropped
+		uint32_t send_queue_size = 1024;		// number of packets that can wait to be sent
+	};
+	struct ServiceStats
+	{
+		uint64_t received_packets = 0;
+		uint64_t received_bytes = 0;
+		uint64_t sent_packets = 0;
+		uint64_t sent_bytes = 0;
+		uint64_t dropped_packets = 0;			// received packets that didn't fit into the pool or the receive queue
+		uint64_t syscalls = 0;					// system calls made by the I/O thread
+	};
+
+	// Creates the service and starts its I/O thread
+	//	service		:	service to create
+	//	sockets		:	the sockets that the service will own, they are referred by their index in this array later
+	//	socket_count:	number of sockets
+	//	desc		:	pool and queue sizes
+	bool CreateService(Service* service, const Socket* sockets, uint32_t socket_count, const ServiceDesc& desc = {});
+
+	// Takes a packet buffer from the pool to be filled out and sent with ServiceSend(), returns nullptr if the pool is empty
+	//	The packet's data and capacity are set up, the caller must fill out the connection, the data and its size
+	Packet* ServiceAllocatePacket(const Service* service);
+
+	// Puts a packet to the send queue of the service, the packet is returned to the pool after it was sent
+	//	Returns false if the queue is full, in that case the caller still owns the packet
+	bool ServiceSend(const Service* service, uint32_t socket_index, Packet* packet);
+
+	// Returns the next received packet of a socket or nullptr if there are none
+	//	It must be called by only one thread for a socket at the same time
+	//	The packet must be returned to the pool with ServiceFreePacket()
+	Packet* ServiceReceive(const Service* service, uint32_t socket_index);
+
+	// Returns a packet to the pool
+	void ServiceFreePacket(const Service* service, Packet* packet);
+
+	// Returns the counters of the I/O thread since the service was created
+	ServiceStats GetServiceStats(const Service* service);
 }
@@ -0,0 +1,753 @@
+#include "wiNetworkHost.h"
+#include "wiRandom.h"
+#include "wiBacklog.h"
+
+#include <algorithm>
+
+namespace wi::network
+{
+	// Datagram layout, all values are little endian:
+	//	header: protocol id (2), flags (1), sequence (2), ack (2), ack bits (4)
+	//	then any number of chunks: flags (1), message id (2), [fragment (2), fragment count (2)], data size (2), data
+	static constexpr uint16_t PROTOCOL_ID = 0x5749;
+	static constexpr size_t PACKET_HEADER_SIZE = 11;
+	static constexpr size_t CHUNK_HEADER_SIZE = 5;
+	static constexpr size_t FRAGMENT_HEADER_SIZE = 9;
+	static constexpr uint8_t PACKET_HAS_ACK = 1 << 0;
+	static constexpr uint8_t CHUNK_DELIVERY_MASK = 0x3;
+	static constexpr uint8_t CHUNK_FRAGMENTED = 1 << 2;
+
+	static constexpr size_t RECEIVE_BATCH_SIZE = 64;
+	static constexpr size_t MAX_QUEUED_MESSAGES = 16384;	// per reliable channel, this keeps the 16-bit message ids unambiguous
+	static constexpr double UNRELIABLE_TIMEOUT = 1;			// seconds that unreliable messages can wait to be sent or completed
+	static constexpr double KEEPALIVE_INTERVAL = 1;			// seconds without sending after which an empty datagram is sent
+	static constexpr double MIN_RESEND_TIMEOUT = 0.05;
+	static constexpr uint32_t PACING_BURST = 8;				// datagrams that can be sent at once after being idle
+
+	inline bool sequence_greater(uint16_t a, uint16_t b)
+	{
+		return int16_t(uint16_t(a - b)) > 0;
+	}
+	inline uint64_t connection_key(const Connection& connection)
+	{
+		uint64_t key = connection.port;
+		for (uint8_t x : connection.ipaddress)
+		{
+			key = (key << 8) | x;
+		}
+		return key;
+	}
+	inline void write_u16(wi::vector<uint8_t>& dst, uint16_t value)
+	{
+		dst.push_back(uint8_t(value));
+		dst.push_back(uint8_t(value >> 8));
+	}
+	inline void write_u32(wi::vector<uint8_t>& dst, uint32_t value)
+	{
+		write_u16(dst, uint16_t(value));
+		write_u16(dst, uint16_t(value >> 16));
+	}
+	inline uint16_t read_u16(const uint8_t* src)
+	{
+		return uint16_t(src[0] | (src[1] << 8));
+	}
+	inline uint32_t read_u32(const uint8_t* src)
+	{
+		return uint32_t(read_u16(src)) | (uint32_t(read_u16(src + 2)) << 16);
+	}
+	inline float random_float()
+	{
+		return float(wi::random::GetRandom(0u, 0xFFFFu)) / float(0x10000);
+	}
+
+	// Stores a received fragment, returns true when the message is complete
+	static bool add_fragment(wi::vector<wi::vector<uint8_t>>& fragments, uint32_t& received_count, uint16_t fragment, uint16_t fragment_count, const uint8_t* data, size_t size)
+	{
+		if (fragments.empty())
+		{
+			fragments.resize(fragment_count);
+		}
+		if (fragments.size() != fragment_count || !fragments[fragment].empty())
+			return false; // mismatching or duplicate fragment, the data of every fragment is non-empty
+		fragments[fragment].assign(data, data + size);
+		received_count++;
+		return received_count == fragment_count;
+	}
+	static void assemble(wi::vector<wi::vector<uint8_t>>& fragments, wi::vector<uint8_t>& data)
+	{
+		size_t size = 0;
+		for (auto& x : fragments)
+		{
+			size += x.size();
+		}
+		data.reserve(size);
+		for (auto& x : fragments)
+		{
+			data.insert(data.end(), x.begin(), x.end());
+		}
+	}
+
+	bool Host::Create(const Desc& desc)
+	{
+		if (desc.mtu < PACKET_HEADER_SIZE + FRAGMENT_HEADER_SIZE + 1 || desc.mtu > 65507)
+		{
+			wi::backlog::post("wi::network::Host::Create error: invalid mtu " + std::to_string(desc.mtu), wi::backlog::LogLevel::Error);
+			return false;
+		}
+		this->desc = desc;
+		const size_t fragment_capacity = desc.mtu - PACKET_HEADER_SIZE - FRAGMENT_HEADER_SIZE;
+		max_fragment_count = uint32_t(std::min(std::max(size_t(1), (size_t(desc.max_message_size) + fragment_capacity - 1) / fragment_capacity), size_t(0xFFFF)));
+		peers.clear();
+		messages.clear();
+		delayed.clear();
+		outgoing_count = 0;
+		packet_record = nullptr;
+
+		socket = {};
+		if (!CreateSocket(&socket))
+		{
+			socket = {};
+			return false;
+		}
+		if (desc.port != 0 && !ListenPort(&socket, desc.port))
+		{
+			socket = {};
+			return false;
+		}
+
+		// One more byte than the mtu, so that larger datagrams can be recognized after they were truncated:
+		receive_buffers.resize(RECEIVE_BATCH_SIZE);
+		receive_packets.resize(RECEIVE_BATCH_SIZE);
+		for (size_t i = 0; i < RECEIVE_BATCH_SIZE; ++i)
+		{
+			receive_buffers[i].resize(desc.mtu + 1);
+			receive_packets[i].data = receive_buffers[i].data();
+			receive_packets[i].capacity = receive_buffers[i].size();
+		}
+
+		timer.record();
+		return true;
+	}
+
+	bool Host::Send(const Connection& connection, Delivery delivery, const void* data, size_t size)
+	{
+		if (!socket.IsValid())
+			return false;
+
+		const size_t single_capacity = desc.mtu - PACKET_HEADER_SIZE - CHUNK_HEADER_SIZE;
+		const size_t fragment_capacity = desc.mtu - PACKET_HEADER_SIZE - FRAGMENT_HEADER_SIZE;
+		const size_t fragment_count = size <= single_capacity ? 1 : (size + fragment_capacity - 1) / fragment_capacity;
+		if (fragment_count > 1 && (size > desc.max_message_size || fragment_count > max_fragment_count))
+		{
+			wi::backlog::post("wi::network::Host::Send error: message of " + std::to_string(size) + " bytes is too large", wi::backlog::LogLevel::Error);
+			return false;
+		}
+
+		const double now = timer.elapsed_seconds();
+		Peer* found = get_peer(connection, now);
+		if (found == nullptr)
+			return false;
+		Peer& peer = *found;
+
+		OutgoingMessage* message = nullptr;
+		if (delivery == Delivery::UNRELIABLE)
+		{
+			message = &peer.unreliable.emplace_back();
+			message->id = peer.unreliable_id++;
+		}
+		else
+		{
+			SendChannel& channel = peer.send_channels[delivery == Delivery::RELIABLE_ORDERED ? CHANNEL_RELIABLE_ORDERED : CHANNEL_RELIABLE_UNORDERED];
+			if (channel.messages.size() >= MAX_QUEUED_MESSAGES)
+				return false;
+			message = &channel.messages.emplace_back();
+			message->id = channel.next_id++;
+			message->fragments.resize(fragment_count);
+		}
+		message->fragment_count = uint16_t(fragment_count);
+		message->time = now;
+		message->data.assign((const uint8_t*)data, (const uint8_t*)data + size);
+		return true;
+	}
+
+	void Host::Update()
+	{
+		if (!socket.IsValid())
+			return;
+		const double now = timer.elapsed_seconds();
+
+		receive(now);
+
+		for (auto it = peers.begin(); it != peers.end();)
+		{
+			Peer& peer = it->second;
+			if (now - peer.receive_time > desc.timeout)
+			{
+				it = peers.erase(it);
+				continue;
+			}
+			for (auto incomplete = peer.unreliable_incomplete.begin(); incomplete != peer.unreliable_incomplete.end();)
+			{
+				if (now - incomplete->second.time > UNRELIABLE_TIMEOUT)
+				{
+					peer.incomplete_count--;
+					peer.incomplete_size -= incomplete->second.size;
+					incomplete = peer.unreliable_incomplete.erase(incomplete);
+				}
+				else
+				{
+					++incomplete;
+				}
+			}
+			send(peer, now);
+			++it;
+		}
+
+		flush(now);
+	}
+
+	bool Host::Receive(Message& message)
+	{
+		if (messages.empty())
+			return false;
+		message = std::move(messages.front());
+		messages.pop_front();
+		return true;
+	}
+
+	void Host::Disconnect(const Connection& connection)
+	{
+		peers.erase(connection_key(connection));
+	}
+
+	bool Host::GetPeerStats(const Connection& connection, PeerStats& stats) const
+	{
+		auto it = peers.find(connection_key(connection));
+		if (it == peers.end())
+			return false;
+		const Peer& peer = it->second;
+		stats = peer.stats;
+		stats.rtt = float(peer.rtt * 1000);
+		stats.send_rate = float(peer.send_rate);
+		stats.pending_messages = 0;
+		for (auto& channel : peer.send_channels)
+		{
+			stats.pending_messages += uint32_t(channel.messages.size());
+		}
+		return true;
+	}
+
+	Host::Peer* Host::get_peer(const Connection& connection, double now)
+	{
+		const uint64_t key = connection_key(connection);
+		auto it = peers.find(key);
+		if (it != peers.end())
+			return &it->second;
+		if (peers.size() >= desc.max_peers)
+			return nullptr;
+
+		Peer& peer = peers[key];
+		peer.connection = connection;
+		peer.sent_packets.resize(WINDOW_SIZE);
+		peer.send_rate = desc.min_send_rate;
+		peer.tokens = double(desc.mtu) * PACING_BURST;
+		peer.rate_change_time = now;
+		peer.token_time = now;
+		peer.send_time = now;
+		peer.receive_time = now;
+		return &peer;
+	}
+
+	void Host::receive(double now)
+	{
+		size_t count = 0;
+		do {
+			count = ReceiveBatch(&socket, receive_packets.data(), receive_packets.size());
+			for (size_t i = 0; i < count; ++i)
+			{
+				const Packet& received = receive_packets[i];
+				const uint8_t* data = (const uint8_t*)received.data;
+				if (received.size < PACKET_HEADER_SIZE || received.size > desc.mtu || read_u16(data) != PROTOCOL_ID)
+					continue;
+				Peer* peer = get_peer(received.connection, now);
+				if (peer == nullptr)
+					continue;
+				receive_packet(*peer, data, received.size, now);
+			}
+		} while (count == receive_packets.size());
+	}
+
+	void Host::receive_packet(Peer& peer, const uint8_t* data, size_t size, double now)
+	{
+		const uint8_t flags = data[2];
+		const uint16_t sequence = read_u16(data + 3);
+		const uint16_t ack = read_u16(data + 5);
+		const uint32_t ack_bits = read_u32(data + 7);
+
+		peer.receive_time = now;
+		peer.stats.received_packets++;
+		peer.stats.received_bytes += size;
+
+		if (flags & PACKET_HAS_ACK)
+		{
+			acknowledge(peer, ack, now);
+			for (uint16_t i = 0; i < 32; ++i)
+			{
+				if (ack_bits & (1u << i))
+				{
+					acknowledge(peer, uint16_t(ack - 1 - i), now);
+				}
+			}
+		}
+
+		// Duplicated datagrams are dropped, because their unreliable messages would be delivered again:
+		if (peer.received_any)
+		{
+			if (sequence == peer.remote_sequence)
+				return;
+			const uint16_t distance = uint16_t(peer.remote_sequence - sequence);
+			if (distance <= 32 && (peer.ack_bits & (1u << (distance - 1))))
+				return;
+		}
+
+		size_t offset = PACKET_HEADER_SIZE;
+		const bool has_chunks = offset < size;
+		while (offset < size)
+		{
+			const uint8_t chunk_flags = data[offset];
+			const bool fragmented = chunk_flags & CHUNK_FRAGMENTED;
+			const size_t header_size = fragmented ? FRAGMENT_HEADER_SIZE : CHUNK_HEADER_SIZE;
+			if (offset + header_size > size)
+				return;
+			const Delivery delivery = Delivery(chunk_flags & CHUNK_DELIVERY_MASK);
+			if (delivery > Delivery::RELIABLE_ORDERED)
+				return;
+			const uint16_t id = read_u16(data + offset + 1);
+			uint16_t fragment = 0;
+			uint16_t fragment_count = 1;
+			if (fragmented)
+			{
+				fragment = read_u16(data + offset + 3);
+				fragment_count = read_u16(data + offset + 5);
+				if (fragment_count < 2 || fragment >= fragment_count || fragment_count > max_fragment_count)
+					return;
+			}
+			const size_t chunk_size = read_u16(data + offset + header_size - 2);
+			offset += header_size;
+			if (offset + chunk_size > size || (fragmented && chunk_size == 0))
+				return;
+			receive_fragment(peer, delivery, id, fragment, fragment_count, data + offset, chunk_size, now);
+			offset += chunk_size;
+		}
+
+		// The datagram is acknowledged only after it was fully parsed:
+		if (!peer.received_any)
+		{
+			peer.received_any = true;
+			peer.remote_sequence = sequence;
+			peer.ack_bits = 0;
+		}
+		else if (sequence_greater(sequence, peer.remote_sequence))
+		{
+			const uint16_t shift = uint16_t(sequence - peer.remote_sequence);
+			peer.ack_bits = shift > 32 ? 0 : ((shift == 32 ? 0 : (peer.ack_bits << shift)) | (1u << (shift - 1)));
+			peer.remote_sequence = sequence;
+		}
+		else
+		{
+			const uint16_t distance = uint16_t(peer.remote_sequence - sequence);
+			if (distance <= 32)
+			{
+				peer.ack_bits |= 1u << (distance - 1);
+			}
+		}
+		if (has_chunks)
+		{
+			peer.ack_pending = true;
+		}
+	}
+
+	void Host::receive_fragment(Peer& peer, Delivery delivery, uint16_t id, uint16_t fragment, uint16_t fragment_count, const uint8_t* data, size_t size, double now)
+	{
+		if (delivery == Delivery::UNRELIABLE)
+		{
+			wi::vector<uint8_t> completed;
+			if (fragment_count == 1)
+			{
+				completed.assign(data, data + size);
+			}
+			else if (!add_incomplete(peer, peer.unreliable_incomplete, id, fragment, fragment_count, data, size, completed, now))
+				return;
+			Message& message = messages.emplace_back();
+			message.peer = peer.connection;
+			message.delivery = delivery;
+			message.data = std::move(completed);
+			return;
+		}
+
+		ReceiveChannel& channel = peer.receive_channels[delivery == Delivery::RELIABLE_ORDERED ? CHANNEL_RELIABLE_ORDERED : CHANNEL_RELIABLE_UNORDERED];
+		if (uint16_t(id - channel.base) >= WINDOW_SIZE)
+			return; // it was already delivered
+		const size_t slot = id % WINDOW_SIZE;
+		if (channel.complete[slot])
+			return;
+
+		wi::vector<uint8_t> completed;
+		if (fragment_count == 1)
+		{
+			completed.assign(data, data + size);
+		}
+		else if (!add_incomplete(peer, channel.incomplete, id, fragment, fragment_count, data, size, completed, now))
+			return;
+		channel.complete.set(slot);
+
+		if (delivery == Delivery::RELIABLE_UNORDERED)
+		{
+			Message& message = messages.emplace_back();
+			message.peer = peer.connection;
+			message.delivery = delivery;
+			message.data = std::move(completed);
+		}
+		else
+		{
+			channel.ordered[id] = std::move(completed);
+		}
+
+		while (channel.complete[channel.base % WINDOW_SIZE])
+		{
+			if (delivery == Delivery::RELIABLE_ORDERED)
+			{
+				auto it = channel.ordered.find(channel.base);
+				Message& message = messages.emplace_back();
+				message.peer = peer.connection;
+				message.delivery = delivery;
+				message.data = std::move(it->second);
+				channel.ordered.erase(it);
+			}
+			channel.complete.reset(channel.base % WINDOW_SIZE);
+			channel.base++;
+		}
+	}
+
+	bool Host::add_incomplete(Peer& peer, wi::unordered_map<uint16_t, IncomingMessage>& incomplete, uint16_t id, uint16_t fragment, uint16_t fragment_count, const uint8_t* data, size_t size, wi::vector<uint8_t>& completed, double now)
+	{
+		// The peer can only hold a limited number and size of partial messages, the fragments beyond that are dropped
+		//	reliable ones are sent again by the peer, unreliable ones are lost
+		auto it = incomplete.find(id);
+		const bool first = it == incomplete.end();
+		if (first && peer.incomplete_count >= MAX_INCOMPLETE_MESSAGES)
+			return false;
+		const size_t added = size + (first ? size_t(fragment_count) * sizeof(wi::vector<uint8_t>) : 0);
+		if (peer.incomplete_size + added > desc.max_incomplete_size)
+			return false;
+		if (first)
+		{
+			it = incomplete.emplace(id, IncomingMessage()).first;
+			it->second.time = now;
+			peer.incomplete_count++;
+		}
+		IncomingMessage& incoming = it->second;
+		const uint32_t received_count = incoming.received_count;
+		const bool complete = add_fragment(incoming.fragments, incoming.received_count, fragment, fragment_count, data, size);
+		if (incoming.received_count == received_count)
+			return false; // mismatching or duplicate fragment, only possible for a message that existed already
+		incoming.size += added;
+		peer.incomplete_size += added;
+		if (!complete)
+			return false;
+		assemble(incoming.fragments, completed);
+		peer.incomplete_count--;
+		peer.incomplete_size -= incoming.size;
+		incomplete.erase(it);
+		return true;
+	}
+
+	void Host::acknowledge(Peer& peer, uint16_t sequence, double now)
+	{
+		SentPacket& sent = peer.sent_packets[sequence % WINDOW_SIZE];
+		if (!sent.valid || sent.acked || sent.sequence != sequence)
+			return;
+		sent.acked = true;
+
+		// Acknowledgement and keepalive datagrams are only acknowledged along with later data, their delay would inflate the round trip time:
+		if (sent.has_data)
+		{
+			const double sample = now - sent.time;
+			if (peer.rtt_measured)
+			{
+				peer.rtt_variance = peer.rtt_variance * 0.75 + std::abs(peer.rtt - sample) * 0.25;
+				peer.rtt = peer.rtt * 0.875 + sample * 0.125;
+			}
+			else
+			{
+				peer.rtt = sample;
+				peer.rtt_variance = sample * 0.5;
+				peer.rtt_measured = true;
+			}
+		}
+
+		for (auto& ref : sent.fragments)
+		{
+			SendChannel& channel = peer.send_channels[ref.channel];
+			if (channel.messages.empty())
+				continue;
+			const uint16_t index = uint16_t(ref.id - channel.messages.front().id);
+			if (index >= channel.messages.size())
+				continue; // the message was completed by an other datagram
+			OutgoingMessage& message = channel.messages[index];
+			Fragment& fragment = message.fragments[ref.fragment];
+			if (!fragment.acked)
+			{
+				fragment.acked = true;
+				message.acked_count++;
+			}
+		}
+		sent.fragments.clear();
+
+		for (auto& channel : peer.send_channels)
+		{
+			while (!channel.messages.empty() && channel.messages.front().acked_count == channel.messages.front().fragment_count)
+			{
+				channel.messages.pop_front();
+			}
+		}
+
+		// The rate is only increased if it was limiting, at most once per round trip:
+		if (peer.rate_limited && now - peer.rate_change_time >= peer.rtt)
+		{
+			if (peer.slow_start)
+			{
+				peer.send_rate *= 2;
+			}
+			else
+			{
+				peer.send_rate += desc.mtu / std::max(peer.rtt, 0.001);
+			}
+			peer.send_rate = std::min(peer.send_rate, double(desc.max_send_rate));
+			peer.rate_limited = false;
+			peer.rate_change_time = now;
+		}
+	}
+
+	void Host::send(Peer& peer, double now)
+	{
+		peer.tokens = std::min(peer.tokens + peer.send_rate * (now - peer.token_time), double(desc.mtu) * PACING_BURST);
+		peer.token_time = now;
+
+		while (!peer.unreliable.empty() && now - peer.unreliable.front().time > UNRELIABLE_TIMEOUT)
+		{
+			peer.unreliable.pop_front();
+		}
+
+		bool blocked = false;
+		while (!blocked && !peer.unreliable.empty())
+		{
+			OutgoingMessage& message = peer.unreliable.front();
+			while (message.next_fragment < message.fragment_count)
+			{
+				if (!write_fragment(peer, Delivery::UNRELIABLE, message, message.next_fragment, now))
+				{
+					blocked = true;
+					break;
+				}
+				message.next_fragment++;
+			}
+			if (!blocked)
+			{
+				peer.unreliable.pop_front();
+			}
+		}
+
+		// Reliable fragments are sent from the oldest message, the ones that were not acknowledged within the resend timeout are sent again:
+		const double resend_timeout = std::max(MIN_RESEND_TIMEOUT, peer.rtt + 4 * peer.rtt_variance);
+		bool loss = false;
+		//	The channel that goes first alternates, so that one of them can't take the whole rate
+		peer.first_channel = (peer.first_channel + 1) % CHANNEL_COUNT;
+		for (int i = 0; i < CHANNEL_COUNT && !blocked; ++i)
+		{
+			const int c = (peer.first_channel + i) % CHANNEL_COUNT;
+			SendChannel& channel = peer.send_channels[c];
+			const Delivery delivery = c == CHANNEL_RELIABLE_ORDERED ? Delivery::RELIABLE_ORDERED : Delivery::RELIABLE_UNORDERED;
+			const size_t count = std::min(channel.messages.size(), size_t(WINDOW_SIZE));
+			for (size_t m = 0; m < count && !blocked; ++m)
+			{
+				OutgoingMessage& message = channel.messages[m];
+				for (uint16_t f = 0; f < message.fragment_count; ++f)
+				{
+					Fragment& fragment = message.fragments[f];
+					if (fragment.acked)
+						continue;
+					const bool resend = fragment.sent_time >= 0;
+					if (resend && now - fragment.sent_time < resend_timeout)
+						continue;
+					if (!write_fragment(peer, delivery, message, f, now))
+					{
+						blocked = true;
+						break;
+					}
+					if (resend)
+					{
+						peer.stats.resent_fragments++;
+						loss = true;
+					}
+					fragment.sent_time = now;
+					FragmentRef& ref = packet_record->fragments.emplace_back();
+					ref.channel = uint8_t(c);
+					ref.id = message.id;
+					ref.fragment = f;
+				}
+			}
+		}
+
+		if (packet_record != nullptr)
+		{
+			end_packet(peer, now);
+		}
+		else if (peer.ack_pending || now - peer.send_time > KEEPALIVE_INTERVAL)
+		{
+			// Acknowledgements and keepalives are small, they are not paced:
+			begin_packet(peer, now);
+			end_packet(peer, now);
+		}
+
+		if (blocked)
+		{
+			peer.rate_limited = true;
+		}
+		if (loss && now - peer.rate_change_time >= peer.rtt)
+		{
+			peer.send_rate = std::max(peer.send_rate * 0.5, double(desc.min_send_rate));
+			peer.slow_start = false;
+			peer.rate_change_time = now;
+		}
+	}
+
+	bool Host::write_fragment(Peer& peer, Delivery delivery, const OutgoingMessage& message, uint16_t fragment, double now)
+	{
+		const bool fragmented = message.fragment_count > 1;
+		const size_t header_size = fragmented ? FRAGMENT_HEADER_SIZE : CHUNK_HEADER_SIZE;
+		const size_t capacity = desc.mtu - PACKET_HEADER_SIZE - header_size;
+		const size_t offset = size_t(fragment) * capacity;
+		const size_t size = std::min(capacity, message.data.size() - offset);
+
+		if (packet_record != nullptr && packet.size() + header_size + size > desc.mtu)
+		{
+			end_packet(peer, now);
+		}
+		if (packet_record == nullptr)
+		{
+			if (peer.tokens <= 0)
+				return false;
+			begin_packet(peer, now);
+		}
+
+		packet.push_back(uint8_t(delivery) | (fragmented ? CHUNK_FRAGMENTED : 0));
+		write_u16(packet, message.id);
+		if (fragmented)
+		{
+			write_u16(packet, fragment);
+			write_u16(packet, message.fragment_count);
+		}
+		write_u16(packet, uint16_t(size));
+		packet.insert(packet.end(), message.data.begin() + offset, message.data.begin() + offset + size);
+		packet_record->has_data = true;
+		return true;
+	}
+
+	void Host::begin_packet(Peer& peer, double now)
+	{
+		packet.clear();
+		write_u16(packet, PROTOCOL_ID);
+		packet.push_back(peer.received_any ? PACKET_HAS_ACK : 0);
+		write_u16(packet, peer.sequence);
+		write_u16(packet, peer.remote_sequence);
+		write_u32(packet, peer.ack_bits);
+
+		packet_record = &peer.sent_packets[peer.sequence % WINDOW_SIZE];
+		packet_record->valid = true;
+		packet_record->acked = false;
+		packet_record->has_data = false;
+		packet_record->sequence = peer.sequence;
+		packet_record->time = now;
+		packet_record->fragments.clear();
+		peer.sequence++;
+	}
+
+	void Host::end_packet(Peer& peer, double now)
+	{
+		transmit(peer.connection, packet.data(), packet.size(), now);
+		peer.tokens -= double(packet.size());
+		peer.stats.sent_packets++;
+		peer.stats.sent_bytes += packet.size();
+		peer.ack_pending = false;
+		peer.send_time = now;
+		packet_record = nullptr;
+	}
+
+	void Host::transmit(const Connection& connection, const uint8_t* data, size_t size, double now)
+	{
+		if (simulation.packet_loss > 0 && random_float() < simulation.packet_loss)
+			return;
+
+		const double delay = (simulation.latency + simulation.jitter * random_float()) * 0.001;
+		Datagram* datagram = nullptr;
+		if (delay > 0)
+		{
+			datagram = &delayed.emplace_back();
+		}
+		else
+		{
+			if (outgoing_count == outgoing.size())
+			{
+				outgoing.emplace_back();
+			}
+			datagram = &outgoing[outgoing_count++];
+		}
+		datagram->connection = connection;
+		datagram->time = now + delay;
+		datagram->data.assign(data, data + size);
+	}
+
+	void Host::flush(double now)
+	{
+		// Delayed datagrams that are due are moved to the outgoing ones, the rest are compacted:
+		size_t remaining = 0;
+		for (size_t i = 0; i < delayed.size(); ++i)
+		{
+			if (delayed[i].time <= now)
+			{
+				if (outgoing_count == outgoing.size())
+				{
+					outgoing.emplace_back();
+				}
+				std::swap(outgoing[outgoing_count++], delayed[i]);
+			}
+			else
+			{
+				if (remaining != i)
+				{
+					std::swap(delayed[remaining], delayed[i]);
+				}
+				remaining++;
+			}
+		}
+		delayed.resize(remaining);
+
+		if (outgoing_count == 0)
+			return;
+		send_packets.resize(outgoing_count);
+		for (size_t i = 0; i < outgoing_count; ++i)
+		{
+			send_packets[i].connection = outgoing[i].connection;
+			send_packets[i].data = outgoing[i].data.data();
+			send_packets[i].size = outgoing[i].data.size();
+		}
+		// A datagram that fails to send is treated like a lost one:
+		size_t offset = 0;
+		while (offset < outgoing_count)
+		{
+			offset += SendBatch(&socket, send_packets.data() + offset, outgoing_count - offset) + 1;
+		}
+		outgoing_count = 0;
+	}
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiNetwork.h"
+#include "wiVector.h"
+#include "wiUnorderedMap.h"
+#include "wiTimer.h"
+
+#include <deque>
+#include <bitset>
+
+namespace wi::network
+{
+	// Message based connections to any number of peers over one UDP socket
+	//	Peers are identified by their Connection, they are added when the first datagram is sent to them or received from them, and removed after the timeout
+	//	Messages that don't fit into one datagram are split into fragments and reassembled on the receiving side
+	//	Every datagram has a sequence number and acknowledges the last 33 datagrams that were received from the peer,
+	//	reliable fragments that were not acknowledged in time are sent again in new datagrams
+	//	Sending is paced per peer: the send rate is halved when fragments are lost and increased while it is the limiting factor
+	//	Nothing is sent or received outside of Update()
+	class Host
+	{
+	public:
+		enum class Delivery : uint8_t
+		{
+			UNRELIABLE,				// can be lost, or arrive in a different order than it was sent
+			RELIABLE_UNORDERED,		// arrives exactly once, in any order
+			RELIABLE_ORDERED,		// arrives exactly once, in the order it was sent with RELIABLE_ORDERED
+		};
+
+		struct Desc
+		{
+			uint16_t port = 0;					// port to listen on, 0 if the host only receives from the peers that it sends to
+			uint32_t mtu = 1200;				// maximum size of a datagram in bytes
+			float timeout = 10;					// peers are removed after this many seconds without receiving from them
+			float min_send_rate = 64 * 1024;	// lower limit of the pacing rate in bytes per second
+			float max_send_rate = 8 * 1024 * 1024;	// upper limit of the pacing rate in bytes per second
+			uint32_t max_message_size = 1024 * 1024;	// larger messages can't be sent, and fragments of larger messages are dropped
+			uint32_t max_incomplete_size = 4 * 1024 * 1024;	// bytes of partially received messages per peer, fragments that don't fit are dropped
+			uint32_t max_peers = 1024;			// datagrams from unknown peers are dropped while there are this many
+		};
+
+		// Simulates a bad network for the datagrams that this host sends
+		struct Simulation
+		{
+			float packet_loss = 0;	// probability of dropping a datagram, in range [0, 1]
+			float latency = 0;		// delay of every datagram in milliseconds
+			float jitter = 0;		// random delay in milliseconds that is added to the latency, it can reorder datagrams
+		};
+
+		struct Message
+		{
+			Connection peer;
+			Delivery delivery = Delivery::UNRELIABLE;
+			wi::vector<uint8_t> data;
+		};
+
+		struct PeerStats
+		{
+			float rtt = 0;					// smoothed round trip time in milliseconds
+			float send_rate = 0;			// current pacing rate in bytes per second
+			uint64_t sent_packets = 0;
+			uint64_t sent_bytes = 0;
+			uint64_t received_packets = 0;
+			uint64_t received_bytes = 0;
+			uint64_t resent_fragments = 0;	// reliable fragments that were sent again because they were not acknowledged in time
+			uint32_t pending_messages = 0;	// reliable messages that were not acknowledged yet
+		};
+
+		// Creates the socket, returns false if it could not be created or the port could not be opened
+		bool Create(const Desc& desc);
+
+		// Queues a message to be sent in the next Update()
+		//	peer		:	receiver of the message, it is added to the peers if it is not known yet
+		//	delivery	:	delivery guarantee of the message
+		//	data		:	message data, it is copied
+		//	size		:	size of the message in bytes
+		//	returns false if the message is larger than Desc::max_message_size, too many reliable messages are waiting to be sent to the peer, or there are too many peers
+		bool Send(const Connection& peer, Delivery delivery, const void* data, size_t size);
+
+		// Receives datagrams, delivers the completed messages, sends acknowledgements, resent and new messages within the pacing rate
+		//	It should be called frequently, for example once per frame
+		void Update();
+
+		// Takes the next delivered message, returns false if there are none
+		bool Receive(Message& message);
+
+		// Forgets a peer and drops the messages that were not sent or delivered to it yet
+		void Disconnect(const Connection& peer);
+
+		// Returns false if the peer is not known
+		bool GetPeerStats(const Connection& peer, PeerStats& stats) const;
+		size_t GetPeerCount() const { return peers.size(); }
+
+		void SetSimulation(const Simulation& value) { simulation = value; }
+		const Simulation& GetSimulation() const { return simulation; }
+
+		const Socket& GetSocket() const { return socket; }
+
+		static constexpr uint32_t WINDOW_SIZE = 1024; // reliable messages in flight per channel, and remembered datagrams per peer
+		static constexpr uint32_t MAX_INCOMPLETE_MESSAGES = 256; // partially received messages per peer, fragments of further messages are dropped
+
+	private:
+		struct Fragment
+		{
+			double sent_time = -1; // negative if it was not sent yet
+			bool acked = false;
+		};
+		struct OutgoingMessage
+		{
+			uint16_t id = 0;
+			uint16_t fragment_count = 1;
+			uint16_t next_fragment = 0;	// unreliable messages are sent from this fragment
+			uint16_t acked_count = 0;
+			double time = 0;
+			wi::vector<uint8_t> data;
+			wi::vector<Fragment> fragments; // only for reliable messages
+		};
+		struct IncomingMessage
+		{
+			double time = 0;
+			uint32_t received_count = 0;
+			size_t size = 0; // received data and fragment slots in bytes, counted in the incomplete size of the peer
+			wi::vector<wi::vector<uint8_t>> fragments;
+		};
+		struct FragmentRef
+		{
+			uint8_t channel = 0;
+			uint16_t id = 0;
+			uint16_t fragment = 0;
+		};
+		struct SentPacket
+		{
+			bool valid = false;
+			bool acked = false;
+			bool has_data = false; // only datagrams with message data are acknowledged promptly, the others don't give round trip time samples
+			uint16_t sequence = 0;
+			double time = 0;
+			wi::vector<FragmentRef> fragments;
+		};
+		struct SendChannel
+		{
+			uint16_t next_id = 0;
+			std::deque<OutgoingMessage> messages; // the front is the oldest message that is not fully acknowledged
+		};
+		struct ReceiveChannel
+		{
+			uint16_t base = 0; // every message before this was delivered
+			std::bitset<WINDOW_SIZE> complete; // messages after the base that were completed, indexed by id % WINDOW_SIZE
+			wi::unordered_map<uint16_t, IncomingMessage> incomplete;
+			wi::unordered_map<uint16_t, wi::vector<uint8_t>> ordered; // completed ordered messages that wait for the previous ones
+		};
+		enum CHANNEL
+		{
+			CHANNEL_RELIABLE_UNORDERED,
+			CHANNEL_RELIABLE_ORDERED,
+			CHANNEL_COUNT
+		};
+		struct Peer
+		{
+			Connection connection;
+			uint16_t sequence = 0;			// sequence of the next sent datagram
+			uint16_t remote_sequence = 0;	// latest received datagram sequence
+			uint32_t ack_bits = 0;			// bit N is set if datagram remote_sequence - 1 - N was received
+			bool received_any = false;
+			bool ack_pending = false;
+			wi::vector<SentPacket> sent_packets; // indexed by sequence % WINDOW_SIZE
+
+			SendChannel send_channels[CHANNEL_COUNT];
+			ReceiveChannel receive_channels[CHANNEL_COUNT];
+			int first_channel = 0;			// reliable channel that is sent first in the next update
+			uint16_t unreliable_id = 0;
+			std::deque<OutgoingMessage> unreliable;
+			wi::unordered_map<uint16_t, IncomingMessage> unreliable_incomplete;
+			uint32_t incomplete_count = 0;	// partially received messages, unreliable and reliable
+			size_t incomplete_size = 0;		// bytes of the partially received messages
+
+			double rtt = 0.1;				// seconds
+			double rtt_variance = 0.05;
+			bool rtt_measured = false;
+			double send_rate = 0;			// bytes per second
+			double tokens = 0;				// bytes that can be sent now
+			bool slow_start = true;
+			bool rate_limited = false;		// some data waited for tokens since the last rate change
+			double rate_change_time = 0;
+			double token_time = 0;
+			double send_time = 0;
+			double receive_time = 0;
+
+			PeerStats stats;
+		};
+		wi::unordered_map<uint64_t, Peer> peers;
+
+		struct Datagram
+		{
+			Connection connection;
+			double time = 0;
+			wi::vector<uint8_t> data;
+		};
+		wi::vector<Datagram> outgoing; // sent at the end of Update()
+		size_t outgoing_count = 0;
+		wi::vector<Datagram> delayed; // held back by the simulation
+		wi::vector<wi::vector<uint8_t>> receive_buffers;
+		wi::vector<Packet> receive_packets;
+		wi::vector<Packet> send_packets;
+		wi::vector<uint8_t> packet;
+		SentPacket* packet_record = nullptr;
+
+		std::deque<Message> messages;
+		Socket socket;
+		Desc desc;
+		Simulation simulation;
+		wi::Timer timer;
+
+		uint32_t max_fragment_count = 0xFFFF;
+
+		Peer* get_peer(const Connection& connection, double now); // nullptr if the peer is not known and there are too many peers
+		bool add_incomplete(Peer& peer, wi::unordered_map<uint16_t, IncomingMessage>& incomplete, uint16_t id, uint16_t fragment, uint16_t fragment_count, const uint8_t* data, size_t size, wi::vector<uint8_t>& completed, double now);
+		void receive(double now);
+		void receive_packet(Peer& peer, const uint8_t* data, size_t size, double now);
+		void receive_fragment(Peer& peer, Delivery delivery, uint16_t id, uint16_t fragment, uint16_t fragment_count, const uint8_t* data, size_t size, double now);
+		void acknowledge(Peer& peer, uint16_t sequence, double now);
+		void send(Peer& peer, double now);
+		bool write_fragment(Peer& peer, Delivery delivery, const OutgoingMessage& message, uint16_t fragment, double now);
+		void begin_packet(Peer& peer, double now);
+		void end_packet(Peer& peer, double now);
+		void transmit(const Connection& connection, const uint8_t* data, size_t size, double now);
+		void flush(double now);
+	};
+}
@@ -4,12 +4,21 @@
 #include "wiNetwork.h"
 #include "wiBacklog.h"
 #include "wiTimer.h"
+#include "wiVector.h"
+#include "wiLockFreeQueue.h"
 
 #include <string>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 #include <unistd.h>
 #include <errno.h>
+#include <poll.h>
 
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <netinet/in.h>
 
 namespace wi::network
@@ -38,6 +47,30 @@ namespace wi::network
 		return static_cast<SocketInternal*>(param->internal_state.get());
 	}
 
+	sockaddr_in to_sockaddr(const Connection* connection)
+	{
+		sockaddr_in target = {};
+		target.sin_family = AF_INET;
+		target.sin_port = htons(connection->port);
+		in_addr_union address;
+		address.S_un_b.s_b1 = connection->ipaddress[0];
+		address.S_un_b.s_b2 = connection->ipaddress[1];
+		address.S_un_b.s_b3 = connection->ipaddress[2];
+		address.S_un_b.s_b4 = connection->ipaddress[3];
+		target.sin_addr.s_addr = address.S_addr;
+		return target;
+	}
+	void from_sockaddr(const sockaddr_in& sender, Connection* connection)
+	{
+		connection->port = htons(sender.sin_port); // reverse byte order from network to host
+		in_addr_union address;
+		address.S_addr = sender.sin_addr.s_addr;
+		connection->ipaddress[0] = address.S_un_b.s_b1;
+		connection->ipaddress[1] = address.S_un_b.s_b2;
+		connection->ipaddress[2] = address.S_un_b.s_b3;
+		connection->ipaddress[3] = address.S_un_b.s_b4;
+	}
+
 	bool CreateSocket(Socket* sock)
 	{
 		std::shared_ptr<SocketInternal> socketinternal = std::make_shared<SocketInternal>();
@@ -57,21 +90,13 @@ namespace wi::network
 	bool Send(const Socket* sock, const Connection* connection, const void* data, size_t dataSize)
 	{
 		if (sock->IsValid()){
-			sockaddr_in target;
-			target.sin_family = AF_INET;
-			target.sin_port = htons(connection->port);
-			in_addr_union address;
-			address.S_un_b.s_b1 = connection->ipaddress[0];
-			address.S_un_b.s_b2 = connection->ipaddress[1];
-			address.S_un_b.s_b3 = connection->ipaddress[2];
-			address.S_un_b.s_b4 = connection->ipaddress[3];
-			target.sin_addr.s_addr = address.S_addr;
+			sockaddr_in target = to_sockaddr(connection);
 
 			auto socketinternal = to_internal(sock);
 			int result = sendto(socketinternal->handle, (const char*)data, (int)dataSize, 0, (const sockaddr*)&target, sizeof(target));
 			if (result < 0)
 			{
-				wi::backlog::post("wi::network_Linux error in Send: (Error Code: " + std::to_string(result) + ") " + std::string(strerror(result)));
+				wi::backlog::post("wi::network_Linux error in Send: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
 				return false;
 			}
 
@@ -107,22 +132,27 @@ namespace wi::network
 		if (sock->IsValid()){
 			auto socketinternal = to_internal(sock);
 
-			fd_set readfds;
-			FD_ZERO(&readfds);
-			FD_SET(socketinternal->handle, &readfds);
-			timeval timeout;
-			timeout.tv_sec = 0;
-			timeout.tv_usec = timeout_microseconds;
+			// poll() is used instead of select(), because it doesn't need the highest descriptor and works with any descriptor value:
+			pollfd fd = {};
+			fd.fd = socketinternal->handle;
+			fd.events = POLLIN;
+			timespec timeout;
+			timeout.tv_sec = timeout_microseconds / 1000000;
+			timeout.tv_nsec = (timeout_microseconds % 1000000) * 1000;
 
-			int result = select(0, &readfds, NULL, NULL, &timeout);
+			int result = ppoll(&fd, 1, &timeout, NULL);
 			if (result < 0)
 			{
-				wi::backlog::post("wi::network_Linux error in Send: (Error Code: " + std::to_string(result) + ") " + std::string(strerror(result)));
+				if (errno == EINTR)
+				{
+					return false;
+				}
+				wi::backlog::post("wi::network_Linux error in CanReceive: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
 				assert(0);
 				return false;
 			}
 
-			return FD_ISSET(socketinternal->handle, &readfds);
+			return result > 0 && (fd.revents & POLLIN);
 		}
 		return false;
 	}
@@ -137,23 +167,478 @@ namespace wi::network
 			int result = recvfrom(socketinternal->handle, (char*)data, (int)dataSize, 0, (sockaddr*)& sender, (socklen_t*)&targetsize);
 			if (result < 0)
 			{
-				wi::backlog::post("wi::network_Linux error in Send: (Error Code: " + std::to_string(result) + ") " + std::string(strerror(result)));
+				wi::backlog::post("wi::network_Linux error in Receive: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
 				assert(0);
 				return false;
 			}
 
-			connection->port = htons(sender.sin_port); // reverse byte order from network to host
-			in_addr_union address;
-			address.S_addr = sender.sin_addr.s_addr;
-			connection->ipaddress[0] = address.S_un_b.s_b1;
-			connection->ipaddress[1] = address.S_un_b.s_b2;
-			connection->ipaddress[2] = address.S_un_b.s_b3;
-			connection->ipaddress[3] = address.S_un_b.s_b4;
+			from_sockaddr(sender, connection);
 
 			return true;
 		}
 		return false;
 	}
+
+	// Packets are processed in chunks, so the message headers can live on the stack
+	static constexpr size_t BATCH_CHUNK_SIZE = 64;
+	static constexpr int SEND_CHUNKS_PER_WAKE = 4; // Service: send chunks between checking the sockets for received packets
+
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count, BatchStats* stats)
+	{
+		BatchStats result_stats;
+		if (sock->IsValid())
+		{
+			auto socketinternal = to_internal(sock);
+
+			mmsghdr messages[BATCH_CHUNK_SIZE];
+			iovec buffers[BATCH_CHUNK_SIZE];
+			sockaddr_in targets[BATCH_CHUNK_SIZE];
+
+			size_t offset = 0;
+			while (offset < count)
+			{
+				const size_t chunk = std::min(count - offset, BATCH_CHUNK_SIZE);
+				for (size_t i = 0; i < chunk; ++i)
+				{
+					const Packet& packet = packets[offset + i];
+					targets[i] = to_sockaddr(&packet.connection);
+					buffers[i].iov_base = packet.data;
+					buffers[i].iov_len = packet.size;
+					messages[i] = {};
+					messages[i].msg_hdr.msg_name = &targets[i];
+					messages[i].msg_hdr.msg_namelen = sizeof(targets[i]);
+					messages[i].msg_hdr.msg_iov = &buffers[i];
+					messages[i].msg_hdr.msg_iovlen = 1;
+				}
+
+				// sendmmsg() can send less than the whole chunk, the rest is sent by the next call:
+				int result = sendmmsg(socketinternal->handle, messages, (unsigned int)chunk, 0);
+				result_stats.syscalls++;
+				if (result < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					wi::backlog::post("wi::network_Linux error in SendBatch: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
+					break;
+				}
+				for (int i = 0; i < result; ++i)
+				{
+					result_stats.bytes += messages[i].msg_len;
+				}
+				result_stats.packets += result;
+				offset += result;
+			}
+		}
+		if (stats != nullptr)
+		{
+			*stats = result_stats;
+		}
+		return result_stats.packets;
+	}
+
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count, BatchStats* stats)
+	{
+		BatchStats result_stats;
+		if (sock->IsValid())
+		{
+			auto socketinternal = to_internal(sock);
+
+			mmsghdr messages[BATCH_CHUNK_SIZE];
+			iovec buffers[BATCH_CHUNK_SIZE];
+			sockaddr_in senders[BATCH_CHUNK_SIZE];
+
+			size_t offset = 0;
+			while (offset < count)
+			{
+				const size_t chunk = std::min(count - offset, BATCH_CHUNK_SIZE);
+				for (size_t i = 0; i < chunk; ++i)
+				{
+					Packet& packet = packets[offset + i];
+					buffers[i].iov_base = packet.data;
+					buffers[i].iov_len = packet.capacity;
+					messages[i] = {};
+					messages[i].msg_hdr.msg_name = &senders[i];
+					messages[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+					messages[i].msg_hdr.msg_iov = &buffers[i];
+					messages[i].msg_hdr.msg_iovlen = 1;
+				}
+
+				// MSG_DONTWAIT returns the packets that are already queued instead of blocking:
+				int result = recvmmsg(socketinternal->handle, messages, (unsigned int)chunk, MSG_DONTWAIT, NULL);
+				result_stats.syscalls++;
+				if (result < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					if (errno != EAGAIN && errno != EWOULDBLOCK)
+					{
+						wi::backlog::post("wi::network_Linux error in ReceiveBatch: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
+					}
+					break;
+				}
+				for (int i = 0; i < result; ++i)
+				{
+					Packet& packet = packets[offset + i];
+					packet.size = messages[i].msg_len;
+					from_sockaddr(senders[i], &packet.connection);
+					result_stats.bytes += packet.size;
+				}
+				result_stats.packets += result;
+				offset += result;
+				if (result < (int)chunk)
+					break; // the queue is empty
+			}
+		}
+		if (stats != nullptr)
+		{
+			*stats = result_stats;
+		}
+		return result_stats.packets;
+	}
+
+	struct ServiceInternal
+	{
+		ServiceDesc desc;
+		wi::vector<Socket> sockets;
+		std::unique_ptr<wi::SPSCQueue<uint32_t>[]> received; // per socket, indices of received packets
+		wi::vector<uint8_t> memory; // packet buffers
+		wi::vector<uint8_t> drop_buffer; // packets are received into this when the pool is empty
+		wi::vector<Packet> packets;
+		wi::vector<uint32_t> packet_sockets; // socket index of packets that are in the send queue
+		wi::MPMCQueue<uint32_t> freelist; // indices of free packets
+		wi::MPMCQueue<uint32_t> sendqueue; // indices of packets to send
+
+		int epollfd = -1;
+		int wakefd = -1; // eventfd that wakes up the I/O thread when there are packets to send
+		std::atomic_bool alive{ true };
+		std::atomic_bool wake_pending{ false };
+		std::thread thread;
+
+		std::atomic<uint64_t> received_packets{ 0 };
+		std::atomic<uint64_t> received_bytes{ 0 };
+		std::atomic<uint64_t> sent_packets{ 0 };
+		std::atomic<uint64_t> sent_bytes{ 0 };
+		std::atomic<uint64_t> dropped_packets{ 0 };
+		std::atomic<uint64_t> syscalls{ 0 };
+
+		~ServiceInternal()
+		{
+			if (thread.joinable())
+			{
+				alive.store(false);
+				wake();
+				thread.join();
+			}
+			if (epollfd >= 0)
+			{
+				close(epollfd);
+			}
+			if (wakefd >= 0)
+			{
+				close(wakefd);
+			}
+		}
+
+		void wake()
+		{
+			uint64_t value = 1;
+			ssize_t result = write(wakefd, &value, sizeof(value));
+			(void)result; // the eventfd can only fail when its counter would overflow, then it is already signaled
+		}
+
+		uint32_t index_of(const Packet* packet) const
+		{
+			assert(packet >= packets.data() && packet < packets.data() + packets.size());
+			return uint32_t(packet - packets.data());
+		}
+
+		// Returns a packet to the pool, its buffer is restored in case the user changed it
+		void release(uint32_t index)
+		{
+			Packet& packet = packets[index];
+			packet.data = memory.data() + size_t(index) * size_t(desc.packet_size);
+			packet.capacity = desc.packet_size;
+			freelist.push(index);
+		}
+
+		void receive(uint32_t socket_index)
+		{
+			Packet batch[BATCH_CHUNK_SIZE];
+			uint32_t indices[BATCH_CHUNK_SIZE];
+			BatchStats stats;
+			for (;;)
+			{
+				size_t count = 0;
+				while (count < BATCH_CHUNK_SIZE && freelist.pop(indices[count]))
+				{
+					batch[count] = packets[indices[count]];
+					count++;
+				}
+
+				if (count == 0)
+				{
+					// The pool is empty, the queued packets are dropped, otherwise epoll would keep reporting the socket:
+					for (size_t i = 0; i < BATCH_CHUNK_SIZE; ++i)
+					{
+						batch[i].data = drop_buffer.data();
+						batch[i].capacity = drop_buffer.size();
+					}
+					size_t dropped = 0;
+					do
+					{
+						dropped = ReceiveBatch(&sockets[socket_index], batch, BATCH_CHUNK_SIZE, &stats);
+						syscalls.fetch_add(stats.syscalls, std::memory_order_relaxed);
+						dropped_packets.fetch_add(dropped, std::memory_order_relaxed);
+					} while (dropped == BATCH_CHUNK_SIZE);
+					return;
+				}
+
+				const size_t result = ReceiveBatch(&sockets[socket_index], batch, count, &stats);
+				syscalls.fetch_add(stats.syscalls, std::memory_order_relaxed);
+				for (size_t i = 0; i < count; ++i)
+				{
+					if (i < result)
+					{
+						packets[indices[i]] = batch[i];
+						if (received[socket_index].push(indices[i]))
+						{
+							received_packets.fetch_add(1, std::memory_order_relaxed);
+							received_bytes.fetch_add(batch[i].size, std::memory_order_relaxed);
+							continue;
+						}
+						dropped_packets.fetch_add(1, std::memory_order_relaxed);
+					}
+					release(indices[i]);
+				}
+				if (result < count)
+					return; // the socket queue is empty
+			}
+		}
+
+		// Sends a limited number of chunks, so that receiving is not delayed by a long send queue
+		//	returns true if the send queue was emptied
+		bool send()
+		{
+			Packet batch[BATCH_CHUNK_SIZE];
+			uint32_t indices[BATCH_CHUNK_SIZE];
+			BatchStats stats;
+			for (int chunk = 0; chunk < SEND_CHUNKS_PER_WAKE; ++chunk)
+			{
+				size_t count = 0;
+				while (count < BATCH_CHUNK_SIZE && sendqueue.pop(indices[count]))
+				{
+					count++;
+				}
+				if (count == 0)
+					return true;
+
+				// Consecutive packets of the same socket are sent with one batch:
+				size_t begin = 0;
+				while (begin < count)
+				{
+					const uint32_t socket_index = packet_sockets[indices[begin]];
+					size_t end = begin;
+					while (end < count && packet_sockets[indices[end]] == socket_index)
+					{
+						batch[end - begin] = packets[indices[end]];
+						end++;
+					}
+					SendBatch(&sockets[socket_index], batch, end - begin, &stats);
+					syscalls.fetch_add(stats.syscalls, std::memory_order_relaxed);
+					sent_packets.fetch_add(stats.packets, std::memory_order_relaxed);
+					sent_bytes.fetch_add(stats.bytes, std::memory_order_relaxed);
+					for (size_t i = begin; i < end; ++i)
+					{
+						release(indices[i]);
+					}
+					begin = end;
+				}
+			}
+			return false;
+		}
+
+		void run()
+		{
+			const uint32_t wake_id = (uint32_t)sockets.size();
+			epoll_event events[16];
+			bool send_pending = false;
+			while (alive.load())
+			{
+				// While there are packets left to send, only the readiness is checked without waiting:
+				int count = epoll_wait(epollfd, events, arraysize(events), send_pending ? 0 : -1);
+				syscalls.fetch_add(1, std::memory_order_relaxed);
+				if (count < 0)
+				{
+					if (errno == EINTR)
+						continue;
+					wi::backlog::post("wi::network_Linux error in Service: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
+					return;
+				}
+				for (int i = 0; i < count; ++i)
+				{
+					const uint32_t id = events[i].data.u32;
+					if (id == wake_id)
+					{
+						uint64_t value;
+						ssize_t result = read(wakefd, &value, sizeof(value));
+						(void)result;
+						syscalls.fetch_add(1, std::memory_order_relaxed);
+						// Cleared before the send queue is drained, so a packet that is queued after this will signal again:
+						wake_pending.store(false);
+					}
+					else
+					{
+						receive(id);
+					}
+				}
+				send_pending = !send();
+			}
+		}
+	};
+	ServiceInternal* to_internal(const Service* param)
+	{
+		return static_cast<ServiceInternal*>(param->internal_state.get());
+	}
+
+	bool CreateService(Service* service, const Socket* sockets, uint32_t socket_count, const ServiceDesc& desc)
+	{
+		std::shared_ptr<ServiceInternal> serviceinternal = std::make_shared<ServiceInternal>();
+		serviceinternal->desc = desc;
+		serviceinternal->sockets.assign(sockets, sockets + socket_count);
+		for (auto& sock : serviceinternal->sockets)
+		{
+			if (!sock.IsValid())
+			{
+				wi::backlog::post("wi::network_Linux error in CreateService: invalid socket");
+				return false;
+			}
+		}
+
+		serviceinternal->received.reset(new wi::SPSCQueue<uint32_t>[socket_count]);
+		for (uint32_t i = 0; i < socket_count; ++i)
+		{
+			serviceinternal->received[i].init(desc.receive_queue_size);
+		}
+
+		serviceinternal->memory.resize(size_t(desc.packet_count) * size_t(desc.packet_size));
+		serviceinternal->drop_buffer.resize(desc.packet_size);
+		serviceinternal->packets.resize(desc.packet_count);
+		serviceinternal->packet_sockets.resize(desc.packet_count);
+		serviceinternal->freelist.init(desc.packet_count);
+		for (uint32_t i = 0; i < desc.packet_count; ++i)
+		{
+			Packet& packet = serviceinternal->packets[i];
+			packet.data = serviceinternal->memory.data() + size_t(i) * size_t(desc.packet_size);
+			packet.capacity = desc.packet_size;
+			serviceinternal->freelist.push(i);
+		}
+		serviceinternal->sendqueue.init(desc.send_queue_size);
+
+		serviceinternal->epollfd = epoll_create1(EPOLL_CLOEXEC);
+		serviceinternal->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (serviceinternal->epollfd < 0 || serviceinternal->wakefd < 0)
+		{
+			wi::backlog::post("wi::network_Linux error in CreateService: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
+			return false;
+		}
+
+		epoll_event event = {};
+		event.events = EPOLLIN;
+		for (uint32_t i = 0; i <= socket_count; ++i)
+		{
+			event.data.u32 = i;
+			const int fd = i < socket_count ? to_internal(&serviceinternal->sockets[i])->handle : serviceinternal->wakefd;
+			if (epoll_ctl(serviceinternal->epollfd, EPOLL_CTL_ADD, fd, &event) < 0)
+			{
+				wi::backlog::post("wi::network_Linux error in CreateService: (Error Code: " + std::to_string(errno) + ") " + std::string(strerror(errno)));
+				return false;
+			}
+		}
+
+		ServiceInternal* ptr = serviceinternal.get();
+		serviceinternal->thread = std::thread([ptr] { ptr->run(); });
+
+		service->internal_state = serviceinternal;
+		return true;
+	}
+
+	Packet* ServiceAllocatePacket(const Service* service)
+	{
+		if (service->IsValid())
+		{
+			auto serviceinternal = to_internal(service);
+			uint32_t index;
+			if (serviceinternal->freelist.pop(index))
+			{
+				Packet& packet = serviceinternal->packets[index];
+				packet.connection = {};
+				packet.size = 0;
+				return &packet;
+			}
+		}
+		return nullptr;
+	}
+
+	bool ServiceSend(const Service* service, uint32_t socket_index, Packet* packet)
+	{
+		if (service->IsValid())
+		{
+			auto serviceinternal = to_internal(service);
+			assert(socket_index < serviceinternal->sockets.size());
+			const uint32_t index = serviceinternal->index_of(packet);
+			serviceinternal->packet_sockets[index] = socket_index;
+			if (!serviceinternal->sendqueue.push(index))
+				return false;
+
+			// Only the first packet after the I/O thread woke up needs to signal it:
+			if (!serviceinternal->wake_pending.exchange(true))
+			{
+				serviceinternal->wake();
+			}
+			return true;
+		}
+		return false;
+	}
+
+	Packet* ServiceReceive(const Service* service, uint32_t socket_index)
+	{
+		if (service->IsValid())
+		{
+			auto serviceinternal = to_internal(service);
+			assert(socket_index < serviceinternal->sockets.size());
+			uint32_t index;
+			if (serviceinternal->received[socket_index].pop(index))
+			{
+				return &serviceinternal->packets[index];
+			}
+		}
+		return nullptr;
+	}
+
+	void ServiceFreePacket(const Service* service, Packet* packet)
+	{
+		if (service->IsValid() && packet != nullptr)
+		{
+			auto serviceinternal = to_internal(service);
+			serviceinternal->release(serviceinternal->index_of(packet));
+		}
+	}
+
+	ServiceStats GetServiceStats(const Service* service)
+	{
+		ServiceStats stats;
+		if (service->IsValid())
+		{
+			auto serviceinternal = to_internal(service);
+			stats.received_packets = serviceinternal->received_packets.load(std::memory_order_relaxed);
+			stats.received_bytes = serviceinternal->received_bytes.load(std::memory_order_relaxed);
+			stats.sent_packets = serviceinternal->sent_packets.load(std::memory_order_relaxed);
+			stats.sent_bytes = serviceinternal->sent_bytes.load(std::memory_order_relaxed);
+			stats.dropped_packets = serviceinternal->dropped_packets.load(std::memory_order_relaxed);
+			stats.syscalls = serviceinternal->syscalls.load(std::memory_order_relaxed);
+		}
+		return stats;
+	}
 }
 
 #endif // LINUX
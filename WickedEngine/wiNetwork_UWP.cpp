@@ -35,6 +35,48 @@ namespace wi::network
 		return false;
 	}
 
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count, BatchStats* stats)
+	{
+		if (stats != nullptr)
+		{
+			*stats = {};
+		}
+		return 0;
+	}
+
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count, BatchStats* stats)
+	{
+		if (stats != nullptr)
+		{
+			*stats = {};
+		}
+		return 0;
+	}
+
+	bool CreateService(Service* service, const Socket* sockets, uint32_t socket_count, const ServiceDesc& desc)
+	{
+		return false;
+	}
+	Packet* ServiceAllocatePacket(const Service* service)
+	{
+		return nullptr;
+	}
+	bool ServiceSend(const Service* service, uint32_t socket_index, Packet* packet)
+	{
+		return false;
+	}
+	Packet* ServiceReceive(const Service* service, uint32_t socket_index)
+	{
+		return nullptr;
+	}
+	void ServiceFreePacket(const Service* service, Packet* packet)
+	{
+	}
+	ServiceStats GetServiceStats(const Service* service)
+	{
+		return {};
+	}
+
 }
 
 #endif // _WIN32 && PLATFORM_UWP
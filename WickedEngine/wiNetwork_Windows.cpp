@@ -184,6 +184,97 @@ namespace wi::network
 		return false;
 	}
 
+	// Winsock has no batched datagram calls, so the batches are sent and received one packet at a time
+	size_t SendBatch(const Socket* sock, const Packet* packets, size_t count, BatchStats* stats)
+	{
+		BatchStats result_stats;
+		for (size_t i = 0; i < count; ++i)
+		{
+			result_stats.syscalls++;
+			if (!Send(sock, &packets[i].connection, packets[i].data, packets[i].size))
+				break;
+			result_stats.packets++;
+			result_stats.bytes += packets[i].size;
+		}
+		if (stats != nullptr)
+		{
+			*stats = result_stats;
+		}
+		return result_stats.packets;
+	}
+
+	size_t ReceiveBatch(const Socket* sock, Packet* packets, size_t count, BatchStats* stats)
+	{
+		BatchStats result_stats;
+		if (sock != nullptr && sock->IsValid())
+		{
+			auto socketinternal = to_internal(sock);
+
+			for (size_t i = 0; i < count; ++i)
+			{
+				result_stats.syscalls++;
+				if (!CanReceive(sock, 0))
+					break;
+
+				Packet& packet = packets[i];
+				sockaddr_in sender;
+				int targetsize = sizeof(sender);
+				result_stats.syscalls++;
+				int result = recvfrom(socketinternal->handle, (char*)packet.data, (int)packet.capacity, 0, (sockaddr*)&sender, &targetsize);
+				if (result == SOCKET_ERROR)
+				{
+					int error = WSAGetLastError();
+					if (error != WSAEMSGSIZE) // truncated packet
+					{
+						wi::backlog::post("wi::network error in ReceiveBatch: " + std::to_string(error));
+						break;
+					}
+					result = (int)packet.capacity;
+				}
+
+				packet.size = (size_t)result;
+				packet.connection.port = htons(sender.sin_port); // reverse byte order from network to host
+				packet.connection.ipaddress[0] = sender.sin_addr.S_un.S_un_b.s_b1;
+				packet.connection.ipaddress[1] = sender.sin_addr.S_un.S_un_b.s_b2;
+				packet.connection.ipaddress[2] = sender.sin_addr.S_un.S_un_b.s_b3;
+				packet.connection.ipaddress[3] = sender.sin_addr.S_un.S_un_b.s_b4;
+				result_stats.packets++;
+				result_stats.bytes += packet.size;
+			}
+		}
+		if (stats != nullptr)
+		{
+			*stats = result_stats;
+		}
+		return result_stats.packets;
+	}
+
+	// The I/O service is implemented with epoll, it is not available on this platform
+	bool CreateService(Service* service, const Socket* sockets, uint32_t socket_count, const ServiceDesc& desc)
+	{
+		wi::backlog::post("wi::network error in CreateService: network I/O service is not supported on this platform");
+		return false;
+	}
+	Packet* ServiceAllocatePacket(const Service* service)
+	{
+		return nullptr;
+	}
+	bool ServiceSend(const Service* service, uint32_t socket_index, Packet* packet)
+	{
+		return false;
+	}
+	Packet* ServiceReceive(const Service* service, uint32_t socket_index)
+	{
+		return nullptr;
+	}
+	void ServiceFreePacket(const Service* service, Packet* packet)
+	{
+	}
+	ServiceStats GetServiceStats(const Service* service)
+	{
+		return {};
+	}
+
 }
 
 #endif // _WIN32 && !PLATFORM_UWP
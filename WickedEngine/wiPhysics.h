@@ -25,16 +25,88 @@ namespace wi::physics
 	//	This value corresponds to maximum simulation step count
 	//	Higher values will be slower but more accurate
 	//	Default is 10
+	//	It is not used when fixed timestep is enabled
 	void SetAccuracy(int value);
 	int GetAccuracy();
 
+	// Enable/disable fixed timestep simulation
+	//	The frame time is accumulated and simulated in steps of constant length, so the results don't depend on the frame rate
+	//	Rigid body transforms will be interpolated between the last two simulated states
+	//	Default is disabled
+	void SetFixedTimestepEnabled(bool value);
+	bool IsFixedTimestepEnabled();
+
+	// Set the number of fixed timesteps per second
+	//	Default is 60
+	void SetFixedTimestepFrequency(float value);
+	float GetFixedTimestepFrequency();
+
+	// Set the maximum number of fixed timesteps that can be simulated in one update
+	//	When the simulation falls behind more than this, the remaining time is dropped and the simulation slows down instead of taking longer
+	//	Default is 4
+	void SetFixedTimestepMaxSteps(int value);
+	int GetFixedTimestepMaxSteps();
+
+	// Enable/disable multithreaded simulation
+	//	Collision detection, motion prediction and constraint solving of separate islands will use the job system
+	//	Default is enabled
+	void SetMultithreadingEnabled(bool value);
+	bool IsMultithreadingEnabled();
+
+	// Limit the number of threads that the simulation can use
+	//	0 means all job system threads (default)
+	void SetThreadCount(uint32_t value);
+	uint32_t GetThreadCount();
+
+	// Set the maximum vertex count of convex hull collision shapes
+	//	Meshes with more vertices will be simplified, this only affects shapes that are created afterwards
+	//	Default is 64
+	void SetConvexHullVertexLimit(uint32_t value);
+	uint32_t GetConvexHullVertexLimit();
+
+	// Set the points of interest of a scene, for example the positions of cameras and players
+	//	Rigid bodies are simulated with level of detail based on the distance to the closest point (see RigidBodyPhysicsComponent::LOD)
+	//	Without interest points, every rigid body is simulated at full rate (default)
+	void SetInterestPoints(wi::scene::Scene& scene, const XMFLOAT3* points, size_t count);
+
+	// Set the distance from interest points after which rigid bodies are simulated at reduced rate
+	//	Default is 100
+	void SetLODReducedDistance(float value);
+	float GetLODReducedDistance();
+
+	// Set the distance from interest points after which rigid bodies are frozen
+	//	Default is 400
+	void SetLODFrozenDistance(float value);
+	float GetLODFrozenDistance();
+
+	// Set how many steps are between two simulation steps of a reduced rate rigid body
+	//	Default is 4
+	void SetLODReducedInterval(uint32_t value);
+	uint32_t GetLODReducedInterval();
+
+	// Rigid body step counts of a scene per level of detail, since its physics world was created
+	//	Bodies that touch each other are in the same simulation island, and they are always stepped together at the most detailed level of the island
+	struct LODStats
+	{
+		uint64_t full_rate_steps = 0;		// steps of full rate and promoted bodies
+		uint64_t reduced_rate_steps = 0;	// longer steps of reduced rate bodies
+		uint64_t skipped_steps = 0;			// steps that reduced rate and frozen bodies slept through
+		uint64_t promotions = 0;			// lower detail bodies that were woken up by contact and promoted to full rate
+	};
+	LODStats GetLODStats(wi::scene::Scene& scene);
+
 	// Update the physics state, run simulation, etc.
+	//	Every scene has its own physics world, so different scenes can be updated in parallel
 	void RunPhysicsUpdateSystem(
 		wi::jobsystem::context& ctx,
 		wi::scene::Scene& scene,
 		float dt
 	);
 
+	// Returns the number of triangles in the collision shape of a TRIANGLE_MESH rigid body
+	//	0 for other shapes, or if the rigid body is not created yet (triangle mesh shapes are built in the background)
+	uint32_t GetCollisionTriangleCount(const wi::scene::RigidBodyPhysicsComponent& physicscomponent);
+
 	// Apply force at body center
 	void ApplyForce(
 		const wi::scene::RigidBodyPhysicsComponent& physicscomponent,
@@ -58,4 +130,99 @@ namespace wi::physics
 		const XMFLOAT3& impulse,
 		const XMFLOAT3& at
 	);
+
+	// Scene queries against the physics shapes of a scene:
+	//	All queries of one call are processed in parallel by the job system
+	//	They must not be called while the physics of the same scene is being updated
+	//	Objects are ignored when they have a LayerComponent that doesn't match the query layerMask
+	//	Soft bodies are not queried
+
+	struct QueryResult
+	{
+		wi::ecs::Entity entity = wi::ecs::INVALID_ENTITY; // INVALID_ENTITY if nothing was hit
+		XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 normal = XMFLOAT3(0, 0, 0);
+		float fraction = 1; // hit position relative to the query distance, 1 if nothing was hit
+	};
+
+	struct RayCastQuery
+	{
+		XMFLOAT3 origin = XMFLOAT3(0, 0, 0);
+		XMFLOAT3 direction = XMFLOAT3(0, 0, 1);
+		float distance = 1000;
+		uint32_t layerMask = ~0u;
+	};
+	// Find the closest hit of rays
+	void RayCast(
+		const wi::scene::Scene& scene,
+		const RayCastQuery* queries,
+		QueryResult* results,
+		size_t count
+	);
+
+	// Shape of sweep and overlap queries
+	struct QueryShape
+	{
+		enum class Type
+		{
+			SPHERE,
+			BOX,
+			CAPSULE,
+		} type = Type::SPHERE;
+		float radius = 0.5f; // SPHERE, CAPSULE
+		float height = 1; // CAPSULE: distance of the two sphere centers along the local Y axis
+		XMFLOAT3 halfextents = XMFLOAT3(0.5f, 0.5f, 0.5f); // BOX
+	};
+
+	struct SphereSweepQuery
+	{
+		XMFLOAT3 origin = XMFLOAT3(0, 0, 0);
+		float radius = 0.5f;
+		XMFLOAT3 direction = XMFLOAT3(0, 0, 1);
+		float distance = 1000;
+		uint32_t layerMask = ~0u;
+	};
+	// Find the first hit of spheres moving along a direction
+	void SphereSweep(
+		const wi::scene::Scene& scene,
+		const SphereSweepQuery* queries,
+		QueryResult* results,
+		size_t count
+	);
+
+	struct ShapeSweepQuery
+	{
+		QueryShape shape;
+		XMFLOAT3 origin = XMFLOAT3(0, 0, 0);
+		XMFLOAT4 rotation = XMFLOAT4(0, 0, 0, 1);
+		XMFLOAT3 direction = XMFLOAT3(0, 0, 1);
+		float distance = 1000;
+		uint32_t layerMask = ~0u;
+	};
+	// Find the first hit of shapes moving along a direction
+	void ShapeSweep(
+		const wi::scene::Scene& scene,
+		const ShapeSweepQuery* queries,
+		QueryResult* results,
+		size_t count
+	);
+
+	struct OverlapQuery
+	{
+		QueryShape shape;
+		XMFLOAT3 position = XMFLOAT3(0, 0, 0);
+		XMFLOAT4 rotation = XMFLOAT4(0, 0, 0, 1);
+		uint32_t layerMask = ~0u;
+	};
+	struct OverlapResult
+	{
+		wi::vector<wi::ecs::Entity> entities; // rigid bodies that intersect the shape
+	};
+	// Find the rigid bodies that intersect shapes
+	void Overlap(
+		const wi::scene::Scene& scene,
+		const OverlapQuery* queries,
+		OverlapResult* results,
+		size_t count
+	);
 }
@@ -5,15 +5,23 @@
 #include "wiJobSystem.h"
 #include "wiRenderer.h"
 #include "wiTimer.h"
+#include "wiSpinLock.h"
+#include "wiVector.h"
+#include "wiUnorderedMap.h"
+#include "wiHelper.h"
 
 #include "btBulletDynamicsCommon.h"
 #include "BulletSoftBody/btSoftBodyHelpers.h"
 #include "BulletSoftBody/btDefaultSoftBodySolver.h"
 #include "BulletSoftBody/btSoftRigidDynamicsWorld.h"
 #include "BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h"
+#include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h"
 
 #include <mutex>
 #include <memory>
+#include <algorithm>
+#include <atomic>
 
 using namespace wi::ecs;
 using namespace wi::scene;
@@ -24,15 +32,563 @@ namespace wi::physics
 	bool SIMULATION_ENABLED = true;
 	bool DEBUGDRAW_ENABLED = false;
 	int ACCURACY = 10;
-	std::mutex physicsLock;
+	bool MULTITHREADING_ENABLED = true;
+	uint32_t THREAD_COUNT = 0;
+	uint32_t CONVEX_HULL_VERTEX_LIMIT = 64;
+	const uint32_t SOFTBODY_GRAIN_SIZE = 1024; // vertex and triangle count per soft body write-back job
+	bool FIXED_TIMESTEP_ENABLED = false;
+	float FIXED_TIMESTEP_FREQUENCY = 60;
+	int FIXED_TIMESTEP_MAX_STEPS = 4;
+	float LOD_DISTANCE_REDUCED = 100;
+	float LOD_DISTANCE_FROZEN = 400;
+	uint32_t LOD_REDUCED_INTERVAL = 4;
+	const uint32_t LOD_PROMOTION_STEPS = 60; // full rate steps of lower detail bodies after they were woken up by contact
+	const float SHAPE_SCALE_STEPS = 64; // cached shapes of rescaled kinematic bodies are created for scales rounded to 1/64 octave steps (about 1%)
+	std::mutex debugDrawLock;
+
+	// Splits [0, count) into at most the allowed thread count of ranges and runs them on the job system
+	//	This is what btITaskScheduler::parallelFor() does in newer Bullet versions, which are not used here
+	//	It runs inline when multithreading is disabled or there is not enough work
+	template<typename F>
+	void ParallelFor(uint32_t count, uint32_t grainSize, const F& body)
+	{
+		const uint32_t threadCount = GetThreadCount();
+		if (!IsMultithreadingEnabled() || threadCount <= 1 || count <= grainSize)
+		{
+			body(0, count);
+			return;
+		}
+		const uint32_t rangeCount = std::min(threadCount, (count + grainSize - 1) / grainSize);
+		const uint32_t rangeSize = (count + rangeCount - 1) / rangeCount;
+		wi::jobsystem::context ctx;
+		wi::jobsystem::Dispatch(ctx, rangeCount, 1, [&](wi::jobsystem::JobArgs args) {
+			const uint32_t begin = args.jobIndex * rangeSize;
+			const uint32_t end = std::min(begin + rangeSize, count);
+			if (begin < end)
+			{
+				body(begin, end);
+			}
+		});
+		wi::jobsystem::Wait(ctx);
+	}
+
+	// Same as ParallelFor, but the ranges are added to a context without waiting, so that multiple loops can run at the same time
+	template<typename F>
+	void ParallelForAsync(wi::jobsystem::context& ctx, uint32_t count, uint32_t grainSize, const F& body)
+	{
+		const uint32_t threadCount = GetThreadCount();
+		if (!IsMultithreadingEnabled() || threadCount <= 1 || count <= grainSize)
+		{
+			body(0, count);
+			return;
+		}
+		const uint32_t rangeCount = std::min(threadCount, (count + grainSize - 1) / grainSize);
+		const uint32_t rangeSize = (count + rangeCount - 1) / rangeCount;
+		wi::jobsystem::Dispatch(ctx, rangeCount, 1, [=](wi::jobsystem::JobArgs args) {
+			const uint32_t begin = args.jobIndex * rangeSize;
+			const uint32_t end = std::min(begin + rangeSize, count);
+			if (begin < end)
+			{
+				body(begin, end);
+			}
+		});
+	}
+
+	// Collision dispatcher that runs the narrow phase of overlapping pairs in parallel
+	//	Manifold and collision algorithm pools are shared, so they are locked
+	//	Pairs that involve soft bodies are processed serially, because soft body collision writes into the soft body
+	class CollisionDispatcher : public btCollisionDispatcher
+	{
+		wi::SpinLock locker;
+
+		static bool IsSoftBodyPair(const btBroadphasePair& pair)
+		{
+			const btCollisionObject* obj0 = (const btCollisionObject*)pair.m_pProxy0->m_clientObject;
+			const btCollisionObject* obj1 = (const btCollisionObject*)pair.m_pProxy1->m_clientObject;
+			return btSoftBody::upcast(obj0) != nullptr || btSoftBody::upcast(obj1) != nullptr;
+		}
+
+	public:
+		using btCollisionDispatcher::btCollisionDispatcher;
+
+		btPersistentManifold* getNewManifold(const btCollisionObject* b0, const btCollisionObject* b1) override
+		{
+			locker.lock();
+			btPersistentManifold* manifold = btCollisionDispatcher::getNewManifold(b0, b1);
+			locker.unlock();
+			return manifold;
+		}
+		void releaseManifold(btPersistentManifold* manifold) override
+		{
+			locker.lock();
+			btCollisionDispatcher::releaseManifold(manifold);
+			locker.unlock();
+		}
+		void* allocateCollisionAlgorithm(int size) override
+		{
+			locker.lock();
+			void* ptr = btCollisionDispatcher::allocateCollisionAlgorithm(size);
+			locker.unlock();
+			return ptr;
+		}
+		void freeCollisionAlgorithm(void* ptr) override
+		{
+			locker.lock();
+			btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+			locker.unlock();
+		}
+
+		void dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo, btDispatcher* dispatcher) override
+		{
+			const uint32_t pairCount = (uint32_t)pairCache->getNumOverlappingPairs();
+			if (!IsMultithreadingEnabled() || pairCount == 0)
+			{
+				btCollisionDispatcher::dispatchAllCollisionPairs(pairCache, dispatchInfo, dispatcher);
+				return;
+			}
+
+			BT_PROFILE("dispatchAllCollisionPairs");
+			btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+			btNearCallback nearCallback = getNearCallback();
+
+			ParallelFor(pairCount, 64, [&](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					if (!IsSoftBodyPair(pairs[i]))
+					{
+						nearCallback(pairs[i], *this, dispatchInfo);
+					}
+				}
+			});
+
+			for (uint32_t i = 0; i < pairCount; ++i)
+			{
+				if (IsSoftBodyPair(pairs[i]))
+				{
+					nearCallback(pairs[i], *this, dispatchInfo);
+				}
+			}
+		}
+	};
+
+	// Rigid body that also stores the transform before the last simulation step, for fixed timestep interpolation
+	//	The motion state is part of the body, the construction info must not contain a motion state
+	struct RigidBody : public btRigidBody
+	{
+		btTransform previousTransform;
+		btDefaultMotionState motionState;
+
+		// Level of detail state, it is managed by DynamicsWorld in every step:
+		RigidBodyPhysicsComponent::LOD lod = RigidBodyPhysicsComponent::LOD_FULL_RATE;
+		uint32_t lod_promotion = 0; // remaining steps of full rate simulation after the body was woken up by contact
+		int lod_activation = 0; // activation state before the body was put to sleep for the step
+		bool lod_sleeping = false;
+		float lod_scale = 1; // time scale of a reduced rate step
+		btVector3 lod_force = btVector3(0, 0, 0); // extra gravity force of a reduced rate step
+
+		RigidBody(const btRigidBodyConstructionInfo& info) : btRigidBody(info), motionState(info.m_startWorldTransform)
+		{
+			setMotionState(&motionState);
+			previousTransform = getWorldTransform();
+		}
+	};
+
+	// Dynamics world that solves simulation islands and predicts rigid body motion in parallel
+	//	Islands are merged into batches that are solved by separate constraint solvers
+	//	Every island that touches a kinematic body is put into the same batch, because the solver writes into kinematic bodies
+	class DynamicsWorld : public btSoftRigidDynamicsWorld
+	{
+		btSoftBodySolver* softBodySolver = nullptr;
+
+		struct Batch
+		{
+			btAlignedObjectArray<btCollisionObject*> bodies;
+			btAlignedObjectArray<btPersistentManifold*> manifolds;
+			btAlignedObjectArray<btTypedConstraint*> constraints;
+
+			void clear()
+			{
+				bodies.resize(0);
+				manifolds.resize(0);
+				constraints.resize(0);
+			}
+			int cost() const
+			{
+				return manifolds.size() + constraints.size();
+			}
+		};
+		wi::vector<Batch> batches; // the first batch is reserved for islands with kinematic bodies
+		uint32_t batchCount = 0;
+
+		wi::vector<std::unique_ptr<btSequentialImpulseConstraintSolver>> solvers;
+		wi::vector<btSequentialImpulseConstraintSolver*> freeSolvers;
+		wi::SpinLock solverLocker;
+
+		btSequentialImpulseConstraintSolver* AcquireSolver()
+		{
+			solverLocker.lock();
+			btSequentialImpulseConstraintSolver* solver = nullptr;
+			if (freeSolvers.empty())
+			{
+				solvers.emplace_back(new btSequentialImpulseConstraintSolver);
+				solver = solvers.back().get();
+			}
+			else
+			{
+				solver = freeSolvers.back();
+				freeSolvers.pop_back();
+			}
+			solverLocker.unlock();
+			return solver;
+		}
+		void ReleaseSolver(btSequentialImpulseConstraintSolver* solver)
+		{
+			solverLocker.lock();
+			freeSolvers.push_back(solver);
+			solverLocker.unlock();
+		}
+
+		static int GetConstraintIslandId(const btTypedConstraint* constraint)
+		{
+			const btCollisionObject& obj0 = constraint->getRigidBodyA();
+			const btCollisionObject& obj1 = constraint->getRigidBodyB();
+			return obj0.getIslandTag() >= 0 ? obj0.getIslandTag() : obj1.getIslandTag();
+		}
+
+		// Collects the islands into batches, the island manager reuses its arrays for every island, so they are copied
+		struct IslandCollector : public btSimulationIslandManager::IslandCallback
+		{
+			DynamicsWorld* world = nullptr;
+			int minimumBatchCost = 0;
+			int constraintCursor = 0; // constraints are sorted by island id, and islands are processed in increasing id order
+
+			void processIsland(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifolds, int numManifolds, int islandId) override
+			{
+				const btAlignedObjectArray<btTypedConstraint*>& constraints = world->m_sortedConstraints;
+				while (constraintCursor < constraints.size() && GetConstraintIslandId(constraints[constraintCursor]) < islandId)
+				{
+					constraintCursor++;
+				}
+				const int constraintBegin = constraintCursor;
+				while (constraintCursor < constraints.size() && GetConstraintIslandId(constraints[constraintCursor]) == islandId)
+				{
+					constraintCursor++;
+				}
+
+				bool kinematic = false;
+				for (int i = 0; i < numManifolds && !kinematic; ++i)
+				{
+					kinematic = manifolds[i]->getBody0()->isKinematicObject() || manifolds[i]->getBody1()->isKinematicObject();
+				}
+				for (int i = constraintBegin; i < constraintCursor && !kinematic; ++i)
+				{
+					kinematic = constraints[i]->getRigidBodyA().isKinematicObject() || constraints[i]->getRigidBodyB().isKinematicObject();
+				}
+
+				uint32_t batchIndex = 0;
+				if (!kinematic)
+				{
+					if (world->batchCount < 2 || world->batches[world->batchCount - 1].cost() >= minimumBatchCost)
+					{
+						if (world->batches.size() <= world->batchCount)
+						{
+							world->batches.emplace_back();
+						}
+						world->batches[world->batchCount].clear();
+						world->batchCount++;
+					}
+					batchIndex = world->batchCount - 1;
+				}
+
+				Batch& batch = world->batches[batchIndex];
+				for (int i = 0; i < numBodies; ++i)
+				{
+					batch.bodies.push_back(bodies[i]);
+				}
+				for (int i = 0; i < numManifolds; ++i)
+				{
+					batch.manifolds.push_back(manifolds[i]);
+				}
+				for (int i = constraintBegin; i < constraintCursor; ++i)
+				{
+					batch.constraints.push_back(constraints[i]);
+				}
+			}
+		};
+
+	protected:
+
+		void predictUnconstraintMotion(btScalar timeStep) override
+		{
+			if (!IsMultithreadingEnabled())
+			{
+				btSoftRigidDynamicsWorld::predictUnconstraintMotion(timeStep);
+				return;
+			}
+
+			{
+				BT_PROFILE("predictUnconstraintMotion");
+				ParallelFor((uint32_t)m_nonStaticRigidBodies.size(), 256, [&](uint32_t begin, uint32_t end) {
+					for (uint32_t i = begin; i < end; ++i)
+					{
+						btRigidBody* body = m_nonStaticRigidBodies[i];
+						if (!body->isStaticOrKinematicObject())
+						{
+							body->applyDamping(timeStep);
+							body->predictIntegratedTransform(timeStep, body->getInterpolationWorldTransform());
+						}
+					}
+				});
+			}
+			{
+				BT_PROFILE("predictUnconstraintMotionSoftBody");
+				softBodySolver->predictMotion(timeStep);
+			}
+		}
+
+		void solveConstraints(btContactSolverInfo& solverInfo) override
+		{
+			if (!IsMultithreadingEnabled() || !m_islandManager->getSplitIslands())
+			{
+				btSoftRigidDynamicsWorld::solveConstraints(solverInfo);
+				return;
+			}
+
+			BT_PROFILE("solveConstraints");
+
+			m_sortedConstraints.resize(m_constraints.size());
+			for (int i = 0; i < m_constraints.size(); ++i)
+			{
+				m_sortedConstraints[i] = m_constraints[i];
+			}
+			m_sortedConstraints.quickSort([](const btTypedConstraint* lhs, const btTypedConstraint* rhs) {
+				return GetConstraintIslandId(lhs) < GetConstraintIslandId(rhs);
+			});
+
+			if (batches.empty())
+			{
+				batches.emplace_back();
+			}
+			batches[0].clear();
+			batchCount = 1;
+
+			IslandCollector collector;
+			collector.world = this;
+			collector.minimumBatchCost = std::max(1, solverInfo.m_minimumSolverBatchSize);
+			m_islandManager->buildAndProcessIslands(getCollisionWorld()->getDispatcher(), getCollisionWorld(), &collector);
+
+			m_constraintSolver->prepareSolve(getCollisionWorld()->getNumCollisionObjects(), getCollisionWorld()->getDispatcher()->getNumManifolds());
+
+			btDispatcher* dispatcher = getCollisionWorld()->getDispatcher();
+			ParallelFor(batchCount, 1, [&](uint32_t begin, uint32_t end) {
+				btSequentialImpulseConstraintSolver* solver = AcquireSolver();
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					Batch& batch = batches[i];
+					if (batch.bodies.size() == 0 && batch.constraints.size() == 0)
+						continue;
+					solver->solveGroup(
+						batch.bodies.size() ? &batch.bodies[0] : nullptr, batch.bodies.size(),
+						batch.manifolds.size() ? &batch.manifolds[0] : nullptr, batch.manifolds.size(),
+						batch.constraints.size() ? &batch.constraints[0] : nullptr, batch.constraints.size(),
+						solverInfo, m_debugDrawer, dispatcher
+					);
+				}
+				ReleaseSolver(solver);
+			});
+
+			m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
+		}
+
+		// Level of detail: before every step, bodies that are not simulated in the step are put to sleep
+		//	Reduced rate bodies are simulated in every Nth step only, their velocity is scaled so that they travel the distance of N steps
+		//	Sleeping bodies still collide, and Bullet wakes them when a simulated body touches them; those are promoted to full rate for a while
+		//	The level of detail is applied to whole simulation islands, so that touching bodies are simulated in the same steps and don't wake each other:
+		//	an island uses the most detailed level of its bodies, and the phase of its lowest body index
+		uint32_t lodStep = 0;
+		struct IslandLOD
+		{
+			RigidBodyPhysicsComponent::LOD lod = RigidBodyPhysicsComponent::LOD_FROZEN;
+			uint32_t index = ~0u; // lowest body index, it selects the reduced rate phase
+		};
+		wi::vector<IslandLOD> islandLODs; // indexed by the island tags of the previous step
+
+		void internalSingleStepSimulation(btScalar timeStep) override
+		{
+			const uint32_t interval = std::max(1u, LOD_REDUCED_INTERVAL);
+			const uint32_t phase = lodStep++ % interval;
+
+			// The islands are the ones that Bullet found in the previous step, new contacts join them in the next step:
+			islandLODs.clear();
+			islandLODs.resize(getNumCollisionObjects());
+			for (int i = 0; i < m_nonStaticRigidBodies.size(); ++i)
+			{
+				const RigidBody* body = (const RigidBody*)m_nonStaticRigidBodies[i];
+				const int tag = body->getIslandTag();
+				if (tag < 0 || tag >= (int)islandLODs.size() || body->isStaticOrKinematicObject())
+					continue;
+				IslandLOD& island = islandLODs[tag];
+				island.lod = std::min(island.lod, body->lod_promotion > 0 ? RigidBodyPhysicsComponent::LOD_FULL_RATE : body->lod);
+				island.index = std::min(island.index, uint32_t(body->getUserIndex()));
+			}
+
+			ParallelFor((uint32_t)m_nonStaticRigidBodies.size(), 256, [&](uint32_t begin, uint32_t end) {
+				uint64_t full = 0;
+				uint64_t reduced = 0;
+				uint64_t skipped = 0;
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					RigidBody* body = (RigidBody*)m_nonStaticRigidBodies[i];
+					body->lod_sleeping = false;
+					body->lod_scale = 1;
+					if (body->isStaticOrKinematicObject() || !body->isActive())
+						continue;
+
+					RigidBodyPhysicsComponent::LOD lod = body->lod;
+					uint32_t index = uint32_t(body->getUserIndex());
+					const int tag = body->getIslandTag();
+					if (tag >= 0 && tag < (int)islandLODs.size())
+					{
+						lod = islandLODs[tag].lod;
+						index = islandLODs[tag].index;
+					}
+					if (body->lod_promotion > 0)
+					{
+						body->lod_promotion--;
+						lod = RigidBodyPhysicsComponent::LOD_FULL_RATE;
+					}
+					if (lod == RigidBodyPhysicsComponent::LOD_FULL_RATE)
+					{
+						full++;
+						continue;
+					}
+
+					if (lod == RigidBodyPhysicsComponent::LOD_FROZEN || index % interval != phase)
+					{
+						body->lod_activation = body->getActivationState();
+						body->forceActivationState(ISLAND_SLEEPING);
+						body->lod_sleeping = true;
+						skipped++;
+					}
+					else if (interval > 1)
+					{
+						// The body covers the time of the whole interval in this step, gravity is scaled by the square to reach the same velocity change:
+						body->lod_scale = float(interval);
+						body->setLinearVelocity(body->getLinearVelocity() * body->lod_scale);
+						body->setAngularVelocity(body->getAngularVelocity() * body->lod_scale);
+						body->lod_force = body->getGravity() * ((body->lod_scale * body->lod_scale - 1) / body->getInvMass());
+						body->applyCentralForce(body->lod_force);
+						reduced++;
+					}
+					else
+					{
+						reduced++;
+					}
+				}
+				lodFullRateSteps.fetch_add(full, std::memory_order_relaxed);
+				lodReducedRateSteps.fetch_add(reduced, std::memory_order_relaxed);
+				lodSkippedSteps.fetch_add(skipped, std::memory_order_relaxed);
+			});
+
+			btSoftRigidDynamicsWorld::internalSingleStepSimulation(timeStep);
+
+			ParallelFor((uint32_t)m_nonStaticRigidBodies.size(), 256, [&](uint32_t begin, uint32_t end) {
+				uint64_t promotions = 0;
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					RigidBody* body = (RigidBody*)m_nonStaticRigidBodies[i];
+					if (body->lod_sleeping)
+					{
+						if (body->getActivationState() != ISLAND_SLEEPING)
+						{
+							// Woken up by contact with a simulated body:
+							body->lod_promotion = LOD_PROMOTION_STEPS;
+							promotions++;
+						}
+						body->forceActivationState(body->lod_activation);
+						body->lod_sleeping = false;
+					}
+					if (body->lod_scale != 1)
+					{
+						body->setLinearVelocity(body->getLinearVelocity() / body->lod_scale);
+						body->setAngularVelocity(body->getAngularVelocity() / body->lod_scale);
+						body->applyCentralForce(-body->lod_force);
+						body->lod_scale = 1;
+					}
+				}
+				lodPromotions.fetch_add(promotions, std::memory_order_relaxed);
+			});
+		}
+
+	public:
+		// Rigid body steps per level of detail since the world was created:
+		std::atomic<uint64_t> lodFullRateSteps{ 0 };
+		std::atomic<uint64_t> lodReducedRateSteps{ 0 };
+		std::atomic<uint64_t> lodSkippedSteps{ 0 };
+		std::atomic<uint64_t> lodPromotions{ 0 };
+
+		DynamicsWorld(btDispatcher* dispatcher, btBroadphaseInterface* pairCache, btConstraintSolver* constraintSolver, btCollisionConfiguration* collisionConfiguration, btSoftBodySolver* softBodySolver)
+			: btSoftRigidDynamicsWorld(dispatcher, pairCache, constraintSolver, collisionConfiguration, softBodySolver)
+			, softBodySolver(softBodySolver)
+		{
+		}
+
+		// Adds multiple rigid bodies, the collision object arrays are grown only once
+		void addRigidBodies(btRigidBody* const* bodies, int count)
+		{
+			m_collisionObjects.reserve(m_collisionObjects.size() + count);
+			m_nonStaticRigidBodies.reserve(m_nonStaticRigidBodies.size() + count);
+			for (int i = 0; i < count; ++i)
+			{
+				addRigidBody(bodies[i]);
+			}
+		}
+	};
 
 	btVector3 gravity(0, -10, 0);
 	int softbodyIterationCount = 5;
-	btSoftBodyRigidBodyCollisionConfiguration collisionConfiguration;
-	btDbvtBroadphase overlappingPairCache;
-	btSequentialImpulseConstraintSolver solver;
-	btCollisionDispatcher dispatcher(&collisionConfiguration);
-	btSoftRigidDynamicsWorld dynamicsWorld(&dispatcher, &overlappingPairCache, &solver, &collisionConfiguration);
+
+	// Memory of rigid bodies is allocated in blocks and reused, so that spawning many bodies doesn't go to the global allocator for each of them
+	//	A slot also has room for a box, sphere or capsule shape that is owned by the body
+	class RigidBodyPool
+	{
+	public:
+		static constexpr size_t SHAPE_SIZE = std::max({ sizeof(btBoxShape), sizeof(btSphereShape), sizeof(btCapsuleShape) });
+		struct Slot
+		{
+			alignas(16) uint8_t body[sizeof(RigidBody)]; // must be the first member, the slot and the body have the same address
+			alignas(16) uint8_t shape[SHAPE_SIZE];
+		};
+
+		Slot* Allocate()
+		{
+			locker.lock();
+			if (freelist.empty())
+			{
+				blocks.emplace_back(new Slot[BLOCK_SIZE]);
+				for (size_t i = BLOCK_SIZE; i > 0; --i)
+				{
+					freelist.push_back(&blocks.back()[i - 1]);
+				}
+			}
+			Slot* slot = freelist.back();
+			freelist.pop_back();
+			locker.unlock();
+			return slot;
+		}
+		void Free(Slot* slot)
+		{
+			locker.lock();
+			freelist.push_back(slot);
+			locker.unlock();
+		}
+
+	private:
+		static constexpr size_t BLOCK_SIZE = 256;
+		wi::vector<std::unique_ptr<Slot[]>> blocks;
+		wi::vector<Slot*> freelist;
+		wi::SpinLock locker;
+	};
 
 	class DebugDraw : public btIDebugDraw
 	{
@@ -44,44 +600,383 @@ namespace wi::physics
 			line.color_start = line.color_end = XMFLOAT4(color.x(), color.y(), color.z(), 1.0f);
 			wi::renderer::DrawLine(line);
 		}
-		void drawContactPoint(const btVector3& PointOnB, const btVector3& normalOnB, btScalar distance, int lifeTime, const btVector3& color) override
+		void drawContactPoint(const btVector3& PointOnB, const btVector3& normalOnB, btScalar distance, int lifeTime, const btVector3& color) override
+		{
+		}
+		void reportErrorWarning(const char* warningString) override
+		{
+			wi::backlog::post(warningString);
+		}
+		void draw3dText(const btVector3& location, const char* textString) override
+		{
+		}
+		void setDebugMode(int debugMode) override
+		{
+		}
+		int getDebugMode() const override
+		{
+			return DBG_DrawWireframe;
+		}
+	};
+	DebugDraw debugDraw;
+
+	// Collision shapes that are created from meshes are shared by the rigid bodies that use the same mesh, shape type and scale
+	//	Convex hulls are simplified to a limited number of vertices
+	//	Triangle mesh BVHs are built by background jobs and shared between all scales, acquiring them returns nullptr until they are ready
+	struct ShapeCache
+	{
+		// Data that only depends on the mesh and shape type
+		struct MeshShape
+		{
+			Entity meshID = INVALID_ENTITY;
+			RigidBodyPhysicsComponent::CollisionShape type = RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL;
+			uint32_t refcount = 0; // number of scaled shapes that use it
+			btAlignedObjectArray<btVector3> vertices; // simplified hull vertices, or all vertices for triangle mesh
+			btAlignedObjectArray<int> indices;
+			btTriangleIndexVertexArray* triangles = nullptr;
+			btBvhTriangleMeshShape* bvh = nullptr;
+			std::atomic<bool> ready{ false };
+		};
+		// Shape that is referenced by rigid bodies, its user pointer refers to this
+		struct Shape
+		{
+			size_t hash = 0;
+			size_t mesh_hash = 0;
+			MeshShape* mesh_shape = nullptr;
+			XMFLOAT3 scale = XMFLOAT3(1, 1, 1);
+			btCollisionShape* shape = nullptr;
+			uint32_t refcount = 0; // number of rigid bodies that use it
+		};
+		// Entries are bucketed by hash, but they are matched by their mesh, shape type and scale, so that a hash collision can't return the shape of an other mesh:
+		wi::unordered_map<size_t, wi::vector<std::unique_ptr<MeshShape>>> mesh_shapes;
+		wi::unordered_map<size_t, wi::vector<std::unique_ptr<Shape>>> shapes;
+		wi::jobsystem::context ctx; // background BVH builds
+
+		ShapeCache()
+		{
+			ctx.priority = wi::jobsystem::Priority::Low;
+		}
+		~ShapeCache()
+		{
+			wi::jobsystem::Wait(ctx);
+			for (auto& bucket : shapes)
+			{
+				for (auto& x : bucket.second)
+				{
+					delete x->shape;
+				}
+			}
+			for (auto& bucket : mesh_shapes)
+			{
+				for (auto& x : bucket.second)
+				{
+					delete x->bvh;
+					delete x->triangles;
+				}
+			}
+		}
+
+		static size_t MeshHash(Entity meshID, RigidBodyPhysicsComponent::CollisionShape type)
+		{
+			size_t hash = 0;
+			wi::helper::hash_combine(hash, meshID);
+			wi::helper::hash_combine(hash, (int)type);
+			return hash;
+		}
+
+		// Returns a shape with one more reference, or nullptr if it can't be created yet
+		btCollisionShape* Acquire(Entity meshID, const MeshComponent& mesh, RigidBodyPhysicsComponent::CollisionShape type, const XMFLOAT3& scale)
+		{
+			const size_t mesh_hash = MeshHash(meshID, type);
+			size_t hash = mesh_hash;
+			wi::helper::hash_combine(hash, scale.x);
+			wi::helper::hash_combine(hash, scale.y);
+			wi::helper::hash_combine(hash, scale.z);
+
+			auto it = shapes.find(hash);
+			if (it != shapes.end())
+			{
+				for (auto& x : it->second)
+				{
+					if (x->mesh_shape->meshID == meshID && x->mesh_shape->type == type && x->scale.x == scale.x && x->scale.y == scale.y && x->scale.z == scale.z)
+					{
+						x->refcount++;
+						return x->shape;
+					}
+				}
+			}
+
+			MeshShape* mesh_shape = nullptr;
+			wi::vector<std::unique_ptr<MeshShape>>& mesh_bucket = mesh_shapes[mesh_hash];
+			for (auto& x : mesh_bucket)
+			{
+				if (x->meshID == meshID && x->type == type)
+				{
+					mesh_shape = x.get();
+					break;
+				}
+			}
+			if (mesh_shape == nullptr)
+			{
+				mesh_shape = mesh_bucket.emplace_back(std::make_unique<MeshShape>()).get();
+				mesh_shape->meshID = meshID;
+				mesh_shape->type = type;
+
+				btAlignedObjectArray<btVector3>& vertices = mesh_shape->vertices;
+				vertices.resize((int)mesh.vertex_positions.size());
+				for (size_t i = 0; i < mesh.vertex_positions.size(); ++i)
+				{
+					const XMFLOAT3& pos = mesh.vertex_positions[i];
+					vertices[(int)i] = btVector3(pos.x, pos.y, pos.z);
+				}
+
+				if (type == RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL)
+				{
+					const int limit = (int)std::max(4u, CONVEX_HULL_VERTEX_LIMIT);
+					if (vertices.size() > limit)
+					{
+						// Keep the extreme vertices in evenly distributed directions (fibonacci sphere):
+						wi::vector<bool> used(vertices.size());
+						btAlignedObjectArray<btVector3> hull;
+						for (int i = 0; i < limit; ++i)
+						{
+							const float y = 1 - (i + 0.5f) / limit * 2;
+							const float r = std::sqrt(1 - y * y);
+							const float phi = i * XM_PI * (3 - std::sqrt(5.0f));
+							const btVector3 dir(std::cos(phi) * r, y, std::sin(phi) * r);
+							btScalar dot;
+							const long index = dir.maxDot(&vertices[0], vertices.size(), dot);
+							if (index >= 0 && !used[index])
+							{
+								used[index] = true;
+								hull.push_back(vertices[index]);
+							}
+						}
+						vertices = hull;
+					}
+					mesh_shape->ready.store(true);
+				}
+				else
+				{
+					// The simplified LOD triangles are not part of the collision shape:
+					btAlignedObjectArray<int>& indices = mesh_shape->indices;
+					const uint32_t index_count = mesh.GetFullDetailIndexCount();
+					indices.resize((int)index_count);
+					for (uint32_t i = 0; i < index_count; ++i)
+					{
+						indices[(int)i] = (int)mesh.indices[i];
+					}
+
+					MeshShape* data = mesh_shape;
+					wi::jobsystem::Execute(ctx, [data](wi::jobsystem::JobArgs args) {
+						data->triangles = new btTriangleIndexVertexArray(
+							data->indices.size() / 3,
+							data->indices.size() > 0 ? &data->indices[0] : nullptr,
+							3 * sizeof(int),
+							data->vertices.size(),
+							data->vertices.size() > 0 ? (btScalar*)&data->vertices[0].x() : nullptr,
+							sizeof(btVector3)
+						);
+						bool useQuantizedAabbCompression = true;
+						data->bvh = new btBvhTriangleMeshShape(data->triangles, useQuantizedAabbCompression);
+						data->ready.store(true);
+					});
+				}
+			}
+			if (!mesh_shape->ready.load())
+			{
+				return nullptr;
+			}
+
+			btCollisionShape* shape = nullptr;
+			const btVector3 S(scale.x, scale.y, scale.z);
+			if (type == RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL)
+			{
+				btConvexHullShape* hull = new btConvexHullShape();
+				for (int i = 0; i < mesh_shape->vertices.size(); ++i)
+				{
+					hull->addPoint(mesh_shape->vertices[i], false);
+				}
+				hull->recalcLocalAabb();
+				hull->setLocalScaling(S);
+				shape = hull;
+			}
+			else
+			{
+				shape = new btScaledBvhTriangleMeshShape(mesh_shape->bvh, S);
+			}
+			mesh_shape->refcount++;
+
+			Shape* entry = shapes[hash].emplace_back(std::make_unique<Shape>()).get();
+			entry->hash = hash;
+			entry->mesh_hash = mesh_hash;
+			entry->mesh_shape = mesh_shape;
+			entry->scale = scale;
+			entry->shape = shape;
+			entry->refcount = 1;
+			shape->setUserPointer(entry);
+			return shape;
+		}
+
+		// Removes a reference from a shape that was returned by Acquire()
+		void Release(btCollisionShape* shape)
+		{
+			Shape* entry = (Shape*)shape->getUserPointer();
+			assert(entry != nullptr && entry->shape == shape);
+			if (--entry->refcount > 0)
+				return;
+
+			const size_t mesh_hash = entry->mesh_hash;
+			MeshShape* mesh_shape = entry->mesh_shape;
+			delete entry->shape;
+			remove_entry(shapes, entry->hash, entry);
+
+			if (--mesh_shape->refcount == 0)
+			{
+				delete mesh_shape->bvh;
+				delete mesh_shape->triangles;
+				remove_entry(mesh_shapes, mesh_hash, mesh_shape);
+			}
+		}
+
+		template<typename T>
+		static void remove_entry(wi::unordered_map<size_t, wi::vector<std::unique_ptr<T>>>& map, size_t hash, const T* entry)
+		{
+			auto it = map.find(hash);
+			if (it == map.end())
+				return;
+			wi::vector<std::unique_ptr<T>>& bucket = it->second;
+			for (size_t i = 0; i < bucket.size(); ++i)
+			{
+				if (bucket[i].get() == entry)
+				{
+					bucket[i] = std::move(bucket.back());
+					bucket.pop_back();
+					break;
+				}
+			}
+			if (bucket.empty())
+			{
+				map.erase(it);
+			}
+		}
+
+		// Returns whether the shape was created by Acquire() and can be shared
+		static bool IsCached(const btCollisionShape* shape)
+		{
+			return shape->getUserPointer() != nullptr;
+		}
+		static const XMFLOAT3 GetScale(const btCollisionShape* shape)
 		{
+			const btVector3& S = shape->getLocalScaling();
+			return XMFLOAT3(S.x(), S.y(), S.z());
 		}
-		void reportErrorWarning(const char* warningString) override
+		// Rounds a scale to logarithmic steps, so that an animated scale doesn't create a new shape in every frame
+		static XMFLOAT3 QuantizeScale(const XMFLOAT3& scale)
 		{
-			wi::backlog::post(warningString);
+			auto quantize = [](float x) {
+				if (x == 0)
+					return 0.0f;
+				const float steps = std::round(std::log2(std::abs(x)) * SHAPE_SCALE_STEPS);
+				return std::copysign(std::exp2(steps / SHAPE_SCALE_STEPS), x);
+			};
+			return XMFLOAT3(quantize(scale.x), quantize(scale.y), quantize(scale.z));
 		}
-		void draw3dText(const btVector3& location, const char* textString) override
+	};
+
+	// The physics world of a scene, it is created on the first physics update of the scene and destroyed with the scene
+	struct PhysicsScene
+	{
+		btSoftBodyRigidBodyCollisionConfiguration collisionConfiguration;
+		btDbvtBroadphase overlappingPairCache;
+		btSequentialImpulseConstraintSolver solver;
+		CollisionDispatcher dispatcher;
+		btDefaultSoftBodySolver softBodySolver;
+		DynamicsWorld dynamicsWorld;
+		ShapeCache shapeCache;
+		RigidBodyPool rigidBodyPool;
+		std::mutex locker; // soft body registration and shape cache
+		wi::vector<std::pair<btRigidBody*, btCollisionShape*>> rescaled_rigidbodies; // kinematic bodies and their new cached shapes, they are replaced after the registration
+		wi::vector<btRigidBody*> added_rigidbodies; // created in parallel, they are added to the world after the registration
+		wi::SpinLock added_locker;
+		wi::vector<XMFLOAT3> interest_points; // rigid body level of detail is based on distance to these
+		float accumulator = 0; // fixed timestep: simulation time that is not stepped yet
+
+		PhysicsScene()
+			: dispatcher(&collisionConfiguration)
+			, dynamicsWorld(&dispatcher, &overlappingPairCache, &solver, &collisionConfiguration, &softBodySolver)
 		{
+			dynamicsWorld.getSolverInfo().m_solverMode |= SOLVER_RANDMIZE_ORDER;
+			dynamicsWorld.getDispatchInfo().m_enableSatConvex = true;
+			dynamicsWorld.getSolverInfo().m_splitImpulse = true;
+			dynamicsWorld.setGravity(gravity);
+			dynamicsWorld.setDebugDrawer(&debugDraw);
+
+			btSoftBodyWorldInfo& softWorldInfo = dynamicsWorld.getWorldInfo();
+			softWorldInfo.air_density = btScalar(1.2f);
+			softWorldInfo.water_density = 0;
+			softWorldInfo.water_offset = 0;
+			softWorldInfo.water_normal = btVector3(0, 0, 0);
+			softWorldInfo.m_gravity.setValue(gravity.x(), gravity.y(), gravity.z());
+			softWorldInfo.m_sparsesdf.Initialize();
 		}
-		void setDebugMode(int debugMode) override
+		// Deletes a rigid body that is no longer in the world, together with its shape
+		void DeleteRigidBody(btRigidBody* rigidbody)
 		{
+			RigidBodyPool::Slot* slot = (RigidBodyPool::Slot*)rigidbody;
+			btCollisionShape* shape = rigidbody->getCollisionShape();
+			if (ShapeCache::IsCached(shape))
+			{
+				shapeCache.Release(shape);
+			}
+			else if ((void*)shape == (void*)slot->shape)
+			{
+				shape->~btCollisionShape();
+			}
+			else
+			{
+				delete shape;
+			}
+			((RigidBody*)rigidbody)->~RigidBody();
+			rigidBodyPool.Free(slot);
 		}
-		int getDebugMode() const override
+
+		~PhysicsScene()
 		{
-			return DBG_DrawWireframe;
+			for (int i = dynamicsWorld.getNumCollisionObjects() - 1; i >= 0; --i)
+			{
+				btCollisionObject* collisionobject = dynamicsWorld.getCollisionObjectArray()[i];
+				btRigidBody* rigidbody = btRigidBody::upcast(collisionobject);
+				if (rigidbody != nullptr)
+				{
+					dynamicsWorld.removeRigidBody(rigidbody);
+					DeleteRigidBody(rigidbody);
+					continue;
+				}
+				btSoftBody* softbody = btSoftBody::upcast(collisionobject);
+				if (softbody != nullptr)
+				{
+					dynamicsWorld.removeSoftBody(softbody);
+					delete softbody;
+					continue;
+				}
+				dynamicsWorld.removeCollisionObject(collisionobject);
+			}
 		}
 	};
-	DebugDraw debugDraw;
+	PhysicsScene& GetPhysicsScene(Scene& scene)
+	{
+		if (scene.physics_scene == nullptr)
+		{
+			scene.physics_scene = std::make_shared<PhysicsScene>();
+		}
+		return *(PhysicsScene*)scene.physics_scene.get();
+	}
 
 	void Initialize()
 	{
 		wi::Timer timer;
 
-		dynamicsWorld.getSolverInfo().m_solverMode |= SOLVER_RANDMIZE_ORDER;
-		dynamicsWorld.getDispatchInfo().m_enableSatConvex = true;
-		dynamicsWorld.getSolverInfo().m_splitImpulse = true;
-		dynamicsWorld.setGravity(gravity);
-		dynamicsWorld.setDebugDrawer(&debugDraw);
-
-		btSoftBodyWorldInfo& softWorldInfo = dynamicsWorld.getWorldInfo();
-		softWorldInfo.air_density = btScalar(1.2f);
-		softWorldInfo.water_density = 0;
-		softWorldInfo.water_offset = 0;
-		softWorldInfo.water_normal = btVector3(0, 0, 0);
-		softWorldInfo.m_gravity.setValue(gravity.x(), gravity.y(), gravity.z());
-		softWorldInfo.m_sparsesdf.Initialize();
-
 		wi::backlog::post("wi::physics Initialized [Bullet] (" + std::to_string((int)std::round(timer.elapsed())) + " ms)");
 	}
 
@@ -97,86 +992,97 @@ namespace wi::physics
 	int GetAccuracy() { return ACCURACY; }
 	void SetAccuracy(int value) { ACCURACY = value; }
 
-	void AddRigidBody(Entity entity, wi::scene::RigidBodyPhysicsComponent& physicscomponent, const wi::scene::TransformComponent& transform, const wi::scene::MeshComponent* mesh)
+	bool IsMultithreadingEnabled() { return MULTITHREADING_ENABLED; }
+	void SetMultithreadingEnabled(bool value) { MULTITHREADING_ENABLED = value; }
+
+	uint32_t GetThreadCount() { return THREAD_COUNT == 0 ? wi::jobsystem::GetThreadCount() : std::min(THREAD_COUNT, wi::jobsystem::GetThreadCount()); }
+	void SetThreadCount(uint32_t value) { THREAD_COUNT = value; }
+
+	uint32_t GetConvexHullVertexLimit() { return CONVEX_HULL_VERTEX_LIMIT; }
+	void SetConvexHullVertexLimit(uint32_t value) { CONVEX_HULL_VERTEX_LIMIT = value; }
+
+	bool IsFixedTimestepEnabled() { return FIXED_TIMESTEP_ENABLED; }
+	void SetFixedTimestepEnabled(bool value) { FIXED_TIMESTEP_ENABLED = value; }
+
+	float GetFixedTimestepFrequency() { return FIXED_TIMESTEP_FREQUENCY; }
+	void SetFixedTimestepFrequency(float value) { FIXED_TIMESTEP_FREQUENCY = std::max(1.0f, value); }
+
+	int GetFixedTimestepMaxSteps() { return FIXED_TIMESTEP_MAX_STEPS; }
+	void SetFixedTimestepMaxSteps(int value) { FIXED_TIMESTEP_MAX_STEPS = std::max(1, value); }
+
+	void SetInterestPoints(Scene& scene, const XMFLOAT3* points, size_t count)
+	{
+		PhysicsScene& physics_scene = GetPhysicsScene(scene);
+		physics_scene.interest_points.assign(points, points + count);
+	}
+
+	float GetLODReducedDistance() { return LOD_DISTANCE_REDUCED; }
+	void SetLODReducedDistance(float value) { LOD_DISTANCE_REDUCED = value; }
+
+	float GetLODFrozenDistance() { return LOD_DISTANCE_FROZEN; }
+	void SetLODFrozenDistance(float value) { LOD_DISTANCE_FROZEN = value; }
+
+	uint32_t GetLODReducedInterval() { return LOD_REDUCED_INTERVAL; }
+	void SetLODReducedInterval(uint32_t value) { LOD_REDUCED_INTERVAL = std::max(1u, value); }
+
+	LODStats GetLODStats(Scene& scene)
 	{
+		const DynamicsWorld& dynamicsWorld = GetPhysicsScene(scene).dynamicsWorld;
+		LODStats stats;
+		stats.full_rate_steps = dynamicsWorld.lodFullRateSteps.load();
+		stats.reduced_rate_steps = dynamicsWorld.lodReducedRateSteps.load();
+		stats.skipped_steps = dynamicsWorld.lodSkippedSteps.load();
+		stats.promotions = dynamicsWorld.lodPromotions.load();
+		return stats;
+	}
+
+	// Creates the rigid body of a component, but doesn't add it to the world yet
+	//	This can be called from multiple threads, the bodies are added to the world in a batch with AddRigidBodies()
+	void PrepareRigidBody(PhysicsScene& physics_scene, Entity entity, wi::scene::RigidBodyPhysicsComponent& physicscomponent, const wi::scene::TransformComponent& transform, Entity meshID, const wi::scene::MeshComponent* mesh)
+	{
+		RigidBodyPool::Slot* slot = nullptr;
 		btCollisionShape* shape = nullptr;
 
 		switch (physicscomponent.shape)
 		{
 		case RigidBodyPhysicsComponent::CollisionShape::BOX:
 		{
-			shape = new btBoxShape(btVector3(physicscomponent.box.halfextents.x, physicscomponent.box.halfextents.y, physicscomponent.box.halfextents.z));
+			slot = physics_scene.rigidBodyPool.Allocate();
+			shape = new (slot->shape) btBoxShape(btVector3(physicscomponent.box.halfextents.x, physicscomponent.box.halfextents.y, physicscomponent.box.halfextents.z));
 		}
 		break;
 
 		case RigidBodyPhysicsComponent::CollisionShape::SPHERE:
 		{
-			shape = new btSphereShape(btScalar(physicscomponent.sphere.radius));
+			slot = physics_scene.rigidBodyPool.Allocate();
+			shape = new (slot->shape) btSphereShape(btScalar(physicscomponent.sphere.radius));
 		}
 		break;
 
 		case RigidBodyPhysicsComponent::CollisionShape::CAPSULE:
-			shape = new btCapsuleShape(btScalar(physicscomponent.capsule.radius), btScalar(physicscomponent.capsule.height));
+			slot = physics_scene.rigidBodyPool.Allocate();
+			shape = new (slot->shape) btCapsuleShape(btScalar(physicscomponent.capsule.radius), btScalar(physicscomponent.capsule.height));
 			break;
 
 		case RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL:
-			if(mesh != nullptr)
-			{
-				shape = new btConvexHullShape();
-				for (auto& pos : mesh->vertex_positions)
-				{
-					((btConvexHullShape*)shape)->addPoint(btVector3(pos.x, pos.y, pos.z));
-				}
-				btVector3 S(transform.scale_local.x, transform.scale_local.y, transform.scale_local.z);
-				shape->setLocalScaling(S);
-			}
-			else
-			{
-				wi::backlog::post("Convex Hull physics requested, but no MeshComponent provided!");
-				assert(0);
-			}
-			break;
-
 		case RigidBodyPhysicsComponent::CollisionShape::TRIANGLE_MESH:
 			if(mesh != nullptr)
 			{
-				int totalVerts = (int)mesh->vertex_positions.size();
-				int totalTriangles = (int)mesh->indices.size() / 3;
-
-				btVector3* btVerts = new btVector3[totalVerts];
-				size_t i = 0;
-				for (auto& pos : mesh->vertex_positions)
-				{
-					btVerts[i++] = btVector3(pos.x, pos.y, pos.z);
-				}
-
-				int* btInd = new int[mesh->indices.size()];
-				i = 0;
-				for (auto& ind : mesh->indices)
+				// The shape is shared with other bodies of the same mesh and scale. It is nullptr while a triangle mesh is still being built, the registration will be retried
+				physics_scene.locker.lock();
+				shape = physics_scene.shapeCache.Acquire(meshID, *mesh, physicscomponent.shape, transform.scale_local);
+				physics_scene.locker.unlock();
+				if (shape != nullptr)
 				{
-					btInd[i++] = ind;
+					slot = physics_scene.rigidBodyPool.Allocate();
 				}
-
-				int vertStride = sizeof(btVector3);
-				int indexStride = 3 * sizeof(int);
-
-				btTriangleIndexVertexArray* indexVertexArrays = new btTriangleIndexVertexArray(
-					totalTriangles,
-					btInd,
-					indexStride,
-					totalVerts,
-					(btScalar*)&btVerts[0].x(),
-					vertStride
-				);
-
-				bool useQuantizedAabbCompression = true;
-				shape = new btBvhTriangleMeshShape(indexVertexArrays, useQuantizedAabbCompression);
-				btVector3 S(transform.scale_local.x, transform.scale_local.y, transform.scale_local.z);
-				shape->setLocalScaling(S);
 			}
 			else
 			{
-				wi::backlog::post("Triangle Mesh physics requested, but no MeshComponent provided!");
+				wi::backlog::post(physicscomponent.shape == RigidBodyPhysicsComponent::CollisionShape::CONVEX_HULL ?
+					"Convex Hull physics requested, but no MeshComponent provided!" :
+					"Triangle Mesh physics requested, but no MeshComponent provided!"
+				);
 				assert(0);
 			}
 			break;
@@ -206,15 +1112,15 @@ namespace wi::physics
 			shapeTransform.setIdentity();
 			shapeTransform.setOrigin(btVector3(transform.translation_local.x, transform.translation_local.y, transform.translation_local.z));
 			shapeTransform.setRotation(btQuaternion(transform.rotation_local.x, transform.rotation_local.y, transform.rotation_local.z, transform.rotation_local.w));
-			btDefaultMotionState* myMotionState = new btDefaultMotionState(shapeTransform);
 
-			btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, myMotionState, shape, localInertia);
+			btRigidBody::btRigidBodyConstructionInfo rbInfo(mass, nullptr, shape, localInertia);
+			rbInfo.m_startWorldTransform = shapeTransform;
 			//rbInfo.m_friction = physicscomponent.friction;
 			//rbInfo.m_restitution = physicscomponent.restitution;
 			//rbInfo.m_linearDamping = physicscomponent.damping;
 			//rbInfo.m_angularDamping = physicscomponent.damping;
 
-			btRigidBody* rigidbody = new btRigidBody(rbInfo);
+			btRigidBody* rigidbody = new (slot->body) RigidBody(rbInfo);
 			rigidbody->setUserIndex(entity);
 
 			if (physicscomponent.IsKinematic())
@@ -226,11 +1132,50 @@ namespace wi::physics
 				rigidbody->setActivationState(DISABLE_DEACTIVATION);
 			}
 
-			dynamicsWorld.addRigidBody(rigidbody);
+			physics_scene.added_locker.lock();
+			physics_scene.added_rigidbodies.push_back(rigidbody);
+			physics_scene.added_locker.unlock();
 			physicscomponent.physicsobject = rigidbody;
 		}
 	}
-	void AddSoftBody(Entity entity, wi::scene::SoftBodyPhysicsComponent& physicscomponent, const wi::scene::MeshComponent& mesh)
+	// Adds the rigid bodies that were created since the last call to the world
+	void AddRigidBodies(PhysicsScene& physics_scene)
+	{
+		if (physics_scene.added_rigidbodies.empty())
+			return;
+
+		// The order of parallel creation is random, but the simulation depends on the order of bodies in the world:
+		std::sort(physics_scene.added_rigidbodies.begin(), physics_scene.added_rigidbodies.end(), [](const btRigidBody* a, const btRigidBody* b) {
+			return a->getUserIndex() < b->getUserIndex();
+		});
+		physics_scene.dynamicsWorld.addRigidBodies(physics_scene.added_rigidbodies.data(), (int)physics_scene.added_rigidbodies.size());
+		physics_scene.added_rigidbodies.clear();
+	}
+	// Replaces the shapes of the kinematic rigid bodies that were rescaled in the registration
+	//	The contact pairs of the bodies refer to the old shapes, so they are cleaned before the old shapes are released
+	void ReplaceRigidBodyShapes(PhysicsScene& physics_scene)
+	{
+		btSoftRigidDynamicsWorld& dynamicsWorld = physics_scene.dynamicsWorld;
+		btOverlappingPairCache* pairCache = dynamicsWorld.getBroadphase()->getOverlappingPairCache();
+		for (auto& x : physics_scene.rescaled_rigidbodies)
+		{
+			btRigidBody* rigidbody = x.first;
+			btCollisionShape* shape = rigidbody->getCollisionShape();
+			btBroadphaseProxy* proxy = rigidbody->getBroadphaseHandle();
+			if (proxy != nullptr)
+			{
+				pairCache->cleanProxyFromPairs(proxy, dynamicsWorld.getDispatcher());
+			}
+			rigidbody->setCollisionShape(x.second);
+			if (proxy != nullptr)
+			{
+				dynamicsWorld.updateSingleAabb(rigidbody);
+			}
+			physics_scene.shapeCache.Release(shape);
+		}
+		physics_scene.rescaled_rigidbodies.clear();
+	}
+	void AddSoftBody(PhysicsScene& physics_scene, Entity entity, wi::scene::SoftBodyPhysicsComponent& physicscomponent, const wi::scene::MeshComponent& mesh)
 	{
 		physicscomponent.CreateFromMesh(mesh);
 
@@ -252,7 +1197,7 @@ namespace wi::physics
 			btVerts[i * 3 + 2] = btScalar(position.z);
 		}
 
-		const int iCount = (int)mesh.indices.size();
+		const int iCount = (int)mesh.GetFullDetailIndexCount(); // without the simplified LOD triangles
 		const int tCount = iCount / 3;
 		int* btInd = new int[iCount];
 		for (int i = 0; i < iCount; ++i) 
@@ -263,7 +1208,7 @@ namespace wi::physics
 		}
 
 		btSoftBody* softbody = btSoftBodyHelpers::CreateFromTriMesh(
-			dynamicsWorld.getWorldInfo()
+			physics_scene.dynamicsWorld.getWorldInfo()
 			, btVerts
 			, btInd
 			, tCount
@@ -322,7 +1267,7 @@ namespace wi::physics
 
 			softbody->setPose(true, true);
 
-			dynamicsWorld.addSoftBody(softbody);
+			physics_scene.dynamicsWorld.addSoftBody(softbody);
 			physicscomponent.physicsobject = softbody;
 		}
 	}
@@ -338,6 +1283,9 @@ namespace wi::physics
 
 		auto range = wi::profiler::BeginRangeCPU("Physics");
 
+		PhysicsScene& physics_scene = GetPhysicsScene(scene);
+		btSoftRigidDynamicsWorld& dynamicsWorld = physics_scene.dynamicsWorld;
+
 		btVector3 wind = btVector3(scene.weather.windDirection.x, scene.weather.windDirection.y, scene.weather.windDirection.z);
 
 		// System will register rigidbodies to objects, and update physics engine state for kinematics:
@@ -350,14 +1298,14 @@ namespace wi::physics
 			{
 				TransformComponent& transform = *scene.transforms.GetComponent(entity);
 				const ObjectComponent* object = scene.objects.GetComponent(entity);
+				Entity meshID = INVALID_ENTITY;
 				const MeshComponent* mesh = nullptr;
 				if (object != nullptr)
 				{
-					mesh = scene.meshes.GetComponent(object->meshID);
+					meshID = object->meshID;
+					mesh = scene.meshes.GetComponent(meshID);
 				}
-				physicsLock.lock();
-				AddRigidBody(entity, physicscomponent, transform, mesh);
-				physicsLock.unlock();
+				PrepareRigidBody(physics_scene, entity, physicscomponent, transform, meshID, mesh);
 			}
 
 			if (physicscomponent.physicsobject != nullptr)
@@ -382,6 +1330,27 @@ namespace wi::physics
 				rigidbody->setFriction(physicscomponent.friction);
 				rigidbody->setRestitution(physicscomponent.restitution);
 
+				// Level of detail is chosen by the distance to the closest interest point:
+				physicscomponent.lod = RigidBodyPhysicsComponent::LOD_FULL_RATE;
+				if (!physicscomponent.IsDisableLOD() && !physics_scene.interest_points.empty())
+				{
+					const btVector3& position = rigidbody->getWorldTransform().getOrigin();
+					float distancesq = std::numeric_limits<float>::max();
+					for (const XMFLOAT3& point : physics_scene.interest_points)
+					{
+						distancesq = std::min(distancesq, position.distance2(btVector3(point.x, point.y, point.z)));
+					}
+					if (distancesq > LOD_DISTANCE_FROZEN * LOD_DISTANCE_FROZEN)
+					{
+						physicscomponent.lod = RigidBodyPhysicsComponent::LOD_FROZEN;
+					}
+					else if (distancesq > LOD_DISTANCE_REDUCED * LOD_DISTANCE_REDUCED)
+					{
+						physicscomponent.lod = RigidBodyPhysicsComponent::LOD_REDUCED_RATE;
+					}
+				}
+				((RigidBody*)rigidbody)->lod = physicscomponent.lod;
+
 				// For kinematic object, system updates physics state, else the physics updates system state:
 				if (physicscomponent.IsKinematic() || !IsSimulationEnabled())
 				{
@@ -406,8 +1375,34 @@ namespace wi::physics
 
 					btCollisionShape* shape = rigidbody->getCollisionShape();
 					XMFLOAT3 scale = transform.GetScale();
-					btVector3 S(scale.x, scale.y, scale.z);
-					shape->setLocalScaling(S);
+					if (ShapeCache::IsCached(shape))
+					{
+						// Cached shapes are shared, so a different scale means a different shape:
+						//	The scales are compared after rounding, small changes keep the current shape
+						//	The shape is replaced after the registration, because the contact pairs of the world must be updated with it
+						const XMFLOAT3 shape_scale = ShapeCache::QuantizeScale(ShapeCache::GetScale(shape));
+						const XMFLOAT3 quantized_scale = ShapeCache::QuantizeScale(scale);
+						if (shape_scale.x != quantized_scale.x || shape_scale.y != quantized_scale.y || shape_scale.z != quantized_scale.z)
+						{
+							const ObjectComponent* object = scene.objects.GetComponent(entity);
+							const MeshComponent* mesh = object == nullptr ? nullptr : scene.meshes.GetComponent(object->meshID);
+							if (mesh != nullptr)
+							{
+								physics_scene.locker.lock();
+								btCollisionShape* scaled_shape = physics_scene.shapeCache.Acquire(object->meshID, *mesh, physicscomponent.shape, quantized_scale);
+								if (scaled_shape != nullptr)
+								{
+									physics_scene.rescaled_rigidbodies.emplace_back(rigidbody, scaled_shape);
+								}
+								physics_scene.locker.unlock();
+							}
+						}
+					}
+					else
+					{
+						btVector3 S(scale.x, scale.y, scale.z);
+						shape->setLocalScaling(S);
+					}
 				}
 			}
 		});
@@ -426,15 +1421,18 @@ namespace wi::physics
 				physicscomponent._flags &= ~SoftBodyPhysicsComponent::FORCE_RESET;
 				if (physicscomponent.physicsobject != nullptr)
 				{
+					physics_scene.locker.lock();
 					dynamicsWorld.removeSoftBody((btSoftBody*)physicscomponent.physicsobject);
+					physics_scene.locker.unlock();
+					delete (btSoftBody*)physicscomponent.physicsobject;
 					physicscomponent.physicsobject = nullptr;
 				}
 			}
 			if (physicscomponent._flags & SoftBodyPhysicsComponent::SAFE_TO_REGISTER && physicscomponent.physicsobject == nullptr)
 			{
-				physicsLock.lock();
-				AddSoftBody(entity, physicscomponent, mesh);
-				physicsLock.unlock();
+				physics_scene.locker.lock();
+				AddSoftBody(physics_scene, entity, physicscomponent, mesh);
+				physics_scene.locker.unlock();
 			}
 
 			if (physicscomponent.physicsobject != nullptr)
@@ -470,13 +1468,59 @@ namespace wi::physics
 
 		wi::jobsystem::Wait(ctx);
 
+		// Rigid bodies that were created by the registration are added to the world together:
+		AddRigidBodies(physics_scene);
+		ReplaceRigidBodyShapes(physics_scene);
+
 		// Perform internal simulation step:
+		float interpolation = 1; // fixed timestep: blend factor between the previous and current simulated transforms
 		if (IsSimulationEnabled())
 		{
-			dynamicsWorld.stepSimulation(dt, ACCURACY);
+			if (IsFixedTimestepEnabled())
+			{
+				// The frame time is accumulated and simulated in constant steps, time that doesn't fit into the step budget is dropped:
+				const float timestep = 1.0f / FIXED_TIMESTEP_FREQUENCY;
+				physics_scene.accumulator += dt;
+				int steps = int(physics_scene.accumulator / timestep);
+				if (steps > FIXED_TIMESTEP_MAX_STEPS)
+				{
+					steps = FIXED_TIMESTEP_MAX_STEPS;
+					physics_scene.accumulator = std::fmod(physics_scene.accumulator, timestep) + steps * timestep;
+				}
+				for (int step = 0; step < steps; ++step)
+				{
+					btCollisionObjectArray& collisionobjects = dynamicsWorld.getCollisionObjectArray();
+					ParallelFor((uint32_t)collisionobjects.size(), 256, [&](uint32_t begin, uint32_t end) {
+						for (uint32_t i = begin; i < end; ++i)
+						{
+							btRigidBody* rigidbody = btRigidBody::upcast(collisionobjects[i]);
+							if (rigidbody != nullptr)
+							{
+								((RigidBody*)rigidbody)->previousTransform = rigidbody->getWorldTransform();
+							}
+						}
+					});
+					dynamicsWorld.stepSimulation(timestep, 0, timestep);
+				}
+				physics_scene.accumulator -= steps * timestep;
+				interpolation = physics_scene.accumulator / timestep;
+			}
+			else
+			{
+				dynamicsWorld.stepSimulation(dt, ACCURACY);
+			}
 		}
 
 		// Feedback physics engine state to system:
+		// Soft bodies that will write their simulation results to graphics data:
+		struct SoftBodyWriteback
+		{
+			btSoftBody* softbody;
+			SoftBodyPhysicsComponent* physicscomponent;
+			const MeshComponent* mesh;
+		};
+		wi::vector<SoftBodyWriteback> softbodies;
+
 		for (int i = 0; i < dynamicsWorld.getCollisionObjectArray().size(); ++i)
 		{
 			btCollisionObject* collisionobject = dynamicsWorld.getCollisionObjectArray()[i];
@@ -489,6 +1533,7 @@ namespace wi::physics
 				if (physicscomponent == nullptr || physicscomponent->physicsobject != rigidbody)
 				{
 					dynamicsWorld.removeRigidBody(rigidbody);
+					physics_scene.DeleteRigidBody(rigidbody);
 					i--;
 					continue;
 				}
@@ -498,12 +1543,25 @@ namespace wi::physics
 				{
 					TransformComponent& transform = *scene.transforms.GetComponent(entity);
 
-					btMotionState* motionState = rigidbody->getMotionState();
-					btTransform physicsTransform;
+					btVector3 T;
+					btQuaternion R;
+					if (IsFixedTimestepEnabled())
+					{
+						// Interpolate between the last two simulated states, so motion is smooth while the simulation runs at a different rate:
+						const btTransform& previousTransform = ((RigidBody*)rigidbody)->previousTransform;
+						const btTransform& currentTransform = rigidbody->getWorldTransform();
+						T = lerp(previousTransform.getOrigin(), currentTransform.getOrigin(), interpolation);
+						R = slerp(previousTransform.getRotation(), currentTransform.getRotation(), interpolation);
+					}
+					else
+					{
+						btMotionState* motionState = rigidbody->getMotionState();
+						btTransform physicsTransform;
 
-					motionState->getWorldTransform(physicsTransform);
-					btVector3 T = physicsTransform.getOrigin();
-					btQuaternion R = physicsTransform.getRotation();
+						motionState->getWorldTransform(physicsTransform);
+						T = physicsTransform.getOrigin();
+						R = physicsTransform.getRotation();
+					}
 
 					transform.translation_local = XMFLOAT3(T.x(), T.y(), T.z());
 					transform.rotation_local = XMFLOAT4(R.x(), R.y(), R.z(), R.w());
@@ -520,6 +1578,7 @@ namespace wi::physics
 					if (physicscomponent == nullptr || physicscomponent->physicsobject != softbody)
 					{
 						dynamicsWorld.removeSoftBody(softbody);
+						delete softbody;
 						i--;
 						continue;
 					}
@@ -532,103 +1591,125 @@ namespace wi::physics
 					softbody->getAabb(aabb_min, aabb_max);
 					physicscomponent->aabb = wi::primitive::AABB(XMFLOAT3(aabb_min.x(), aabb_min.y(), aabb_min.z()), XMFLOAT3(aabb_max.x(), aabb_max.y(), aabb_max.z()));
 
-					// Soft body simulation nodes will update graphics mesh:
-					for (size_t ind = 0; ind < physicscomponent->vertex_positions_simulation.size(); ++ind)
-					{
-						uint32_t physicsInd = physicscomponent->graphicsToPhysicsVertexMapping[ind];
-						float weight = physicscomponent->weights[physicsInd];
-
-						btSoftBody::Node& node = softbody->m_nodes[physicsInd];
+					softbodies.push_back({ softbody, physicscomponent, &mesh });
+				}
+			}
+		}
 
-						MeshComponent::Vertex_POS& vertex = physicscomponent->vertex_positions_simulation[ind];
-						vertex.pos.x = node.m_x.getX();
-						vertex.pos.y = node.m_x.getY();
-						vertex.pos.z = node.m_x.getZ();
+		// Soft body simulation nodes will update graphics meshes:
+		//	Every soft body is split into vertex and triangle ranges that are processed in parallel
+		for (const SoftBodyWriteback& x : softbodies)
+		{
+			ParallelForAsync(ctx, (uint32_t)x.physicscomponent->vertex_positions_simulation.size(), SOFTBODY_GRAIN_SIZE, [x](uint32_t begin, uint32_t end) {
+				const XMVECTOR scale = XMVectorReplicate(-0.5f * 255.0f); // normals are flipped
+				const XMVECTOR bias = XMVectorReplicate(0.5f * 255.0f);
+				for (uint32_t ind = begin; ind < end; ++ind)
+				{
+					uint32_t physicsInd = x.physicscomponent->graphicsToPhysicsVertexMapping[ind];
+					const btSoftBody::Node& node = x.softbody->m_nodes[physicsInd];
+
+					MeshComponent::Vertex_POS& vertex = x.physicscomponent->vertex_positions_simulation[ind];
+					vertex.pos.x = node.m_x.getX();
+					vertex.pos.y = node.m_x.getY();
+					vertex.pos.z = node.m_x.getZ();
+
+					// Pack normal to UNORM8 in SIMD, wind weight is kept in the highest byte:
+					XMVECTOR N = XMVectorSet(node.m_n.getX(), node.m_n.getY(), node.m_n.getZ(), 0);
+					N = XMVectorMultiplyAdd(N, scale, bias);
+					XMUBYTE4 packed;
+					XMStoreUByte4(&packed, N);
+					vertex.normal_wind = (vertex.normal_wind & 0xFF000000) | (packed.v & 0x00FFFFFF);
+				}
+			});
+		}
+		wi::jobsystem::Wait(ctx);
 
-						XMFLOAT3 normal;
-						normal.x = -node.m_n.getX();
-						normal.y = -node.m_n.getY();
-						normal.z = -node.m_n.getZ();
-						vertex.MakeFromParams(normal);
-					}
+		// Update tangent vectors:
+		for (const SoftBodyWriteback& x : softbodies)
+		{
+			if (x.mesh->vertex_uvset_0.empty() || x.physicscomponent->vertex_tangents_simulation.empty())
+				continue;
+			ParallelForAsync(ctx, (uint32_t)x.physicscomponent->triangle_tangents_tmp.size(), SOFTBODY_GRAIN_SIZE, [x](uint32_t begin, uint32_t end) {
+				const MeshComponent& mesh = *x.mesh;
+				for (uint32_t triangle = begin; triangle < end; ++triangle)
+				{
+					const uint32_t i0 = mesh.indices[triangle * 3 + 0];
+					const uint32_t i1 = mesh.indices[triangle * 3 + 1];
+					const uint32_t i2 = mesh.indices[triangle * 3 + 2];
+
+					const XMFLOAT3 v0 = x.physicscomponent->vertex_positions_simulation[i0].pos;
+					const XMFLOAT3 v1 = x.physicscomponent->vertex_positions_simulation[i1].pos;
+					const XMFLOAT3 v2 = x.physicscomponent->vertex_positions_simulation[i2].pos;
+
+					const XMFLOAT2 u0 = mesh.vertex_uvset_0[i0];
+					const XMFLOAT2 u1 = mesh.vertex_uvset_0[i1];
+					const XMFLOAT2 u2 = mesh.vertex_uvset_0[i2];
+
+					const XMVECTOR nor0 = x.physicscomponent->vertex_positions_simulation[i0].LoadNOR();
+					const XMVECTOR nor1 = x.physicscomponent->vertex_positions_simulation[i1].LoadNOR();
+					const XMVECTOR nor2 = x.physicscomponent->vertex_positions_simulation[i2].LoadNOR();
+
+					const XMVECTOR facenormal = XMVector3Normalize(XMVectorAdd(XMVectorAdd(nor0, nor1), nor2));
+
+					const float x1 = v1.x - v0.x;
+					const float x2 = v2.x - v0.x;
+					const float y1 = v1.y - v0.y;
+					const float y2 = v2.y - v0.y;
+					const float z1 = v1.z - v0.z;
+					const float z2 = v2.z - v0.z;
+
+					const float s1 = u1.x - u0.x;
+					const float s2 = u2.x - u0.x;
+					const float t1 = u1.y - u0.y;
+					const float t2 = u2.y - u0.y;
+
+					const float r = 1.0f / (s1 * t2 - s2 * t1);
+					const XMVECTOR sdir = XMVectorSet((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r,
+						(t2 * z1 - t1 * z2) * r, 0);
+					const XMVECTOR tdir = XMVectorSet((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r,
+						(s1 * z2 - s2 * z1) * r, 0);
+
+					XMVECTOR tangent;
+					tangent = XMVector3Normalize(XMVectorSubtract(sdir, XMVectorMultiply(facenormal, XMVector3Dot(facenormal, sdir))));
+					float sign = XMVectorGetX(XMVector3Dot(XMVector3Cross(tangent, facenormal), tdir)) < 0.0f ? -1.0f : 1.0f;
+
+					XMFLOAT4& t = x.physicscomponent->triangle_tangents_tmp[triangle];
+					XMStoreFloat4(&t, tangent);
+					t.w = sign;
+				}
+			});
+		}
+		wi::jobsystem::Wait(ctx);
 
-					// Update tangent vectors:
-					if (!mesh.vertex_uvset_0.empty())
+		// Vertex tangents are the sum of tangents of triangles that use the vertex:
+		for (const SoftBodyWriteback& x : softbodies)
+		{
+			if (x.mesh->vertex_uvset_0.empty())
+				continue;
+			ParallelForAsync(ctx, (uint32_t)x.physicscomponent->vertex_tangents_simulation.size(), SOFTBODY_GRAIN_SIZE, [x](uint32_t begin, uint32_t end) {
+				for (uint32_t i = begin; i < end; ++i)
+				{
+					XMFLOAT4 tangent = XMFLOAT4(0, 0, 0, 1);
+					for (uint32_t j = x.physicscomponent->vertex_triangle_offsets[i]; j < x.physicscomponent->vertex_triangle_offsets[i + 1]; ++j)
 					{
-						for (size_t i = 0; i < mesh.indices.size(); i += 3)
-						{
-							const uint32_t i0 = mesh.indices[i + 0];
-							const uint32_t i1 = mesh.indices[i + 1];
-							const uint32_t i2 = mesh.indices[i + 2];
-
-							const XMFLOAT3 v0 = physicscomponent->vertex_positions_simulation[i0].pos;
-							const XMFLOAT3 v1 = physicscomponent->vertex_positions_simulation[i1].pos;
-							const XMFLOAT3 v2 = physicscomponent->vertex_positions_simulation[i2].pos;
-
-							const XMFLOAT2 u0 = mesh.vertex_uvset_0[i0];
-							const XMFLOAT2 u1 = mesh.vertex_uvset_0[i1];
-							const XMFLOAT2 u2 = mesh.vertex_uvset_0[i2];
-
-							const XMVECTOR nor0 = physicscomponent->vertex_positions_simulation[i0].LoadNOR();
-							const XMVECTOR nor1 = physicscomponent->vertex_positions_simulation[i1].LoadNOR();
-							const XMVECTOR nor2 = physicscomponent->vertex_positions_simulation[i2].LoadNOR();
-
-							const XMVECTOR facenormal = XMVector3Normalize(XMVectorAdd(XMVectorAdd(nor0, nor1), nor2));
-
-							const float x1 = v1.x - v0.x;
-							const float x2 = v2.x - v0.x;
-							const float y1 = v1.y - v0.y;
-							const float y2 = v2.y - v0.y;
-							const float z1 = v1.z - v0.z;
-							const float z2 = v2.z - v0.z;
-
-							const float s1 = u1.x - u0.x;
-							const float s2 = u2.x - u0.x;
-							const float t1 = u1.y - u0.y;
-							const float t2 = u2.y - u0.y;
-
-							const float r = 1.0f / (s1 * t2 - s2 * t1);
-							const XMVECTOR sdir = XMVectorSet((t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r,
-								(t2 * z1 - t1 * z2) * r, 0);
-							const XMVECTOR tdir = XMVectorSet((s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r,
-								(s1 * z2 - s2 * z1) * r, 0);
-
-							XMVECTOR tangent;
-							tangent = XMVector3Normalize(XMVectorSubtract(sdir, XMVectorMultiply(facenormal, XMVector3Dot(facenormal, sdir))));
-							float sign = XMVectorGetX(XMVector3Dot(XMVector3Cross(tangent, facenormal), tdir)) < 0.0f ? -1.0f : 1.0f;
-
-							XMFLOAT3 t;
-							XMStoreFloat3(&t, tangent);
-
-							physicscomponent->vertex_tangents_tmp[i0].x += t.x;
-							physicscomponent->vertex_tangents_tmp[i0].y += t.y;
-							physicscomponent->vertex_tangents_tmp[i0].z += t.z;
-							physicscomponent->vertex_tangents_tmp[i0].w = sign;
-
-							physicscomponent->vertex_tangents_tmp[i1].x += t.x;
-							physicscomponent->vertex_tangents_tmp[i1].y += t.y;
-							physicscomponent->vertex_tangents_tmp[i1].z += t.z;
-							physicscomponent->vertex_tangents_tmp[i1].w = sign;
-
-							physicscomponent->vertex_tangents_tmp[i2].x += t.x;
-							physicscomponent->vertex_tangents_tmp[i2].y += t.y;
-							physicscomponent->vertex_tangents_tmp[i2].z += t.z;
-							physicscomponent->vertex_tangents_tmp[i2].w = sign;
-						}
-
-						for (size_t i = 0; i < physicscomponent->vertex_tangents_simulation.size(); ++i)
-						{
-							physicscomponent->vertex_tangents_simulation[i].FromFULL(physicscomponent->vertex_tangents_tmp[i]);
-						}
+						const XMFLOAT4& t = x.physicscomponent->triangle_tangents_tmp[x.physicscomponent->vertex_triangles[j]];
+						tangent.x += t.x;
+						tangent.y += t.y;
+						tangent.z += t.z;
+						tangent.w = t.w;
 					}
-
+					x.physicscomponent->vertex_tangents_simulation[i].FromFULL(tangent);
 				}
-			}
+			});
 		}
+		wi::jobsystem::Wait(ctx);
 
 		if (IsDebugDrawEnabled())
 		{
+			// Debug lines are collected globally, scenes that are updated in parallel must not add them at the same time:
+			debugDrawLock.lock();
 			dynamicsWorld.debugDrawWorld();
+			debugDrawLock.unlock();
 		}
 
 		wi::profiler::EndRange(range); // Physics
@@ -636,6 +1717,26 @@ namespace wi::physics
 
 
 
+	uint32_t GetCollisionTriangleCount(const wi::scene::RigidBodyPhysicsComponent& physicscomponent)
+	{
+		if (physicscomponent.physicsobject == nullptr)
+			return 0;
+		const btCollisionShape* shape = ((btRigidBody*)physicscomponent.physicsobject)->getCollisionShape();
+		if (shape->getShapeType() == SCALED_TRIANGLE_MESH_SHAPE_PROXYTYPE)
+		{
+			shape = ((const btScaledBvhTriangleMeshShape*)shape)->getChildShape();
+		}
+		if (shape->getShapeType() != TRIANGLE_MESH_SHAPE_PROXYTYPE)
+			return 0;
+		const IndexedMeshArray& meshes = ((btTriangleIndexVertexArray*)((const btBvhTriangleMeshShape*)shape)->getMeshInterface())->getIndexedMeshArray();
+		uint32_t count = 0;
+		for (int i = 0; i < meshes.size(); ++i)
+		{
+			count += (uint32_t)meshes[i].m_numTriangles;
+		}
+		return count;
+	}
+
 	void ApplyForce(
 		const wi::scene::RigidBodyPhysicsComponent& physicscomponent,
 		const XMFLOAT3& force
@@ -684,4 +1785,254 @@ namespace wi::physics
 		}
 	}
 
+
+	bool IsLayerQueried(const Scene& scene, const btCollisionObject* collisionobject, uint32_t layerMask)
+	{
+		if (layerMask == ~0u)
+			return true;
+		const LayerComponent* layer = scene.layers.GetComponent((Entity)collisionobject->getUserIndex());
+		return layer == nullptr || (layer->GetLayerMask() & layerMask) != 0;
+	}
+
+	// Calls func with a temporary Bullet shape that matches the query shape
+	template<typename F>
+	void WithQueryShape(const QueryShape& shape, const F& func)
+	{
+		switch (shape.type)
+		{
+		default:
+		case QueryShape::Type::SPHERE:
+		{
+			btSphereShape sphere(btScalar(shape.radius));
+			func(sphere);
+		}
+		break;
+		case QueryShape::Type::BOX:
+		{
+			btBoxShape box(btVector3(shape.halfextents.x, shape.halfextents.y, shape.halfextents.z));
+			func(box);
+		}
+		break;
+		case QueryShape::Type::CAPSULE:
+		{
+			btCapsuleShape capsule(btScalar(shape.radius), btScalar(shape.height));
+			func(capsule);
+		}
+		break;
+		}
+	}
+
+	struct RayQueryCallback : public btCollisionWorld::ClosestRayResultCallback
+	{
+		const Scene& scene;
+		uint32_t layerMask;
+
+		RayQueryCallback(const btVector3& from, const btVector3& to, const Scene& scene, uint32_t layerMask)
+			: ClosestRayResultCallback(from, to), scene(scene), layerMask(layerMask)
+		{
+		}
+		bool needsCollision(btBroadphaseProxy* proxy0) const override
+		{
+			// Soft body ray tests build the face tree of the soft body on first use, which is not safe from parallel queries, so they are not queried:
+			const btCollisionObject* collisionobject = (const btCollisionObject*)proxy0->m_clientObject;
+			return ClosestRayResultCallback::needsCollision(proxy0) && btSoftBody::upcast(collisionobject) == nullptr && IsLayerQueried(scene, collisionobject, layerMask);
+		}
+	};
+
+	struct SweepQueryCallback : public btCollisionWorld::ClosestConvexResultCallback
+	{
+		const Scene& scene;
+		uint32_t layerMask;
+
+		SweepQueryCallback(const btVector3& from, const btVector3& to, const Scene& scene, uint32_t layerMask)
+			: ClosestConvexResultCallback(from, to), scene(scene), layerMask(layerMask)
+		{
+		}
+		bool needsCollision(btBroadphaseProxy* proxy0) const override
+		{
+			return ClosestConvexResultCallback::needsCollision(proxy0) && IsLayerQueried(scene, (const btCollisionObject*)proxy0->m_clientObject, layerMask);
+		}
+	};
+
+	struct OverlapQueryCallback : public btCollisionWorld::ContactResultCallback
+	{
+		const Scene& scene;
+		uint32_t layerMask;
+		const btCollisionObject* queryobject;
+		OverlapResult& result;
+
+		OverlapQueryCallback(const Scene& scene, uint32_t layerMask, const btCollisionObject* queryobject, OverlapResult& result)
+			: scene(scene), layerMask(layerMask), queryobject(queryobject), result(result)
+		{
+		}
+		bool needsCollision(btBroadphaseProxy* proxy0) const override
+		{
+			// Soft body collision modifies the soft body, so they are not queried:
+			const btCollisionObject* collisionobject = (const btCollisionObject*)proxy0->m_clientObject;
+			return ContactResultCallback::needsCollision(proxy0) && btSoftBody::upcast(collisionobject) == nullptr && IsLayerQueried(scene, collisionobject, layerMask);
+		}
+		btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* colObj0Wrap, int partId0, int index0, const btCollisionObjectWrapper* colObj1Wrap, int partId1, int index1) override
+		{
+			if (cp.getDistance() <= 0)
+			{
+				const btCollisionObject* collisionobject = colObj0Wrap->getCollisionObject() == queryobject ? colObj1Wrap->getCollisionObject() : colObj0Wrap->getCollisionObject();
+				const Entity entity = (Entity)collisionobject->getUserIndex();
+				if (std::find(result.entities.begin(), result.entities.end(), entity) == result.entities.end())
+				{
+					result.entities.push_back(entity);
+				}
+			}
+			return 0;
+		}
+	};
+
+	void Sweep(
+		const Scene& scene,
+		PhysicsScene& physics_scene,
+		const btConvexShape& shape,
+		const XMFLOAT3& origin,
+		const XMFLOAT4& rotation,
+		const XMFLOAT3& direction,
+		float distance,
+		uint32_t layerMask,
+		QueryResult& result
+	)
+	{
+		const btQuaternion R(rotation.x, rotation.y, rotation.z, rotation.w);
+		const btVector3 from(origin.x, origin.y, origin.z);
+		const btVector3 to = from + btVector3(direction.x, direction.y, direction.z) * distance;
+
+		SweepQueryCallback callback(from, to, scene, layerMask);
+		physics_scene.dynamicsWorld.convexSweepTest(&shape, btTransform(R, from), btTransform(R, to), callback);
+
+		result = QueryResult();
+		if (callback.hasHit())
+		{
+			result.entity = (Entity)callback.m_hitCollisionObject->getUserIndex();
+			result.position = XMFLOAT3(callback.m_hitPointWorld.x(), callback.m_hitPointWorld.y(), callback.m_hitPointWorld.z());
+			result.normal = XMFLOAT3(callback.m_hitNormalWorld.x(), callback.m_hitNormalWorld.y(), callback.m_hitNormalWorld.z());
+			result.fraction = callback.m_closestHitFraction;
+		}
+	}
+
+	void RayCast(
+		const wi::scene::Scene& scene,
+		const RayCastQuery* queries,
+		QueryResult* results,
+		size_t count
+	)
+	{
+		if (scene.physics_scene == nullptr)
+		{
+			std::fill(results, results + count, QueryResult());
+			return;
+		}
+		PhysicsScene& physics_scene = *(PhysicsScene*)scene.physics_scene.get();
+
+		ParallelFor((uint32_t)count, 16, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const RayCastQuery& query = queries[i];
+				const btVector3 from(query.origin.x, query.origin.y, query.origin.z);
+				const btVector3 to = from + btVector3(query.direction.x, query.direction.y, query.direction.z) * query.distance;
+
+				RayQueryCallback callback(from, to, scene, query.layerMask);
+				physics_scene.dynamicsWorld.rayTest(from, to, callback);
+
+				QueryResult& result = results[i];
+				result = QueryResult();
+				if (callback.hasHit())
+				{
+					const btVector3 normal = callback.m_hitNormalWorld.normalized();
+					result.entity = (Entity)callback.m_collisionObject->getUserIndex();
+					result.position = XMFLOAT3(callback.m_hitPointWorld.x(), callback.m_hitPointWorld.y(), callback.m_hitPointWorld.z());
+					result.normal = XMFLOAT3(normal.x(), normal.y(), normal.z());
+					result.fraction = callback.m_closestHitFraction;
+				}
+			}
+		});
+	}
+
+	void SphereSweep(
+		const wi::scene::Scene& scene,
+		const SphereSweepQuery* queries,
+		QueryResult* results,
+		size_t count
+	)
+	{
+		if (scene.physics_scene == nullptr)
+		{
+			std::fill(results, results + count, QueryResult());
+			return;
+		}
+		PhysicsScene& physics_scene = *(PhysicsScene*)scene.physics_scene.get();
+
+		ParallelFor((uint32_t)count, 16, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const SphereSweepQuery& query = queries[i];
+				btSphereShape sphere(btScalar(query.radius));
+				Sweep(scene, physics_scene, sphere, query.origin, XMFLOAT4(0, 0, 0, 1), query.direction, query.distance, query.layerMask, results[i]);
+			}
+		});
+	}
+
+	void ShapeSweep(
+		const wi::scene::Scene& scene,
+		const ShapeSweepQuery* queries,
+		QueryResult* results,
+		size_t count
+	)
+	{
+		if (scene.physics_scene == nullptr)
+		{
+			std::fill(results, results + count, QueryResult());
+			return;
+		}
+		PhysicsScene& physics_scene = *(PhysicsScene*)scene.physics_scene.get();
+
+		ParallelFor((uint32_t)count, 16, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const ShapeSweepQuery& query = queries[i];
+				WithQueryShape(query.shape, [&](const btConvexShape& shape) {
+					Sweep(scene, physics_scene, shape, query.origin, query.rotation, query.direction, query.distance, query.layerMask, results[i]);
+				});
+			}
+		});
+	}
+
+	void Overlap(
+		const wi::scene::Scene& scene,
+		const OverlapQuery* queries,
+		OverlapResult* results,
+		size_t count
+	)
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			results[i].entities.clear();
+		}
+		if (scene.physics_scene == nullptr)
+			return;
+		PhysicsScene& physics_scene = *(PhysicsScene*)scene.physics_scene.get();
+
+		ParallelFor((uint32_t)count, 16, [&](uint32_t begin, uint32_t end) {
+			for (uint32_t i = begin; i < end; ++i)
+			{
+				const OverlapQuery& query = queries[i];
+				WithQueryShape(query.shape, [&](btConvexShape& shape) {
+					btCollisionObject queryobject;
+					queryobject.setCollisionShape(&shape);
+					queryobject.setWorldTransform(btTransform(
+						btQuaternion(query.rotation.x, query.rotation.y, query.rotation.z, query.rotation.w),
+						btVector3(query.position.x, query.position.y, query.position.z)
+					));
+
+					OverlapQueryCallback callback(scene, query.layerMask, &queryobject, results[i]);
+					physics_scene.dynamicsWorld.contactTest(&queryobject, callback);
+				});
+			}
+		});
+	}
 }
@@ -268,6 +268,57 @@ namespace wi::profiler
 	};
 	wi::unordered_map<std::string, Hits> time_cache_cpu;
 	wi::unordered_map<std::string, Hits> time_cache_gpu;
+
+	// Querying the memory usage walks every tracked resource, so the displayed usage is only refreshed periodically:
+	static constexpr uint64_t memory_usage_refresh_frames = 30;
+	GPUMemoryUsage memory_usage_cache;
+	uint64_t memory_usage_frame = ~0ull;
+	const char* GetCategoryName(GPUMemoryUsage::Category category)
+	{
+		switch (category)
+		{
+		case GPUMemoryUsage::Category::BUFFER:
+			return "Buffers";
+		case GPUMemoryUsage::Category::TEXTURE:
+			return "Textures";
+		case GPUMemoryUsage::Category::RENDERTARGET:
+			return "Render targets";
+		case GPUMemoryUsage::Category::ACCELERATION_STRUCTURE:
+			return "Acceleration structures";
+		default:
+			return "";
+		}
+	}
+	void WriteGPUMemoryUsage(std::stringstream& ss, const GPUMemoryUsage& usage, size_t max_named_resources)
+	{
+		const double MB = 1.0 / (1024.0 * 1024.0);
+		ss << std::fixed;
+		ss << "GPU Memory: " << usage.usage * MB << " MB / " << usage.budget * MB << " MB budget" << std::endl;
+		for (size_t i = 0; i < arraysize(usage.categories); ++i)
+		{
+			const GPUMemoryUsage::Allocations& allocations = usage.categories[i];
+			ss << "\t" << GetCategoryName((GPUMemoryUsage::Category)i) << " (" << allocations.count << "x): " << allocations.size * MB << " MB" << std::endl;
+		}
+		const size_t count = std::min(max_named_resources, usage.named_resources.size());
+		if (count > 0)
+		{
+			ss << "Largest resources:" << std::endl;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			const GPUMemoryUsage::NamedResource& named = usage.named_resources[i];
+			ss << "\t" << named.name << " [" << GetCategoryName(named.category) << "] (" << named.allocations.count << "x): " << named.allocations.size * MB << " MB" << std::endl;
+		}
+	}
+
+	void WriteUploadRingUsage(std::stringstream& ss)
+	{
+		const double MB = 1.0 / (1024.0 * 1024.0);
+		const GraphicsDevice* device = GetDevice();
+		ss << std::fixed;
+		ss << "Upload ring high water mark: " << device->GetUploadRingHighWaterMark() * MB << " MB, overflows: " << device->GetUploadRingOverflowCount() << std::endl;
+	}
+
 	void DrawData(const wi::Canvas& canvas, float x, float y, CommandList cmd)
 	{
 		if (!ENABLED || !initialized)
@@ -331,6 +382,17 @@ namespace wi::profiler
 			x.second.num_hits = 0;
 			x.second.total_time = 0;
 		}
+		ss << std::endl;
+
+		// Print GPU memory:
+		const uint64_t frame = GetDevice()->GetFrameCount();
+		if (memory_usage_frame == ~0ull || frame - memory_usage_frame >= memory_usage_refresh_frames)
+		{
+			memory_usage_cache = GetDevice()->GetMemoryUsage();
+			memory_usage_frame = frame;
+		}
+		WriteGPUMemoryUsage(ss, memory_usage_cache, 10);
+		WriteUploadRingUsage(ss);
 
 		wi::font::Params params = wi::font::Params(x, y, wi::font::WIFONTSIZE_DEFAULT - 4, wi::font::WIFALIGN_LEFT, wi::font::WIFALIGN_TOP, wi::Color(255, 255, 255, 255), wi::Color(0, 0, 0, 255));
 
@@ -345,12 +407,29 @@ namespace wi::profiler
 		wi::font::Draw(ss.str(), params, cmd);
 	}
 
+	bool SaveGPUMemoryUsage(const std::string& filename)
+	{
+		std::stringstream ss("");
+		ss.precision(2);
+		WriteGPUMemoryUsage(ss, GetDevice()->GetMemoryUsage(), ~0ull);
+		WriteUploadRingUsage(ss);
+		const std::string text = ss.str();
+		if (wi::helper::FileWrite(filename, (const uint8_t*)text.c_str(), text.length()))
+		{
+			wi::backlog::post("GPU memory usage saved: " + filename);
+			return true;
+		}
+		wi::backlog::post("GPU memory usage could not be saved: " + filename, wi::backlog::LogLevel::Error);
+		return false;
+	}
+
 	void SetEnabled(bool value)
 	{
 		if (value != ENABLED)
 		{
 			initialized = false;
 			ranges.clear();
+			memory_usage_frame = ~0ull;
 			ENABLED = value;
 		}
 	}
@@ -24,6 +24,10 @@ namespace wi::profiler
 	// Renders a basic text of the Profiling results to the (x,y) screen coordinate
 	void DrawData(const wi::Canvas& canvas, float x, float y, wi::graphics::CommandList cmd);
 
+	// Writes the GPU memory budget, usage and all resources grouped by name to a text file
+	//	Returns true if the file was written successfully
+	bool SaveGPUMemoryUsage(const std::string& filename);
+
 	// Enable/disable profiling
 	void SetEnabled(bool value);
 
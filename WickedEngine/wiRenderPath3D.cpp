@@ -538,19 +538,45 @@ void RenderPath3D::Update(float dt)
 	visibility_main.scene = scene;
 	visibility_main.camera = camera;
 	visibility_main.flags = wi::renderer::Visibility::ALLOW_EVERYTHING;
-	wi::renderer::UpdateVisibility(visibility_main);
 
-	if (visibility_main.planar_reflection_visible)
-	{
-		// Frustum culling for planar reflections:
+	// The planar reflection camera depends on the reflection plane that the main culling finds,
+	//	so the plane of the previous frame is used to cull both views in one pass,
+	//	and the reflection is culled again only if the plane changed
+	auto setup_reflection = [&](const XMFLOAT4& plane) {
 		camera_reflection = *camera;
 		camera_reflection.jitter = XMFLOAT2(0, 0);
-		camera_reflection.Reflect(visibility_main.reflectionPlane);
+		camera_reflection.Reflect(plane);
 		visibility_reflection.layerMask = getLayerMask();
 		visibility_reflection.scene = scene;
 		visibility_reflection.camera = &camera_reflection;
 		visibility_reflection.flags = wi::renderer::Visibility::ALLOW_OBJECTS;
-		wi::renderer::UpdateVisibility(visibility_reflection);
+	};
+	const bool reflection_predicted = visibility_main.planar_reflection_visible;
+	const XMFLOAT4 predicted_plane = visibility_main.reflectionPlane;
+	if (reflection_predicted)
+	{
+		setup_reflection(predicted_plane);
+		wi::renderer::Visibility* views[] = { &visibility_main, &visibility_reflection };
+		wi::renderer::UpdateVisibility(views, arraysize(views));
+	}
+	else
+	{
+		wi::renderer::UpdateVisibility(visibility_main);
+	}
+
+	if (visibility_main.planar_reflection_visible)
+	{
+		const XMFLOAT4& plane = visibility_main.reflectionPlane;
+		if (!reflection_predicted ||
+			plane.x != predicted_plane.x ||
+			plane.y != predicted_plane.y ||
+			plane.z != predicted_plane.z ||
+			plane.w != predicted_plane.w)
+		{
+			// Frustum culling for planar reflections:
+			setup_reflection(plane);
+			wi::renderer::UpdateVisibility(visibility_reflection);
+		}
 	}
 
 	XMUINT2 internalResolution = GetInternalResolution();
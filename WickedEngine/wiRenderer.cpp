@@ -28,6 +28,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 
 using namespace wi::primitive;
 using namespace wi::graphics;
@@ -197,35 +198,63 @@ Texture texture_curlNoise;
 Texture texture_weatherMap;
 
 // Direct reference to a renderable instance:
+//	The sort key is 96 bits wide (16-bit distance | 32-bit mesh index | 32-bit instance index),
+//	stored as a 64-bit primary key and a 32-bit secondary key, so the sort order is the same
+//	as distance -> mesh -> instance without limiting the mesh and instance counts to 24 bits
+//	The "Render Queue Sorting" test measures its sorting cost against the previous 64-bit packing
 struct RenderBatch
 {
 	uint64_t data;
+	uint32_t instanceIndex;
 
 	inline void Create(size_t meshIndex, size_t instanceIndex, float distance)
 	{
-		assert(meshIndex < 0x00FFFFFF);
-		assert(instanceIndex < 0x00FFFFFF);
+		assert(meshIndex <= 0xFFFFFFFF);
+		assert(instanceIndex <= 0xFFFFFFFF);
 
 		data = 0;
-		data |= uint64_t(XMConvertFloatToHalf(distance) & 0xFFFF) << 48ull;
-		data |= uint64_t(meshIndex & 0x00FFFFFF) << 24ull;
-		data |= uint64_t(instanceIndex & 0x00FFFFFF) << 0ull;
+		data |= uint64_t(XMConvertFloatToHalf(distance) & 0xFFFF) << 32ull;
+		data |= uint64_t(meshIndex & 0xFFFFFFFF) << 0ull;
+		this->instanceIndex = uint32_t(instanceIndex);
 	}
 
 	inline float GetDistance() const
 	{
-		return XMConvertHalfToFloat(HALF(data >> 48ull));
+		return XMConvertHalfToFloat(HALF(data >> 32ull));
 	}
 	inline uint32_t GetMeshIndex() const
 	{
-		return (data >> 24ull) & 0x00FFFFFF;
+		return uint32_t(data & 0xFFFFFFFF);
 	}
 	inline uint32_t GetInstanceIndex() const
 	{
-		return (data >> 0ull) & 0x00FFFFFF;
+		return instanceIndex;
+	}
+
+	inline bool operator<(const RenderBatch& other) const
+	{
+		return data < other.data || (data == other.data && instanceIndex < other.instanceIndex);
+	}
+	inline bool operator>(const RenderBatch& other) const
+	{
+		return data > other.data || (data == other.data && instanceIndex > other.instanceIndex);
 	}
 };
 
+// ObjectPushConstants packs the mesh index in 24 bits next to the subset index, meshes above that can't be drawn:
+//	Returns false for them and logs it once, because it is checked for every draw
+inline bool CheckPushConstantMeshIndex(uint32_t meshIndex)
+{
+	if (meshIndex < 0x00FFFFFF)
+		return true;
+	static std::atomic_bool logged{ false };
+	if (!logged.exchange(true))
+	{
+		wi::backlog::post("wi::renderer: mesh index " + std::to_string(meshIndex) + " doesn't fit into the 24 bits of ObjectPushConstants, meshes above it are not drawn", wi::backlog::LogLevel::Error);
+	}
+	return false;
+}
+
 // This is just a utility that points to a linear array of render batches:
 struct RenderQueue
 {
@@ -253,7 +282,7 @@ struct RenderQueue
 		if (batchCount > 1)
 		{
 			std::sort(batchArray, batchArray + batchCount, [sortType](const RenderBatch& a, const RenderBatch& b) -> bool {
-				return ((sortType == SORT_FRONT_TO_BACK) ? (a.data < b.data) : (a.data > b.data));
+				return ((sortType == SORT_FRONT_TO_BACK) ? (a < b) : (a > b));
 			});
 		}
 	}
@@ -665,6 +694,12 @@ bool LoadShader(ShaderStage stage, Shader& shader, const std::string& filename,
 {
 	std::string shaderbinaryfilename = SHADERPATH + filename;
 
+	if (device->GetShaderFormat() == ShaderFormat::NONE)
+	{
+		// The device doesn't consume shader binaries (GraphicsDevice_Null), nothing needs to be loaded:
+		return device->CreateShader(stage, nullptr, 0, &shader);
+	}
+
 #ifdef SHADERDUMP_ENABLED
 	
 	// Loading shader from precompiled dump:
@@ -2327,7 +2362,7 @@ ForwardEntityMaskCB ForwardEntityCullingCPU(const Visibility& vis, const AABB& b
 	uint32_t buckets[2] = { 0,0 };
 	for (size_t i = 0; i < std::min(size_t(64), vis.visibleLights.size()); ++i) // only support indexing 64 lights at max for now
 	{
-		const uint16_t lightIndex = vis.visibleLights[i].index;
+		const uint32_t lightIndex = vis.visibleLights[i].index;
 		const AABB& light_aabb = vis.scene->aabb_lights[lightIndex];
 		if (light_aabb.intersects(batch_aabb))
 		{
@@ -2402,18 +2437,47 @@ void RenderMeshes(
 		uint32_t meshIndex = ~0u;
 		uint32_t instanceCount = 0;
 		uint32_t dataOffset = 0;
+		uint32_t lod = 0;
+		uint32_t instanceIndex = 0; // last written instance, used when the batch has only one
 		uint8_t userStencilRefOverride = 0;
 		bool forceAlphatestForDithering = false;
 		AABB aabb;
 	} instancedBatch = {};
 
+	// Meshlet culling can be done when the pass is rendered with a single frustum:
+	//	Backface cone culling is only done for camera passes, shadow passes only use the frustum
+	const Frustum* meshlet_frustum = nullptr;
+	const XMFLOAT3* meshlet_eye = nullptr;
+	if (frusta != nullptr)
+	{
+		if (frustum_count == 1)
+		{
+			meshlet_frustum = frusta;
+		}
+	}
+	else if (renderPass == RENDERPASS_MAIN || renderPass == RENDERPASS_PREPASS)
+	{
+		meshlet_frustum = &vis.camera->frustum;
+		meshlet_eye = &vis.camera->Eye;
+	}
+	wi::vector<MeshComponent::MeshletRange> meshlet_ranges;
+
+	// Meshes share index buffers of the geometry arena, they are only rebound when the buffer changes:
+	//	Every allocation holds its own GPUBuffer copy of the arena block, so the block is identified by the shared internal state
+	const void* bound_indexbuffer = nullptr;
+	IndexBufferFormat bound_indexformat = IndexBufferFormat::UINT16;
+
 
 	// This will be called every time we start a new draw call:
 	auto batch_flush = [&]()
 	{
 		if (instancedBatch.instanceCount == 0)
 			return;
+		if (!CheckPushConstantMeshIndex(instancedBatch.meshIndex))
+			return;
 		const MeshComponent& mesh = vis.scene->meshes[instancedBatch.meshIndex];
+		if (!mesh.IsGeometryReady())
+			return;
 		const bool forceAlphaTestForDithering = instancedBatch.forceAlphatestForDithering != 0;
 		const uint8_t userStencilRefOverride = instancedBatch.userStencilRefOverride;
 
@@ -2427,9 +2491,45 @@ void RenderMeshes(
 			device->BindDynamicConstantBuffer(cb, CB_GETBINDSLOT(ForwardEntityMaskCB), cmd);
 		}
 
-		device->BindIndexBuffer(&mesh.indexBuffer, mesh.GetIndexFormat(), 0, cmd);
+		const GPUBuffer* indexbuffer = mesh.GetIndexBuffer();
+		const void* indexbuffer_block = indexbuffer == nullptr ? nullptr : indexbuffer->internal_state.get();
+		const IndexBufferFormat indexformat = mesh.GetIndexFormat();
+		if (indexbuffer_block != bound_indexbuffer || indexformat != bound_indexformat)
+		{
+			device->BindIndexBuffer(indexbuffer, indexformat, 0, cmd);
+			bound_indexbuffer = indexbuffer_block;
+			bound_indexformat = indexformat;
+		}
+		const uint32_t indexOffset = mesh.GetIndexOffset();
+
+		uint32_t first_subset = 0;
+		uint32_t last_subset = 0;
+		mesh.GetLODSubsetRange(instancedBatch.lod, first_subset, last_subset);
+
+		// Meshlets are only usable for a single undeformed instance of the full detail mesh:
+		//	Instanced batches share one draw call for all instances, so they can't use the index ranges of one instance and are drawn without meshlet culling
+		const bool meshlet_culling =
+			meshlet_frustum != nullptr &&
+			instancedBatch.instanceCount == 1 &&
+			instancedBatch.lod == 0 &&
+			!mesh.meshlets.empty() &&
+			!mesh.streamoutBuffer_POS.IsValid() &&
+			!tessellatorRequested;
+		meshlet_ranges.clear();
+		size_t meshlet_range_index = 0;
+		if (meshlet_culling)
+		{
+			bool cone_culling = meshlet_eye != nullptr && !mesh.IsDoubleSided();
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset && cone_culling; ++subsetIndex)
+			{
+				cone_culling = !vis.scene->materials[mesh.subsets[subsetIndex].materialIndex].IsDoubleSided();
+			}
+			const ObjectComponent& instance = vis.scene->objects[instancedBatch.instanceIndex];
+			const XMMATRIX W = instance.transform_index >= 0 ? XMLoadFloat4x4(&vis.scene->transforms[instance.transform_index].world) : XMMatrixIdentity();
+			mesh.CullMeshlets(W, *meshlet_frustum, cone_culling ? meshlet_eye : nullptr, meshlet_ranges);
+		}
 
-		for (size_t subsetIndex = 0; subsetIndex < mesh.subsets.size(); ++subsetIndex)
+		for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 		{
 			const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 			if (subset.indexCount == 0)
@@ -2516,16 +2616,53 @@ void RenderMeshes(
 				instancedBatch.dataOffset
 			);
 
+			if (meshlet_culling)
+			{
+				// Only the visible meshlet ranges of this subset are drawn:
+				while (meshlet_range_index < meshlet_ranges.size() && meshlet_ranges[meshlet_range_index].subsetIndex < subsetIndex)
+				{
+					meshlet_range_index++;
+				}
+				const size_t range_begin = meshlet_range_index;
+				size_t range_end = range_begin;
+				while (range_end < meshlet_ranges.size() && meshlet_ranges[range_end].subsetIndex == subsetIndex)
+				{
+					range_end++;
+				}
+				if (range_begin == range_end)
+				{
+					continue;
+				}
+
+				if (pso_backside != nullptr)
+				{
+					device->BindPipelineState(pso_backside, cmd);
+					device->PushConstants(&push, sizeof(push), cmd);
+					for (size_t i = range_begin; i < range_end; ++i)
+					{
+						device->DrawIndexedInstanced(meshlet_ranges[i].indexCount, 1, indexOffset + meshlet_ranges[i].indexOffset, 0, 0, cmd);
+					}
+				}
+
+				device->BindPipelineState(pso, cmd);
+				device->PushConstants(&push, sizeof(push), cmd);
+				for (size_t i = range_begin; i < range_end; ++i)
+				{
+					device->DrawIndexedInstanced(meshlet_ranges[i].indexCount, 1, indexOffset + meshlet_ranges[i].indexOffset, 0, 0, cmd);
+				}
+				continue;
+			}
+
 			if (pso_backside != nullptr)
 			{
 				device->BindPipelineState(pso_backside, cmd);
 				device->PushConstants(&push, sizeof(push), cmd);
-				device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, subset.indexOffset, 0, 0, cmd);
+				device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, indexOffset + subset.indexOffset, 0, 0, cmd);
 			}
 
 			device->BindPipelineState(pso, cmd);
 			device->PushConstants(&push, sizeof(push), cmd);
-			device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, subset.indexOffset, 0, 0, cmd);
+			device->DrawIndexedInstanced(subset.indexCount, instancedBatch.instanceCount, indexOffset + subset.indexOffset, 0, 0, cmd);
 
 		}
 	};
@@ -2542,13 +2679,29 @@ void RenderMeshes(
 		const AABB& instanceAABB = vis.scene->aabb_objects[instanceIndex];
 		const uint8_t userStencilRefOverride = instance.userStencilRef;
 
+		// LOD is selected by the projected size of the instance on the main camera,
+		//	so every pass (including shadows) will render the same LOD for an instance:
+		uint32_t lod = 0;
+		const MeshComponent& mesh = vis.scene->meshes[meshIndex];
+		if (mesh.subsets_per_lod > 0)
+		{
+			const float distance = wi::math::Distance(vis.camera->Eye, instanceAABB.getCenter());
+			const float screen_radius = instanceAABB.getRadius() / std::max(0.0001f, distance * std::tan(vis.camera->fov * 0.5f));
+			if (screen_radius < 1)
+			{
+				lod = (uint32_t)std::max(0.0f, -std::log2(std::max(0.0001f, screen_radius)));
+				lod = std::min(lod, mesh.GetLODCount() - 1);
+			}
+		}
+
 		// When we encounter a new mesh inside the global instance array, we begin a new RenderBatch:
-		if (meshIndex != instancedBatch.meshIndex || userStencilRefOverride != instancedBatch.userStencilRefOverride)
+		if (meshIndex != instancedBatch.meshIndex || lod != instancedBatch.lod || userStencilRefOverride != instancedBatch.userStencilRefOverride)
 		{
 			batch_flush();
 
 			instancedBatch = {};
 			instancedBatch.meshIndex = meshIndex;
+			instancedBatch.lod = lod;
 			instancedBatch.instanceCount = 0;
 			instancedBatch.dataOffset = (uint32_t)(instances.offset + instanceCount * instanceDataSize);
 			instancedBatch.userStencilRefOverride = userStencilRefOverride;
@@ -2588,6 +2741,7 @@ void RenderMeshes(
 			ShaderMeshInstancePointer* poi = (ShaderMeshInstancePointer*)instances.data + instanceCount;
 			poi->Create(instanceIndex, frustum_index, dither);
 
+			instancedBatch.instanceIndex = instanceIndex;
 			instancedBatch.instanceCount++; // next instance in current InstancedBatch
 			instanceCount++;
 		}
@@ -2704,275 +2858,349 @@ void ProcessDeferredMipGenRequests(CommandList cmd)
 
 void UpdateVisibility(Visibility& vis)
 {
+	Visibility* views[] = { &vis };
+	UpdateVisibility(views, 1);
+}
+void UpdateVisibility(Visibility* const* visibilities, uint32_t count)
+{
+	if (visibilities == nullptr || count == 0)
+		return;
+
 	// Perform parallel frustum culling and obtain closest reflector:
 	wi::jobsystem::context ctx;
 	wi::jobsystem::context ctx_lights;
 	auto range = wi::profiler::BeginRangeCPU("Frustum Culling");
 
-	assert(vis.scene != nullptr); // User must provide a scene!
-	assert(vis.camera != nullptr); // User must provide a camera!
+	// All views must be culled against the same scene, because the scene is only walked once:
+	const Scene* scene = visibilities[0]->scene;
+	assert(scene != nullptr); // User must provide a scene!
 
 	// The parallel frustum culling is first performed in shared memory, 
 	//	then each group writes out it's local list to global memory
 	//	The shared memory approach reduces atomics and helps the list to remain
 	//	more coherent (less randomly organized compared to original order)
+	//	When multiple views are culled together, every AABB is loaded once and tested against all frusta,
+	//	each view has its own local list + counter in the shared memory
 	static const uint32_t groupSize = 64;
-	static const size_t sharedmemory_size = (groupSize + 1) * sizeof(uint32_t); // list + counter per group
+	const size_t sharedmemory_size = count * (groupSize + 1) * sizeof(uint32_t); // list + counter per group per view
+	const size_t sharedmemory_size_lights = count * (groupSize + 1) * sizeof(Visibility::VisibleLight); // list + counter per group per view (counter is padded to list element size)
 
-	// Initialize visible indices:
-	vis.Clear();
-
-	if (!GetFreezeCullingCameraEnabled())
+	uint32_t flags_combined = Visibility::EMPTY;
+	for (uint32_t view = 0; view < count; ++view)
 	{
-		vis.frustum = vis.camera->frustum;
-	}
+		Visibility& vis = *visibilities[view];
+		assert(vis.scene == scene); // Views culled together must refer to the same scene!
+		assert(vis.camera != nullptr); // User must provide a camera!
 
-	if (!GetOcclusionCullingEnabled() || GetFreezeCullingCameraEnabled())
-	{
-		vis.flags &= ~Visibility::ALLOW_OCCLUSION_CULLING;
+		// Initialize visible indices:
+		vis.Clear();
+
+		if (!GetFreezeCullingCameraEnabled())
+		{
+			vis.frustum = vis.camera->frustum;
+		}
+
+		if (!GetOcclusionCullingEnabled() || GetFreezeCullingCameraEnabled())
+		{
+			vis.flags &= ~Visibility::ALLOW_OCCLUSION_CULLING;
+		}
+
+		if (vis.flags & Visibility::ALLOW_LIGHTS)
+		{
+			vis.visibleLights.resize(scene->aabb_lights.GetCount());
+		}
+		if (vis.flags & Visibility::ALLOW_OBJECTS)
+		{
+			vis.visibleObjects.resize(scene->aabb_objects.GetCount());
+		}
+		if (vis.flags & Visibility::ALLOW_DECALS)
+		{
+			vis.visibleDecals.resize(scene->aabb_decals.GetCount());
+		}
+
+		flags_combined |= vis.flags;
 	}
 
-	if (vis.flags & Visibility::ALLOW_LIGHTS)
+	if (flags_combined & Visibility::ALLOW_LIGHTS)
 	{
 		// Cull lights:
-		vis.visibleLights.resize(vis.scene->aabb_lights.GetCount());
-		wi::jobsystem::Dispatch(ctx_lights, (uint32_t)vis.scene->aabb_lights.GetCount(), groupSize, [&](wi::jobsystem::JobArgs args) {
-
-			// Setup stream compaction:
-			uint32_t& group_count = *(uint32_t*)args.sharedmemory;
-			Visibility::VisibleLight* group_list = (Visibility::VisibleLight*)args.sharedmemory + 1;
-			if (args.isFirstJobInGroup)
-			{
-				group_count = 0; // first thread initializes local counter
-			}
+		wi::jobsystem::Dispatch(ctx_lights, (uint32_t)scene->aabb_lights.GetCount(), groupSize, [&](wi::jobsystem::JobArgs args) {
 
-			const AABB& aabb = vis.scene->aabb_lights[args.jobIndex];
+			const AABB& aabb = scene->aabb_lights[args.jobIndex];
+			const LightComponent& light = scene->lights[args.jobIndex];
 
-			if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
+			for (uint32_t view = 0; view < count; ++view)
 			{
-				// Local stream compaction:
-				//	(also compute light distance for shadow priority sorting)
-				assert(args.jobIndex < 0xFFFF);
-				group_list[group_count].index = (uint16_t)args.jobIndex;
-				const LightComponent& light = vis.scene->lights[args.jobIndex];
-				float distance = 0;
-				if (light.type != LightComponent::DIRECTIONAL)
-				{
-					distance = wi::math::DistanceEstimated(light.position, vis.camera->Eye);
-				}
-				group_list[group_count].distance = uint16_t(distance * 10);
-				group_count++;
-				if (light.IsVolumetricsEnabled())
+				Visibility& vis = *visibilities[view];
+				if ((vis.flags & Visibility::ALLOW_LIGHTS) == 0)
+					continue;
+
+				// Setup stream compaction:
+				Visibility::VisibleLight* group_base = (Visibility::VisibleLight*)args.sharedmemory + view * (groupSize + 1);
+				uint32_t& group_count = *(uint32_t*)group_base;
+				Visibility::VisibleLight* group_list = group_base + 1;
+				if (args.isFirstJobInGroup)
 				{
-					vis.volumetriclight_request.store(true);
+					group_count = 0; // first thread initializes local counter
 				}
 
-				if (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING)
+				if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
 				{
-					if (!light.IsStatic() && light.GetType() != LightComponent::DIRECTIONAL || light.occlusionquery < 0)
+					// Local stream compaction:
+					//	(also compute light distance for shadow priority sorting)
+					group_list[group_count].index = args.jobIndex;
+					float distance = 0;
+					if (light.type != LightComponent::DIRECTIONAL)
+					{
+						distance = wi::math::DistanceEstimated(light.position, vis.camera->Eye);
+					}
+					group_list[group_count].distance = uint32_t(distance * 10);
+					group_count++;
+					if (light.IsVolumetricsEnabled())
 					{
-						if (!aabb.intersects(vis.camera->Eye))
+						vis.volumetriclight_request.store(true);
+					}
+
+					if (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING)
+					{
+						// The scene update resets the query every frame, so it is allocated only once even if multiple views see the light:
+						if (light.occlusionquery < 0 && !aabb.intersects(vis.camera->Eye))
 						{
-							light.occlusionquery = vis.scene->queryAllocator.fetch_add(1); // allocate new occlusion query from heap
+							light.occlusionquery = scene->queryAllocator.fetch_add(1); // allocate new occlusion query from heap
 						}
 					}
 				}
-			}
 
-			// Global stream compaction:
-			if (args.isLastJobInGroup && group_count > 0)
-			{
-				uint32_t prev_count = vis.light_counter.fetch_add(group_count);
-				for (uint32_t i = 0; i < group_count; ++i)
+				// Global stream compaction:
+				if (args.isLastJobInGroup && group_count > 0)
 				{
-					vis.visibleLights[prev_count + i] = group_list[i];
+					uint32_t prev_count = vis.light_counter.fetch_add(group_count);
+					for (uint32_t i = 0; i < group_count; ++i)
+					{
+						vis.visibleLights[prev_count + i] = group_list[i];
+					}
 				}
 			}
 
-			}, sharedmemory_size);
+			}, sharedmemory_size_lights);
 	}
 
-	if (vis.flags & Visibility::ALLOW_OBJECTS)
+	if (flags_combined & Visibility::ALLOW_OBJECTS)
 	{
 		// Cull objects:
-		vis.visibleObjects.resize(vis.scene->aabb_objects.GetCount());
-		wi::jobsystem::Dispatch(ctx, (uint32_t)vis.scene->aabb_objects.GetCount(), groupSize, [&](wi::jobsystem::JobArgs args) {
-
-			// Setup stream compaction:
-			uint32_t& group_count = *(uint32_t*)args.sharedmemory;
-			uint32_t* group_list = (uint32_t*)args.sharedmemory + 1;
-			if (args.isFirstJobInGroup)
-			{
-				group_count = 0; // first thread initializes local counter
-			}
+		wi::jobsystem::Dispatch(ctx, (uint32_t)scene->aabb_objects.GetCount(), groupSize, [&](wi::jobsystem::JobArgs args) {
 
-			const AABB& aabb = vis.scene->aabb_objects[args.jobIndex];
+			const AABB& aabb = scene->aabb_objects[args.jobIndex];
+			const ObjectComponent& object = scene->objects[args.jobIndex];
 
-			if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
+			for (uint32_t view = 0; view < count; ++view)
 			{
-				// Local stream compaction:
-				group_list[group_count++] = args.jobIndex;
+				Visibility& vis = *visibilities[view];
+				if ((vis.flags & Visibility::ALLOW_OBJECTS) == 0)
+					continue;
 
-				const ObjectComponent& object = vis.scene->objects[args.jobIndex];
+				// Setup stream compaction:
+				uint32_t& group_count = *((uint32_t*)args.sharedmemory + view * (groupSize + 1));
+				uint32_t* group_list = &group_count + 1;
+				if (args.isFirstJobInGroup)
+				{
+					group_count = 0; // first thread initializes local counter
+				}
 
-				if (vis.flags & Visibility::ALLOW_REQUEST_REFLECTION)
+				if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
 				{
-					if (object.IsRequestPlanarReflection())
+					// Local stream compaction:
+					group_list[group_count++] = args.jobIndex;
+
+					if (vis.flags & Visibility::ALLOW_REQUEST_REFLECTION)
 					{
-						float dist = wi::math::DistanceEstimated(vis.camera->Eye, object.center);
-						vis.locker.lock();
-						if (dist < vis.closestRefPlane)
+						if (object.IsRequestPlanarReflection())
 						{
-							vis.closestRefPlane = dist;
-							const TransformComponent& transform = vis.scene->transforms[object.transform_index];
-							XMVECTOR P = transform.GetPositionV();
-							XMVECTOR N = XMVectorSet(0, 1, 0, 0);
-							N = XMVector3TransformNormal(N, XMLoadFloat4x4(&transform.world));
-							XMVECTOR _refPlane = XMPlaneFromPointNormal(P, N);
-							XMStoreFloat4(&vis.reflectionPlane, _refPlane);
-
-							vis.planar_reflection_visible = true;
+							float dist = wi::math::DistanceEstimated(vis.camera->Eye, object.center);
+							vis.locker.lock();
+							if (dist < vis.closestRefPlane)
+							{
+								vis.closestRefPlane = dist;
+								const TransformComponent& transform = scene->transforms[object.transform_index];
+								XMVECTOR P = transform.GetPositionV();
+								XMVECTOR N = XMVectorSet(0, 1, 0, 0);
+								N = XMVector3TransformNormal(N, XMLoadFloat4x4(&transform.world));
+								XMVECTOR _refPlane = XMPlaneFromPointNormal(P, N);
+								XMStoreFloat4(&vis.reflectionPlane, _refPlane);
+
+								vis.planar_reflection_visible = true;
+							}
+							vis.locker.unlock();
 						}
-						vis.locker.unlock();
 					}
-				}
 
-				if (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING)
-				{
-					if (object.IsRenderable() && object.occlusionQueries[vis.scene->queryheap_idx] < 0)
+					if (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING)
 					{
-						if (aabb.intersects(vis.camera->Eye))
+						if (object.IsRenderable() && object.occlusionQueries[scene->queryheap_idx] < 0)
 						{
-							// camera is inside the instance, mark it as visible in this frame:
-							object.occlusionHistory |= 1;
-						}
-						else
-						{
-							object.occlusionQueries[vis.scene->queryheap_idx] = vis.scene->queryAllocator.fetch_add(1); // allocate new occlusion query from heap
+							if (aabb.intersects(vis.camera->Eye))
+							{
+								// camera is inside the instance, mark it as visible in this frame:
+								object.occlusionHistory |= 1;
+							}
+							else
+							{
+								object.occlusionQueries[scene->queryheap_idx] = scene->queryAllocator.fetch_add(1); // allocate new occlusion query from heap
+							}
 						}
 					}
 				}
-			}
 
-			// Global stream compaction:
-			if (args.isLastJobInGroup && group_count > 0)
-			{
-				uint32_t prev_count = vis.object_counter.fetch_add(group_count);
-				for (uint32_t i = 0; i < group_count; ++i)
+				// Global stream compaction:
+				if (args.isLastJobInGroup && group_count > 0)
 				{
-					vis.visibleObjects[prev_count + i] = group_list[i];
+					uint32_t prev_count = vis.object_counter.fetch_add(group_count);
+					for (uint32_t i = 0; i < group_count; ++i)
+					{
+						vis.visibleObjects[prev_count + i] = group_list[i];
+					}
 				}
 			}
 
 			}, sharedmemory_size);
 	}
 
-	if (vis.flags & Visibility::ALLOW_DECALS)
+	if (flags_combined & Visibility::ALLOW_DECALS)
 	{
-		vis.visibleDecals.resize(vis.scene->aabb_decals.GetCount());
-		wi::jobsystem::Dispatch(ctx, (uint32_t)vis.scene->aabb_decals.GetCount(), groupSize, [&](wi::jobsystem::JobArgs args) {
+		wi::jobsystem::Dispatch(ctx, (uint32_t)scene->aabb_decals.GetCount(), groupSize, [&](wi::jobsystem::JobArgs args) {
+
+			const AABB& aabb = scene->aabb_decals[args.jobIndex];
 
-			// Setup stream compaction:
-			uint32_t& group_count = *(uint32_t*)args.sharedmemory;
-			uint32_t* group_list = (uint32_t*)args.sharedmemory + 1;
-			if (args.isFirstJobInGroup)
+			for (uint32_t view = 0; view < count; ++view)
 			{
-				group_count = 0; // first thread initializes local counter
-			}
+				Visibility& vis = *visibilities[view];
+				if ((vis.flags & Visibility::ALLOW_DECALS) == 0)
+					continue;
 
-			const AABB& aabb = vis.scene->aabb_decals[args.jobIndex];
+				// Setup stream compaction:
+				uint32_t& group_count = *((uint32_t*)args.sharedmemory + view * (groupSize + 1));
+				uint32_t* group_list = &group_count + 1;
+				if (args.isFirstJobInGroup)
+				{
+					group_count = 0; // first thread initializes local counter
+				}
 
-			if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
-			{
-				// Local stream compaction:
-				group_list[group_count++] = args.jobIndex;
-			}
+				if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
+				{
+					// Local stream compaction:
+					group_list[group_count++] = args.jobIndex;
+				}
 
-			// Global stream compaction:
-			if (args.isLastJobInGroup && group_count > 0)
-			{
-				uint32_t prev_count = vis.decal_counter.fetch_add(group_count);
-				for (uint32_t i = 0; i < group_count; ++i)
+				// Global stream compaction:
+				if (args.isLastJobInGroup && group_count > 0)
 				{
-					vis.visibleDecals[prev_count + i] = group_list[i];
+					uint32_t prev_count = vis.decal_counter.fetch_add(group_count);
+					for (uint32_t i = 0; i < group_count; ++i)
+					{
+						vis.visibleDecals[prev_count + i] = group_list[i];
+					}
 				}
 			}
 
 			}, sharedmemory_size);
 	}
 
-	if (vis.flags & Visibility::ALLOW_ENVPROBES)
+	if (flags_combined & Visibility::ALLOW_ENVPROBES)
 	{
 		wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
 			// Cull probes:
-			for (size_t i = 0; i < vis.scene->aabb_probes.GetCount(); ++i)
+			for (size_t i = 0; i < scene->aabb_probes.GetCount(); ++i)
 			{
-				const AABB& aabb = vis.scene->aabb_probes[i];
+				const AABB& aabb = scene->aabb_probes[i];
 
-				if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
+				for (uint32_t view = 0; view < count; ++view)
 				{
-					vis.visibleEnvProbes.push_back((uint32_t)i);
+					Visibility& vis = *visibilities[view];
+					if ((vis.flags & Visibility::ALLOW_ENVPROBES) && (aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
+					{
+						vis.visibleEnvProbes.push_back((uint32_t)i);
+					}
 				}
 			}
 			});
 	}
 
-	if (vis.flags & Visibility::ALLOW_EMITTERS)
+	if (flags_combined & Visibility::ALLOW_EMITTERS)
 	{
 		wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
 			// Cull emitters:
-			for (size_t i = 0; i < vis.scene->emitters.GetCount(); ++i)
+			for (size_t i = 0; i < scene->emitters.GetCount(); ++i)
 			{
-				const wi::EmittedParticleSystem& emitter = vis.scene->emitters[i];
-				if (!(emitter.layerMask & vis.layerMask))
+				const wi::EmittedParticleSystem& emitter = scene->emitters[i];
+
+				for (uint32_t view = 0; view < count; ++view)
 				{
-					continue;
+					Visibility& vis = *visibilities[view];
+					if ((vis.flags & Visibility::ALLOW_EMITTERS) && (emitter.layerMask & vis.layerMask))
+					{
+						vis.visibleEmitters.push_back((uint32_t)i);
+					}
 				}
-				vis.visibleEmitters.push_back((uint32_t)i);
 			}
 			});
 	}
 
-	if (vis.flags & Visibility::ALLOW_HAIRS)
+	if (flags_combined & Visibility::ALLOW_HAIRS)
 	{
 		wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
 			// Cull hairs:
-			for (size_t i = 0; i < vis.scene->hairs.GetCount(); ++i)
+			for (size_t i = 0; i < scene->hairs.GetCount(); ++i)
 			{
-				const wi::HairParticleSystem& hair = vis.scene->hairs[i];
-				if (!(hair.layerMask & vis.layerMask))
+				const wi::HairParticleSystem& hair = scene->hairs[i];
+				if (hair.meshID == INVALID_ENTITY)
 				{
 					continue;
 				}
-				if (hair.meshID == INVALID_ENTITY || !vis.frustum.CheckBoxFast(hair.aabb))
+
+				for (uint32_t view = 0; view < count; ++view)
 				{
-					continue;
+					Visibility& vis = *visibilities[view];
+					if ((vis.flags & Visibility::ALLOW_HAIRS) && (hair.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(hair.aabb))
+					{
+						vis.visibleHairs.push_back((uint32_t)i);
+					}
 				}
-				vis.visibleHairs.push_back((uint32_t)i);
 			}
 			});
 	}
 
-	if (vis.flags & Visibility::ALLOW_LIGHTS)
+	if (flags_combined & Visibility::ALLOW_LIGHTS)
 	{
 		wi::jobsystem::Wait(ctx_lights);
-		vis.visibleLights.resize((size_t)vis.light_counter.load());
-		// Sort lights based on distance so that closer lights will receive shadow map priority:
-		std::sort(vis.visibleLights.begin(), vis.visibleLights.end());
+		for (uint32_t view = 0; view < count; ++view)
+		{
+			Visibility& vis = *visibilities[view];
+			if (vis.flags & Visibility::ALLOW_LIGHTS)
+			{
+				vis.visibleLights.resize((size_t)vis.light_counter.load());
+				// Sort lights based on distance so that closer lights will receive shadow map priority:
+				std::sort(vis.visibleLights.begin(), vis.visibleLights.end());
+			}
+		}
 	}
 
 	wi::jobsystem::Wait(ctx);
 
-	// finalize stream compaction:
-	vis.visibleObjects.resize((size_t)vis.object_counter.load());
-	vis.visibleDecals.resize((size_t)vis.decal_counter.load());
-
-	if ((vis.flags & Visibility::ALLOW_REQUEST_REFLECTION) && vis.scene->weather.IsOceanEnabled())
+	for (uint32_t view = 0; view < count; ++view)
 	{
-		// Ocean will override any current reflectors
-		vis.planar_reflection_visible = true;
-		XMVECTOR _refPlane = XMPlaneFromPointNormal(XMVectorSet(0, vis.scene->weather.oceanParameters.waterHeight, 0, 0), XMVectorSet(0, 1, 0, 0));
-		XMStoreFloat4(&vis.reflectionPlane, _refPlane);
+		Visibility& vis = *visibilities[view];
+
+		// finalize stream compaction:
+		vis.visibleObjects.resize((size_t)vis.object_counter.load());
+		vis.visibleDecals.resize((size_t)vis.decal_counter.load());
+
+		if ((vis.flags & Visibility::ALLOW_REQUEST_REFLECTION) && scene->weather.IsOceanEnabled())
+		{
+			// Ocean will override any current reflectors
+			vis.planar_reflection_visible = true;
+			XMVECTOR _refPlane = XMPlaneFromPointNormal(XMVectorSet(0, scene->weather.oceanParameters.waterHeight, 0, 0), XMVectorSet(0, 1, 0, 0));
+			XMStoreFloat4(&vis.reflectionPlane, _refPlane);
+		}
 	}
 
 	wi::profiler::EndRange(range); // Frustum Culling
@@ -3225,45 +3453,60 @@ void UpdateRenderData(
 	auto prof_updatebuffer_cpu = wi::profiler::BeginRangeCPU("Update Buffers (CPU)");
 	auto prof_updatebuffer_gpu = wi::profiler::BeginRangeGPU("Update Buffers (GPU)", cmd);
 
+	// Mesh geometry uploads and defragmentation:
+	wi::scene::GetGeometryArena().Flush(cmd);
+
 	device->UpdateBuffer(&constantBuffers[CBTYPE_FRAME], &frameCB, cmd);
 	barrier_stack[cmd].push_back(GPUBarrier::Buffer(&constantBuffers[CBTYPE_FRAME], ResourceState::COPY_DST, ResourceState::CONSTANT_BUFFER));
 
-	if (vis.scene->instanceBuffer.IsValid() && vis.scene->instanceArraySize > 0)
+	if (vis.scene->instanceBuffer.IsValid() && !vis.scene->instanceArray.ranges.empty())
 	{
-		device->CopyBuffer(
-			&vis.scene->instanceBuffer,
-			0,
-			&vis.scene->instanceUploadBuffer[device->GetBufferIndex()],
-			0,
-			vis.scene->instanceArraySize * sizeof(ShaderMeshInstance),
-			cmd
-		);
+		// Only the ranges that were changed in the last scene update are copied:
+		for (auto& range : vis.scene->instanceArray.ranges)
+		{
+			device->CopyBuffer(
+				&vis.scene->instanceBuffer,
+				range.offset * sizeof(ShaderMeshInstance),
+				&vis.scene->instanceUploadBuffer[device->GetBufferIndex()],
+				range.offset * sizeof(ShaderMeshInstance),
+				range.count * sizeof(ShaderMeshInstance),
+				cmd
+			);
+		}
 		barrier_stack[cmd].push_back(GPUBarrier::Buffer(&vis.scene->instanceBuffer, ResourceState::COPY_DST, ResourceState::SHADER_RESOURCE));
 	}
 
-	if (vis.scene->meshBuffer.IsValid() && vis.scene->meshArraySize > 0)
+	if (vis.scene->meshBuffer.IsValid() && !vis.scene->meshArray.ranges.empty())
 	{
-		device->CopyBuffer(
-			&vis.scene->meshBuffer,
-			0,
-			&vis.scene->meshUploadBuffer[device->GetBufferIndex()],
-			0,
-			vis.scene->meshArraySize * sizeof(ShaderMesh),
-			cmd
-		);
+		// Only the ranges that were changed in the last scene update are copied:
+		for (auto& range : vis.scene->meshArray.ranges)
+		{
+			device->CopyBuffer(
+				&vis.scene->meshBuffer,
+				range.offset * sizeof(ShaderMesh),
+				&vis.scene->meshUploadBuffer[device->GetBufferIndex()],
+				range.offset * sizeof(ShaderMesh),
+				range.count * sizeof(ShaderMesh),
+				cmd
+			);
+		}
 		barrier_stack[cmd].push_back(GPUBarrier::Buffer(&vis.scene->meshBuffer, ResourceState::COPY_DST, ResourceState::SHADER_RESOURCE));
 	}
 
-	if (vis.scene->materialBuffer.IsValid() && vis.scene->materialArraySize > 0)
+	if (vis.scene->materialBuffer.IsValid() && !vis.scene->materialArray.ranges.empty())
 	{
-		device->CopyBuffer(
-			&vis.scene->materialBuffer,
-			0,
-			&vis.scene->materialUploadBuffer[device->GetBufferIndex()],
-			0,
-			vis.scene->materialArraySize * sizeof(ShaderMaterial),
-			cmd
-		);
+		// Only the ranges that were changed in the last scene update are copied:
+		for (auto& range : vis.scene->materialArray.ranges)
+		{
+			device->CopyBuffer(
+				&vis.scene->materialBuffer,
+				range.offset * sizeof(ShaderMaterial),
+				&vis.scene->materialUploadBuffer[device->GetBufferIndex()],
+				range.offset * sizeof(ShaderMaterial),
+				range.count * sizeof(ShaderMaterial),
+				cmd
+			);
+		}
 		barrier_stack[cmd].push_back(GPUBarrier::Buffer(&vis.scene->materialBuffer, ResourceState::COPY_DST, ResourceState::SHADER_RESOURCE));
 	}
 
@@ -3385,7 +3628,7 @@ void UpdateRenderData(
 				break;
 			}
 
-			uint16_t lightIndex = visibleLight.index;
+			uint32_t lightIndex = visibleLight.index;
 			const LightComponent& light = vis.scene->lights[lightIndex];
 
 			entityArray[entityCounter] = {}; // zero out!
@@ -3584,7 +3827,6 @@ void UpdateRenderData(
 		{
 			Entity entity = vis.scene->meshes.GetEntity(i);
 			const MeshComponent& mesh = vis.scene->meshes[i];
-			barrier_stack[cmd].push_back(GPUBarrier::Buffer(&mesh.indexBuffer, ResourceState::UNDEFINED, ResourceState::INDEX_BUFFER | ResourceState::SHADER_RESOURCE));
 
 			if (mesh.dirty_subsets)
 			{
@@ -3605,14 +3847,10 @@ void UpdateRenderData(
 				barrier_stack[cmd].push_back(GPUBarrier::Buffer(&mesh.subsetBuffer, ResourceState::COPY_DST, ResourceState::SHADER_RESOURCE));
 			}
 
-			if (mesh.dirty_morph)
-			{
-				mesh.dirty_morph = false;
-				device->UpdateBuffer(&mesh.vertexBuffer_POS, mesh.vertex_positions_morphed.data(), cmd);
-				barrier_stack[cmd].push_back(GPUBarrier::Buffer(&mesh.vertexBuffer_POS, ResourceState::COPY_DST, ResourceState::SHADER_RESOURCE));
-			}
+			// The morphed vertices were written to the geometry arena by the scene update:
+			mesh.dirty_morph = false;
 
-			if (mesh.IsSkinned() && vis.scene->armatures.Contains(mesh.armatureID))
+			if (mesh.IsSkinned() && mesh.IsGeometryReady() && vis.scene->armatures.Contains(mesh.armatureID))
 			{
 				const SoftBodyPhysicsComponent* softbody = vis.scene->softbodies.GetComponent(entity);
 				if (softbody != nullptr && softbody->physicsobject != nullptr)
@@ -3628,9 +3866,9 @@ void UpdateRenderData(
 
 				SkinningPushConstants push;
 				push.bonebuffer_index = device->GetDescriptorIndex(&armature.boneBuffer, SubresourceType::SRV);
-				push.vb_pos_nor_wind = device->GetDescriptorIndex(&mesh.vertexBuffer_POS, SubresourceType::SRV);
-				push.vb_tan = device->GetDescriptorIndex(&mesh.vertexBuffer_TAN, SubresourceType::SRV);
-				push.vb_bon = device->GetDescriptorIndex(&mesh.vertexBuffer_BON, SubresourceType::SRV);
+				push.vb_pos_nor_wind = mesh.GetVertexView(MeshComponent::VERTEX_STREAM_POS).descriptor;
+				push.vb_tan = mesh.GetVertexView(MeshComponent::VERTEX_STREAM_TAN).descriptor;
+				push.vb_bon = mesh.GetVertexView(MeshComponent::VERTEX_STREAM_BON).descriptor;
 				push.so_pos_nor_wind = device->GetDescriptorIndex(&mesh.streamoutBuffer_POS, SubresourceType::UAV);
 				push.so_tan = device->GetDescriptorIndex(&mesh.streamoutBuffer_TAN, SubresourceType::UAV);
 				device->PushConstants(&push, sizeof(push), cmd);
@@ -4199,7 +4437,7 @@ void DrawLightVisualizers(
 
 			for (auto visibleLight : vis.visibleLights)
 			{
-				uint16_t lightIndex = visibleLight.index;
+				uint32_t lightIndex = visibleLight.index;
 				const LightComponent& light = vis.scene->lights[lightIndex];
 
 				if (light.GetType() == type && light.IsVisualizerEnabled())
@@ -4342,7 +4580,7 @@ void DrawLensFlares(
 
 	for (auto visibleLight : vis.visibleLights)
 	{
-		uint16_t lightIndex = visibleLight.index;
+		uint32_t lightIndex = visibleLight.index;
 		const LightComponent& light = vis.scene->lights[lightIndex];
 
 		if (!light.lensFlareRimTextures.empty())
@@ -4606,7 +4844,7 @@ void DrawShadowmaps(
 				break;
 			}
 
-			uint16_t lightIndex = visibleLight.index;
+			uint32_t lightIndex = visibleLight.index;
 			const LightComponent& light = vis.scene->lights[lightIndex];
 			
 			bool shadow = light.IsCastingShadow() && !light.IsStatic();
@@ -4670,10 +4908,10 @@ void DrawShadowmaps(
 						vp.max_depth = 1.0f;
 						device->BindViewports(1, &vp, cmd);
 
-						RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_OPAQUE, cmd);
+						RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_OPAQUE, cmd, false, &shcams[cascade].frustum, 1);
 						if (GetTransparentShadowsEnabled() && transparentShadowsRequested)
 						{
-							RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, cmd);
+							RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, cmd, false, &shcams[cascade].frustum, 1);
 						}
 
 						GetRenderFrameAllocator(cmd).free(sizeof(RenderBatch) * renderQueue.batchCount);
@@ -4743,10 +4981,10 @@ void DrawShadowmaps(
 					device->BindViewports(1, &vp, cmd);
 
 					device->RenderPassBegin(&renderpasses_shadow2D[slice], cmd);
-					RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_OPAQUE, cmd);
+					RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_OPAQUE, cmd, false, &shcam.frustum, 1);
 					if (GetTransparentShadowsEnabled() && transparentShadowsRequested)
 					{
-						RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, cmd);
+						RenderMeshes(vis, renderQueue, RENDERPASS_SHADOW, RENDERTYPE_TRANSPARENT | RENDERTYPE_WATER, cmd, false, &shcam.frustum, 1);
 					}
 					device->RenderPassEnd(cmd);
 
@@ -5808,13 +6046,16 @@ void DrawDebugWorld(
 				// Draw mesh wireframe:
 				device->BindPipelineState(&PSO_debug[DEBUGRENDERING_EMITTER], cmd);
 				const GPUBuffer* vbs[] = {
-					mesh->streamoutBuffer_POS.IsValid() ? &mesh->streamoutBuffer_POS : &mesh->vertexBuffer_POS,
+					mesh->streamoutBuffer_POS.IsValid() ? &mesh->streamoutBuffer_POS : mesh->GetVertexBuffer(),
 				};
 				const uint32_t strides[] = {
 					sizeof(MeshComponent::Vertex_POS),
 				};
-				device->BindVertexBuffers(vbs, 0, arraysize(vbs), strides, nullptr, cmd);
-				device->BindIndexBuffer(&mesh->indexBuffer, mesh->GetIndexFormat(), 0, cmd);
+				const uint64_t offsets[] = {
+					mesh->streamoutBuffer_POS.IsValid() ? 0 : mesh->GetVertexView(MeshComponent::VERTEX_STREAM_POS).offset,
+				};
+				device->BindVertexBuffers(vbs, 0, arraysize(vbs), strides, offsets, cmd);
+				device->BindIndexBuffer(mesh->GetIndexBuffer(), mesh->GetIndexFormat(), mesh->GetIndexView().offset, cmd);
 
 				device->DrawIndexed((uint32_t)mesh->indices.size(), 0, 0, cmd);
 			}
@@ -5833,6 +6074,9 @@ void DrawDebugWorld(
 		{
 			const ObjectComponent& object = *scene.objects.GetComponent(x.objectEntity);
 			const TransformComponent& transform = *scene.transforms.GetComponent(x.objectEntity);
+			const uint32_t meshIndex = (uint32_t)scene.meshes.GetIndex(object.meshID);
+			if (!CheckPushConstantMeshIndex(meshIndex))
+				continue;
 			const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
 			const MeshComponent::MeshSubset& subset = mesh.subsets[x.subset];
 			const MaterialComponent& material = *scene.materials.GetComponent(subset.materialID);
@@ -5842,7 +6086,7 @@ void DrawDebugWorld(
 			buff->instanceID = (uint)scene.objects.GetIndex(x.objectEntity);
 			buff->userdata = 0;
 
-			device->BindIndexBuffer(&mesh.indexBuffer, mesh.GetIndexFormat(), 0, cmd);
+			device->BindIndexBuffer(mesh.GetIndexBuffer(), mesh.GetIndexFormat(), mesh.GetIndexView().offset, cmd);
 
 			PaintRadiusCB cb;
 			cb.xPaintRadResolution = x.dimensions;
@@ -5853,7 +6097,7 @@ void DrawDebugWorld(
 
 			ObjectPushConstants push;
 			push.init(
-				(uint)scene.meshes.GetIndex(object.meshID),
+				meshIndex,
 				x.subset,
 				subset.materialIndex,
 				device->GetDescriptorIndex(&mem.buffer, SubresourceType::SRV),
@@ -6397,12 +6641,15 @@ void RefreshImpostors(const Scene& scene, CommandList cmd)
 		impostor.render_dirty = false;
 
 		Entity entity = scene.impostors.GetEntity(impostorIndex);
+		const uint32_t meshIndex = (uint32_t)scene.meshes.GetIndex(entity);
+		if (!CheckPushConstantMeshIndex(meshIndex))
+			continue;
 		const MeshComponent& mesh = *scene.meshes.GetComponent(entity);
 
 		// impostor camera will fit around mesh bounding sphere:
 		const Sphere boundingsphere = mesh.GetBoundingSphere();
 
-		device->BindIndexBuffer(&mesh.indexBuffer, mesh.GetIndexFormat(), 0, cmd);
+		device->BindIndexBuffer(mesh.GetIndexBuffer(), mesh.GetIndexFormat(), mesh.GetIndexView().offset, cmd);
 
 		for (int prop = 0; prop < 3; ++prop)
 		{
@@ -6448,7 +6695,10 @@ void RefreshImpostors(const Scene& scene, CommandList cmd)
 				viewport.width = (float)scene.impostorTextureDim;
 				device->BindViewports(1, &viewport, cmd);
 
-				for (size_t subsetIndex = 0; subsetIndex < mesh.subsets.size(); ++subsetIndex)
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 				{
 					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 					if (subset.indexCount == 0)
@@ -6459,7 +6709,7 @@ void RefreshImpostors(const Scene& scene, CommandList cmd)
 
 					ObjectPushConstants push;
 					push.init(
-						(uint)scene.meshes.GetIndex(entity),
+						meshIndex,
 						(uint)subsetIndex,
 						subset.materialIndex,
 						-1, 0
@@ -7240,7 +7490,7 @@ void RefreshLightmaps(const Scene& scene, CommandList cmd, uint8_t instanceInclu
 
 				const MeshComponent& mesh = *scene.meshes.GetComponent(object.meshID);
 				assert(!mesh.vertex_atlas.empty());
-				assert(mesh.vertexBuffer_ATL.IsValid());
+				assert(mesh.GetVertexView(MeshComponent::VERTEX_STREAM_ATL).IsValid());
 
 				const TextureDesc& desc = object.lightmap.GetDesc();
 
@@ -7266,19 +7516,19 @@ void RefreshLightmaps(const Scene& scene, CommandList cmd, uint8_t instanceInclu
 				device->BindDynamicConstantBuffer(misccb, CB_GETBINDSLOT(MiscCB), cmd);
 
 				const GPUBuffer* vbs[] = {
-					&mesh.vertexBuffer_POS,
-					&mesh.vertexBuffer_ATL,
+					mesh.GetVertexBuffer(),
+					mesh.GetVertexBuffer(),
 				};
 				uint32_t strides[] = {
 					sizeof(MeshComponent::Vertex_POS),
 					sizeof(MeshComponent::Vertex_TEX),
 				};
 				uint64_t offsets[] = {
-					0,
-					0,
+					mesh.GetVertexView(MeshComponent::VERTEX_STREAM_POS).offset,
+					mesh.GetVertexView(MeshComponent::VERTEX_STREAM_ATL).offset,
 				};
 				device->BindVertexBuffers(vbs, 0, arraysize(vbs), strides, offsets, cmd);
-				device->BindIndexBuffer(&mesh.indexBuffer, mesh.GetIndexFormat(), 0, cmd);
+				device->BindIndexBuffer(mesh.GetIndexBuffer(), mesh.GetIndexFormat(), mesh.GetIndexView().offset, cmd);
 
 				RaytracingCB cb;
 				cb.xTraceResolution.x = desc.width;
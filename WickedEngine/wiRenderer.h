@@ -107,9 +107,9 @@ namespace wi::renderer
 
 		struct VisibleLight
 		{
-			uint16_t index;
-			uint16_t distance;
-			constexpr operator uint32_t() const { return index | (uint32_t(distance) << 16u); }
+			uint32_t index;
+			uint32_t distance;
+			constexpr operator uint64_t() const { return uint64_t(index) | (uint64_t(distance) << 32ull); }
 		};
 		wi::vector<VisibleLight> visibleLights;
 
@@ -153,6 +153,10 @@ namespace wi::renderer
 
 	// Performs frustum culling.
 	void UpdateVisibility(Visibility& vis);
+	// Performs frustum culling for multiple views in one pass over the scene.
+	//	Every AABB is tested against all the view frustums, and each view receives its own compacted visibility lists.
+	//	All views must refer to the same scene
+	void UpdateVisibility(Visibility* const* visibilities, uint32_t count);
 	// Prepares the scene for rendering
 	void UpdatePerFrameData(
 		wi::scene::Scene& scene,
@@ -12,6 +12,8 @@
 #include "wiTimer.h"
 #include "wiUnorderedMap.h"
 
+#include "Utility/meshoptimizer/meshoptimizer.h"
+
 #include "shaders/ShaderInterop_SurfelGI.h"
 
 using namespace wi::ecs;
@@ -384,53 +386,54 @@ namespace wi::scene
 	{
 		GraphicsDevice* device = wi::graphics::GetDevice();
 
+		uint32_t first_subset = 0;
+		uint32_t last_subset = 0;
+		GetLODSubsetRange(0, first_subset, last_subset);
+
 		vertex_subsets.resize(vertex_positions.size());
-		uint32_t subsetCounter = 0;
-		for (auto& subset : subsets)
+		for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 		{
+			const MeshSubset& subset = subsets[subsetIndex];
 			for (uint32_t i = 0; i < subset.indexCount; ++i)
 			{
 				uint32_t index = indices[subset.indexOffset + i];
-				vertex_subsets[index] = subsetCounter;
+				vertex_subsets[index] = subsetIndex;
 			}
-			subsetCounter++;
 		}
 
+		GeometryArena& arena = GetGeometryArena();
+
 		// Create index buffer GPU data:
 		{
-			GPUBufferDesc bd;
-			bd.bind_flags = BindFlag::INDEX_BUFFER | BindFlag::SHADER_RESOURCE;
-			if (device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
-			{
-				bd.misc_flags |= ResourceMiscFlag::RAY_TRACING;
-			}
-
+			GeometryArena::Stream stream;
 			if (GetIndexFormat() == IndexBufferFormat::UINT32)
 			{
-				bd.stride = sizeof(uint32_t);
-				bd.format = Format::R32_UINT;
-				bd.size = uint32_t(sizeof(uint32_t) * indices.size());
-
 				// Use indices directly since vector is in correct format
 				static_assert(std::is_same<decltype(indices)::value_type, uint32_t>::value, "indices not in IndexBufferFormat::UINT32");
 
-				device->CreateBuffer(&bd, indices.data(), &indexBuffer);
-				device->SetName(&indexBuffer, "indexBuffer_32bit");
+				stream.data = indices.data();
+				stream.size = sizeof(uint32_t) * indices.size();
+				indexAllocation = arena.Allocate(GeometryArena::POOL_INDEX32, &stream, 1);
 			}
 			else
 			{
-				bd.stride = sizeof(uint16_t);
-				bd.format = Format::R16_UINT;
-				bd.size = uint32_t(sizeof(uint16_t) * indices.size());
-
 				wi::vector<uint16_t> gpuIndexData(indices.size());
 				std::copy(indices.begin(), indices.end(), gpuIndexData.begin());
 
-				device->CreateBuffer(&bd, gpuIndexData.data(), &indexBuffer);
-				device->SetName(&indexBuffer, "indexBuffer_16bit");
+				stream.data = gpuIndexData.data();
+				stream.size = sizeof(uint16_t) * gpuIndexData.size();
+				indexAllocation = arena.Allocate(GeometryArena::POOL_INDEX16, &stream, 1);
 			}
 		}
 
+		// The vertex streams are collected and allocated together:
+		GeometryArena::Stream streams[VERTEX_STREAM_COUNT];
+		wi::vector<Vertex_POS> vertices_pos;
+		wi::vector<Vertex_TAN> vertices_tan;
+		wi::vector<Vertex_TEX> vertices_uv0;
+		wi::vector<Vertex_TEX> vertices_uv1;
+		wi::vector<Vertex_BON> vertices_bon;
+		wi::vector<Vertex_TEX> vertices_atl;
 
 		XMFLOAT3 _min = XMFLOAT3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
 		XMFLOAT3 _max = XMFLOAT3(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
@@ -443,31 +446,21 @@ namespace wi::scene
 				dirty_morph = true;
 		    }
 
-			wi::vector<Vertex_POS> vertices(vertex_positions.size());
-			for (size_t i = 0; i < vertices.size(); ++i)
+			vertices_pos.resize(vertex_positions.size());
+			for (size_t i = 0; i < vertices_pos.size(); ++i)
 			{
 				const XMFLOAT3& pos = vertex_positions[i];
 			    XMFLOAT3 nor = vertex_normals.empty() ? XMFLOAT3(1, 1, 1) : vertex_normals[i];
 			    XMStoreFloat3(&nor, XMVector3Normalize(XMLoadFloat3(&nor)));
 				const uint8_t wind = vertex_windweights.empty() ? 0xFF : vertex_windweights[i];
-				vertices[i].FromFULL(pos, nor, wind);
+				vertices_pos[i].FromFULL(pos, nor, wind);
 
 				_min = wi::math::Min(_min, pos);
 				_max = wi::math::Max(_max, pos);
 			}
 
-			GPUBufferDesc bd;
-			bd.usage = Usage::DEFAULT;
-			bd.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::SHADER_RESOURCE;
-			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			if (device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
-			{
-				bd.misc_flags |= ResourceMiscFlag::RAY_TRACING;
-			}
-			bd.size = (uint32_t)(sizeof(Vertex_POS) * vertices.size());
-
-			device->CreateBuffer(&bd, vertices.data(), &vertexBuffer_POS);
-			device->SetName(&vertexBuffer_POS, "vertexBuffer_POS");
+			streams[VERTEX_STREAM_POS].data = vertices_pos.data();
+			streams[VERTEX_STREAM_POS].size = sizeof(Vertex_POS) * vertices_pos.size();
 		}
 
 		// vertexBuffer - TANGENTS
@@ -475,10 +468,11 @@ namespace wi::scene
 		{
 			if (vertex_tangents.empty())
 			{
-				// Generate tangents if not found:
+				// Generate tangents if not found, the simplified LOD triangles are not included:
 				vertex_tangents.resize(vertex_positions.size());
 
-				for (size_t i = 0; i < indices.size(); i += 3)
+				const size_t index_count = GetFullDetailIndexCount();
+				for (size_t i = 0; i < index_count; i += 3)
 				{
 					const uint32_t i0 = indices[i + 0];
 					const uint32_t i1 = indices[i + 1];
@@ -545,21 +539,14 @@ namespace wi::scene
 
 			}
 
-			wi::vector<Vertex_TAN> vertices(vertex_tangents.size());
+			vertices_tan.resize(vertex_tangents.size());
 			for (size_t i = 0; i < vertex_tangents.size(); ++i)
 			{
-				vertices[i].FromFULL(vertex_tangents[i]);
+				vertices_tan[i].FromFULL(vertex_tangents[i]);
 			}
 
-			GPUBufferDesc bd;
-			bd.usage = Usage::DEFAULT;
-			bd.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::SHADER_RESOURCE;
-			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			bd.stride = sizeof(Vertex_TAN);
-			bd.size = (uint32_t)(bd.stride * vertices.size());
-
-			device->CreateBuffer(&bd, vertices.data(), &vertexBuffer_TAN);
-			device->SetName(&vertexBuffer_TAN, "vertexBuffer_TAN");
+			streams[VERTEX_STREAM_TAN].data = vertices_tan.data();
+			streams[VERTEX_STREAM_TAN].size = sizeof(Vertex_TAN) * vertices_tan.size();
 		}
 
 		aabb = AABB(_min, _max);
@@ -567,8 +554,8 @@ namespace wi::scene
 		// skinning buffers:
 		if (!vertex_boneindices.empty())
 		{
-			wi::vector<Vertex_BON> vertices(vertex_boneindices.size());
-			for (size_t i = 0; i < vertices.size(); ++i)
+			vertices_bon.resize(vertex_boneindices.size());
+			for (size_t i = 0; i < vertices_bon.size(); ++i)
 			{
 				XMFLOAT4& wei = vertex_boneweights[i];
 				// normalize bone weights
@@ -580,16 +567,13 @@ namespace wi::scene
 					wei.z /= len;
 					wei.w /= len;
 				}
-				vertices[i].FromFULL(vertex_boneindices[i], wei);
+				vertices_bon[i].FromFULL(vertex_boneindices[i], wei);
 			}
 
-			GPUBufferDesc bd;
-			bd.bind_flags = BindFlag::SHADER_RESOURCE;
-			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			bd.size = (uint32_t)(sizeof(Vertex_BON) * vertices.size());
-
-			device->CreateBuffer(&bd, vertices.data(), &vertexBuffer_BON);
+			streams[VERTEX_STREAM_BON].data = vertices_bon.data();
+			streams[VERTEX_STREAM_BON].size = sizeof(Vertex_BON) * vertices_bon.size();
 
+			GPUBufferDesc bd;
 			bd.usage = Usage::DEFAULT;
 			bd.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::UNORDERED_ACCESS | BindFlag::SHADER_RESOURCE;
 			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
@@ -613,73 +597,52 @@ namespace wi::scene
 		// vertexBuffer - UV SET 0
 		if(!vertex_uvset_0.empty())
 		{
-			wi::vector<Vertex_TEX> vertices(vertex_uvset_0.size());
-			for (size_t i = 0; i < vertices.size(); ++i)
+			vertices_uv0.resize(vertex_uvset_0.size());
+			for (size_t i = 0; i < vertices_uv0.size(); ++i)
 			{
-				vertices[i].FromFULL(vertex_uvset_0[i]);
+				vertices_uv0[i].FromFULL(vertex_uvset_0[i]);
 			}
 
-			GPUBufferDesc bd;
-			bd.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::SHADER_RESOURCE;
-			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			bd.stride = sizeof(Vertex_TEX);
-			bd.size = (uint32_t)(bd.stride * vertices.size());
-
-			device->CreateBuffer(&bd, vertices.data(), &vertexBuffer_UV0);
-			device->SetName(&vertexBuffer_UV0, "vertexBuffer_UV0");
+			streams[VERTEX_STREAM_UV0].data = vertices_uv0.data();
+			streams[VERTEX_STREAM_UV0].size = sizeof(Vertex_TEX) * vertices_uv0.size();
 		}
 
 		// vertexBuffer - UV SET 1
 		if (!vertex_uvset_1.empty())
 		{
-			wi::vector<Vertex_TEX> vertices(vertex_uvset_1.size());
-			for (size_t i = 0; i < vertices.size(); ++i)
+			vertices_uv1.resize(vertex_uvset_1.size());
+			for (size_t i = 0; i < vertices_uv1.size(); ++i)
 			{
-				vertices[i].FromFULL(vertex_uvset_1[i]);
+				vertices_uv1[i].FromFULL(vertex_uvset_1[i]);
 			}
 
-			GPUBufferDesc bd;
-			bd.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::SHADER_RESOURCE;
-			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			bd.stride = sizeof(Vertex_TEX);
-			bd.size = (uint32_t)(bd.stride * vertices.size());
-
-			device->CreateBuffer(&bd, vertices.data(), &vertexBuffer_UV1);
-			device->SetName(&vertexBuffer_UV1, "vertexBuffer_UV1");
+			streams[VERTEX_STREAM_UV1].data = vertices_uv1.data();
+			streams[VERTEX_STREAM_UV1].size = sizeof(Vertex_TEX) * vertices_uv1.size();
 		}
 
 		// vertexBuffer - COLORS
 		if (!vertex_colors.empty())
 		{
-			GPUBufferDesc bd;
-			bd.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::SHADER_RESOURCE;
-			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			bd.stride = sizeof(Vertex_COL);
-			bd.size = (uint32_t)(bd.stride * vertex_colors.size());
-
-			device->CreateBuffer(&bd, vertex_colors.data(), &vertexBuffer_COL);
-			device->SetName(&vertexBuffer_COL, "vertexBuffer_COL");
+			streams[VERTEX_STREAM_COL].data = vertex_colors.data();
+			streams[VERTEX_STREAM_COL].size = sizeof(Vertex_COL) * vertex_colors.size();
 		}
 
 		// vertexBuffer - ATLAS
 		if (!vertex_atlas.empty())
 		{
-			wi::vector<Vertex_TEX> vertices(vertex_atlas.size());
-			for (size_t i = 0; i < vertices.size(); ++i)
+			vertices_atl.resize(vertex_atlas.size());
+			for (size_t i = 0; i < vertices_atl.size(); ++i)
 			{
-				vertices[i].FromFULL(vertex_atlas[i]);
+				vertices_atl[i].FromFULL(vertex_atlas[i]);
 			}
 
-			GPUBufferDesc bd;
-			bd.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::SHADER_RESOURCE;
-			bd.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			bd.stride = sizeof(Vertex_TEX);
-			bd.size = (uint32_t)(bd.stride * vertices.size());
-
-			device->CreateBuffer(&bd, vertices.data(), &vertexBuffer_ATL);
-			device->SetName(&vertexBuffer_ATL, "vertexBuffer_ATL");
+			streams[VERTEX_STREAM_ATL].data = vertices_atl.data();
+			streams[VERTEX_STREAM_ATL].size = sizeof(Vertex_TEX) * vertices_atl.size();
 		}
 
+		vertexAllocation = arena.Allocate(GeometryArena::POOL_VERTEX, streams, arraysize(streams));
+		geometry_generation = GetGeometryGeneration();
+
 		// vertexBuffer_PRE will be created on demand later!
 		vertexBuffer_PRE = GPUBuffer();
 
@@ -693,7 +656,7 @@ namespace wi::scene
 		dirty_subsets = true;
 
 
-		if (device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
+		if (device->CheckCapability(GraphicsDeviceCapability::RAYTRACING) && indexAllocation != nullptr && vertexAllocation != nullptr)
 		{
 			BLAS_state = MeshComponent::BLAS_STATE_NEEDS_REBUILD;
 
@@ -710,16 +673,26 @@ namespace wi::scene
 				desc.flags |= RaytracingAccelerationStructureDesc::FLAG_PREFER_FAST_TRACE;
 			}
 
-			for (auto& subset : subsets)
+			// Only the full detail LOD is used for ray tracing:
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 			{
+				const MeshSubset& subset = subsets[subsetIndex];
 				desc.bottom_level.geometries.emplace_back();
 				auto& geometry = desc.bottom_level.geometries.back();
 				geometry.type = RaytracingAccelerationStructureDesc::BottomLevel::Geometry::Type::TRIANGLES;
-				geometry.triangles.vertex_buffer = streamoutBuffer_POS.IsValid() ? streamoutBuffer_POS : vertexBuffer_POS;
-				geometry.triangles.index_buffer = indexBuffer;
+				if (streamoutBuffer_POS.IsValid())
+				{
+					geometry.triangles.vertex_buffer = streamoutBuffer_POS;
+				}
+				else
+				{
+					geometry.triangles.vertex_buffer = vertexAllocation->buffer;
+					geometry.triangles.vertex_byte_offset = (uint32_t)GetVertexView(VERTEX_STREAM_POS).offset;
+				}
+				geometry.triangles.index_buffer = indexAllocation->buffer;
 				geometry.triangles.index_format = GetIndexFormat();
 				geometry.triangles.index_count = subset.indexCount;
-				geometry.triangles.index_offset = subset.indexOffset;
+				geometry.triangles.index_offset = GetIndexOffset() + subset.indexOffset;
 				geometry.triangles.vertex_count = (uint32_t)vertex_positions.size();
 				geometry.triangles.vertex_format = Format::R32G32B32_FLOAT;
 				geometry.triangles.vertex_stride = sizeof(MeshComponent::Vertex_POS);
@@ -734,14 +707,14 @@ namespace wi::scene
 	{
 		dest->init();
 		GraphicsDevice* device = wi::graphics::GetDevice();
-		dest->ib = device->GetDescriptorIndex(&indexBuffer, SubresourceType::SRV);
+		dest->ib = GetIndexView().descriptor;
 		if (streamoutBuffer_POS.IsValid())
 		{
 			dest->vb_pos_nor_wind = device->GetDescriptorIndex(&streamoutBuffer_POS, SubresourceType::SRV);
 		}
 		else
 		{
-			dest->vb_pos_nor_wind = device->GetDescriptorIndex(&vertexBuffer_POS, SubresourceType::SRV);
+			dest->vb_pos_nor_wind = GetVertexView(VERTEX_STREAM_POS).descriptor;
 		}
 		if (streamoutBuffer_TAN.IsValid())
 		{
@@ -749,12 +722,12 @@ namespace wi::scene
 		}
 		else
 		{
-			dest->vb_tan = device->GetDescriptorIndex(&vertexBuffer_TAN, SubresourceType::SRV);
+			dest->vb_tan = GetVertexView(VERTEX_STREAM_TAN).descriptor;
 		}
-		dest->vb_col = device->GetDescriptorIndex(&vertexBuffer_COL, SubresourceType::SRV);
-		dest->vb_uv0 = device->GetDescriptorIndex(&vertexBuffer_UV0, SubresourceType::SRV);
-		dest->vb_uv1 = device->GetDescriptorIndex(&vertexBuffer_UV1, SubresourceType::SRV);
-		dest->vb_atl = device->GetDescriptorIndex(&vertexBuffer_ATL, SubresourceType::SRV);
+		dest->vb_col = GetVertexView(VERTEX_STREAM_COL).descriptor;
+		dest->vb_uv0 = GetVertexView(VERTEX_STREAM_UV0).descriptor;
+		dest->vb_uv1 = GetVertexView(VERTEX_STREAM_UV1).descriptor;
+		dest->vb_atl = GetVertexView(VERTEX_STREAM_ATL).descriptor;
 		dest->vb_pre = device->GetDescriptorIndex(&vertexBuffer_PRE, SubresourceType::SRV);
 		dest->blendmaterial1 = terrain_material1_index;
 		dest->blendmaterial2 = terrain_material2_index;
@@ -792,6 +765,8 @@ namespace wi::scene
 			wi::vector<XMFLOAT4> newBoneWeightsBuffer;
 			wi::vector<uint32_t> newColorsBuffer;
 
+			// The full detail faces come first, so their new vertices are the same as without LODs
+			//	The simplified LOD faces get their own vertices, and hard normals are per face, so they don't change the full detail normals
 			for (size_t face = 0; face < indices.size() / 3; face++)
 			{
 				uint32_t i0 = indices[face * 3 + 0];
@@ -899,12 +874,13 @@ namespace wi::scene
 				vertex_normals[i] = XMFLOAT3(0, 0, 0);
 			}
 
-			// 2.) Find identical vertices by POSITION, accumulate face normals
+			// 2.) Find identical vertices by POSITION, accumulate face normals of the full detail faces
+			const size_t face_count = GetFullDetailIndexCount() / 3;
 			for (size_t i = 0; i < vertex_positions.size(); i++)
 			{
 				XMFLOAT3& v_search_pos = vertex_positions[i];
 
-				for (size_t ind = 0; ind < indices.size() / 3; ++ind)
+				for (size_t ind = 0; ind < face_count; ++ind)
 				{
 					uint32_t i0 = indices[ind * 3 + 0];
 					uint32_t i1 = indices[ind * 3 + 1];
@@ -949,6 +925,7 @@ namespace wi::scene
 			}
 
 			// 3.) Find duplicated vertices by POSITION and UV0 and UV1 and ATLAS and SUBSET and remove them:
+			//	The vertices of the LOD faces are after the full detail ones, so removing their duplicates doesn't change the full detail vertices
 			for (auto& subset : subsets)
 			{
 				for (uint32_t i = 0; i < subset.indexCount - 1; i++)
@@ -1051,7 +1028,8 @@ namespace wi::scene
 			{
 				vertex_normals[i] = XMFLOAT3(0, 0, 0);
 			}
-			for (size_t i = 0; i < indices.size() / 3; ++i)
+			const size_t face_count = GetFullDetailIndexCount() / 3;
+			for (size_t i = 0; i < face_count; ++i)
 			{
 				uint32_t index1 = indices[i * 3];
 				uint32_t index2 = indices[i * 3 + 1];
@@ -1082,6 +1060,11 @@ namespace wi::scene
 
 		vertex_tangents.clear(); // <- will be recomputed
 
+		if (!meshlets.empty())
+		{
+			BuildMeshlets(); // <- indices could have changed
+		}
+
 		CreateRenderData(); // <- normals will be normalized here!
 	}
 	void MeshComponent::FlipCulling()
@@ -1097,6 +1080,11 @@ namespace wi::scene
 			indices[face * 3 + 2] = i1;
 		}
 
+		if (!meshlets.empty())
+		{
+			BuildMeshlets(); // <- normal cones are flipped
+		}
+
 		CreateRenderData();
 	}
 	void MeshComponent::FlipNormals()
@@ -1147,6 +1135,201 @@ namespace wi::scene
 
 		return sphere;
 	}
+	void MeshComponent::GenerateLODs(uint32_t lod_count, float target_error)
+	{
+		if (vertex_positions.empty() || subsets.empty())
+			return;
+
+		// Remove previously generated LODs, only the full detail subsets are kept as source:
+		if (subsets_per_lod > 0)
+		{
+			indices.resize(GetFullDetailIndexCount());
+			subsets.resize(subsets_per_lod);
+		}
+		subsets_per_lod = (uint32_t)subsets.size();
+
+		// The renderer stores subset indices in 8 bits, so all LODs must fit in 256 subsets:
+		const uint32_t max_lod_count = std::max(1u, 256u / subsets_per_lod);
+		if (lod_count > max_lod_count)
+		{
+			wi::backlog::post("MeshComponent::GenerateLODs: LOD count reduced from " + std::to_string(lod_count) + " to " + std::to_string(max_lod_count) + ", because the mesh has " + std::to_string(subsets_per_lod) + " subsets", wi::backlog::LogLevel::Warning);
+			lod_count = max_lod_count;
+		}
+
+		wi::vector<uint32_t> lod_indices;
+		wi::vector<MeshSubset> lod_subsets;
+		for (uint32_t lod = 1; lod < lod_count; ++lod)
+		{
+			lod_subsets.clear();
+			bool simplified = false;
+			for (uint32_t subsetIndex = 0; subsetIndex < subsets_per_lod; ++subsetIndex)
+			{
+				// The previous LOD of the same subset is simplified further:
+				const MeshSubset& source = subsets[(lod - 1) * subsets_per_lod + subsetIndex];
+				const size_t target_index_count = size_t(source.indexCount / 3 / 2) * 3;
+
+				lod_indices.resize(source.indexCount);
+				size_t lod_index_count = meshopt_simplify(
+					lod_indices.data(),
+					indices.data() + source.indexOffset,
+					source.indexCount,
+					&vertex_positions[0].x,
+					vertex_positions.size(),
+					sizeof(XMFLOAT3),
+					target_index_count,
+					target_error
+				);
+
+				MeshSubset& subset = lod_subsets.emplace_back(source);
+				if (lod_index_count == 0 || lod_index_count >= source.indexCount)
+				{
+					// The subset can't be simplified further, the previous level's indices are reused, so that it doesn't disappear:
+					continue;
+				}
+				subset.indexOffset = (uint32_t)indices.size();
+				subset.indexCount = (uint32_t)lod_index_count;
+				indices.insert(indices.end(), lod_indices.begin(), lod_indices.begin() + lod_index_count);
+				simplified = true;
+			}
+			if (!simplified)
+			{
+				// This level would be the same as the previous one, no more levels are added:
+				break;
+			}
+			subsets.insert(subsets.end(), lod_subsets.begin(), lod_subsets.end());
+		}
+
+		CreateRenderData();
+	}
+	void MeshComponent::BuildMeshlets(uint32_t max_vertices, uint32_t max_triangles, float cone_weight)
+	{
+		meshlets.clear();
+		if (vertex_positions.empty() || subsets.empty())
+			return;
+
+		uint32_t first_subset = 0;
+		uint32_t last_subset = 0;
+		GetLODSubsetRange(0, first_subset, last_subset);
+
+		wi::vector<meshopt_Meshlet> clusters;
+		wi::vector<uint32_t> cluster_vertices;
+		wi::vector<uint8_t> cluster_triangles;
+		for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+		{
+			const MeshSubset& subset = subsets[subsetIndex];
+			if (subset.indexCount == 0)
+				continue;
+
+			const uint32_t* subset_indices = indices.data() + subset.indexOffset;
+			const size_t max_clusters = meshopt_buildMeshletsBound(subset.indexCount, max_vertices, max_triangles);
+			clusters.resize(max_clusters);
+			cluster_vertices.resize(max_clusters * max_vertices);
+			cluster_triangles.resize(max_clusters * max_triangles * 3);
+
+			const size_t cluster_count = meshopt_buildMeshlets(
+				clusters.data(),
+				cluster_vertices.data(),
+				cluster_triangles.data(),
+				subset_indices,
+				subset.indexCount,
+				&vertex_positions[0].x,
+				vertex_positions.size(),
+				sizeof(XMFLOAT3),
+				max_vertices,
+				max_triangles,
+				cone_weight
+			);
+
+			// The subset indices are rewritten in meshlet order:
+			wi::vector<uint32_t> reordered_indices;
+			reordered_indices.reserve(subset.indexCount);
+			for (size_t clusterIndex = 0; clusterIndex < cluster_count; ++clusterIndex)
+			{
+				const meshopt_Meshlet& cluster = clusters[clusterIndex];
+				const meshopt_Bounds bounds = meshopt_computeMeshletBounds(
+					&cluster_vertices[cluster.vertex_offset],
+					&cluster_triangles[cluster.triangle_offset],
+					cluster.triangle_count,
+					&vertex_positions[0].x,
+					vertex_positions.size(),
+					sizeof(XMFLOAT3)
+				);
+
+				meshlets.emplace_back();
+				Meshlet& meshlet = meshlets.back();
+				meshlet.subsetIndex = subsetIndex;
+				meshlet.indexOffset = subset.indexOffset + (uint32_t)reordered_indices.size();
+				meshlet.indexCount = cluster.triangle_count * 3;
+				meshlet.center = XMFLOAT3(bounds.center[0], bounds.center[1], bounds.center[2]);
+				meshlet.radius = bounds.radius;
+				meshlet.cone_apex = XMFLOAT3(bounds.cone_apex[0], bounds.cone_apex[1], bounds.cone_apex[2]);
+				meshlet.cone_axis = XMFLOAT3(bounds.cone_axis[0], bounds.cone_axis[1], bounds.cone_axis[2]);
+				meshlet.cone_cutoff = bounds.cone_cutoff;
+
+				for (uint32_t i = 0; i < meshlet.indexCount; ++i)
+				{
+					reordered_indices.push_back(cluster_vertices[cluster.vertex_offset + cluster_triangles[cluster.triangle_offset + i]]);
+				}
+			}
+
+			assert(reordered_indices.size() == subset.indexCount);
+			std::copy(reordered_indices.begin(), reordered_indices.end(), indices.begin() + subset.indexOffset);
+		}
+	}
+	uint32_t MeshComponent::CullMeshlets(const XMMATRIX& world, const wi::primitive::Frustum& frustum, const XMFLOAT3* eye, wi::vector<MeshletRange>& result) const
+	{
+		// Uniform scale is assumed for the bounding sphere, so the largest axis scale is used:
+		const float scale_x = XMVectorGetX(XMVector3Length(world.r[0]));
+		const float scale_y = XMVectorGetX(XMVector3Length(world.r[1]));
+		const float scale_z = XMVectorGetX(XMVector3Length(world.r[2]));
+		const float scale = std::max(scale_x, std::max(scale_y, scale_z));
+
+		// Cone culling is done in local space, which is only correct if the transform preserves angles:
+		//	mirroring transforms flip the winding order, and non-uniform scale changes the angles between the normals and the view direction
+		const float min_scale = std::min(scale_x, std::min(scale_y, scale_z));
+		const bool uniform_scale = scale - min_scale <= scale * 0.001f;
+		bool cone_culling = eye != nullptr && uniform_scale && XMVectorGetX(XMMatrixDeterminant(world)) > 0;
+		XMVECTOR eye_local = XMVectorZero();
+		if (cone_culling)
+		{
+			eye_local = XMVector3Transform(XMLoadFloat3(eye), XMMatrixInverse(nullptr, world));
+		}
+
+		uint32_t culled = 0;
+		for (auto& meshlet : meshlets)
+		{
+			XMFLOAT3 center;
+			XMStoreFloat3(&center, XMVector3Transform(XMLoadFloat3(&meshlet.center), world));
+			bool visible = frustum.CheckSphere(center, meshlet.radius * scale);
+
+			if (visible && cone_culling)
+			{
+				const XMVECTOR apex = XMLoadFloat3(&meshlet.cone_apex);
+				const XMVECTOR axis = XMLoadFloat3(&meshlet.cone_axis);
+				visible = XMVectorGetX(XMVector3Dot(XMVector3Normalize(apex - eye_local), axis)) < meshlet.cone_cutoff;
+			}
+
+			if (!visible)
+			{
+				culled++;
+				continue;
+			}
+
+			if (!result.empty() && result.back().subsetIndex == meshlet.subsetIndex && result.back().indexOffset + result.back().indexCount == meshlet.indexOffset)
+			{
+				result.back().indexCount += meshlet.indexCount;
+			}
+			else
+			{
+				result.emplace_back();
+				MeshletRange& range = result.back();
+				range.subsetIndex = meshlet.subsetIndex;
+				range.indexOffset = meshlet.indexOffset;
+				range.indexCount = meshlet.indexCount;
+			}
+		}
+		return culled;
+	}
 
 	void ObjectComponent::ClearLightmap()
 	{
@@ -1312,9 +1495,29 @@ namespace wi::scene
 	void SoftBodyPhysicsComponent::CreateFromMesh(const MeshComponent& mesh)
 	{
 		vertex_positions_simulation.resize(mesh.vertex_positions.size());
-		vertex_tangents_tmp.resize(mesh.vertex_tangents.size());
 		vertex_tangents_simulation.resize(mesh.vertex_tangents.size());
 
+		// The triangles of every vertex are gathered, so that tangents can be rebuilt for vertex ranges independently:
+		//	Only the full detail triangles are simulated, the simplified LOD triangles use the same vertices
+		triangle_tangents_tmp.resize(mesh.GetFullDetailIndexCount() / 3);
+		vertex_triangle_offsets.clear();
+		vertex_triangle_offsets.resize(vertex_positions_simulation.size() + 1);
+		for (size_t i = 0; i < triangle_tangents_tmp.size() * 3; ++i)
+		{
+			vertex_triangle_offsets[mesh.indices[i] + 1]++;
+		}
+		for (size_t i = 1; i < vertex_triangle_offsets.size(); ++i)
+		{
+			vertex_triangle_offsets[i] += vertex_triangle_offsets[i - 1];
+		}
+		vertex_triangles.resize(triangle_tangents_tmp.size() * 3);
+		wi::vector<uint32_t> vertex_triangle_counts(vertex_positions_simulation.size());
+		for (size_t i = 0; i < vertex_triangles.size(); ++i)
+		{
+			const uint32_t vertexID = mesh.indices[i];
+			vertex_triangles[vertex_triangle_offsets[vertexID] + vertex_triangle_counts[vertexID]++] = uint32_t(i / 3);
+		}
+
 		XMMATRIX W = XMLoadFloat4x4(&worldMatrix);
 		XMFLOAT3 _min = XMFLOAT3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
 		XMFLOAT3 _max = XMFLOAT3(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
@@ -1463,9 +1666,14 @@ namespace wi::scene
 
 		GraphicsDevice* device = wi::graphics::GetDevice();
 
+		// New mesh geometry gets its descriptors here, before the mesh shader data is written:
+		GetGeometryArena().Update();
+
 		instanceArraySize = objects.GetCount() + hairs.GetCount() + emitters.GetCount();
+		bool instanceBufferRecreated = false;
 		if (instanceBuffer.desc.size < (instanceArraySize * sizeof(ShaderMeshInstance)))
 		{
+			instanceBufferRecreated = true;
 			GPUBufferDesc desc;
 			desc.stride = sizeof(ShaderMeshInstance);
 			desc.size = desc.stride * instanceArraySize * 2; // *2 to grow fast
@@ -1483,11 +1691,13 @@ namespace wi::scene
 				device->SetName(&instanceUploadBuffer[i], "instanceUploadBuffer");
 			}
 		}
-		instanceArrayMapped = (ShaderMeshInstance*)instanceUploadBuffer[device->GetBufferIndex()].mapped_data;
+		instanceArray.Begin(instanceUploadBuffer[device->GetBufferIndex()].mapped_data, instanceArraySize, instanceBufferRecreated);
 
 		meshArraySize = meshes.GetCount() + hairs.GetCount() + emitters.GetCount();
+		bool meshBufferRecreated = false;
 		if (meshBuffer.desc.size < (meshArraySize * sizeof(ShaderMesh)))
 		{
+			meshBufferRecreated = true;
 			GPUBufferDesc desc;
 			desc.stride = sizeof(ShaderMesh);
 			desc.size = desc.stride * meshArraySize * 2; // *2 to grow fast
@@ -1505,11 +1715,13 @@ namespace wi::scene
 				device->SetName(&meshUploadBuffer[i], "meshUploadBuffer");
 			}
 		}
-		meshArrayMapped = (ShaderMesh*)meshUploadBuffer[device->GetBufferIndex()].mapped_data;
+		meshArray.Begin(meshUploadBuffer[device->GetBufferIndex()].mapped_data, meshArraySize, meshBufferRecreated);
 
 		materialArraySize = materials.GetCount();
+		bool materialBufferRecreated = false;
 		if (materialBuffer.desc.size < (materialArraySize * sizeof(ShaderMaterial)))
 		{
+			materialBufferRecreated = true;
 			GPUBufferDesc desc;
 			desc.stride = sizeof(ShaderMaterial);
 			desc.size = desc.stride * materialArraySize * 2; // *2 to grow fast
@@ -1527,7 +1739,7 @@ namespace wi::scene
 				device->SetName(&materialUploadBuffer[i], "materialUploadBuffer");
 			}
 		}
-		materialArrayMapped = (ShaderMaterial*)materialUploadBuffer[device->GetBufferIndex()].mapped_data;
+		materialArray.Begin(materialUploadBuffer[device->GetBufferIndex()].mapped_data, materialArraySize, materialBufferRecreated);
 
 		TLAS_instancesMapped = nullptr;
 		if (device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
@@ -1640,6 +1852,12 @@ namespace wi::scene
 
 		wi::jobsystem::Wait(ctx); // dependencies
 
+		// Upload only the changed shader data (depends on all systems that write shader data):
+		instanceArray.Flush(ctx);
+		meshArray.Flush(ctx);
+		materialArray.Flush(ctx);
+		wi::jobsystem::Wait(ctx); // the upload jobs use ctx and the ranges, they must finish before UpdateRenderData()
+
 		// Merge parallel bounds computation (depends on object update system):
 		bounds = AABB();
 		for (auto& group_bound : parallel_bounds)
@@ -1846,6 +2064,7 @@ namespace wi::scene
 		TLAS = RaytracingAccelerationStructure();
 		BVH.Clear();
 		waterRipples.clear();
+		physics_scene.reset();
 
 		surfelBuffer = {};
 		surfelDataBuffer = {};
@@ -1858,6 +2077,17 @@ namespace wi::scene
 	}
 	void Scene::Merge(Scene& other)
 	{
+		// Physics objects of the other scene are in its own physics world, they will be recreated in this scene's world:
+		for (size_t i = 0; i < other.rigidbodies.GetCount(); ++i)
+		{
+			other.rigidbodies[i].physicsobject = nullptr;
+		}
+		for (size_t i = 0; i < other.softbodies.GetCount(); ++i)
+		{
+			other.softbodies[i].physicsobject = nullptr;
+		}
+		other.physics_scene.reset();
+
 		names.Merge(other.names);
 		layers.Merge(other.layers);
 		transforms.Merge(other.transforms);
@@ -2883,9 +3113,23 @@ namespace wi::scene
 				const SoftBodyPhysicsComponent* softbody = softbodies.GetComponent(entity);
 				if (softbody != nullptr && wi::physics::IsSimulationEnabled())
 				{
-					device->CreateBuffer(&mesh.vertexBuffer_POS.desc, nullptr, &mesh.streamoutBuffer_POS);
-					device->CreateBuffer(&mesh.vertexBuffer_POS.desc, nullptr, &mesh.vertexBuffer_PRE);
-					device->CreateBuffer(&mesh.vertexBuffer_TAN.desc, nullptr, &mesh.streamoutBuffer_TAN);
+					GPUBufferDesc desc;
+					desc.bind_flags = BindFlag::VERTEX_BUFFER | BindFlag::SHADER_RESOURCE;
+					desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
+					if (device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
+					{
+						desc.misc_flags |= ResourceMiscFlag::RAY_TRACING;
+					}
+					desc.size = sizeof(MeshComponent::Vertex_POS) * mesh.vertex_positions.size();
+					device->CreateBuffer(&desc, nullptr, &mesh.streamoutBuffer_POS);
+					device->CreateBuffer(&desc, nullptr, &mesh.vertexBuffer_PRE);
+					if (!mesh.vertex_tangents.empty())
+					{
+						desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
+						desc.stride = sizeof(MeshComponent::Vertex_TAN);
+						desc.size = desc.stride * mesh.vertex_tangents.size();
+						device->CreateBuffer(&desc, nullptr, &mesh.streamoutBuffer_TAN);
+					}
 				}
 				else if (mesh.IsSkinned() && armatures.Contains(mesh.armatureID))
 				{
@@ -2901,6 +3145,29 @@ namespace wi::scene
 				std::swap(mesh.streamoutBuffer_POS, mesh.vertexBuffer_PRE);
 			}
 
+			// The geometry arena moved the mesh data, so the ray tracing geometry must be updated:
+			const uint32_t geometry_generation = mesh.GetGeometryGeneration();
+			if (mesh.geometry_generation != geometry_generation)
+			{
+				mesh.geometry_generation = geometry_generation;
+				if (mesh.BLAS.IsValid())
+				{
+					uint32_t first_subset = 0;
+					uint32_t last_subset = 0;
+					mesh.GetLODSubsetRange(0, first_subset, last_subset);
+					for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+					{
+						auto& geometry = mesh.BLAS.desc.bottom_level.geometries[subsetIndex - first_subset];
+						if (!mesh.streamoutBuffer_POS.IsValid())
+						{
+							geometry.triangles.vertex_byte_offset = (uint32_t)mesh.GetVertexView(MeshComponent::VERTEX_STREAM_POS).offset;
+						}
+						geometry.triangles.index_offset = mesh.GetIndexOffset() + mesh.subsets[subsetIndex].indexOffset;
+					}
+					mesh.BLAS_state = MeshComponent::BLAS_STATE_NEEDS_REBUILD;
+				}
+			}
+
 			uint32_t subsetIndex = 0;
 			for (auto& subset : mesh.subsets)
 			{
@@ -2908,7 +3175,7 @@ namespace wi::scene
 				if (material != nullptr)
 				{
 					subset.materialIndex = (uint32_t)materials.GetIndex(subset.materialID);
-					if (mesh.BLAS.IsValid())
+					if (mesh.BLAS.IsValid() && subsetIndex < (uint32_t)mesh.BLAS.desc.bottom_level.geometries.size())
 					{
 						auto& geometry = mesh.BLAS.desc.bottom_level.geometries[subsetIndex];
 						uint32_t flags = geometry.flags;
@@ -2928,6 +3195,7 @@ namespace wi::scene
 						{
 							mesh.BLAS_state = MeshComponent::BLAS_STATE_NEEDS_REBUILD;
 							geometry.triangles.vertex_buffer = mesh.streamoutBuffer_POS;
+							geometry.triangles.vertex_byte_offset = 0;
 						}
 						if (material->IsDoubleSided())
 						{
@@ -2988,9 +3256,23 @@ namespace wi::scene
 			    }
 
 			    mesh.aabb = AABB(_min, _max);
+
+				// The morphed positions overwrite the position stream in the geometry arena:
+				if (mesh.vertexAllocation != nullptr)
+				{
+					const GeometryArena::View view = mesh.GetVertexView(MeshComponent::VERTEX_STREAM_POS);
+					GetGeometryArena().Write(
+						mesh.vertexAllocation,
+						view.offset - mesh.vertexAllocation->offset,
+						mesh.vertex_positions_morphed.data(),
+						sizeof(MeshComponent::Vertex_POS) * mesh.vertex_positions_morphed.size()
+					);
+				}
 			}
 
-			mesh.WriteShaderMesh(meshArrayMapped + args.jobIndex);
+			ShaderMesh shadermesh = ShaderMesh();
+			mesh.WriteShaderMesh(&shadermesh);
+			meshArray.Write(args.jobIndex, shadermesh);
 
 		});
 	}
@@ -3027,7 +3309,9 @@ namespace wi::scene
 				material.SetDirty(false);
 			}
 
-			material.WriteShaderMaterial(materialArrayMapped + args.jobIndex);
+			ShaderMaterial shadermaterial = ShaderMaterial();
+			material.WriteShaderMaterial(&shadermaterial);
+			materialArray.Write(args.jobIndex, shadermaterial);
 
 		});
 	}
@@ -3247,7 +3531,7 @@ namespace wi::scene
 					XMStoreFloat4x4(&transformIT, worldMatrixInverseTranspose);
 
 					GraphicsDevice* device = wi::graphics::GetDevice();
-					ShaderMeshInstance& inst = instanceArrayMapped[args.jobIndex];
+					ShaderMeshInstance inst = ShaderMeshInstance();
 					inst.init();
 					inst.transform.Create(worldMatrix);
 					inst.transformInverseTranspose.Create(transformIT);
@@ -3261,6 +3545,7 @@ namespace wi::scene
 					inst.color = wi::math::CompressColor(object.color);
 					inst.emissive = wi::math::Pack_R11G11B10_FLOAT(XMFLOAT3(object.emissiveColor.x * object.emissiveColor.w, object.emissiveColor.y * object.emissiveColor.w, object.emissiveColor.z * object.emissiveColor.w));
 					inst.meshIndex = (uint)meshes.GetIndex(object.meshID);
+					instanceArray.Write(args.jobIndex, inst);
 
 					if (TLAS_instancesMapped != nullptr)
 					{
@@ -3664,7 +3949,7 @@ namespace wi::scene
 					GraphicsDevice* device = wi::graphics::GetDevice();
 
 					size_t meshIndex = meshes.GetCount() + args.jobIndex;
-					ShaderMesh& mesh = meshArrayMapped[meshIndex];
+					ShaderMesh mesh = ShaderMesh();
 					mesh.init();
 					mesh.ib = device->GetDescriptorIndex(&hair.primitiveBuffer, SubresourceType::SRV);
 					mesh.vb_pos_nor_wind = device->GetDescriptorIndex(&hair.vertexBuffer_POS[0], SubresourceType::SRV);
@@ -3672,9 +3957,10 @@ namespace wi::scene
 					mesh.vb_uv0 = device->GetDescriptorIndex(&hair.vertexBuffer_TEX, SubresourceType::SRV);
 					mesh.subsetbuffer = device->GetDescriptorIndex(&hair.subsetBuffer, SubresourceType::SRV);
 					mesh.flags = SHADERMESH_FLAG_DOUBLE_SIDED | SHADERMESH_FLAG_HAIRPARTICLE;
+					meshArray.Write(meshIndex, mesh);
 
 					size_t instanceIndex = objects.GetCount() + args.jobIndex;
-					ShaderMeshInstance& inst = instanceArrayMapped[instanceIndex];
+					ShaderMeshInstance inst = ShaderMeshInstance();
 					inst.init();
 					inst.uid = entity;
 					inst.layerMask = hair.layerMask;
@@ -3682,6 +3968,7 @@ namespace wi::scene
 					inst.transform.Create(wi::math::IDENTITY_MATRIX);
 					inst.transformPrev.Create(wi::math::IDENTITY_MATRIX);
 					inst.meshIndex = (uint)meshIndex;
+					instanceArray.Write(instanceIndex, inst);
 
 					if (TLAS_instancesMapped != nullptr && hair.BLAS.IsValid())
 					{
@@ -3741,7 +4028,7 @@ namespace wi::scene
 			GraphicsDevice* device = wi::graphics::GetDevice();
 
 			size_t meshIndex = meshes.GetCount() + hairs.GetCount() + args.jobIndex;
-			ShaderMesh& mesh = meshArrayMapped[meshIndex];
+			ShaderMesh mesh = ShaderMesh();
 			mesh.init();
 			mesh.ib = device->GetDescriptorIndex(&emitter.primitiveBuffer, SubresourceType::SRV);
 			mesh.vb_pos_nor_wind = device->GetDescriptorIndex(&emitter.vertexBuffer_POS, SubresourceType::SRV);
@@ -3750,9 +4037,10 @@ namespace wi::scene
 			mesh.vb_col = device->GetDescriptorIndex(&emitter.vertexBuffer_COL, SubresourceType::SRV);
 			mesh.subsetbuffer = device->GetDescriptorIndex(&emitter.subsetBuffer, SubresourceType::SRV);
 			mesh.flags = SHADERMESH_FLAG_DOUBLE_SIDED | SHADERMESH_FLAG_EMITTEDPARTICLE;
+			meshArray.Write(meshIndex, mesh);
 
 			size_t instanceIndex = objects.GetCount() + hairs.GetCount() + args.jobIndex;
-			ShaderMeshInstance& inst = instanceArrayMapped[instanceIndex];
+			ShaderMeshInstance inst = ShaderMeshInstance();
 			inst.init();
 			inst.uid = entity;
 			inst.layerMask = emitter.layerMask;
@@ -3760,6 +4048,7 @@ namespace wi::scene
 			inst.transform.Create(wi::math::IDENTITY_MATRIX);
 			inst.transformPrev.Create(wi::math::IDENTITY_MATRIX);
 			inst.meshIndex = (uint)meshIndex;
+			instanceArray.Write(instanceIndex, inst);
 
 			if (TLAS_instancesMapped != nullptr && emitter.BLAS.IsValid())
 			{
@@ -4001,9 +4290,13 @@ namespace wi::scene
 
 				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
 
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
 				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 				{
+					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 					for (size_t i = 0; i < subset.indexCount; i += 3)
 					{
 						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
@@ -4129,9 +4422,13 @@ namespace wi::scene
 
 				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
 
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
 				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 				{
+					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 					for (size_t i = 0; i < subset.indexCount; i += 3)
 					{
 						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
@@ -4335,9 +4632,13 @@ namespace wi::scene
 
 				const ArmatureComponent* armature = mesh.IsSkinned() ? scene.armatures.GetComponent(mesh.armatureID) : nullptr;
 
+				uint32_t first_subset = 0;
+				uint32_t last_subset = 0;
+				mesh.GetLODSubsetRange(0, first_subset, last_subset);
 				int subsetCounter = 0;
-				for (auto& subset : mesh.subsets)
+				for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
 				{
+					const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
 					for (size_t i = 0; i < subset.indexCount; i += 3)
 					{
 						const uint32_t i0 = mesh.indices[subset.indexOffset + i + 0];
@@ -10,6 +10,7 @@
 #include "wiResourceManager.h"
 #include "wiSpinLock.h"
 #include "wiGPUBVH.h"
+#include "wiGeometryArena.h"
 #include "wiOcean.h"
 #include "wiSprite.h"
 #include "wiMath.h"
@@ -351,6 +352,24 @@ namespace wi::scene
 			uint32_t materialIndex = 0;
 		};
 		wi::vector<MeshSubset> subsets;
+		uint32_t subsets_per_lod = 0; // this needs to be specified if there are multiple LOD levels
+
+		// Meshlets are clusters of the full detail subsets with bounds that can be used for culling
+		//	The triangles of a meshlet are contiguous in the index buffer, see BuildMeshlets()
+		struct Meshlet
+		{
+			uint32_t subsetIndex = 0;
+			uint32_t indexOffset = 0;
+			uint32_t indexCount = 0;
+
+			// Bounding sphere and normal cone in mesh local space:
+			XMFLOAT3 center = XMFLOAT3(0, 0, 0);
+			float radius = 0;
+			XMFLOAT3 cone_apex = XMFLOAT3(0, 0, 0);
+			XMFLOAT3 cone_axis = XMFLOAT3(0, 0, 1);
+			float cone_cutoff = 1; // cos(angle/2), 1 means that the cone can't be used for culling
+		};
+		wi::vector<Meshlet> meshlets;
 
 		float tessellationFactor = 0.0f;
 		wi::ecs::Entity armatureID = wi::ecs::INVALID_ENTITY;
@@ -375,14 +394,21 @@ namespace wi::scene
 
 		// Non-serialized attributes:
 		wi::primitive::AABB aabb;
-		wi::graphics::GPUBuffer indexBuffer;
-		wi::graphics::GPUBuffer vertexBuffer_POS;
-		wi::graphics::GPUBuffer vertexBuffer_TAN;
-		wi::graphics::GPUBuffer vertexBuffer_UV0;
-		wi::graphics::GPUBuffer vertexBuffer_UV1;
-		wi::graphics::GPUBuffer vertexBuffer_BON;
-		wi::graphics::GPUBuffer vertexBuffer_COL;
-		wi::graphics::GPUBuffer vertexBuffer_ATL;
+		// The index and vertex data are suballocated from the geometry arena:
+		enum VERTEX_STREAM
+		{
+			VERTEX_STREAM_POS,
+			VERTEX_STREAM_TAN,
+			VERTEX_STREAM_UV0,
+			VERTEX_STREAM_UV1,
+			VERTEX_STREAM_BON,
+			VERTEX_STREAM_COL,
+			VERTEX_STREAM_ATL,
+			VERTEX_STREAM_COUNT
+		};
+		std::shared_ptr<GeometryArena::Allocation> indexAllocation;
+		std::shared_ptr<GeometryArena::Allocation> vertexAllocation;
+		uint32_t geometry_generation = 0; // used to detect that the arena moved the geometry
 		wi::graphics::GPUBuffer vertexBuffer_PRE;
 		wi::graphics::GPUBuffer streamoutBuffer_POS;
 		wi::graphics::GPUBuffer streamoutBuffer_TAN;
@@ -419,7 +445,44 @@ namespace wi::scene
 		inline float GetTessellationFactor() const { return tessellationFactor; }
 		inline wi::graphics::IndexBufferFormat GetIndexFormat() const { return vertex_positions.size() > 65535 ? wi::graphics::IndexBufferFormat::UINT32 : wi::graphics::IndexBufferFormat::UINT16; }
 		inline size_t GetIndexStride() const { return GetIndexFormat() == wi::graphics::IndexBufferFormat::UINT32 ? sizeof(uint32_t) : sizeof(uint16_t); }
+		inline const wi::graphics::GPUBuffer* GetIndexBuffer() const { return indexAllocation == nullptr ? nullptr : &indexAllocation->buffer; }
+		inline const wi::graphics::GPUBuffer* GetVertexBuffer() const { return vertexAllocation == nullptr ? nullptr : &vertexAllocation->buffer; }
+		inline GeometryArena::View GetIndexView() const { return indexAllocation == nullptr ? GeometryArena::View() : indexAllocation->views[0]; }
+		inline GeometryArena::View GetVertexView(VERTEX_STREAM stream) const { return vertexAllocation == nullptr ? GeometryArena::View() : vertexAllocation->views[stream]; }
+		// The first index of the mesh in the index buffer, this must be added to subset index offsets when drawing
+		inline uint32_t GetIndexOffset() const { return uint32_t(GetIndexView().offset / GetIndexStride()); }
+		inline uint32_t GetGeometryGeneration() const { return (indexAllocation == nullptr ? 0 : indexAllocation->generation) + (vertexAllocation == nullptr ? 0 : vertexAllocation->generation); }
+		// The geometry can't be drawn until the arena created its descriptors
+		inline bool IsGeometryReady() const { return GetIndexView().descriptor >= 0 && GetVertexView(VERTEX_STREAM_POS).descriptor >= 0; }
 		inline bool IsSkinned() const { return armatureID != wi::ecs::INVALID_ENTITY; }
+		inline uint32_t GetLODCount() const { return subsets_per_lod == 0 ? 1 : ((uint32_t)subsets.size() / subsets_per_lod); }
+		inline void GetLODSubsetRange(uint32_t lod, uint32_t& first_subset, uint32_t& last_subset) const
+		{
+			first_subset = 0;
+			last_subset = (uint32_t)subsets.size();
+			if (subsets_per_lod > 0)
+			{
+				lod = std::min(lod, GetLODCount() - 1);
+				first_subset = subsets_per_lod * lod;
+				last_subset = first_subset + subsets_per_lod;
+			}
+		}
+		// The number of indices that belong to the full detail subsets, the generated LOD indices are stored after these
+		//	Code that processes the triangles of the mesh (collision, normals, tangents, soft bodies) must only use this range
+		inline uint32_t GetFullDetailIndexCount() const
+		{
+			if (subsets_per_lod == 0)
+				return (uint32_t)indices.size();
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			GetLODSubsetRange(0, first_subset, last_subset);
+			uint32_t index_count = 0;
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+			{
+				index_count = std::max(index_count, subsets[subsetIndex].indexOffset + subsets[subsetIndex].indexCount);
+			}
+			return index_count;
+		}
 
 		// Recreates GPU resources for index/vertex buffers
 		void CreateRenderData();
@@ -437,6 +500,29 @@ namespace wi::scene
 		void Recenter();
 		void RecenterToBottom();
 		wi::primitive::Sphere GetBoundingSphere() const;
+		// Generates simplified index lists for lod_count-1 additional LOD levels, halving the triangle count at every level
+		//	The LOD subsets are appended after the full detail subsets and the result can be used by GetLODSubsetRange()
+		//	target_error is relative to the mesh extents, simplification of a level stops early when it is reached
+		//	Levels are only added while they reduce the triangle count, and lod_count is reduced if all levels don't fit into 256 subsets
+		//	The generated LOD triangles are only used for rendering, collision, soft bodies, normals and tangents use the full detail subsets
+		void GenerateLODs(uint32_t lod_count, float target_error = 0.02f);
+
+		// Splits the full detail subsets into meshlets and reorders their indices so that every meshlet is a contiguous index range
+		//	This only modifies CPU data, CreateRenderData() must be called afterwards to upload the reordered indices
+		void BuildMeshlets(uint32_t max_vertices = 64, uint32_t max_triangles = 124, float cone_weight = 0.25f);
+
+		struct MeshletRange
+		{
+			uint32_t subsetIndex = 0;
+			uint32_t indexOffset = 0;
+			uint32_t indexCount = 0;
+		};
+		// Appends the index ranges of meshlets that intersect the frustum into result, neighbouring visible meshlets are merged
+		//	world		: world matrix of the instance, the frustum is in world space
+		//	eye			: world space view position for backface cone culling, nullptr disables it (double sided or shadow rendering)
+		//					  it is also disabled when the world matrix has non-uniform scale or mirroring
+		//	returns the number of culled meshlets
+		uint32_t CullMeshlets(const XMMATRIX& world, const wi::primitive::Frustum& frustum, const XMFLOAT3* eye, wi::vector<MeshletRange>& result) const;
 
 		void Serialize(wi::Archive& archive, wi::ecs::EntitySerializer& seri);
 
@@ -698,9 +784,18 @@ namespace wi::scene
 			EMPTY = 0,
 			DISABLE_DEACTIVATION = 1 << 0,
 			KINEMATIC = 1 << 1,
+			DISABLE_LOD = 1 << 2, // always simulated at full rate, regardless of distance to the physics interest points
 		};
 		uint32_t _flags = EMPTY;
 
+		// Simulation level of detail, assigned by the physics system based on distance to the physics interest points:
+		enum LOD
+		{
+			LOD_FULL_RATE,		// simulated in every step
+			LOD_REDUCED_RATE,	// simulated in every Nth step with a longer time step
+			LOD_FROZEN,			// sleeping until it is woken up by contact with a simulated body
+		};
+
 		enum CollisionShape
 		{
 			BOX,
@@ -733,12 +828,15 @@ namespace wi::scene
 
 		// Non-serialized attributes:
 		void* physicsobject = nullptr;
+		LOD lod = LOD_FULL_RATE;
 
 		inline void SetDisableDeactivation(bool value) { if (value) { _flags |= DISABLE_DEACTIVATION; } else { _flags &= ~DISABLE_DEACTIVATION; } }
 		inline void SetKinematic(bool value) { if (value) { _flags |= KINEMATIC; } else { _flags &= ~KINEMATIC; } }
+		inline void SetDisableLOD(bool value) { if (value) { _flags |= DISABLE_LOD; } else { _flags &= ~DISABLE_LOD; } }
 
 		inline bool IsDisableDeactivation() const { return _flags & DISABLE_DEACTIVATION; }
 		inline bool IsKinematic() const { return _flags & KINEMATIC; }
+		inline bool IsDisableLOD() const { return _flags & DISABLE_LOD; }
 
 		void Serialize(wi::Archive& archive, wi::ecs::EntitySerializer& seri);
 	};
@@ -765,7 +863,9 @@ namespace wi::scene
 		void* physicsobject = nullptr;
 		XMFLOAT4X4 worldMatrix = wi::math::IDENTITY_MATRIX;
 		wi::vector<MeshComponent::Vertex_POS> vertex_positions_simulation; // graphics vertices after simulation (world space)
-		wi::vector<XMFLOAT4>vertex_tangents_tmp;
+		wi::vector<XMFLOAT4> triangle_tangents_tmp; // tangent of every mesh triangle after simulation
+		wi::vector<uint32_t> vertex_triangle_offsets; // range of vertex_triangles for every graphics vertex
+		wi::vector<uint32_t> vertex_triangles; // triangles that are using graphics vertices
 		wi::vector<MeshComponent::Vertex_TAN> vertex_tangents_simulation;
 		wi::primitive::AABB aabb;
 
@@ -1234,6 +1334,89 @@ namespace wi::scene
 		void Serialize(wi::Archive& archive, wi::ecs::EntitySerializer& seri);
 	};
 
+	// CPU copy of a shader data array that is uploaded to the GPU every frame, with change tracking:
+	//	Write() only stores the element and marks it dirty if its contents are different from the last uploaded version
+	//	Flush() gathers dirty elements into ranges and writes only those into the mapped upload buffer
+	//	Only the ranges need to be copied from the upload buffer into the GPU buffer afterwards
+	template<typename T>
+	struct ShaderDataArray
+	{
+		struct Range
+		{
+			uint32_t offset; // in elements
+			uint32_t count; // in elements
+		};
+		wi::vector<T> data;
+		wi::vector<uint8_t> dirty;
+		wi::vector<Range> ranges;
+		T* mapped = nullptr;
+		size_t upload_size = 0; // in bytes
+
+		// Dirty elements that are closer than this will be merged into one range (the gap will also be uploaded)
+		static constexpr uint32_t merge_gap = 16;
+
+		// Begins a new frame of writes:
+		//	mapped_data	: the upload buffer of the current frame
+		//	count		: element count of this frame
+		//	invalidate	: every element will be uploaded (for example when the GPU buffer was recreated)
+		void Begin(void* mapped_data, size_t count, bool invalidate)
+		{
+			mapped = (T*)mapped_data;
+			data.resize(count);
+			dirty.resize(count, 1); // new elements are always uploaded
+			if (invalidate)
+			{
+				std::fill(dirty.begin(), dirty.end(), uint8_t(1));
+			}
+			ranges.clear();
+			upload_size = 0;
+		}
+		// Can be called from multiple threads if they write different elements
+		//	The value is compared byte by byte, so it should be value-initialized (T value = T();) to have zeroed padding
+		inline void Write(size_t index, const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value);
+			assert(index < data.size());
+			if (dirty[index] || std::memcmp(&data[index], &value, sizeof(T)) != 0)
+			{
+				std::memcpy(&data[index], &value, sizeof(T)); // byte copy, because assignment doesn't need to copy the padding
+				dirty[index] = 1;
+			}
+		}
+		// Collects dirty ranges and writes them into the upload buffer in parallel jobs
+		void Flush(wi::jobsystem::context& ctx)
+		{
+			ranges.clear();
+			upload_size = 0;
+			if (mapped == nullptr)
+				return;
+			for (uint32_t i = 0; i < (uint32_t)dirty.size(); ++i)
+			{
+				if (dirty[i] == 0)
+					continue;
+				dirty[i] = 0;
+				if (!ranges.empty() && i - (ranges.back().offset + ranges.back().count) <= merge_gap)
+				{
+					ranges.back().count = i - ranges.back().offset + 1;
+				}
+				else
+				{
+					Range& range = ranges.emplace_back();
+					range.offset = i;
+					range.count = 1;
+				}
+			}
+			for (auto& range : ranges)
+			{
+				upload_size += range.count * sizeof(T);
+			}
+			wi::jobsystem::Dispatch(ctx, (uint32_t)ranges.size(), 1, [this](wi::jobsystem::JobArgs args) {
+				const Range& range = ranges[args.jobIndex];
+				std::memcpy(mapped + range.offset, data.data() + range.offset, range.count * sizeof(T));
+			});
+		}
+	};
+
 	struct Scene
 	{
 		wi::ecs::ComponentManager<NameComponent> names;
@@ -1279,6 +1462,7 @@ namespace wi::scene
 		wi::primitive::AABB bounds;
 		wi::vector<wi::primitive::AABB> parallel_bounds;
 		WeatherComponent weather;
+		std::shared_ptr<void> physics_scene; // physics world of this scene, created by wi::physics when it's first needed
 		wi::graphics::RaytracingAccelerationStructure TLAS;
 		wi::graphics::GPUBuffer TLAS_instancesUpload[wi::graphics::GraphicsDevice::GetBufferCount()];
 		void* TLAS_instancesMapped = nullptr;
@@ -1296,7 +1480,7 @@ namespace wi::scene
 		//		2) hair particles
 		//		3) emitted particles
 		wi::graphics::GPUBuffer instanceUploadBuffer[wi::graphics::GraphicsDevice::GetBufferCount()];
-		ShaderMeshInstance* instanceArrayMapped = nullptr;
+		ShaderDataArray<ShaderMeshInstance> instanceArray;
 		size_t instanceArraySize = 0;
 		wi::graphics::GPUBuffer instanceBuffer;
 
@@ -1306,13 +1490,13 @@ namespace wi::scene
 		//		2) hair particles
 		//		3) emitted particles
 		wi::graphics::GPUBuffer meshUploadBuffer[wi::graphics::GraphicsDevice::GetBufferCount()];
-		ShaderMesh* meshArrayMapped = nullptr;
+		ShaderDataArray<ShaderMesh> meshArray;
 		size_t meshArraySize = 0;
 		wi::graphics::GPUBuffer meshBuffer;
 
 		// Materials for bindless visibility indexing:
 		wi::graphics::GPUBuffer materialUploadBuffer[wi::graphics::GraphicsDevice::GetBufferCount()];
-		ShaderMaterial* materialArrayMapped = nullptr;
+		ShaderDataArray<ShaderMaterial> materialArray;
 		size_t materialArraySize = 0;
 		wi::graphics::GPUBuffer materialBuffer;
 
@@ -1362,6 +1546,8 @@ namespace wi::scene
 		// Update all components by a given timestep (in seconds):
 		//	This is an expensive function, prefer to call it only once per frame!
 		void Update(float dt);
+		// Returns the size of instance, mesh and material data (in bytes) that was changed in the last Update() and will be uploaded to the GPU:
+		inline size_t GetShaderDataUploadSize() const { return instanceArray.upload_size + meshArray.upload_size + materialArray.upload_size; }
 		// Remove everything from the scene that it owns:
 		void Clear();
 		// Merge an other scene into this.
@@ -0,0 +1,905 @@
+#include "wiSceneReplication.h"
+#include "wiJobSystem.h"
+#include "wiTimer.h"
+#include "wiMath.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace wi::ecs;
+
+namespace wi::scene::replication
+{
+	// Snapshot layout, bits are packed from the least significant bit of every byte:
+	//	snapshot id (32), baseline id (32, 0 if there is none)
+	//	removed entity count, then the removed entities as increasing deltas
+	//	written entity count, then for every written entity: entity delta, component mask (3), the fields of every component
+	//	Every field has a bit that tells whether it changed relative to the baseline, only changed fields are written
+	static constexpr uint32_t COMPONENT_BITS = 3;
+	static constexpr uint32_t ANIMATION_FLAGS = AnimationComponent::PLAYING | AnimationComponent::LOOPED;
+	static constexpr uint32_t ANIMATION_AMOUNT_MAX = 1023;
+	static constexpr uint32_t CAPTURE_GRAIN_SIZE = 256;
+	static constexpr float SQRT2 = 1.41421356f;
+	static const EntityState empty_state; // the baseline of components that the client doesn't have yet
+
+	class BitWriter
+	{
+	public:
+		BitWriter(wi::vector<uint8_t>& data) : data(data) {}
+
+		void write(uint32_t value, uint32_t bits)
+		{
+			if (bits == 0)
+				return;
+			if (bits < 32)
+			{
+				value &= (1u << bits) - 1;
+			}
+			scratch |= uint64_t(value) << count;
+			count += bits;
+			while (count >= 8)
+			{
+				data.push_back(uint8_t(scratch));
+				scratch >>= 8;
+				count -= 8;
+			}
+		}
+		void write64(uint64_t value, uint32_t bits)
+		{
+			write(uint32_t(value), std::min(bits, 32u));
+			if (bits > 32)
+			{
+				write(uint32_t(value >> 32), bits - 32);
+			}
+		}
+		void write_bool(bool value)
+		{
+			write(value ? 1 : 0, 1);
+		}
+		void write_float(float value)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			write(bits, 32);
+		}
+		// Small values take fewer bits: the bit count of the value is written first
+		void write_varbits(uint32_t value)
+		{
+			uint32_t bits = 0;
+			while (bits < 32 && (value >> bits) != 0)
+			{
+				bits++;
+			}
+			write(bits, 6);
+			write(value, bits);
+		}
+		// Signed difference with wrap around, zigzag encoded so that small negative values take few bits too
+		void write_delta(int32_t value, int32_t base)
+		{
+			const int32_t delta = int32_t(uint32_t(value) - uint32_t(base));
+			write_varbits((uint32_t(delta) << 1) ^ uint32_t(delta >> 31));
+		}
+		void flush()
+		{
+			if (count > 0)
+			{
+				data.push_back(uint8_t(scratch));
+				scratch = 0;
+				count = 0;
+			}
+		}
+
+	private:
+		wi::vector<uint8_t>& data;
+		uint64_t scratch = 0;
+		uint32_t count = 0;
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+		uint32_t read(uint32_t bits)
+		{
+			uint32_t value = 0;
+			uint32_t done = 0;
+			while (done < bits)
+			{
+				const size_t byte = position >> 3;
+				if (byte >= size)
+				{
+					overflow = true;
+					return 0;
+				}
+				const uint32_t offset = uint32_t(position & 7);
+				const uint32_t take = std::min(8 - offset, bits - done);
+				value |= uint32_t((data[byte] >> offset) & ((1u << take) - 1)) << done;
+				done += take;
+				position += take;
+			}
+			return value;
+		}
+		uint64_t read64(uint32_t bits)
+		{
+			uint64_t value = read(std::min(bits, 32u));
+			if (bits > 32)
+			{
+				value |= uint64_t(read(bits - 32)) << 32;
+			}
+			return value;
+		}
+		bool read_bool()
+		{
+			return read(1) != 0;
+		}
+		float read_float()
+		{
+			const uint32_t bits = read(32);
+			float value;
+			std::memcpy(&value, &bits, sizeof(value));
+			return value;
+		}
+		uint32_t read_varbits()
+		{
+			const uint32_t bits = read(6);
+			if (bits > 32)
+			{
+				overflow = true;
+				return 0;
+			}
+			return read(bits);
+		}
+		int32_t read_delta(int32_t base)
+		{
+			const uint32_t zigzag = read_varbits();
+			const uint32_t delta = (zigzag >> 1) ^ (0u - (zigzag & 1));
+			return int32_t(uint32_t(base) + delta);
+		}
+
+		bool overflow = false;
+
+	private:
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		size_t position = 0; // in bits
+	};
+
+	inline int32_t quantize(float value, float precision)
+	{
+		return int32_t(std::min(std::max(std::round(double(value) / double(precision)), double(INT32_MIN)), double(INT32_MAX)));
+	}
+	inline float dequantize(int32_t value, float precision)
+	{
+		return float(double(value) * double(precision));
+	}
+
+	// The largest component of the quaternion is left out and reconstructed from the others
+	//	Its index is stored in the lowest 2 bits, it is made positive because q and -q are the same rotation
+	inline uint64_t quantize_rotation(const XMFLOAT4& rotation, uint32_t bits)
+	{
+		XMFLOAT4 q;
+		XMStoreFloat4(&q, XMQuaternionNormalize(XMLoadFloat4(&rotation)));
+		const float values[] = { q.x, q.y, q.z, q.w };
+		uint32_t largest = 0;
+		for (uint32_t i = 1; i < 4; ++i)
+		{
+			if (std::abs(values[i]) > std::abs(values[largest]))
+			{
+				largest = i;
+			}
+		}
+		const float sign = values[largest] < 0 ? -1.0f : 1.0f;
+		const uint32_t max = (1u << bits) - 1;
+		uint64_t packed = largest;
+		uint32_t shift = 2;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (i == largest)
+				continue;
+			// the other components are in range [-1/sqrt(2), 1/sqrt(2)]
+			const float normalized = wi::math::saturate(values[i] * sign * SQRT2 * 0.5f + 0.5f);
+			packed |= uint64_t(uint32_t(normalized * max + 0.5f)) << shift;
+			shift += bits;
+		}
+		return packed;
+	}
+	inline XMFLOAT4 dequantize_rotation(uint64_t packed, uint32_t bits)
+	{
+		const uint32_t largest = uint32_t(packed & 3);
+		const uint32_t max = (1u << bits) - 1;
+		float values[4];
+		float sum = 0;
+		uint32_t shift = 2;
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (i == largest)
+				continue;
+			const float normalized = float((packed >> shift) & max) / float(max);
+			values[i] = (normalized - 0.5f) * 2.0f / SQRT2;
+			sum += values[i] * values[i];
+			shift += bits;
+		}
+		values[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+		XMFLOAT4 q;
+		XMStoreFloat4(&q, XMQuaternionNormalize(XMVectorSet(values[0], values[1], values[2], values[3])));
+		return q;
+	}
+
+	inline uint32_t pack_color(const XMFLOAT3& color)
+	{
+		return
+			uint32_t(wi::math::saturate(color.x) * 255.0f + 0.5f) |
+			(uint32_t(wi::math::saturate(color.y) * 255.0f + 0.5f) << 8) |
+			(uint32_t(wi::math::saturate(color.z) * 255.0f + 0.5f) << 16);
+	}
+	inline XMFLOAT3 unpack_color(uint32_t color)
+	{
+		return XMFLOAT3(
+			float(color & 0xFF) / 255.0f,
+			float((color >> 8) & 0xFF) / 255.0f,
+			float((color >> 16) & 0xFF) / 255.0f
+		);
+	}
+
+	inline bool equal_transform(const EntityState& a, const EntityState& b)
+	{
+		return
+			std::equal(std::begin(a.position), std::end(a.position), std::begin(b.position)) &&
+			a.rotation == b.rotation &&
+			std::equal(std::begin(a.scale), std::end(a.scale), std::begin(b.scale));
+	}
+	inline bool equal_animation(const EntityState& a, const EntityState& b)
+	{
+		return
+			a.animation_flags == b.animation_flags &&
+			a.animation_timer == b.animation_timer &&
+			a.animation_amount == b.animation_amount &&
+			a.animation_speed == b.animation_speed;
+	}
+	inline bool equal_light(const EntityState& a, const EntityState& b)
+	{
+		return
+			a.light_type == b.light_type &&
+			a.light_flags == b.light_flags &&
+			a.light_color == b.light_color &&
+			a.light_energy == b.light_energy &&
+			a.light_range == b.light_range &&
+			a.light_fov == b.light_fov;
+	}
+	// Compares two states, each of them limited to a set of their components
+	inline bool equal(const EntityState& a, uint32_t a_components, const EntityState& b, uint32_t b_components)
+	{
+		if (a_components != b_components)
+			return false;
+		if ((a_components & COMPONENT_TRANSFORM) && !equal_transform(a, b))
+			return false;
+		if ((a_components & COMPONENT_ANIMATION) && !equal_animation(a, b))
+			return false;
+		if ((a_components & COMPONENT_LIGHT) && !equal_light(a, b))
+			return false;
+		return true;
+	}
+
+	static void write_state(BitWriter& writer, const EntityState& state, uint32_t components, const EntityState& base, uint32_t base_components, const Desc& desc)
+	{
+		writer.write(components, COMPONENT_BITS);
+
+		if (components & COMPONENT_TRANSFORM)
+		{
+			const EntityState& b = (base_components & COMPONENT_TRANSFORM) ? base : empty_state;
+			const bool position_changed = !std::equal(std::begin(state.position), std::end(state.position), std::begin(b.position));
+			writer.write_bool(position_changed);
+			if (position_changed)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					writer.write_delta(state.position[i], b.position[i]);
+				}
+			}
+			writer.write_bool(state.rotation != b.rotation);
+			if (state.rotation != b.rotation)
+			{
+				writer.write64(state.rotation, 2 + desc.rotation_bits * 3);
+			}
+			const bool scale_changed = !std::equal(std::begin(state.scale), std::end(state.scale), std::begin(b.scale));
+			writer.write_bool(scale_changed);
+			if (scale_changed)
+			{
+				for (int i = 0; i < 3; ++i)
+				{
+					writer.write_delta(state.scale[i], b.scale[i]);
+				}
+			}
+		}
+
+		if (components & COMPONENT_ANIMATION)
+		{
+			const EntityState& b = (base_components & COMPONENT_ANIMATION) ? base : empty_state;
+			writer.write_bool(state.animation_flags != b.animation_flags);
+			if (state.animation_flags != b.animation_flags)
+			{
+				writer.write(state.animation_flags, 2);
+			}
+			writer.write_bool(state.animation_timer != b.animation_timer);
+			if (state.animation_timer != b.animation_timer)
+			{
+				writer.write_delta(state.animation_timer, b.animation_timer);
+			}
+			writer.write_bool(state.animation_amount != b.animation_amount);
+			if (state.animation_amount != b.animation_amount)
+			{
+				writer.write(state.animation_amount, 10);
+			}
+			writer.write_bool(state.animation_speed != b.animation_speed);
+			if (state.animation_speed != b.animation_speed)
+			{
+				writer.write_float(state.animation_speed);
+			}
+		}
+
+		if (components & COMPONENT_LIGHT)
+		{
+			const EntityState& b = (base_components & COMPONENT_LIGHT) ? base : empty_state;
+			const bool type_changed = state.light_type != b.light_type || state.light_flags != b.light_flags;
+			writer.write_bool(type_changed);
+			if (type_changed)
+			{
+				writer.write_varbits(state.light_type);
+				writer.write_varbits(state.light_flags);
+			}
+			writer.write_bool(state.light_color != b.light_color);
+			if (state.light_color != b.light_color)
+			{
+				writer.write(state.light_color, 24);
+			}
+			writer.write_bool(state.light_energy != b.light_energy);
+			if (state.light_energy != b.light_energy)
+			{
+				writer.write_float(state.light_energy);
+			}
+			writer.write_bool(state.light_range != b.light_range);
+			if (state.light_range != b.light_range)
+			{
+				writer.write_float(state.light_range);
+			}
+			writer.write_bool(state.light_fov != b.light_fov);
+			if (state.light_fov != b.light_fov)
+			{
+				writer.write_float(state.light_fov);
+			}
+		}
+	}
+
+	static void read_state(BitReader& reader, EntityState& state, const EntityState& base, const Desc& desc)
+	{
+		state.components = reader.read(COMPONENT_BITS);
+
+		if (state.components & COMPONENT_TRANSFORM)
+		{
+			const EntityState& b = (base.components & COMPONENT_TRANSFORM) ? base : empty_state;
+			const bool position_changed = reader.read_bool();
+			for (int i = 0; i < 3; ++i)
+			{
+				state.position[i] = position_changed ? reader.read_delta(b.position[i]) : b.position[i];
+			}
+			state.rotation = reader.read_bool() ? reader.read64(2 + desc.rotation_bits * 3) : b.rotation;
+			const bool scale_changed = reader.read_bool();
+			for (int i = 0; i < 3; ++i)
+			{
+				state.scale[i] = scale_changed ? reader.read_delta(b.scale[i]) : b.scale[i];
+			}
+		}
+
+		if (state.components & COMPONENT_ANIMATION)
+		{
+			const EntityState& b = (base.components & COMPONENT_ANIMATION) ? base : empty_state;
+			state.animation_flags = reader.read_bool() ? reader.read(2) : b.animation_flags;
+			state.animation_timer = reader.read_bool() ? reader.read_delta(b.animation_timer) : b.animation_timer;
+			state.animation_amount = reader.read_bool() ? reader.read(10) : b.animation_amount;
+			state.animation_speed = reader.read_bool() ? reader.read_float() : b.animation_speed;
+		}
+
+		if (state.components & COMPONENT_LIGHT)
+		{
+			const EntityState& b = (base.components & COMPONENT_LIGHT) ? base : empty_state;
+			if (reader.read_bool())
+			{
+				state.light_type = reader.read_varbits();
+				state.light_flags = reader.read_varbits();
+			}
+			else
+			{
+				state.light_type = b.light_type;
+				state.light_flags = b.light_flags;
+			}
+			state.light_color = reader.read_bool() ? reader.read(24) : b.light_color;
+			state.light_energy = reader.read_bool() ? reader.read_float() : b.light_energy;
+			state.light_range = reader.read_bool() ? reader.read_float() : b.light_range;
+			state.light_fov = reader.read_bool() ? reader.read_float() : b.light_fov;
+		}
+	}
+
+
+	void Server::Init(const Desc& desc)
+	{
+		this->desc = desc;
+		this->desc.rotation_bits = std::min(std::max(desc.rotation_bits, 4u), 20u);
+		for (auto& x : history)
+		{
+			x = {};
+		}
+		clients.clear();
+		replicated.clear();
+		replicated_sorted.clear();
+		replicated_dirty = false;
+		next_id = 1;
+		capture_time = 0;
+	}
+
+	void Server::SetReplicated(Entity entity, uint32_t components)
+	{
+		components &= COMPONENT_ALL;
+		if (components == COMPONENT_NONE)
+		{
+			replicated.erase(entity);
+		}
+		else
+		{
+			replicated[entity] = components;
+		}
+		replicated_dirty = true;
+	}
+	uint32_t Server::GetReplicated(Entity entity) const
+	{
+		auto it = replicated.find(entity);
+		if (it == replicated.end())
+			return COMPONENT_NONE;
+		return it->second;
+	}
+
+	uint32_t Server::AddClient()
+	{
+		uint32_t client = 0;
+		while (client < clients.size() && clients[client].active)
+		{
+			client++;
+		}
+		if (client == clients.size())
+		{
+			clients.emplace_back();
+		}
+		clients[client] = {};
+		clients[client].active = true;
+		return client;
+	}
+	void Server::RemoveClient(uint32_t client)
+	{
+		clients[client] = {};
+	}
+	void Server::SetClientInterest(uint32_t client, const XMFLOAT3& position, float radius)
+	{
+		clients[client].interest_position = position;
+		clients[client].interest_radius = radius;
+	}
+	void Server::SetClientComponents(uint32_t client, uint32_t components)
+	{
+		clients[client].components = components & COMPONENT_ALL;
+	}
+	void Server::Acknowledge(uint32_t client, uint32_t snapshot)
+	{
+		// Acknowledgements can arrive out of order, the newest is kept:
+		clients[client].acknowledged = std::max(clients[client].acknowledged, snapshot);
+	}
+
+	uint32_t Server::Update(const Scene& scene)
+	{
+		wi::Timer timer;
+
+		if (replicated_dirty)
+		{
+			replicated_sorted.assign(replicated.begin(), replicated.end());
+			std::sort(replicated_sorted.begin(), replicated_sorted.end());
+			replicated_dirty = false;
+		}
+
+		const uint32_t id = next_id++;
+		Snapshot& snapshot = history[id % HISTORY_SIZE];
+		snapshot.id = id;
+		snapshot.states.resize(replicated_sorted.size());
+		snapshot.positions.resize(replicated_sorted.size());
+
+		wi::jobsystem::context ctx;
+		wi::jobsystem::Dispatch(ctx, (uint32_t)replicated_sorted.size(), CAPTURE_GRAIN_SIZE, [&](wi::jobsystem::JobArgs args) {
+			const Entity entity = replicated_sorted[args.jobIndex].first;
+			const uint32_t components = replicated_sorted[args.jobIndex].second;
+			EntityState& state = snapshot.states[args.jobIndex];
+			XMFLOAT3& position = snapshot.positions[args.jobIndex];
+			state = {};
+			state.entity = entity;
+			position = XMFLOAT3(0, 0, 0);
+
+			if (components & COMPONENT_TRANSFORM)
+			{
+				const TransformComponent* transform = scene.transforms.GetComponent(entity);
+				if (transform != nullptr)
+				{
+					state.components |= COMPONENT_TRANSFORM;
+					state.position[0] = quantize(transform->translation_local.x, desc.position_precision);
+					state.position[1] = quantize(transform->translation_local.y, desc.position_precision);
+					state.position[2] = quantize(transform->translation_local.z, desc.position_precision);
+					state.rotation = quantize_rotation(transform->rotation_local, desc.rotation_bits);
+					state.scale[0] = quantize(transform->scale_local.x, desc.scale_precision);
+					state.scale[1] = quantize(transform->scale_local.y, desc.scale_precision);
+					state.scale[2] = quantize(transform->scale_local.z, desc.scale_precision);
+					position = transform->GetPosition();
+				}
+			}
+			if (components & COMPONENT_ANIMATION)
+			{
+				const AnimationComponent* animation = scene.animations.GetComponent(entity);
+				if (animation != nullptr)
+				{
+					state.components |= COMPONENT_ANIMATION;
+					state.animation_flags = animation->_flags & ANIMATION_FLAGS;
+					state.animation_timer = quantize(animation->timer, desc.animation_time_precision);
+					state.animation_amount = uint32_t(wi::math::saturate(animation->amount) * ANIMATION_AMOUNT_MAX + 0.5f);
+					state.animation_speed = animation->speed;
+				}
+			}
+			if (components & COMPONENT_LIGHT)
+			{
+				const LightComponent* light = scene.lights.GetComponent(entity);
+				if (light != nullptr)
+				{
+					state.components |= COMPONENT_LIGHT;
+					state.light_type = (uint32_t)light->GetType();
+					state.light_flags = light->_flags;
+					state.light_color = pack_color(light->color);
+					state.light_energy = light->energy;
+					state.light_range = light->range_local;
+					state.light_fov = light->fov;
+				}
+			}
+		});
+		wi::jobsystem::Wait(ctx);
+
+		capture_time = float(timer.elapsed_milliseconds());
+
+		// Every client is encoded by a separate job, they only read the shared snapshot history:
+		wi::jobsystem::Dispatch(ctx, (uint32_t)clients.size(), 1, [&](wi::jobsystem::JobArgs args) {
+			ClientState& client = clients[args.jobIndex];
+			if (client.active)
+			{
+				encode(client, snapshot);
+			}
+		});
+		wi::jobsystem::Wait(ctx);
+
+		return id;
+	}
+
+	void Server::encode(ClientState& client, const Snapshot& snapshot) const
+	{
+		wi::Timer timer;
+
+		// The baseline is the acknowledged snapshot if it is still in the history, it must be looked up before its sent record is overwritten:
+		const Snapshot* base_snapshot = nullptr;
+		const SentSnapshot* base_sent = nullptr;
+		if (client.acknowledged != 0 && client.acknowledged < snapshot.id && snapshot.id - client.acknowledged < HISTORY_SIZE)
+		{
+			const Snapshot& candidate = history[client.acknowledged % HISTORY_SIZE];
+			const SentSnapshot& candidate_sent = client.sent[client.acknowledged % HISTORY_SIZE];
+			if (candidate.id == client.acknowledged && candidate_sent.id == client.acknowledged)
+			{
+				base_snapshot = &candidate;
+				base_sent = &candidate_sent;
+			}
+		}
+
+		SentSnapshot& sent = client.sent[snapshot.id % HISTORY_SIZE];
+		sent.id = snapshot.id;
+		sent.components = client.components;
+		sent.indices.clear();
+		const float radius_sq = client.interest_radius * client.interest_radius;
+		const XMVECTOR interest = XMLoadFloat3(&client.interest_position);
+		for (uint32_t i = 0; i < (uint32_t)snapshot.states.size(); ++i)
+		{
+			const EntityState& state = snapshot.states[i];
+			if ((state.components & client.components) == COMPONENT_NONE)
+				continue;
+			if (client.interest_radius > 0 && (state.components & COMPONENT_TRANSFORM))
+			{
+				const float distance_sq = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&snapshot.positions[i]) - interest));
+				if (distance_sq > radius_sq)
+					continue;
+			}
+			sent.indices.push_back(i);
+		}
+
+		client.data.clear();
+		BitWriter writer(client.data);
+		writer.write(snapshot.id, 32);
+		writer.write(base_snapshot == nullptr ? 0 : base_snapshot->id, 32);
+
+		// Both lists are sorted by entity, so they are walked together to find the removed, added and changed entities:
+		const size_t base_count = base_sent == nullptr ? 0 : base_sent->indices.size();
+		const uint32_t base_components = base_sent == nullptr ? (uint32_t)COMPONENT_NONE : base_sent->components;
+		client.removed.clear();
+		client.written.clear();
+		size_t b = 0;
+		size_t c = 0;
+		while (b < base_count || c < sent.indices.size())
+		{
+			const EntityState* base = b < base_count ? &base_snapshot->states[base_sent->indices[b]] : nullptr;
+			const EntityState* current = c < sent.indices.size() ? &snapshot.states[sent.indices[c]] : nullptr;
+			if (current == nullptr || (base != nullptr && base->entity < current->entity))
+			{
+				client.removed.push_back(base->entity);
+				b++;
+				continue;
+			}
+			if (base != nullptr && base->entity == current->entity)
+			{
+				if (!equal(*current, current->components & client.components, *base, base->components & base_components))
+				{
+					client.written.push_back(std::make_pair(current, base));
+				}
+				b++;
+			}
+			else
+			{
+				client.written.push_back(std::make_pair(current, nullptr));
+			}
+			c++;
+		}
+
+		writer.write_varbits((uint32_t)client.removed.size());
+		Entity previous = INVALID_ENTITY;
+		for (Entity entity : client.removed)
+		{
+			writer.write_varbits(entity - previous);
+			previous = entity;
+		}
+		writer.write_varbits((uint32_t)client.written.size());
+		previous = INVALID_ENTITY;
+		for (auto& x : client.written)
+		{
+			const EntityState& current = *x.first;
+			const EntityState& base = x.second == nullptr ? empty_state : *x.second;
+			writer.write_varbits(current.entity - previous);
+			previous = current.entity;
+			write_state(writer, current, current.components & client.components, base, base.components & base_components, desc);
+		}
+		writer.flush();
+
+		client.stats.snapshot = snapshot.id;
+		client.stats.baseline = base_snapshot == nullptr ? 0 : base_snapshot->id;
+		client.stats.bytes = (uint32_t)client.data.size();
+		client.stats.written_entities = (uint32_t)client.written.size();
+		client.stats.removed_entities = (uint32_t)client.removed.size();
+		client.stats.encode_time = float(timer.elapsed_milliseconds());
+		client.stats.total_bytes += client.data.size();
+	}
+
+
+	void Client::Init(const Desc& desc)
+	{
+		this->desc = desc;
+		this->desc.rotation_bits = std::min(std::max(desc.rotation_bits, 4u), 20u);
+		for (auto& x : history)
+		{
+			x = {};
+		}
+		applied.clear();
+		applied_id = 0;
+		entity_map.clear();
+		created_entities.clear();
+	}
+
+	void Client::MapEntity(Entity server_entity, Entity client_entity)
+	{
+		entity_map[server_entity] = client_entity;
+	}
+	Entity Client::GetMappedEntity(Entity server_entity) const
+	{
+		auto it = entity_map.find(server_entity);
+		if (it == entity_map.end())
+			return INVALID_ENTITY;
+		return it->second;
+	}
+
+	bool Client::Decode(const uint8_t* data, size_t size, Scene& scene, uint32_t* snapshot)
+	{
+		BitReader reader(data, size);
+		const uint32_t id = reader.read(32);
+		const uint32_t baseline = reader.read(32);
+		if (reader.overflow || id == 0 || baseline >= id)
+			return false;
+
+		Snapshot& slot = history[id % HISTORY_SIZE];
+		if (slot.id >= id)
+		{
+			// Already decoded, or too old to be stored; acknowledging it again is harmless:
+			if (slot.id == id && snapshot != nullptr)
+			{
+				*snapshot = id;
+			}
+			return slot.id == id;
+		}
+
+		static const wi::vector<EntityState> empty;
+		const wi::vector<EntityState>* base = &empty;
+		if (baseline != 0)
+		{
+			const Snapshot& base_snapshot = history[baseline % HISTORY_SIZE];
+			if (base_snapshot.id != baseline)
+				return false;
+			base = &base_snapshot.states;
+		}
+
+		const uint32_t removed_count = reader.read_varbits();
+		if (reader.overflow || removed_count > base->size())
+			return false;
+		wi::vector<Entity> removed(removed_count);
+		Entity previous = INVALID_ENTITY;
+		for (auto& entity : removed)
+		{
+			const uint32_t delta = reader.read_varbits();
+			if (delta == 0)
+				return false;
+			entity = previous + delta;
+			previous = entity;
+		}
+
+		const uint32_t written_count = reader.read_varbits();
+		if (reader.overflow || written_count > size * 8)
+			return false;
+
+		// The new state is the baseline with the removed entities left out and the written entities added or replaced:
+		wi::vector<EntityState> states;
+		states.reserve(base->size() + written_count);
+		size_t b = 0;
+		size_t r = 0;
+		auto copy_base = [&](Entity until) {
+			while (b < base->size() && (*base)[b].entity < until)
+			{
+				const Entity entity = (*base)[b].entity;
+				while (r < removed.size() && removed[r] < entity)
+				{
+					r++;
+				}
+				if (r == removed.size() || removed[r] != entity)
+				{
+					states.push_back((*base)[b]);
+				}
+				b++;
+			}
+		};
+		previous = INVALID_ENTITY;
+		for (uint32_t i = 0; i < written_count; ++i)
+		{
+			const uint32_t delta = reader.read_varbits();
+			if (delta == 0 || reader.overflow)
+				return false;
+			const Entity entity = previous + delta;
+			previous = entity;
+			copy_base(entity);
+			const bool has_base = b < base->size() && (*base)[b].entity == entity;
+			EntityState& state = states.emplace_back();
+			state.entity = entity;
+			read_state(reader, state, has_base ? (*base)[b] : empty_state, desc);
+			b += has_base ? 1 : 0;
+		}
+		copy_base(std::numeric_limits<Entity>::max());
+		if (reader.overflow)
+			return false;
+
+		if (id > applied_id)
+		{
+			// Changes are applied relative to the last applied state, which can be different from the baseline:
+			size_t a = 0;
+			for (auto& state : states)
+			{
+				while (a < applied.size() && applied[a].entity < state.entity)
+				{
+					remove(scene, applied[a++].entity);
+				}
+				const bool has_applied = a < applied.size() && applied[a].entity == state.entity;
+				if (!has_applied || !equal(state, state.components, applied[a], applied[a].components))
+				{
+					apply(scene, state);
+				}
+				a += has_applied ? 1 : 0;
+			}
+			while (a < applied.size())
+			{
+				remove(scene, applied[a++].entity);
+			}
+			applied = states;
+			applied_id = id;
+		}
+
+		slot.id = id;
+		slot.states = std::move(states);
+		if (snapshot != nullptr)
+		{
+			*snapshot = id;
+		}
+		return true;
+	}
+
+	void Client::apply(Scene& scene, const EntityState& state)
+	{
+		Entity entity = GetMappedEntity(state.entity);
+		if (entity == INVALID_ENTITY)
+		{
+			entity = CreateEntity();
+			entity_map[state.entity] = entity;
+			created_entities.insert(entity);
+		}
+
+		if (state.components & (COMPONENT_TRANSFORM | COMPONENT_LIGHT))
+		{
+			TransformComponent* transform = scene.transforms.GetComponent(entity);
+			if (transform == nullptr)
+			{
+				transform = &scene.transforms.Create(entity);
+			}
+			if (state.components & COMPONENT_TRANSFORM)
+			{
+				transform->translation_local.x = dequantize(state.position[0], desc.position_precision);
+				transform->translation_local.y = dequantize(state.position[1], desc.position_precision);
+				transform->translation_local.z = dequantize(state.position[2], desc.position_precision);
+				transform->rotation_local = dequantize_rotation(state.rotation, desc.rotation_bits);
+				transform->scale_local.x = dequantize(state.scale[0], desc.scale_precision);
+				transform->scale_local.y = dequantize(state.scale[1], desc.scale_precision);
+				transform->scale_local.z = dequantize(state.scale[2], desc.scale_precision);
+				transform->SetDirty();
+			}
+		}
+
+		if (state.components & COMPONENT_ANIMATION)
+		{
+			AnimationComponent* animation = scene.animations.GetComponent(entity);
+			if (animation != nullptr)
+			{
+				animation->_flags = (animation->_flags & ~ANIMATION_FLAGS) | (state.animation_flags & ANIMATION_FLAGS);
+				animation->timer = dequantize(state.animation_timer, desc.animation_time_precision);
+				animation->amount = float(state.animation_amount) / float(ANIMATION_AMOUNT_MAX);
+				animation->speed = state.animation_speed;
+			}
+		}
+
+		if (state.components & COMPONENT_LIGHT)
+		{
+			LightComponent* light = scene.lights.GetComponent(entity);
+			if (light == nullptr)
+			{
+				light = &scene.lights.Create(entity);
+				scene.aabb_lights.Create(entity);
+			}
+			light->SetType((LightComponent::LightType)state.light_type);
+			light->_flags = state.light_flags;
+			light->color = unpack_color(state.light_color);
+			light->energy = state.light_energy;
+			light->range_local = state.light_range;
+			light->fov = state.light_fov;
+		}
+	}
+
+	void Client::remove(Scene& scene, Entity server_entity)
+	{
+		auto it = entity_map.find(server_entity);
+		if (it == entity_map.end())
+			return;
+		const Entity entity = it->second;
+		if (created_entities.erase(entity) > 0)
+		{
+			// only the entities that were created by the replication are removed from the scene, mapped entities are kept
+			scene.Entity_Remove(entity);
+			entity_map.erase(it);
+		}
+	}
+}
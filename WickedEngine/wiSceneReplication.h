@@ -0,0 +1,183 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiScene.h"
+#include "wiVector.h"
+#include "wiUnorderedMap.h"
+#include "wiUnorderedSet.h"
+
+namespace wi::scene::replication
+{
+	// Replication of scene component state from an authoritative server to clients with small snapshots
+	//	The server captures the selected components of the replicated entities every update, and encodes a snapshot for every client in parallel
+	//	A snapshot contains only the entities that changed since the last snapshot that the client acknowledged (the baseline),
+	//	or every entity if there is no baseline yet
+	//	Values are quantized and bit-packed: positions and scales as fixed point deltas, rotations as the smallest three quaternion components
+	//	Snapshots can be lost or arrive out of order, so they are suitable for unreliable delivery
+	//	Local transforms are replicated, the hierarchy is not
+
+	enum COMPONENT
+	{
+		COMPONENT_NONE = 0,
+		COMPONENT_TRANSFORM = 1 << 0,	// local position, rotation and scale
+		COMPONENT_ANIMATION = 1 << 1,	// playback state (flags, timer, blend amount, speed) of an AnimationComponent that the client already has
+		COMPONENT_LIGHT = 1 << 2,		// type, flags, color, energy, range and fov
+		COMPONENT_ALL = COMPONENT_TRANSFORM | COMPONENT_ANIMATION | COMPONENT_LIGHT,
+	};
+
+	// Quantization settings, they must be the same on the server and the clients
+	struct Desc
+	{
+		float position_precision = 1.0f / 512.0f;			// world units
+		float scale_precision = 1.0f / 1024.0f;
+		uint32_t rotation_bits = 12;						// bits per quaternion component, in range [4, 20]
+		float animation_time_precision = 1.0f / 1000.0f;	// seconds
+	};
+
+	// Quantized state of one entity
+	struct EntityState
+	{
+		wi::ecs::Entity entity = wi::ecs::INVALID_ENTITY;
+		uint32_t components = COMPONENT_NONE;
+
+		int32_t position[3] = {};
+		uint64_t rotation = 0;
+		int32_t scale[3] = {};
+
+		uint32_t animation_flags = 0;
+		int32_t animation_timer = 0;
+		uint32_t animation_amount = 0;
+		float animation_speed = 0;
+
+		uint32_t light_type = 0;
+		uint32_t light_flags = 0;
+		uint32_t light_color = 0;
+		float light_energy = 0;
+		float light_range = 0;
+		float light_fov = 0;
+	};
+
+	static constexpr uint32_t HISTORY_SIZE = 32; // number of snapshots that can be used as baselines
+
+	class Server
+	{
+	public:
+		void Init(const Desc& desc = {});
+
+		// Selects the components of an entity to replicate, COMPONENT_NONE removes it from the replication
+		void SetReplicated(wi::ecs::Entity entity, uint32_t components);
+		uint32_t GetReplicated(wi::ecs::Entity entity) const;
+
+		// Adds a client and returns its index, indices of removed clients are reused
+		uint32_t AddClient();
+		void RemoveClient(uint32_t client);
+		// Limits the entities that a client receives to a sphere, they are removed on the client when they leave it
+		//	radius		:	0 or less means that the client receives every entity
+		//	Entities without transform are always sent
+		void SetClientInterest(uint32_t client, const XMFLOAT3& position, float radius);
+		// Limits the components that a client receives
+		void SetClientComponents(uint32_t client, uint32_t components);
+		// The client confirmed that it decoded a snapshot, later snapshots are encoded relative to it
+		void Acknowledge(uint32_t client, uint32_t snapshot);
+
+		// Captures the state of the replicated entities and encodes the snapshot of every client in parallel
+		//	returns the id of the new snapshot
+		uint32_t Update(const Scene& scene);
+
+		// Returns the snapshot of a client that was encoded in the last Update()
+		const wi::vector<uint8_t>& GetSnapshot(uint32_t client) const { return clients[client].data; }
+
+		struct ClientStats
+		{
+			uint32_t snapshot = 0;			// id of the last snapshot
+			uint32_t baseline = 0;			// id of the snapshot that the last snapshot was encoded relative to, 0 if it contains every entity
+			uint32_t bytes = 0;				// size of the last snapshot
+			uint32_t written_entities = 0;	// entities that were written to the last snapshot
+			uint32_t removed_entities = 0;	// entities that were removed in the last snapshot
+			float encode_time = 0;			// milliseconds spent encoding the last snapshot
+			uint64_t total_bytes = 0;		// size of all snapshots since the client was added
+		};
+		const ClientStats& GetClientStats(uint32_t client) const { return clients[client].stats; }
+		size_t GetClientCount() const { return clients.size(); }
+
+		// Milliseconds spent capturing the scene state in the last Update()
+		float GetCaptureTime() const { return capture_time; }
+
+	private:
+		struct Snapshot
+		{
+			uint32_t id = 0;
+			wi::vector<EntityState> states; // sorted by entity
+			wi::vector<XMFLOAT3> positions; // world positions for interest, same order as states
+		};
+		Snapshot history[HISTORY_SIZE]; // indexed by snapshot id % HISTORY_SIZE
+
+		struct SentSnapshot
+		{
+			uint32_t id = 0;
+			uint32_t components = COMPONENT_NONE;
+			wi::vector<uint32_t> indices; // states of the snapshot that were sent to the client
+		};
+		struct ClientState
+		{
+			bool active = false;
+			uint32_t components = COMPONENT_ALL;
+			XMFLOAT3 interest_position = XMFLOAT3(0, 0, 0);
+			float interest_radius = 0;
+			uint32_t acknowledged = 0;
+			SentSnapshot sent[HISTORY_SIZE]; // indexed by snapshot id % HISTORY_SIZE
+			wi::vector<uint8_t> data;
+			ClientStats stats;
+			wi::vector<wi::ecs::Entity> removed; // scratch lists of encode()
+			wi::vector<std::pair<const EntityState*, const EntityState*>> written; // current and baseline state
+		};
+		wi::vector<ClientState> clients;
+
+		wi::unordered_map<wi::ecs::Entity, uint32_t> replicated;
+		wi::vector<std::pair<wi::ecs::Entity, uint32_t>> replicated_sorted;
+		bool replicated_dirty = false;
+
+		Desc desc;
+		uint32_t next_id = 1;
+		float capture_time = 0;
+
+		void encode(ClientState& client, const Snapshot& snapshot) const;
+	};
+
+	class Client
+	{
+	public:
+		void Init(const Desc& desc = {});
+
+		// Associates an entity of the server with an existing entity of the client's scene, for example when both of them loaded the same model
+		//	Entities of the server that are not mapped are created in the client's scene when they first arrive
+		void MapEntity(wi::ecs::Entity server_entity, wi::ecs::Entity client_entity);
+		// Returns the client's entity of a server entity, or INVALID_ENTITY if it is not known
+		wi::ecs::Entity GetMappedEntity(wi::ecs::Entity server_entity) const;
+
+		// Decodes a snapshot and applies it to the scene, unless a newer snapshot was applied already
+		//	snapshot	:	optional, the id of the decoded snapshot is written to it, this should be acknowledged to the server
+		//	returns false if the data is invalid or the snapshot's baseline is not known
+		bool Decode(const uint8_t* data, size_t size, Scene& scene, uint32_t* snapshot = nullptr);
+
+		// Returns the id of the last snapshot that was applied to the scene
+		uint32_t GetAppliedSnapshot() const { return applied_id; }
+
+	private:
+		struct Snapshot
+		{
+			uint32_t id = 0;
+			wi::vector<EntityState> states; // sorted by entity
+		};
+		Snapshot history[HISTORY_SIZE]; // indexed by snapshot id % HISTORY_SIZE
+		wi::vector<EntityState> applied;
+		uint32_t applied_id = 0;
+
+		wi::unordered_map<wi::ecs::Entity, wi::ecs::Entity> entity_map;
+		wi::unordered_set<wi::ecs::Entity> created_entities; // removed from the scene when the server removes them
+
+		Desc desc;
+
+		void apply(Scene& scene, const EntityState& state);
+		void remove(Scene& scene, wi::ecs::Entity entity);
+	};
+}
@@ -4,6 +4,7 @@
 #include "wiEmittedParticle.h"
 #include "wiTexture_BindLua.h"
 #include "wiPrimitive_BindLua.h"
+#include "wiPhysics.h"
 
 using namespace wi::ecs;
 using namespace wi::scene;
@@ -244,6 +245,158 @@ int SceneIntersectCapsule(lua_State* L)
 
 	return 0;
 }
+int PhysicsRayCast(lua_State* L)
+{
+	int argc = wi::lua::SGetArgCount(L);
+	if (argc > 1)
+	{
+		Ray_BindLua* ray = Luna<Ray_BindLua>::lightcheck(L, 1);
+		if (ray != nullptr)
+		{
+			wi::physics::RayCastQuery query;
+			query.origin = ray->ray.origin;
+			query.direction = ray->ray.direction;
+			query.distance = wi::lua::SGetFloat(L, 2);
+			Scene* scene = &wi::scene::GetScene();
+			if (argc > 2)
+			{
+				int mask = wi::lua::SGetInt(L, 3);
+				query.layerMask = *reinterpret_cast<uint32_t*>(&mask);
+
+				if (argc > 3)
+				{
+					Scene_BindLua* custom_scene = Luna<Scene_BindLua>::lightcheck(L, 4);
+					if (custom_scene)
+					{
+						scene = custom_scene->scene;
+					}
+					else
+					{
+						wi::lua::SError(L, "PhysicsRayCast(Ray ray, float distance, opt uint layerMask, opt Scene scene) last argument is not of type Scene!");
+					}
+				}
+			}
+			wi::physics::QueryResult result;
+			wi::physics::RayCast(*scene, &query, &result, 1);
+			wi::lua::SSetLongLong(L, result.entity);
+			Luna<Vector_BindLua>::push(L, new Vector_BindLua(XMLoadFloat3(&result.position)));
+			Luna<Vector_BindLua>::push(L, new Vector_BindLua(XMLoadFloat3(&result.normal)));
+			wi::lua::SSetFloat(L, result.fraction);
+			return 4;
+		}
+
+		wi::lua::SError(L, "PhysicsRayCast(Ray ray, float distance, opt uint layerMask, opt Scene scene) first argument must be of Ray type!");
+	}
+	else
+	{
+		wi::lua::SError(L, "PhysicsRayCast(Ray ray, float distance, opt uint layerMask, opt Scene scene) not enough arguments!");
+	}
+
+	return 0;
+}
+int PhysicsSphereSweep(lua_State* L)
+{
+	int argc = wi::lua::SGetArgCount(L);
+	if (argc > 2)
+	{
+		Sphere_BindLua* sphere = Luna<Sphere_BindLua>::lightcheck(L, 1);
+		Vector_BindLua* direction = Luna<Vector_BindLua>::lightcheck(L, 2);
+		if (sphere != nullptr && direction != nullptr)
+		{
+			wi::physics::SphereSweepQuery query;
+			query.origin = sphere->sphere.center;
+			query.radius = sphere->sphere.radius;
+			XMStoreFloat3(&query.direction, XMVector3Normalize(XMLoadFloat4(direction)));
+			query.distance = wi::lua::SGetFloat(L, 3);
+			Scene* scene = &wi::scene::GetScene();
+			if (argc > 3)
+			{
+				int mask = wi::lua::SGetInt(L, 4);
+				query.layerMask = *reinterpret_cast<uint32_t*>(&mask);
+
+				if (argc > 4)
+				{
+					Scene_BindLua* custom_scene = Luna<Scene_BindLua>::lightcheck(L, 5);
+					if (custom_scene)
+					{
+						scene = custom_scene->scene;
+					}
+					else
+					{
+						wi::lua::SError(L, "PhysicsSphereSweep(Sphere sphere, Vector direction, float distance, opt uint layerMask, opt Scene scene) last argument is not of type Scene!");
+					}
+				}
+			}
+			wi::physics::QueryResult result;
+			wi::physics::SphereSweep(*scene, &query, &result, 1);
+			wi::lua::SSetLongLong(L, result.entity);
+			Luna<Vector_BindLua>::push(L, new Vector_BindLua(XMLoadFloat3(&result.position)));
+			Luna<Vector_BindLua>::push(L, new Vector_BindLua(XMLoadFloat3(&result.normal)));
+			wi::lua::SSetFloat(L, result.fraction);
+			return 4;
+		}
+
+		wi::lua::SError(L, "PhysicsSphereSweep(Sphere sphere, Vector direction, float distance, opt uint layerMask, opt Scene scene) first argument must be of Sphere type, second argument must be of Vector type!");
+	}
+	else
+	{
+		wi::lua::SError(L, "PhysicsSphereSweep(Sphere sphere, Vector direction, float distance, opt uint layerMask, opt Scene scene) not enough arguments!");
+	}
+
+	return 0;
+}
+int PhysicsOverlapSphere(lua_State* L)
+{
+	int argc = wi::lua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		Sphere_BindLua* sphere = Luna<Sphere_BindLua>::lightcheck(L, 1);
+		if (sphere != nullptr)
+		{
+			wi::physics::OverlapQuery query;
+			query.shape.type = wi::physics::QueryShape::Type::SPHERE;
+			query.shape.radius = sphere->sphere.radius;
+			query.position = sphere->sphere.center;
+			Scene* scene = &wi::scene::GetScene();
+			if (argc > 1)
+			{
+				int mask = wi::lua::SGetInt(L, 2);
+				query.layerMask = *reinterpret_cast<uint32_t*>(&mask);
+
+				if (argc > 2)
+				{
+					Scene_BindLua* custom_scene = Luna<Scene_BindLua>::lightcheck(L, 3);
+					if (custom_scene)
+					{
+						scene = custom_scene->scene;
+					}
+					else
+					{
+						wi::lua::SError(L, "PhysicsOverlapSphere(Sphere sphere, opt uint layerMask, opt Scene scene) last argument is not of type Scene!");
+					}
+				}
+			}
+			wi::physics::OverlapResult result;
+			wi::physics::Overlap(*scene, &query, &result, 1);
+			lua_createtable(L, (int)result.entities.size(), 0);
+			int newTable = lua_gettop(L);
+			for (size_t i = 0; i < result.entities.size(); ++i)
+			{
+				wi::lua::SSetLongLong(L, result.entities[i]);
+				lua_rawseti(L, newTable, lua_Integer(i + 1));
+			}
+			return 1;
+		}
+
+		wi::lua::SError(L, "PhysicsOverlapSphere(Sphere sphere, opt uint layerMask, opt Scene scene) first argument must be of Sphere type!");
+	}
+	else
+	{
+		wi::lua::SError(L, "PhysicsOverlapSphere(Sphere sphere, opt uint layerMask, opt Scene scene) not enough arguments!");
+	}
+
+	return 0;
+}
 
 void Bind()
 {
@@ -277,6 +430,9 @@ void Bind()
 		wi::lua::RegisterFunc("Pick", Pick);
 		wi::lua::RegisterFunc("SceneIntersectSphere", SceneIntersectSphere);
 		wi::lua::RegisterFunc("SceneIntersectCapsule", SceneIntersectCapsule);
+		wi::lua::RegisterFunc("PhysicsRayCast", PhysicsRayCast);
+		wi::lua::RegisterFunc("PhysicsSphereSweep", PhysicsSphereSweep);
+		wi::lua::RegisterFunc("PhysicsOverlapSphere", PhysicsOverlapSphere);
 
 		Luna<Scene_BindLua>::Register(L);
 		Luna<NameComponent_BindLua>::Register(L);
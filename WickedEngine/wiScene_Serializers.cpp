@@ -404,6 +404,29 @@ namespace wi::scene
 			    }
 			}
 
+			if (archive.GetVersion() >= 75)
+			{
+				archive >> subsets_per_lod;
+			}
+
+			if (archive.GetVersion() >= 76)
+			{
+				size_t meshletCount;
+				archive >> meshletCount;
+				meshlets.resize(meshletCount);
+				for (size_t i = 0; i < meshletCount; ++i)
+				{
+					archive >> meshlets[i].subsetIndex;
+					archive >> meshlets[i].indexOffset;
+					archive >> meshlets[i].indexCount;
+					archive >> meshlets[i].center;
+					archive >> meshlets[i].radius;
+					archive >> meshlets[i].cone_apex;
+					archive >> meshlets[i].cone_axis;
+					archive >> meshlets[i].cone_cutoff;
+				}
+			}
+
 			wi::jobsystem::Execute(seri.ctx, [&](wi::jobsystem::JobArgs args) {
 				CreateRenderData();
 			});
@@ -464,6 +487,27 @@ namespace wi::scene
 			    }
 			}
 
+			if (archive.GetVersion() >= 75)
+			{
+				archive << subsets_per_lod;
+			}
+
+			if (archive.GetVersion() >= 76)
+			{
+				archive << meshlets.size();
+				for (size_t i = 0; i < meshlets.size(); ++i)
+				{
+					archive << meshlets[i].subsetIndex;
+					archive << meshlets[i].indexOffset;
+					archive << meshlets[i].indexCount;
+					archive << meshlets[i].center;
+					archive << meshlets[i].radius;
+					archive << meshlets[i].cone_apex;
+					archive << meshlets[i].cone_axis;
+					archive << meshlets[i].cone_cutoff;
+				}
+			}
+
 		}
 	}
 	void ImpostorComponent::Serialize(wi::Archive& archive, EntitySerializer& seri)